@@ -0,0 +1,669 @@
+//
+//  esbench.cpp
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  Microbenchmarks of the ESTransform, ESShapes and TGA paths, swept over
+//  batch sizes. Built by the CMake build only; the bench target runs
+//  everything and writes esbench.json, any Google Benchmark flag works too:
+//
+//  esbench --benchmark_filter=Matrix --benchmark_format=json
+//
+
+#include "ESUtil.h"
+#include "ESImage.h"
+#include "ESQuaternion.h"
+#include "ESMatrix.hpp"
+#include "ESProfile.h"
+#include "ESGLTrace.h"
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // matrices per iteration of the transform benchmarks
+    void BatchSizes( benchmark::internal::Benchmark *b )
+    {
+        b->RangeMultiplier( 8 )->Range( 1, 4096 );
+    }
+    
+    // distinct, well conditioned inputs so nothing folds away
+    std::vector< ESMatrix > MakeMatrices( int count )
+    {
+        std::vector< ESMatrix > matrices( count );
+        
+        for( int i = 0; i < count; i++ )
+        {
+            esMatrixLoadIdentity( &matrices[i] );
+            esTranslate( &matrices[i], ( float ) i, ( float ) ( i % 7 ), -5.0f );
+            esRotate( &matrices[i], ( float ) ( i % 360 ), 0.3f, 1.0f, 0.2f );
+        }
+        
+        return matrices;
+    }
+    
+    void BM_MatrixMultiply( benchmark::State &state )
+    {
+        const int count = ( int ) state.range( 0 );
+        std::vector< ESMatrix > a = MakeMatrices( count );
+        std::vector< ESMatrix > result( count );
+        ESMatrix b;
+        
+        esMatrixLoadIdentity( &b );
+        esPerspective( &b, 60.0f, 1.5f, 1.0f, 20.0f );
+        
+        for( auto _ : state )
+        {
+            for( int i = 0; i < count; i++ )
+            {
+                esMatrixMultiply( &result[i], &a[i], &b );
+            }
+            
+            benchmark::DoNotOptimize( result.data() );
+            benchmark::ClobberMemory();
+        }
+        
+        state.SetItemsProcessed( state.iterations() * count );
+    }
+    BENCHMARK( BM_MatrixMultiply )->Apply( BatchSizes );
+    
+    void BM_MatrixMultiplyBatch( benchmark::State &state )
+    {
+        const int count = ( int ) state.range( 0 );
+        std::vector< ESMatrix > a = MakeMatrices( count );
+        std::vector< ESMatrix > result( count );
+        ESMatrix b;
+        
+        esMatrixLoadIdentity( &b );
+        esPerspective( &b, 60.0f, 1.5f, 1.0f, 20.0f );
+        
+        for( auto _ : state )
+        {
+            esMatrixMultiplyBatch( result.data(), a.data(), &b, count );
+            benchmark::DoNotOptimize( result.data() );
+            benchmark::ClobberMemory();
+        }
+        
+        state.SetItemsProcessed( state.iterations() * count );
+        state.SetLabel( esMatrixImplName() );
+    }
+    BENCHMARK( BM_MatrixMultiplyBatch )->Apply( BatchSizes );
+    
+    // M * V * P through the C++ header, one fused expression per matrix
+    void BM_MatrixExpression( benchmark::State &state )
+    {
+        const int count = ( int ) state.range( 0 );
+        std::vector< ESMatrix > a = MakeMatrices( count );
+        std::vector< es::Matrix > result( count );
+        const es::Matrix view = es::translation( 0.0f, 0.0f, -5.0f );
+        const es::Matrix projection = es::perspective( 60.0f, 1.5f, 1.0f, 20.0f );
+        
+        for( auto _ : state )
+        {
+            for( int i = 0; i < count; i++ )
+            {
+                result[i] = es::Matrix( a[i] ) * view * projection;
+            }
+            
+            benchmark::DoNotOptimize( result.data() );
+            benchmark::ClobberMemory();
+        }
+        
+        state.SetItemsProcessed( state.iterations() * count );
+    }
+    BENCHMARK( BM_MatrixExpression )->Apply( BatchSizes );
+    
+    void BM_Rotate( benchmark::State &state )
+    {
+        const int count = ( int ) state.range( 0 );
+        std::vector< ESMatrix > matrices = MakeMatrices( count );
+        
+        for( auto _ : state )
+        {
+            for( int i = 0; i < count; i++ )
+            {
+                esRotate( &matrices[i], 1.0f, 0.0f, 1.0f, 0.0f );
+            }
+            
+            benchmark::DoNotOptimize( matrices.data() );
+            benchmark::ClobberMemory();
+        }
+        
+        state.SetItemsProcessed( state.iterations() * count );
+    }
+    BENCHMARK( BM_Rotate )->Apply( BatchSizes );
+    
+    void BM_Translate( benchmark::State &state )
+    {
+        const int count = ( int ) state.range( 0 );
+        std::vector< ESMatrix > matrices = MakeMatrices( count );
+        
+        for( auto _ : state )
+        {
+            for( int i = 0; i < count; i++ )
+            {
+                esTranslate( &matrices[i], 0.001f, -0.001f, 0.0f );
+            }
+            
+            benchmark::DoNotOptimize( matrices.data() );
+            benchmark::ClobberMemory();
+        }
+        
+        state.SetItemsProcessed( state.iterations() * count );
+    }
+    BENCHMARK( BM_Translate )->Apply( BatchSizes );
+    
+    void BM_Perspective( benchmark::State &state )
+    {
+        const int count = ( int ) state.range( 0 );
+        std::vector< ESMatrix > matrices( count );
+        
+        for( auto _ : state )
+        {
+            for( int i = 0; i < count; i++ )
+            {
+                esMatrixLoadIdentity( &matrices[i] );
+                esPerspective( &matrices[i], 60.0f, 1.0f + ( float ) ( i & 3 ), 1.0f, 20.0f );
+            }
+            
+            benchmark::DoNotOptimize( matrices.data() );
+            benchmark::ClobberMemory();
+        }
+        
+        state.SetItemsProcessed( state.iterations() * count );
+    }
+    BENCHMARK( BM_Perspective )->Apply( BatchSizes );
+    
+    // the scene graph path: unit quaternion plus translation straight to a matrix, four at a time
+    void BM_MatrixFromTRSBatch( benchmark::State &state )
+    {
+        const int count = ( int ) state.range( 0 );
+        std::vector< GLfloat > position( count, 1.0f );
+        std::vector< GLfloat > zero( count, 0.0f );
+        std::vector< GLfloat > rotationY( count, 0.0f );
+        std::vector< GLfloat > rotationW( count, 1.0f );
+        std::vector< ESMatrix > result( count );
+        ESTRSArrays trs = {};
+        
+        for( int i = 0; i < count; i++ )
+        {
+            ESQuaternion q;
+            
+            esQuaternionFromAxisAngle( &q, ( float ) ( i % 360 ), 0.0f, 1.0f, 0.0f );
+            rotationY[i] = q.y;
+            rotationW[i] = q.w;
+        }
+        
+        trs.positionX = position.data();
+        trs.positionY = position.data();
+        trs.positionZ = position.data();
+        trs.rotationX = zero.data();
+        trs.rotationY = rotationY.data();
+        trs.rotationZ = zero.data();
+        trs.rotationW = rotationW.data();
+        
+        for( auto _ : state )
+        {
+            esMatrixFromTRSBatch( result.data(), &trs, NULL, count );
+            benchmark::DoNotOptimize( result.data() );
+            benchmark::ClobberMemory();
+        }
+        
+        state.SetItemsProcessed( state.iterations() * count );
+    }
+    BENCHMARK( BM_MatrixFromTRSBatch )->Apply( BatchSizes );
+    
+    // an empty zone, idle ( 0 ) and capturing ( 1 ). Without ES_PROFILE both measure an empty loop
+    void BM_ProfileZone( benchmark::State &state )
+    {
+        if( state.range( 0 ) )
+        {
+            esProfileStart();
+        }
+        
+        for( auto _ : state )
+        {
+            ES_PROFILE_ZONE( "BM_ProfileZone" );
+            
+            benchmark::ClobberMemory();
+        }
+        
+        esProfileStop();
+        esProfileReset();
+    }
+    BENCHMARK( BM_ProfileZone )->Arg( 0 )->Arg( 1 )->ArgName( "capturing" );
+    
+    // a frame of range( 0 ) bind + draw pairs through the counting wrappers into the stub GL,
+    // i.e. what ES_GL_TRACE adds per call on top of the driver
+    void BM_GLTraceFrame( benchmark::State &state )
+    {
+        const int draws = static_cast<int>( state.range( 0 ) );
+        ESGLCounters counters;
+        
+        esGLSetBackend( esGLStubBackend() );
+        
+        for( auto _ : state )
+        {
+            for( int i = 0; i < draws; i++ )
+            {
+                esGLBindVertexArray( static_cast<GLuint>( i + 1 ) );
+                esGLDrawElementsInstanced( GL_TRIANGLES, 36, GL_UNSIGNED_SHORT, nullptr, 4 );
+            }
+            
+            esGLEndFrame();
+        }
+        
+        esGLGetFrameCounters( &counters );
+        esGLSetBackend( nullptr );
+        
+        state.counters["drawCalls"]    = counters.drawCalls;
+        state.counters["stateChanges"] = counters.stateChanges;
+        state.SetItemsProcessed( state.iterations() * draws * 2 );
+    }
+    BENCHMARK( BM_GLTraceFrame )->RangeMultiplier( 10 )->Range( 10, 1000 );
+    
+    // count cubes per iteration, allocation and free included as callers see it
+    void BM_GenCube( benchmark::State &state )
+    {
+        const int count = ( int ) state.range( 0 );
+        
+        for( auto _ : state )
+        {
+            for( int i = 0; i < count; i++ )
+            {
+                GLfloat *vertices;
+                GLfloat *normals;
+                GLfloat *texCoords;
+                GLuint *indices;
+                
+                benchmark::DoNotOptimize( esGenCube( 1.0f, &vertices, &normals, &texCoords, &indices ) );
+                free( vertices );
+                free( normals );
+                free( texCoords );
+                free( indices );
+            }
+        }
+        
+        state.SetItemsProcessed( state.iterations() * count );
+    }
+    BENCHMARK( BM_GenCube )->RangeMultiplier( 8 )->Range( 1, 512 );
+    
+    void BM_GenSphere( benchmark::State &state )
+    {
+        const int numSlices = ( int ) state.range( 0 );
+        int numVertices;
+        int numIndices;
+        
+        esGenSphereSize( numSlices, &numVertices, &numIndices );
+        
+        for( auto _ : state )
+        {
+            GLfloat *vertices;
+            GLfloat *normals;
+            GLfloat *texCoords;
+            GLuint *indices;
+            
+            benchmark::DoNotOptimize( esGenSphere( numSlices, 1.0f, &vertices, &normals, &texCoords, &indices ) );
+            free( vertices );
+            free( normals );
+            free( texCoords );
+            free( indices );
+        }
+        
+        state.SetItemsProcessed( state.iterations() * numVertices );
+    }
+    BENCHMARK( BM_GenSphere )->RangeMultiplier( 4 )->Range( 16, 1024 );
+    
+    void BM_GenSquareGrid( benchmark::State &state )
+    {
+        const int size = ( int ) state.range( 0 );
+        
+        for( auto _ : state )
+        {
+            GLfloat *vertices;
+            GLuint *indices;
+            
+            benchmark::DoNotOptimize( esGenSquareGrid( size, &vertices, &indices ) );
+            free( vertices );
+            free( indices );
+        }
+        
+        state.SetItemsProcessed( state.iterations() * size * size );
+    }
+    BENCHMARK( BM_GenSquareGrid )->RangeMultiplier( 4 )->Range( 16, 1024 );
+    
+    // Test images, written once to the temp directory and removed at exit
+    struct TGAFile
+    {
+        std::string path;
+        size_t pixelBytes;
+    };
+    
+    const int kTGATrueColor = 0;
+    const int kTGATrueColorAlpha = 1;
+    const int kTGARLE = 2;
+    const char *const kTGANames[] = { "bgr24", "bgra32", "rle24" };
+    
+    std::vector< std::string > tgaFiles;
+    
+    void RemoveTGAFiles( void )
+    {
+        for( const std::string &path : tgaFiles )
+        {
+            std::remove( path.c_str() );
+        }
+    }
+    
+    void PutPixel( std::vector< unsigned char > &out, int x, int y, int channels )
+    {
+        out.push_back( ( unsigned char ) x );
+        out.push_back( ( unsigned char ) y );
+        out.push_back( ( unsigned char ) ( x ^ y ) );
+        
+        if( channels == 4 )
+        {
+            out.push_back( 255 );
+        }
+    }
+    
+    // size x size, bottom-up. The RLE image alternates 32 pixel raw and run packets
+    const TGAFile &GetTGAFile( int kind, int size )
+    {
+        static std::map< std::pair< int, int >, TGAFile > cache;
+        const int channels = kind == kTGATrueColorAlpha ? 4 : 3;
+        std::vector< unsigned char > file( 18, 0 );
+        FILE *fp;
+        TGAFile tga;
+        
+        auto found = cache.find( { kind, size } );
+        
+        if( found != cache.end() )
+        {
+            return found->second;
+        }
+        
+        file[2]  = kind == kTGARLE ? ES_TGA_RLE_TRUECOLOR : ES_TGA_TRUECOLOR;
+        file[12] = ( unsigned char ) ( size & 0xff );
+        file[13] = ( unsigned char ) ( size >> 8 );
+        file[14] = ( unsigned char ) ( size & 0xff );
+        file[15] = ( unsigned char ) ( size >> 8 );
+        file[16] = ( unsigned char ) ( channels * 8 );
+        file[17] = channels == 4 ? 8 : 0;
+        
+        for( int y = 0; y < size; y++ )
+        {
+            for( int x = 0; x < size; x += 32 )
+            {
+                if( kind != kTGARLE )
+                {
+                    for( int i = 0; i < 32 && x + i < size; i++ )
+                    {
+                        PutPixel( file, x + i, y, channels );
+                    }
+                }
+                else if( ( x / 32 ) & 1 )
+                {
+                    file.push_back( 0x80 | 31 );
+                    PutPixel( file, x, y, channels );
+                }
+                else
+                {
+                    file.push_back( 31 );
+                    
+                    for( int i = 0; i < 32; i++ )
+                    {
+                        PutPixel( file, x + i, y, channels );
+                    }
+                }
+            }
+        }
+        
+        tga.path = ( std::filesystem::temp_directory_path() /
+                     ( "esbench_" + std::string( kTGANames[kind] ) + "_" + std::to_string( size ) + ".tga" ) ).string();
+        tga.pixelBytes = ( size_t ) size * size * channels;
+        
+        fp = std::fopen( tga.path.c_str(), "wb" );
+        
+        if( fp == NULL || std::fwrite( file.data(), file.size(), 1, fp ) != 1 )
+        {
+            std::fprintf( stderr, "esbench: cannot write %s\n", tga.path.c_str() );
+            std::exit( 1 );
+        }
+        
+        std::fclose( fp );
+        
+        if( tgaFiles.empty() )
+        {
+            std::atexit( RemoveTGAFiles );
+        }
+        
+        tgaFiles.push_back( tga.path );
+        return cache[{ kind, size }] = tga;
+    }
+    
+    void TGASizes( benchmark::internal::Benchmark *b )
+    {
+        for( int kind = kTGATrueColor; kind <= kTGARLE; kind++ )
+        {
+            for( int size = 64; size <= 1024; size *= 4 )
+            {
+                b->Args( { kind, size } );
+            }
+        }
+        
+        b->ArgNames( { "kind", "size" } );
+    }
+    
+    // decode only, into a buffer reused across iterations
+    void BM_ImageDecodeTGA( benchmark::State &state )
+    {
+        const TGAFile &tga = GetTGAFile( ( int ) state.range( 0 ), ( int ) state.range( 1 ) );
+        ESImage image;
+        
+        if( !esImageOpenTGA( &image, tga.path.c_str() ) )
+        {
+            state.SkipWithError( "esImageOpenTGA failed" );
+            return;
+        }
+        
+        std::vector< unsigned char > pixels( esImageDecodedSize( &image ) );
+        
+        for( auto _ : state )
+        {
+            benchmark::DoNotOptimize( esImageDecode( &image, pixels.data() ) );
+            benchmark::ClobberMemory();
+        }
+        
+        esImageClose( &image );
+        
+        state.SetBytesProcessed( state.iterations() * tga.pixelBytes );
+        state.SetLabel( kTGANames[state.range( 0 )] );
+    }
+    BENCHMARK( BM_ImageDecodeTGA )->Apply( TGASizes );
+    
+    // the whole esLoadTGA call: map, parse, allocate, decode
+    void BM_LoadTGA( benchmark::State &state )
+    {
+        const TGAFile &tga = GetTGAFile( ( int ) state.range( 0 ), ( int ) state.range( 1 ) );
+        
+        for( auto _ : state )
+        {
+            int width;
+            int height;
+            char *pixels = esLoadTGA( NULL, tga.path.c_str(), &width, &height );
+            
+            if( pixels == NULL )
+            {
+                state.SkipWithError( "esLoadTGA failed" );
+                break;
+            }
+            
+            benchmark::DoNotOptimize( pixels );
+            free( pixels );
+        }
+        
+        state.SetBytesProcessed( state.iterations() * tga.pixelBytes );
+        state.SetLabel( kTGANames[state.range( 0 )] );
+    }
+    BENCHMARK( BM_LoadTGA )->Apply( TGASizes );
+    
+    // One headless context for the whole run, NULL when EGL has none to offer
+    ESContext *GetHeadlessContext( void )
+    {
+        static ESContext esContext;
+        static int created = -1;
+        
+        if( created < 0 )
+        {
+            created = esCreateWindow( &esContext, "esbench", 1024, 1024,
+                                      ES_WINDOW_RGB | ES_WINDOW_DEPTH | ES_WINDOW_HEADLESS ) ? 1 : 0;
+        }
+        
+        return created ? &esContext : NULL;
+    }
+    
+    // clear, then wait for the driver, i.e. the fixed cost of a frame on the offscreen surface
+    void BM_HeadlessClear( benchmark::State &state )
+    {
+        const int size = ( int ) state.range( 0 );
+        ESContext *esContext = GetHeadlessContext();
+        
+        if( esContext == NULL )
+        {
+            state.SkipWithError( "no headless EGL context" );
+            return;
+        }
+        
+        glViewport( 0, 0, size, size );
+        glEnable( GL_SCISSOR_TEST );
+        glScissor( 0, 0, size, size );
+        // the first clear pays for llvmpipe's shader JIT
+        glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+        glFinish();
+        
+        for( auto _ : state )
+        {
+            glClearColor( 0.0f, 0.0f, ( float ) ( state.iterations() & 1 ), 1.0f );
+            glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+            glFinish();
+        }
+        
+        glDisable( GL_SCISSOR_TEST );
+        
+        state.SetItemsProcessed( state.iterations() );
+        state.SetLabel( ( const char * ) glGetString( GL_RENDERER ) );
+    }
+    BENCHMARK( BM_HeadlessClear )->RangeMultiplier( 4 )->Range( 64, 1024 )->UseRealTime();
+    
+    void ESCALLBACK RunFramesUpdate( ESContext *esContext, float deltaTime )
+    {
+        ( void ) esContext;
+        benchmark::DoNotOptimize( deltaTime );
+    }
+    
+    void ESCALLBACK RunFramesDraw( ESContext *esContext )
+    {
+        ( void ) esContext;
+        glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+    }
+    
+    // esRunFrames with near empty callbacks: the loop, swap and driver overhead of a frame
+    void BM_RunFrames( benchmark::State &state )
+    {
+        const int numFrames = ( int ) state.range( 0 );
+        ESContext *esContext = GetHeadlessContext();
+        ESFrameStats stats;
+        
+        if( esContext == NULL )
+        {
+            state.SkipWithError( "no headless EGL context" );
+            return;
+        }
+        
+        esRegisterUpdateFunc( esContext, RunFramesUpdate );
+        esRegisterDrawFunc( esContext, RunFramesDraw );
+        esSetFixedTimestep( esContext, 1.0f / 120.0f );
+        
+        for( auto _ : state )
+        {
+            esRunFrames( esContext, numFrames );
+        }
+        
+        esGetFrameStats( esContext, &stats );
+        esRegisterUpdateFunc( esContext, NULL );
+        esRegisterDrawFunc( esContext, NULL );
+        
+        state.SetItemsProcessed( state.iterations() * numFrames );
+        state.counters["p99_ms"] = stats.p99Ms;
+    }
+    BENCHMARK( BM_RunFrames )->Arg( 100 )->UseRealTime();
+    
+    // CPU time each side of a pipelined frame burns, the same for both so the ideal overlap is 2x
+    const unsigned long long kPipelineWorkNs = 100000;
+    
+    void SpinNs( unsigned long long ns )
+    {
+        unsigned long long end = esGetTimeNs() + ns;
+        
+        while( esGetTimeNs() < end )
+        {
+        }
+    }
+    
+    void ESCALLBACK PipelineUpdate( ESContext *esContext, float deltaTime )
+    {
+        float *position = ( float * ) esUpdateSnapshot( esContext );
+        
+        *position += deltaTime;
+        SpinNs( kPipelineWorkNs );
+    }
+    
+    void ESCALLBACK PipelineDraw( ESContext *esContext )
+    {
+        const float *position = ( const float * ) esDrawSnapshot( esContext );
+        
+        benchmark::DoNotOptimize( *position );
+        SpinNs( kPipelineWorkNs );
+    }
+    
+    // equal update and draw cost, serial ( 0 ) against the update thread ( 1 ). Needs two free cores to overlap
+    void BM_PipelinedFrames( benchmark::State &state )
+    {
+        const int numFrames = 50;
+        ESContext *esContext = GetHeadlessContext();
+        
+        if( esContext == NULL )
+        {
+            state.SkipWithError( "no headless EGL context" );
+            return;
+        }
+        
+        esRegisterUpdateFunc( esContext, PipelineUpdate );
+        esRegisterDrawFunc( esContext, PipelineDraw );
+        esSetFixedTimestep( esContext, 0.0f );
+        esSetSnapshotSize( esContext, sizeof( float ) );
+        esSetPipelined( esContext, state.range( 0 ) ? GL_TRUE : GL_FALSE );
+        
+        for( auto _ : state )
+        {
+            esRunFrames( esContext, numFrames );
+        }
+        
+        esSetPipelined( esContext, GL_FALSE );
+        esSetSnapshotSize( esContext, 0 );
+        esRegisterUpdateFunc( esContext, NULL );
+        esRegisterDrawFunc( esContext, NULL );
+        
+        state.SetItemsProcessed( state.iterations() * numFrames );
+    }
+    BENCHMARK( BM_PipelinedFrames )->Arg( 0 )->Arg( 1 )->ArgName( "pipelined" )->UseRealTime();
+}
+
+BENCHMARK_MAIN();
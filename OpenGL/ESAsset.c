@@ -0,0 +1,545 @@
+//
+//  ESAsset.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  Asset streaming. File I/O and decoding run as jobs on the worker threads;
+//  finished assets go through a bounded lock-free queue to the render thread,
+//  which creates the GL objects within a per-frame time budget and stages
+//  texture data through a pixel unpack ring so the copy to the GPU is async.
+//
+
+#include "ESAsset.h"
+#include "ESImage.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Types
+typedef struct
+{
+    ESAssetStreamer   *streamer;
+    ESAsset           *asset;
+    // buffers
+    ESAssetProduceFunc produce;
+    void              *arg;
+    GLenum             usage;
+    // textures, NUL terminated
+    char               fileName[1];
+} ESAssetRequest;
+
+static const ESAssetGL assetGL =
+{
+    glGenTextures,
+    glTexImage2D,
+    glTexParameteri,
+    glPixelStorei,
+    glGenBuffers,
+    glBindBuffer,
+    glBufferData,
+};
+
+static const ESAssetGL *assetBackend = &assetGL;
+
+// esAssetSetBackend()
+void ESUTIL_API esAssetSetBackend( const ESAssetGL *backend )
+{
+    assetBackend = backend != NULL ? backend : &assetGL;
+}
+
+//
+// Upload queue, a bounded MPMC queue after Dmitry Vyukov. Every cell carries a
+// sequence number telling producers and consumers whose turn it is, so the only
+// shared writes are one CAS on the position and one store to the cell
+//
+
+static GLboolean esAssetEnqueue( ESAssetStreamer *streamer, const ESAssetUpload *upload )
+{
+    unsigned int pos = __atomic_load_n( &streamer->enqueuePos, __ATOMIC_RELAXED );
+    
+    for( ;; )
+    {
+        ESAssetCell *cell = &streamer->cells[ pos & ( ES_ASSET_QUEUE_SIZE - 1 ) ];
+        int diff = ( int ) ( __atomic_load_n( &cell->sequence, __ATOMIC_ACQUIRE ) - pos );
+        
+        if( diff == 0 )
+        {
+            // a failed CAS reloads pos
+            if( __atomic_compare_exchange_n( &streamer->enqueuePos, &pos, pos + 1, GL_TRUE,
+                                             __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+            {
+                cell->upload = *upload;
+                __atomic_store_n( &cell->sequence, pos + 1, __ATOMIC_RELEASE );
+                return GL_TRUE;
+            }
+        }
+        else if( diff < 0 )
+        {
+            // full
+            return GL_FALSE;
+        }
+        else
+        {
+            pos = __atomic_load_n( &streamer->enqueuePos, __ATOMIC_RELAXED );
+        }
+    }
+}
+
+static GLboolean esAssetDequeue( ESAssetStreamer *streamer, ESAssetUpload *upload )
+{
+    unsigned int pos = __atomic_load_n( &streamer->dequeuePos, __ATOMIC_RELAXED );
+    
+    for( ;; )
+    {
+        ESAssetCell *cell = &streamer->cells[ pos & ( ES_ASSET_QUEUE_SIZE - 1 ) ];
+        int diff = ( int ) ( __atomic_load_n( &cell->sequence, __ATOMIC_ACQUIRE ) - ( pos + 1 ) );
+        
+        if( diff == 0 )
+        {
+            if( __atomic_compare_exchange_n( &streamer->dequeuePos, &pos, pos + 1, GL_TRUE,
+                                             __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+            {
+                *upload = cell->upload;
+                // free the cell for the producer one lap ahead
+                __atomic_store_n( &cell->sequence, pos + ES_ASSET_QUEUE_SIZE, __ATOMIC_RELEASE );
+                return GL_TRUE;
+            }
+        }
+        else if( diff < 0 )
+        {
+            // empty
+            return GL_FALSE;
+        }
+        else
+        {
+            pos = __atomic_load_n( &streamer->dequeuePos, __ATOMIC_RELAXED );
+        }
+    }
+}
+
+static void esAssetFinish( ESAssetStreamer *streamer, ESAsset *asset, ESAssetState state )
+{
+    // publishes name/width/height/size together with the state
+    __atomic_store_n( &asset->state, state, __ATOMIC_RELEASE );
+    __atomic_sub_fetch( &streamer->pending, 1, __ATOMIC_RELAXED );
+}
+
+// hand a decoded asset to the render thread, frees the data if that is impossible.
+// Never waits: the render thread runs load jobs itself while it helps in esJobWait
+// or when a worker deque is full, and it is the only one draining the queue
+static void esAssetPost( ESAssetStreamer *streamer, const ESAssetUpload *upload )
+{
+    ESAssetOverflow *node;
+    
+    if( __atomic_load_n( &streamer->closing, __ATOMIC_ACQUIRE ) )
+    {
+        free( upload->data );
+        esAssetFinish( streamer, upload->asset, ES_ASSET_FAILED );
+        return;
+    }
+    
+    if( esAssetEnqueue( streamer, upload ) )
+    {
+        return;
+    }
+    
+    node = malloc( sizeof( ESAssetOverflow ) );
+    
+    if( node == NULL )
+    {
+        esLogMessage( " esAssetPost: upload queue full\n " );
+        free( upload->data );
+        esAssetFinish( streamer, upload->asset, ES_ASSET_FAILED );
+        return;
+    }
+    
+    node->upload = *upload;
+    node->next   = __atomic_load_n( &streamer->overflow, __ATOMIC_RELAXED );
+    
+    // a failed CAS reloads node->next
+    while( !__atomic_compare_exchange_n( &streamer->overflow, &node->next, node, GL_TRUE,
+                                         __ATOMIC_RELEASE, __ATOMIC_RELAXED ) )
+    {
+    }
+    
+    __atomic_add_fetch( &streamer->numOverflows, 1, __ATOMIC_RELAXED );
+}
+
+// render thread: the held upload first, then the queue, then the overflow list
+static GLboolean esAssetNext( ESAssetStreamer *streamer, ESAssetUpload *upload )
+{
+    ESAssetOverflow *node;
+    
+    if( streamer->hasHeld )
+    {
+        *upload = streamer->held;
+        streamer->hasHeld = GL_FALSE;
+        return GL_TRUE;
+    }
+    
+    if( esAssetDequeue( streamer, upload ) )
+    {
+        return GL_TRUE;
+    }
+    
+    if( streamer->overflowTaken == NULL )
+    {
+        // the list is newest first, reverse it into posting order
+        node = __atomic_exchange_n( &streamer->overflow, NULL, __ATOMIC_ACQUIRE );
+        
+        while( node != NULL )
+        {
+            ESAssetOverflow *next = node->next;
+            
+            node->next = streamer->overflowTaken;
+            streamer->overflowTaken = node;
+            node = next;
+        }
+    }
+    
+    node = streamer->overflowTaken;
+    
+    if( node == NULL )
+    {
+        return GL_FALSE;
+    }
+    
+    streamer->overflowTaken = node->next;
+    *upload = node->upload;
+    free( node );
+    
+    return GL_TRUE;
+}
+
+// render thread: anything left for esAssetNext
+static GLboolean esAssetHasWork( ESAssetStreamer *streamer )
+{
+    return streamer->hasHeld || streamer->overflowTaken != NULL ||
+           __atomic_load_n( &streamer->overflow, __ATOMIC_RELAXED ) != NULL ||
+           __atomic_load_n( &streamer->enqueuePos, __ATOMIC_RELAXED ) != streamer->dequeuePos;
+}
+
+static void ESCALLBACK esAssetLoadTextureJob( void *arg )
+{
+    ESAssetRequest *request = ( ESAssetRequest * ) arg;
+    ESAssetUpload upload;
+    ESImage image;
+    
+    memset( &upload, 0, sizeof( ESAssetUpload ) );
+    
+    if( !esImageOpenTGA( &image, request->fileName ) )
+    {
+        esAssetFinish( request->streamer, request->asset, ES_ASSET_FAILED );
+        free( request );
+        return;
+    }
+    
+    upload.asset  = request->asset;
+    upload.target = GL_TEXTURE_2D;
+    upload.size   = ( GLsizeiptr ) esImageDecodedSize( &image );
+    upload.data   = malloc( upload.size );
+    
+    switch( image.channels )
+    {
+        case 1:
+            upload.format         = GL_RED;
+            upload.internalFormat = GL_R8;
+            break;
+        case 3:
+            upload.format         = GL_RGB;
+            upload.internalFormat = GL_RGB8;
+            break;
+        default:
+            upload.format         = GL_RGBA;
+            upload.internalFormat = GL_RGBA8;
+            break;
+    }
+    
+    if( upload.data == NULL || !esImageDecode( &image, upload.data ) )
+    {
+        esLogMessage( " esAssetLoadTexture FAILED to decode : { %s }\n ", request->fileName );
+        free( upload.data );
+        esImageClose( &image );
+        esAssetFinish( request->streamer, request->asset, ES_ASSET_FAILED );
+        free( request );
+        return;
+    }
+    
+    request->asset->width  = image.width;
+    request->asset->height = image.height;
+    esImageClose( &image );
+    
+    esAssetPost( request->streamer, &upload );
+    free( request );
+}
+
+static void ESCALLBACK esAssetLoadBufferJob( void *arg )
+{
+    ESAssetRequest *request = ( ESAssetRequest * ) arg;
+    ESAssetUpload upload;
+    
+    memset( &upload, 0, sizeof( ESAssetUpload ) );
+    upload.asset  = request->asset;
+    upload.target = request->asset->target;
+    upload.format = request->usage;
+    
+    if( !request->produce( request->arg, &upload.data, &upload.size ) || upload.data == NULL )
+    {
+        esAssetFinish( request->streamer, request->asset, ES_ASSET_FAILED );
+        free( request );
+        return;
+    }
+    
+    request->asset->size = upload.size;
+    
+    esAssetPost( request->streamer, &upload );
+    free( request );
+}
+
+// esAssetStreamerInit()
+GLboolean ESUTIL_API esAssetStreamerInit( ESAssetStreamer *streamer, GLsizeiptr stagingSize )
+{
+    unsigned int i;
+    
+    memset( streamer, 0, sizeof( ESAssetStreamer ) );
+    streamer->gl = assetBackend;
+    
+    for( i = 0; i < ES_ASSET_QUEUE_SIZE; i++ )
+    {
+        streamer->cells[i].sequence = i;
+    }
+    
+    if( !esRingBufferInit( &streamer->staging, GL_PIXEL_UNPACK_BUFFER,
+                           stagingSize > 0 ? stagingSize : ES_ASSET_DEFAULT_STAGING, ES_RING_DEFAULT_REGIONS ) )
+    {
+        return GL_FALSE;
+    }
+    
+    // a bound unpack buffer would turn every client pointer glTexImage2D into an offset
+    streamer->gl->bindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+    
+    return GL_TRUE;
+}
+
+// esAssetStreamerDestroy()
+void ESUTIL_API esAssetStreamerDestroy( ESAssetStreamer *streamer )
+{
+    ESAssetUpload upload;
+    
+    // loads finishing from now on fail in esAssetPost instead of adding to the queue
+    __atomic_store_n( &streamer->closing, 1, __ATOMIC_RELEASE );
+    esJobWait( &streamer->loads );
+    
+    while( esAssetNext( streamer, &upload ) )
+    {
+        free( upload.data );
+        esAssetFinish( streamer, upload.asset, ES_ASSET_FAILED );
+    }
+    
+    if( streamer->staging.buffer != 0 )
+    {
+        esRingBufferDestroy( &streamer->staging );
+    }
+}
+
+static ESAssetRequest *esAssetRequestNew( ESAssetStreamer *streamer, ESAsset *asset, GLenum target, const char *fileName )
+{
+    size_t length = fileName != NULL ? strlen( fileName ) : 0;
+    ESAssetRequest *request = malloc( sizeof( ESAssetRequest ) + length );
+    
+    memset( asset, 0, sizeof( ESAsset ) );
+    asset->target = target;
+    
+    if( request == NULL )
+    {
+        asset->state = ES_ASSET_FAILED;
+        return NULL;
+    }
+    
+    memset( request, 0, sizeof( ESAssetRequest ) );
+    request->streamer = streamer;
+    request->asset    = asset;
+    memcpy( request->fileName, fileName != NULL ? fileName : "", length + 1 );
+    
+    __atomic_add_fetch( &streamer->pending, 1, __ATOMIC_RELAXED );
+    
+    return request;
+}
+
+// esAssetLoadTexture()
+void ESUTIL_API esAssetLoadTexture( ESAssetStreamer *streamer, ESAsset *asset, const char *fileName )
+{
+    ESAssetRequest *request = esAssetRequestNew( streamer, asset, GL_TEXTURE_2D, fileName );
+    
+    if( request != NULL )
+    {
+        esJobSubmit( esAssetLoadTextureJob, request, &streamer->loads );
+    }
+}
+
+// esAssetLoadBuffer()
+void ESUTIL_API esAssetLoadBuffer( ESAssetStreamer *streamer, ESAsset *asset, GLenum target, GLenum usage,
+                                   ESAssetProduceFunc produce, void *arg )
+{
+    ESAssetRequest *request = esAssetRequestNew( streamer, asset, target, NULL );
+    
+    if( request != NULL )
+    {
+        request->produce = produce;
+        request->arg     = arg;
+        request->usage   = usage;
+        esJobSubmit( esAssetLoadBufferJob, request, &streamer->loads );
+    }
+}
+
+// Create and fill the texture. Data that fits this frame's staging region is copied
+// into the unpack ring and uploaded from there, larger images go straight from memory.
+// Returns GL_FALSE, without touching GL, when the region is too full for this one
+static GLboolean esAssetUploadTexture( ESAssetStreamer *streamer, ESStateCache *cache,
+                                       const ESAssetUpload *upload, GLboolean *staged )
+{
+    const ESAssetGL *gl = streamer->gl;
+    ESRingBuffer *staging = &streamer->staging;
+    GLboolean useStaging = upload->size <= staging->regionSize;
+    const void *pixels = upload->data;
+    GLintptr offset = 0;
+    GLuint texture;
+    
+    if( useStaging && ( ( staging->head + 3 ) & ~( GLsizeiptr ) 3 ) + upload->size > staging->regionSize )
+    {
+        return GL_FALSE;
+    }
+    
+    gl->genTextures( 1, &texture );
+    esStateBindTexture( cache, 0, GL_TEXTURE_2D, texture );
+    
+    if( useStaging )
+    {
+        void *ptr = esRingBufferMap( staging, upload->size, 4, &offset );
+        
+        if( ptr != NULL )
+        {
+            memcpy( ptr, upload->data, upload->size );
+            esRingBufferUnmap( staging );
+            // the ring left its buffer bound to GL_PIXEL_UNPACK_BUFFER, pixels is an offset into it
+            pixels  = ( const void * ) offset;
+            *staged = GL_TRUE;
+        }
+        else
+        {
+            useStaging = GL_FALSE;
+        }
+    }
+    
+    // rows are tightly packed
+    gl->pixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+    gl->texImage2D( GL_TEXTURE_2D, 0, upload->internalFormat, upload->asset->width, upload->asset->height, 0,
+                    upload->format, GL_UNSIGNED_BYTE, pixels );
+    gl->pixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+    gl->texParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+    gl->texParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+    
+    if( useStaging )
+    {
+        gl->bindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+    }
+    
+    upload->asset->name = texture;
+    
+    return GL_TRUE;
+}
+
+static void esAssetUploadBuffer( ESAssetStreamer *streamer, ESStateCache *cache, const ESAssetUpload *upload )
+{
+    const ESAssetGL *gl = streamer->gl;
+    GLuint buffer;
+    
+    gl->genBuffers( 1, &buffer );
+    
+    // an element buffer binding would otherwise land in whatever VAO is bound
+    esStateBindVertexArray( cache, 0 );
+    esStateBindBuffer( cache, upload->target, buffer );
+    // the driver copies the data, it can be freed right after
+    gl->bufferData( upload->target, upload->size, upload->data, upload->format );
+    
+    upload->asset->name = buffer;
+}
+
+// esAssetPump()
+int ESUTIL_API esAssetPump( ESAssetStreamer *streamer, ESStateCache *cache, unsigned long long budgetNs )
+{
+    unsigned long long start = esGetTimeNs();
+    GLboolean staged = GL_FALSE;
+    ESAssetUpload upload;
+    int numReady = 0;
+    
+    for( ;; )
+    {
+        // Always make progress, then stop once the budget is spent
+        if( numReady > 0 && esGetTimeNs() - start >= budgetNs )
+        {
+            if( esAssetHasWork( streamer ) )
+            {
+                streamer->numDeferred++;
+            }
+            break;
+        }
+        
+        if( !esAssetNext( streamer, &upload ) )
+        {
+            break;
+        }
+        
+        if( upload.target == GL_TEXTURE_2D )
+        {
+            if( !esAssetUploadTexture( streamer, cache, &upload, &staged ) )
+            {
+                // staging region is full, retry first thing next frame
+                streamer->held    = upload;
+                streamer->hasHeld = GL_TRUE;
+                streamer->numDeferred++;
+                break;
+            }
+        }
+        else
+        {
+            esAssetUploadBuffer( streamer, cache, &upload );
+        }
+        
+        streamer->numUploads++;
+        streamer->bytesUploaded += upload.size;
+        free( upload.data );
+        
+        esAssetFinish( streamer, upload.asset, ES_ASSET_READY );
+        numReady++;
+    }
+    
+    if( staged )
+    {
+        // fence the region the GPU still copies from
+        esRingBufferEndFrame( &streamer->staging );
+    }
+    
+    return numReady;
+}
+
+// esAssetReady()
+GLboolean ESUTIL_API esAssetReady( const ESAsset *asset )
+{
+    return __atomic_load_n( &asset->state, __ATOMIC_ACQUIRE ) == ES_ASSET_READY ? GL_TRUE : GL_FALSE;
+}
+
+// esAssetPending()
+int ESUTIL_API esAssetPending( const ESAssetStreamer *streamer )
+{
+    return __atomic_load_n( &streamer->pending, __ATOMIC_RELAXED );
+}
+
+// esAssetLogStats()
+void ESUTIL_API esAssetLogStats( const ESAssetStreamer *streamer )
+{
+    esLogMessage( " assets: %u uploaded, %llu bytes, %u overflowed, %u deferred pumps, %d pending\n",
+                  streamer->numUploads, streamer->bytesUploaded, __atomic_load_n( &streamer->numOverflows, __ATOMIC_RELAXED ),
+                  streamer->numDeferred, esAssetPending( streamer ) );
+}
@@ -0,0 +1,157 @@
+//
+//  ESAsset.h
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+
+#ifndef ESAsset_h
+#define ESAsset_h
+
+#include "ESUtil.h"
+#include "ESJob.h"
+#include "ESRingBuffer.h"
+#include "ESStateCache.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// Decoded assets waiting for the render thread, a power of two.
+// Loaders never wait for the render thread, once it is full they put uploads on an overflow list
+#define ES_ASSET_QUEUE_SIZE      256
+// Staging bytes per frame for texture uploads through the pixel unpack buffer
+#define ES_ASSET_DEFAULT_STAGING ( 4 * 1024 * 1024 )
+
+typedef enum
+{
+    // requested, still loading or waiting for its upload
+    ES_ASSET_PENDING = 0,
+    // name holds the GL object
+    ES_ASSET_READY,
+    // file missing, unsupported or the producer failed
+    ES_ASSET_FAILED
+} ESAssetState;
+
+// Owned by the caller and must stay valid until the asset is no longer pending
+typedef struct
+{
+    // ESAssetState, written by the loaders and the render thread, read it with esAssetReady
+    int        state;
+    // texture or buffer object, 0 until ready
+    GLuint     name;
+    GLenum     target;
+    // textures
+    int        width;
+    int        height;
+    // buffers
+    GLsizeiptr size;
+} ESAsset;
+
+// Runs on a job worker: produce the contents of a buffer asset into a malloc'd *data of *size bytes.
+// The streamer frees data after the upload
+typedef GLboolean ( ESCALLBACK *ESAssetProduceFunc )( void *arg, void **data, GLsizeiptr *size );
+
+// GL entry points the upload pump uses, swap them out to drive the streamer without a GPU
+typedef struct
+{
+    void ( GL_APIENTRY *genTextures )( GLsizei n, GLuint *textures );
+    void ( GL_APIENTRY *texImage2D )( GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+                                      GLint border, GLenum format, GLenum type, const void *pixels );
+    void ( GL_APIENTRY *texParameteri )( GLenum target, GLenum pname, GLint param );
+    void ( GL_APIENTRY *pixelStorei )( GLenum pname, GLint param );
+    void ( GL_APIENTRY *genBuffers )( GLsizei n, GLuint *buffers );
+    void ( GL_APIENTRY *bindBuffer )( GLenum target, GLuint buffer );
+    void ( GL_APIENTRY *bufferData )( GLenum target, GLsizeiptr size, const void *data, GLenum usage );
+} ESAssetGL;
+
+// One decoded asset on its way to the render thread
+typedef struct
+{
+    ESAsset   *asset;
+    void      *data;
+    GLsizeiptr size;
+    // GL_TEXTURE_2D or a buffer target
+    GLenum     target;
+    // texture format or buffer usage
+    GLenum     format;
+    GLint      internalFormat;
+} ESAssetUpload;
+
+// Upload that found the queue full
+typedef struct ESAssetOverflow
+{
+    struct ESAssetOverflow *next;
+    ESAssetUpload           upload;
+} ESAssetOverflow;
+
+typedef struct
+{
+    // cell is free for enqueue position n when sequence == n, holds data for dequeue when sequence == n + 1
+    unsigned int  sequence;
+    ESAssetUpload upload;
+} ESAssetCell;
+
+typedef struct
+{
+    const ESAssetGL *gl;
+    
+    // Bounded lock-free MPMC queue, loaders enqueue and the render thread dequeues
+    ESAssetCell  cells[ES_ASSET_QUEUE_SIZE];
+    unsigned int enqueuePos;
+    unsigned int dequeuePos;
+    // Unbounded spill-over, loaders push and the render thread takes the whole list at once
+    ESAssetOverflow *overflow;
+    // taken from overflow in posting order, render thread only
+    ESAssetOverflow *overflowTaken;
+    // set by esAssetStreamerDestroy, loads finishing afterwards fail instead of posting
+    int              closing;
+    
+    // Pixel unpack ring the textures are staged through
+    ESRingBuffer staging;
+    // dequeued upload that did not fit in this frame's staging region
+    ESAssetUpload held;
+    GLboolean     hasHeld;
+    
+    // load jobs still running
+    ESJobCounter loads;
+    // requested and not yet ready or failed
+    int          pending;
+    
+    unsigned int numUploads;
+    unsigned long long bytesUploaded;
+    // uploads that went to the overflow list
+    unsigned int numOverflows;
+    // pumps that stopped on the time budget or a full staging region with work left
+    unsigned int numDeferred;
+} ESAssetStreamer;
+
+// install the GL entry points used by streamers created afterwards, NULL restores the real GL
+void ESUTIL_API esAssetSetBackend( const ESAssetGL *backend );
+// stagingSize bytes of texture staging per frame, <= 0 uses ES_ASSET_DEFAULT_STAGING.
+// Loads run on the job system, start it with esJobSystemInit first to load in the background
+GLboolean ESUTIL_API esAssetStreamerInit( ESAssetStreamer *streamer, GLsizeiptr stagingSize );
+// fail the loads still running, wait for them, drop everything not uploaded yet and delete the staging buffer.
+// The GL objects of ready assets belong to the caller
+void ESUTIL_API esAssetStreamerDestroy( ESAssetStreamer *streamer );
+// map and decode a TGA file on a worker, the pump uploads it as a GL_TEXTURE_2D with linear filtering
+void ESUTIL_API esAssetLoadTexture( ESAssetStreamer *streamer, ESAsset *asset, const char *fileName );
+// run produce( arg, ... ) on a worker, the pump uploads the result to a new buffer object
+void ESUTIL_API esAssetLoadBuffer( ESAssetStreamer *streamer, ESAsset *asset, GLenum target, GLenum usage,
+                                   ESAssetProduceFunc produce, void *arg );
+// render thread, once per frame: upload decoded assets until budgetNs elapsed ( at least one per call ).
+// Returns the number of assets that became ready
+int ESUTIL_API esAssetPump( ESAssetStreamer *streamer, ESStateCache *cache, unsigned long long budgetNs );
+// GL_TRUE once the asset's GL object can be used
+GLboolean ESUTIL_API esAssetReady( const ESAsset *asset );
+// assets requested and not yet ready or failed
+int ESUTIL_API esAssetPending( const ESAssetStreamer *streamer );
+// log uploads, bytes, overflows and deferred pumps
+void ESUTIL_API esAssetLogStats( const ESAssetStreamer *streamer );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESAsset_h */
@@ -0,0 +1,246 @@
+//
+//  ESBatch.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  Automatic instancing. Draws are grouped by mesh and program as they are
+//  added; the flush scatters the instances of every group next to each other
+//  in the ring buffer and draws each group with one glDrawElementsInstanced.
+//
+
+#include "ESBatch.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Bytes of instance data per draw: one MVP and one RGBA8 color
+#define BATCH_INSTANCE_SIZE ( sizeof( ESMatrix ) + 4 * sizeof( GLubyte ) )
+
+static const ESBatchGL batchGL =
+{
+    glVertexAttribPointer,
+    glDrawElementsInstanced,
+};
+
+static const ESBatchGL *batchBackend = &batchGL;
+
+// esBatchSetBackend()
+void ESUTIL_API esBatchSetBackend( const ESBatchGL *backend )
+{
+    batchBackend = backend != NULL ? backend : &batchGL;
+}
+
+static unsigned int esBatchHash( const ESBatchMesh *mesh )
+{
+    unsigned int hash = 2166136261u;
+    
+    hash = ( hash ^ mesh->program ) * 16777619u;
+    hash = ( hash ^ mesh->vertexArray ) * 16777619u;
+    hash = ( hash ^ ( unsigned int ) mesh->indexOffset ) * 16777619u;
+    hash = ( hash ^ ( unsigned int ) mesh->count ) * 16777619u;
+    
+    return hash & ( ES_BATCH_HASH_SIZE - 1 );
+}
+
+static int esBatchMeshEqual( const ESBatchMesh *a, const ESBatchMesh *b )
+{
+    return a->program == b->program && a->vertexArray == b->vertexArray &&
+           a->mode == b->mode && a->indexType == b->indexType &&
+           a->indexOffset == b->indexOffset && a->count == b->count;
+}
+
+// forget the groups and instances of the last frame
+static void esBatchClear( ESBatch *batch )
+{
+    int i;
+    
+    batch->numInstances = 0;
+    batch->numGroups    = 0;
+    
+    for( i = 0; i < ES_BATCH_HASH_SIZE; i++ )
+    {
+        batch->buckets[i] = -1;
+    }
+}
+
+// esBatchInit()
+GLboolean ESUTIL_API esBatchInit( ESBatch *batch, int maxInstances, GLuint mvpLoc, GLuint colorLoc )
+{
+    memset( batch, 0, sizeof( ESBatch ) );
+    
+    if( maxInstances < 1 )
+    {
+        return GL_FALSE;
+    }
+    
+    batch->gl           = batchBackend;
+    batch->mvpLoc       = mvpLoc;
+    batch->colorLoc     = colorLoc;
+    batch->maxInstances = maxInstances;
+    
+    // every instance may be a group of its own
+    batch->instances   = malloc( sizeof( ESBatchInstance ) * maxInstances );
+    batch->groups      = malloc( sizeof( ESBatchGroup ) * maxInstances );
+    batch->groupStarts = malloc( sizeof( int ) * maxInstances );
+    
+    if( batch->instances == NULL || batch->groups == NULL || batch->groupStarts == NULL ||
+        !esRingBufferInit( &batch->ring, GL_ARRAY_BUFFER, BATCH_INSTANCE_SIZE * maxInstances, ES_RING_DEFAULT_REGIONS ) )
+    {
+        esBatchDestroy( batch );
+        return GL_FALSE;
+    }
+    
+    esBatchClear( batch );
+    
+    return GL_TRUE;
+}
+
+// esBatchDestroy()
+void ESUTIL_API esBatchDestroy( ESBatch *batch )
+{
+    free( batch->instances );
+    free( batch->groups );
+    free( batch->groupStarts );
+    
+    if( batch->ring.buffer != 0 )
+    {
+        esRingBufferDestroy( &batch->ring );
+    }
+    
+    memset( batch, 0, sizeof( ESBatch ) );
+}
+
+// esBatchAdd()
+GLboolean ESUTIL_API esBatchAdd( ESBatch *batch, const ESBatchMesh *mesh, const ESMatrix *mvp, const GLubyte color[4] )
+{
+    unsigned int bucket = esBatchHash( mesh );
+    ESBatchInstance *instance;
+    int group;
+    
+    if( batch->numInstances == batch->maxInstances )
+    {
+        batch->numOverflows++;
+        return GL_FALSE;
+    }
+    
+    for( group = batch->buckets[bucket]; group >= 0; group = batch->groups[group].next )
+    {
+        if( esBatchMeshEqual( &batch->groups[group].mesh, mesh ) )
+        {
+            break;
+        }
+    }
+    
+    if( group < 0 )
+    {
+        group = batch->numGroups++;
+        batch->groups[group].mesh         = *mesh;
+        batch->groups[group].numInstances = 0;
+        batch->groups[group].next         = batch->buckets[bucket];
+        batch->buckets[bucket] = group;
+    }
+    
+    batch->groups[group].numInstances++;
+    
+    instance = &batch->instances[ batch->numInstances++ ];
+    instance->mvp   = *mvp;
+    instance->group = group;
+    memcpy( instance->color, color, sizeof( instance->color ) );
+    
+    return GL_TRUE;
+}
+
+// esBatchFlush()
+void ESUTIL_API esBatchFlush( ESBatch *batch, ESStateCache *cache )
+{
+    const ESBatchGL *gl = batch->gl;
+    int numInstances = batch->numInstances;
+    GLintptr mvpBase;
+    GLintptr colorBase;
+    ESMatrix *mvps;
+    GLubyte  *colors;
+    int start = 0;
+    int i;
+    
+    batch->numDrawsAdded  = numInstances;
+    batch->numDrawsIssued = batch->numGroups;
+    batch->numDrawsSaved  = numInstances - batch->numGroups;
+    
+    if( numInstances == 0 )
+    {
+        esRingBufferEndFrame( &batch->ring );
+        return;
+    }
+    
+    mvps = esRingBufferMap( &batch->ring, BATCH_INSTANCE_SIZE * numInstances, sizeof( ESMatrix ), &mvpBase );
+    
+    if( mvps == NULL )
+    {
+        esLogMessage( " esBatchFlush FAILED to map the instance buffer\n " );
+        esBatchClear( batch );
+        return;
+    }
+    
+    colors    = ( GLubyte * ) ( mvps + numInstances );
+    colorBase = mvpBase + sizeof( ESMatrix ) * numInstances;
+    
+    // Counting sort by group: instances of one group become a contiguous range
+    for( i = 0; i < batch->numGroups; i++ )
+    {
+        batch->groupStarts[i] = start;
+        start += batch->groups[i].numInstances;
+    }
+    
+    for( i = 0; i < numInstances; i++ )
+    {
+        const ESBatchInstance *instance = &batch->instances[i];
+        int slot = batch->groupStarts[ instance->group ]++;
+        
+        mvps[slot] = instance->mvp;
+        memcpy( &colors[ slot * 4 ], instance->color, 4 );
+    }
+    
+    esRingBufferUnmap( &batch->ring );
+    esStateInvalidateBinding( cache, GL_ARRAY_BUFFER );
+    
+    for( i = 0; i < batch->numGroups; i++ )
+    {
+        const ESBatchGroup *group = &batch->groups[i];
+        // groupStarts was advanced past the group by the scatter
+        GLintptr first = batch->groupStarts[i] - group->numInstances;
+        GLintptr mvpOffset = mvpBase + first * sizeof( ESMatrix );
+        int row;
+        
+        esStateUseProgram( cache, group->mesh.program );
+        esStateBindVertexArray( cache, group->mesh.vertexArray );
+        esStateBindBuffer( cache, GL_ARRAY_BUFFER, batch->ring.buffer );
+        
+        // One MVP row per attribute location, advancing once per instance
+        for( row = 0; row < 4; row++ )
+        {
+            gl->vertexAttribPointer( batch->mvpLoc + row, 4, GL_FLOAT, GL_FALSE, sizeof( ESMatrix ),
+                                     ( const void * ) ( mvpOffset + sizeof( GLfloat ) * 4 * row ) );
+            esStateEnableVertexAttribArray( cache, batch->mvpLoc + row );
+            esStateVertexAttribDivisor( cache, batch->mvpLoc + row, 1 );
+        }
+        
+        gl->vertexAttribPointer( batch->colorLoc, 4, GL_UNSIGNED_BYTE, GL_TRUE, 4 * sizeof( GLubyte ),
+                                 ( const void * ) ( colorBase + first * 4 ) );
+        esStateEnableVertexAttribArray( cache, batch->colorLoc );
+        esStateVertexAttribDivisor( cache, batch->colorLoc, 1 );
+        
+        gl->drawElementsInstanced( group->mesh.mode, group->mesh.count, group->mesh.indexType,
+                                   ( const void * ) group->mesh.indexOffset, group->numInstances );
+    }
+    
+    esRingBufferEndFrame( &batch->ring );
+    esBatchClear( batch );
+}
+
+// esBatchLogStats()
+void ESUTIL_API esBatchLogStats( const ESBatch *batch )
+{
+    esLogMessage( " batch: %u draws added, %u issued, %u saved, %u dropped\n",
+                  batch->numDrawsAdded, batch->numDrawsIssued, batch->numDrawsSaved, batch->numOverflows );
+}
@@ -0,0 +1,105 @@
+//
+//  ESBatch.h
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+
+#ifndef ESBatch_h
+#define ESBatch_h
+
+#include "ESUtil.h"
+#include "ESRingBuffer.h"
+#include "ESStateCache.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// Buckets of the mesh lookup table, a power of two
+#define ES_BATCH_HASH_SIZE 256
+
+// What a draw shares with the others in its group
+typedef struct
+{
+    GLuint   program;
+    // vertex array holding the per-vertex attributes and the element buffer
+    GLuint   vertexArray;
+    GLenum   mode;
+    GLenum   indexType;
+    // byte offset of the first index in the element buffer
+    GLintptr indexOffset;
+    GLsizei  count;
+} ESBatchMesh;
+
+// GL entry points used by the batcher, swap them out to check the emitted draws without a GPU
+typedef struct
+{
+    void ( GL_APIENTRY *vertexAttribPointer )( GLuint index, GLint size, GLenum type, GLboolean normalized,
+                                               GLsizei stride, const void *pointer );
+    void ( GL_APIENTRY *drawElementsInstanced )( GLenum mode, GLsizei count, GLenum type, const void *indices,
+                                                 GLsizei instanceCount );
+} ESBatchGL;
+
+typedef struct
+{
+    ESBatchMesh mesh;
+    int         numInstances;
+    // next group in the same hash bucket, -1 ends the chain
+    int         next;
+} ESBatchGroup;
+
+typedef struct
+{
+    ESMatrix mvp;
+    GLubyte  color[4];
+    int      group;
+} ESBatchInstance;
+
+typedef struct
+{
+    const ESBatchGL *gl;
+    
+    // Per-instance data, laid out like mvpVBO/colorVBO: all MVPs, then all colors
+    ESRingBuffer ring;
+    GLuint       mvpLoc;
+    GLuint       colorLoc;
+    
+    ESBatchInstance *instances;
+    int              numInstances;
+    int              maxInstances;
+    
+    ESBatchGroup    *groups;
+    int              numGroups;
+    int              buckets[ES_BATCH_HASH_SIZE];
+    // first instance slot of every group, filled by esBatchFlush
+    int             *groupStarts;
+    
+    // draws added, instanced draws issued and the difference, for the last flush
+    unsigned int numDrawsAdded;
+    unsigned int numDrawsIssued;
+    unsigned int numDrawsSaved;
+    // instances that did not fit, they are dropped
+    unsigned int numOverflows;
+} ESBatch;
+
+// install the GL entry points used by batches initialized afterwards, NULL restores the real GL
+void ESUTIL_API esBatchSetBackend( const ESBatchGL *backend );
+// room for maxInstances draws per frame. mvpLoc is the first of the four mat4 row attributes,
+// colorLoc a normalized unsigned byte vec4, as in the instancing shader
+GLboolean ESUTIL_API esBatchInit( ESBatch *batch, int maxInstances, GLuint mvpLoc, GLuint colorLoc );
+void ESUTIL_API esBatchDestroy( ESBatch *batch );
+// queue one draw of mesh, it joins the group of every other draw of the same mesh and program
+GLboolean ESUTIL_API esBatchAdd( ESBatch *batch, const ESBatchMesh *mesh, const ESMatrix *mvp, const GLubyte color[4] );
+// upload the instance data and issue one glDrawElementsInstanced per group.
+// Closes the frame of the instance ring, so call it once per frame
+void ESUTIL_API esBatchFlush( ESBatch *batch, ESStateCache *cache );
+// print the draw counters of the last flush with esLogMessage
+void ESUTIL_API esBatchLogStats( const ESBatch *batch );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESBatch_h */
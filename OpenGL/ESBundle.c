@@ -0,0 +1,428 @@
+//
+//  ESBundle.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  .esb asset bundles. Everything that could be decided offline already was:
+//  vertices are interleaved in their final format, indices have their final
+//  type and textures carry their whole mip chain. Loading maps the file and
+//  hands section pointers to GL as they are.
+//
+
+#include "ESBundle.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t esBundleAlign( uint64_t offset )
+{
+    return ( offset + ES_BUNDLE_ALIGNMENT - 1 ) & ~( uint64_t ) ( ES_BUNDLE_ALIGNMENT - 1 );
+}
+
+// esBundleOpen()
+GLboolean ESUTIL_API esBundleOpen( ESBundle *bundle, const char *fileName )
+{
+    const ESBundleHeader *header;
+    size_t tableEnd;
+    int i;
+    
+    memset( bundle, 0, sizeof( ESBundle ) );
+    
+    bundle->data = esMapFile( fileName, &bundle->dataSize );
+    
+    if( bundle->data == NULL )
+    {
+        esLogMessage( " esBundleOpen FAILED to open : { %s }\n ", fileName );
+        return GL_FALSE;
+    }
+    
+    header   = ( const ESBundleHeader * ) bundle->data;
+    tableEnd = sizeof( ESBundleHeader );
+    
+    if( bundle->dataSize >= sizeof( ESBundleHeader ) )
+    {
+        tableEnd += ( size_t ) header->numSections * sizeof( ESBundleSection );
+    }
+    
+    if( bundle->dataSize < sizeof( ESBundleHeader ) || header->magic != ES_BUNDLE_MAGIC ||
+        header->version != ES_BUNDLE_VERSION || header->fileSize != bundle->dataSize ||
+        header->numSections > ES_BUNDLE_MAX_SECTIONS || tableEnd > bundle->dataSize )
+    {
+        esLogMessage( " esBundleOpen: { %s } is not a version %d bundle\n ", fileName, ES_BUNDLE_VERSION );
+        esBundleClose( bundle );
+        return GL_FALSE;
+    }
+    
+    bundle->header      = header;
+    bundle->sections    = ( const ESBundleSection * ) ( bundle->data + sizeof( ESBundleHeader ) );
+    bundle->numSections = ( int ) header->numSections;
+    
+    // Only the table is checked, so a corrupt file can't send GL outside the mapping
+    for( i = 0; i < bundle->numSections; i++ )
+    {
+        const ESBundleSection *section = &bundle->sections[i];
+        
+        if( section->offset < tableEnd || section->offset > bundle->dataSize ||
+            section->size > bundle->dataSize - section->offset )
+        {
+            esLogMessage( " esBundleOpen: { %s } section %d is out of bounds\n ", fileName, i );
+            esBundleClose( bundle );
+            return GL_FALSE;
+        }
+        
+        // the writer aligns every section, anything else was not written by it
+        if( section->offset % ES_BUNDLE_ALIGNMENT != 0 )
+        {
+            esLogMessage( " esBundleOpen: { %s } section %d is not aligned\n ", fileName, i );
+            esBundleClose( bundle );
+            return GL_FALSE;
+        }
+    }
+    
+    return GL_TRUE;
+}
+
+// esBundleClose()
+void ESUTIL_API esBundleClose( ESBundle *bundle )
+{
+    if( bundle->data != NULL )
+    {
+        esUnmapFile( bundle->data, bundle->dataSize );
+    }
+    
+    memset( bundle, 0, sizeof( ESBundle ) );
+}
+
+// esBundleFind()
+const ESBundleSection *ESUTIL_API esBundleFind( const ESBundle *bundle, const char *name )
+{
+    int i;
+    
+    for( i = 0; i < bundle->numSections; i++ )
+    {
+        if( strncmp( bundle->sections[i].name, name, ES_BUNDLE_NAME_SIZE ) == 0 )
+        {
+            return &bundle->sections[i];
+        }
+    }
+    
+    return NULL;
+}
+
+// esBundleSectionData()
+const void *ESUTIL_API esBundleSectionData( const ESBundle *bundle, const ESBundleSection *section )
+{
+    return bundle->data + section->offset;
+}
+
+// esBundleVertexFormat()
+GLboolean ESUTIL_API esBundleVertexFormat( const ESBundleSection *section, ESVertexFormat *format )
+{
+    if( section->type != ES_BUNDLE_VERTICES ||
+        !esVertexFormatInit( format, ( ESAttribEncoding ) ( section->format & 0xFF ),
+                             ( ESAttribEncoding ) ( ( section->format >> 8 ) & 0xFF ),
+                             ( ESAttribEncoding ) ( ( section->format >> 16 ) & 0xFF ), section->positionScale ) )
+    {
+        return GL_FALSE;
+    }
+    
+    return format->stride == ( GLsizei ) section->stride ? GL_TRUE : GL_FALSE;
+}
+
+// esBundleUploadBuffer()
+GLuint ESUTIL_API esBundleUploadBuffer( const ESBundle *bundle, const ESBundleSection *section, GLenum usage,
+                                        ESStateCache *cache )
+{
+    GLenum target;
+    GLuint buffer;
+    
+    switch( section->type )
+    {
+        case ES_BUNDLE_VERTICES:
+            target = GL_ARRAY_BUFFER;
+            break;
+        case ES_BUNDLE_INDICES:
+            target = GL_ELEMENT_ARRAY_BUFFER;
+            // keep the binding out of whatever VAO is bound
+            esStateBindVertexArray( cache, 0 );
+            break;
+        default:
+            return 0;
+    }
+    
+    glGenBuffers( 1, &buffer );
+    esStateBindBuffer( cache, target, buffer );
+    glBufferData( target, ( GLsizeiptr ) section->size, esBundleSectionData( bundle, section ), usage );
+    
+    return buffer;
+}
+
+// esBundleUploadTexture()
+GLuint ESUTIL_API esBundleUploadTexture( const ESBundle *bundle, const ESBundleSection *section, ESStateCache *cache )
+{
+    ESMipLevel levels[ES_TEXTURE_MAX_LEVELS];
+    const GLubyte *pixels = esBundleSectionData( bundle, section );
+    int width  = ( int ) section->width;
+    int height = ( int ) section->height;
+    int numLevels = ( int ) section->count;
+    size_t size = 0;
+    GLuint texture;
+    int level;
+    
+    if( section->type != ES_BUNDLE_TEXTURE || numLevels < 1 || numLevels > ES_TEXTURE_MAX_LEVELS )
+    {
+        return 0;
+    }
+    
+    // The levels follow each other, only their pointers need working out
+    for( level = 0; level < numLevels; level++ )
+    {
+        levels[level].width  = width;
+        levels[level].height = height;
+        levels[level].pixels = pixels + size;
+        
+        size  += ( size_t ) width * height * section->stride;
+        width  = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    
+    if( size > section->size )
+    {
+        return 0;
+    }
+    
+    glGenTextures( 1, &texture );
+    esStateBindTexture( cache, 0, GL_TEXTURE_2D, texture );
+    esTextureUploadMipChain( levels, numLevels, section->format );
+    
+    return texture;
+}
+
+//
+// Writer
+//
+
+// esBundleWriterInit()
+void ESUTIL_API esBundleWriterInit( ESBundleWriter *writer )
+{
+    memset( writer, 0, sizeof( ESBundleWriter ) );
+}
+
+// esBundleWriterDestroy()
+void ESUTIL_API esBundleWriterDestroy( ESBundleWriter *writer )
+{
+    int i;
+    
+    for( i = 0; i < writer->numSections; i++ )
+    {
+        free( writer->blobs[i] );
+    }
+    
+    writer->numSections = 0;
+}
+
+// new section named name owning a size byte blob, NULL when full or out of memory
+static ESBundleSection *esBundleAddSection( ESBundleWriter *writer, const char *name, ESBundleSectionType type,
+                                            size_t size, void **blob )
+{
+    ESBundleSection *section;
+    
+    if( writer->numSections == ES_BUNDLE_MAX_SECTIONS || strlen( name ) >= ES_BUNDLE_NAME_SIZE )
+    {
+        esLogMessage( " esBundleAddSection: can't add { %s }\n ", name );
+        return NULL;
+    }
+    
+    *blob = malloc( size > 0 ? size : 1 );
+    
+    if( *blob == NULL )
+    {
+        return NULL;
+    }
+    
+    section = &writer->sections[ writer->numSections ];
+    memset( section, 0, sizeof( ESBundleSection ) );
+    strncpy( section->name, name, ES_BUNDLE_NAME_SIZE - 1 );
+    section->type = type;
+    section->size = size;
+    
+    writer->blobs[ writer->numSections++ ] = *blob;
+    
+    return section;
+}
+
+// esBundleAddVertices()
+GLboolean ESUTIL_API esBundleAddVertices( ESBundleWriter *writer, const char *name, const ESVertexFormat *format,
+                                          const void *vertices, int numVertices )
+{
+    size_t size = ( size_t ) format->stride * numVertices;
+    ESBundleSection *section;
+    void *blob;
+    
+    section = esBundleAddSection( writer, name, ES_BUNDLE_VERTICES, size, &blob );
+    
+    if( section == NULL )
+    {
+        return GL_FALSE;
+    }
+    
+    memcpy( blob, vertices, size );
+    section->format        = format->position | ( format->normal << 8 ) | ( format->texCoord << 16 );
+    section->count         = numVertices;
+    section->stride        = format->stride;
+    section->positionScale = format->positionScale;
+    
+    return GL_TRUE;
+}
+
+// esBundleAddIndices()
+GLboolean ESUTIL_API esBundleAddIndices( ESBundleWriter *writer, const char *name, const GLuint *indices, int numIndices,
+                                         int numVertices )
+{
+    // half the index bandwidth whenever the mesh allows it
+    GLboolean shortIndices = numVertices <= 65536;
+    size_t size = ( size_t ) numIndices * ( shortIndices ? sizeof( GLushort ) : sizeof( GLuint ) );
+    ESBundleSection *section;
+    void *blob;
+    int i;
+    
+    section = esBundleAddSection( writer, name, ES_BUNDLE_INDICES, size, &blob );
+    
+    if( section == NULL )
+    {
+        return GL_FALSE;
+    }
+    
+    if( shortIndices )
+    {
+        for( i = 0; i < numIndices; i++ )
+        {
+            ( ( GLushort * ) blob )[i] = ( GLushort ) indices[i];
+        }
+    }
+    else
+    {
+        memcpy( blob, indices, size );
+    }
+    
+    section->format = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    section->count  = numIndices;
+    
+    return GL_TRUE;
+}
+
+// esBundleAddTexture()
+GLboolean ESUTIL_API esBundleAddTexture( ESBundleWriter *writer, const char *name, const GLubyte *pixels,
+                                         int width, int height, int channels, ESMipFilter filter )
+{
+    static const GLenum formats[4] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+    ESMipLevel levels[ES_TEXTURE_MAX_LEVELS];
+    size_t baseSize = ( size_t ) width * height * channels;
+    size_t size;
+    ESBundleSection *section;
+    void *blob;
+    
+    if( channels < 1 || channels > 4 || width < 1 || height < 1 )
+    {
+        return GL_FALSE;
+    }
+    
+    size    = baseSize + esTextureMipChainSize( width, height, channels );
+    section = esBundleAddSection( writer, name, ES_BUNDLE_TEXTURE, size, &blob );
+    
+    if( section == NULL )
+    {
+        return GL_FALSE;
+    }
+    
+    // level 0 first, the chain is built right behind it
+    memcpy( blob, pixels, baseSize );
+    section->count  = esTextureBuildMipChain( blob, width, height, channels, filter,
+                                              ( GLubyte * ) blob + baseSize, levels );
+    section->format = formats[ channels - 1 ];
+    section->stride = channels;
+    section->width  = width;
+    section->height = height;
+    
+    return GL_TRUE;
+}
+
+// esBundleWrite()
+GLboolean ESUTIL_API esBundleWrite( const ESBundleWriter *writer, const char *fileName )
+{
+    static const unsigned char zeros[ES_BUNDLE_ALIGNMENT];
+    ESBundleSection *sections;
+    ESBundleHeader header;
+    uint64_t offset;
+    GLboolean ok = GL_TRUE;
+    FILE *fp;
+    int i;
+    
+    sections = malloc( sizeof( ESBundleSection ) * ( writer->numSections > 0 ? writer->numSections : 1 ) );
+    
+    if( sections == NULL )
+    {
+        return GL_FALSE;
+    }
+    
+    // Lay the blobs out after the table
+    offset = sizeof( ESBundleHeader ) + sizeof( ESBundleSection ) * writer->numSections;
+    
+    for( i = 0; i < writer->numSections; i++ )
+    {
+        sections[i]        = writer->sections[i];
+        sections[i].offset = esBundleAlign( offset );
+        offset             = sections[i].offset + sections[i].size;
+    }
+    
+    memset( &header, 0, sizeof( ESBundleHeader ) );
+    header.magic       = ES_BUNDLE_MAGIC;
+    header.version     = ES_BUNDLE_VERSION;
+    header.numSections = writer->numSections;
+    header.fileSize    = offset;
+    
+    fp = fopen( fileName, "wb" );
+    
+    if( fp == NULL )
+    {
+        esLogMessage( " esBundleWrite FAILED to create : { %s }\n ", fileName );
+        free( sections );
+        return GL_FALSE;
+    }
+    
+    ok = fwrite( &header, sizeof( header ), 1, fp ) == 1;
+    
+    if( ok && writer->numSections > 0 )
+    {
+        ok = fwrite( sections, sizeof( ESBundleSection ), writer->numSections, fp ) == ( size_t ) writer->numSections;
+    }
+    
+    offset = sizeof( ESBundleHeader ) + sizeof( ESBundleSection ) * writer->numSections;
+    
+    for( i = 0; ok && i < writer->numSections; i++ )
+    {
+        size_t pad = ( size_t ) ( sections[i].offset - offset );
+        
+        ok = ( pad == 0 || fwrite( zeros, pad, 1, fp ) == 1 ) &&
+             ( sections[i].size == 0 || fwrite( writer->blobs[i], sections[i].size, 1, fp ) == 1 );
+        
+        offset = sections[i].offset + sections[i].size;
+    }
+    
+    if( fclose( fp ) != 0 )
+    {
+        ok = GL_FALSE;
+    }
+    
+    free( sections );
+    
+    if( !ok )
+    {
+        esLogMessage( " esBundleWrite FAILED to write : { %s }\n ", fileName );
+        remove( fileName );
+    }
+    
+    return ok;
+}
@@ -0,0 +1,128 @@
+//
+//  ESBundle.h
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+
+#ifndef ESBundle_h
+#define ESBundle_h
+
+#include "ESUtil.h"
+#include "ESVertexFormat.h"
+#include "ESStateCache.h"
+#include "ESTexture.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// "ESB1" read as a little-endian word
+#define ES_BUNDLE_MAGIC        0x31425345u
+#define ES_BUNDLE_VERSION      1
+// Every section starts on this boundary, enough for any GPU copy path and a cache line
+#define ES_BUNDLE_ALIGNMENT    64
+#define ES_BUNDLE_NAME_SIZE    32
+#define ES_BUNDLE_MAX_SECTIONS 1024
+
+typedef enum
+{
+    // interleaved vertices in the layout of an ESVertexFormat
+    ES_BUNDLE_VERTICES = 1,
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT indices
+    ES_BUNDLE_INDICES,
+    // a full mip chain, level 0 first, rows tightly packed and bottom row first
+    ES_BUNDLE_TEXTURE
+} ESBundleSectionType;
+
+// File layout: header, section table, then the section blobs. All little-endian
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t numSections;
+    uint32_t reserved;
+    uint64_t fileSize;
+    uint64_t reserved2;
+} ESBundleHeader;
+
+typedef struct
+{
+    char     name[ES_BUNDLE_NAME_SIZE];
+    uint32_t type;
+    // vertices: position, normal and texCoord ESAttribEncoding in bytes 0, 1 and 2.
+    // indices: GL index type. textures: GL format
+    uint32_t format;
+    // vertices and indices: element count. textures: mip levels
+    uint32_t count;
+    // vertices: bytes per vertex. textures: bytes per pixel
+    uint32_t stride;
+    // textures: level 0 size
+    uint32_t width;
+    uint32_t height;
+    // vertices: ESVertexFormat positionScale
+    float    positionScale;
+    uint32_t reserved;
+    // from the start of the file, a multiple of ES_BUNDLE_ALIGNMENT
+    uint64_t offset;
+    uint64_t size;
+} ESBundleSection;
+
+// A mapped bundle, sections point straight into the mapping
+typedef struct
+{
+    const unsigned char   *data;
+    size_t                 dataSize;
+    const ESBundleHeader  *header;
+    const ESBundleSection *sections;
+    int                    numSections;
+} ESBundle;
+
+// Collects sections in memory for esBundleWrite, used by the esbpack tool
+typedef struct
+{
+    ESBundleSection sections[ES_BUNDLE_MAX_SECTIONS];
+    // owned copies of the section contents
+    void           *blobs[ES_BUNDLE_MAX_SECTIONS];
+    int             numSections;
+} ESBundleWriter;
+
+// map a bundle and check its header and section table, nothing else is read
+GLboolean ESUTIL_API esBundleOpen( ESBundle *bundle, const char *fileName );
+// unmap the bundle, section data pointers become invalid
+void ESUTIL_API esBundleClose( ESBundle *bundle );
+// section called name, NULL if there is none
+const ESBundleSection *ESUTIL_API esBundleFind( const ESBundle *bundle, const char *name );
+// contents of a section inside the mapping
+const void *ESUTIL_API esBundleSectionData( const ESBundle *bundle, const ESBundleSection *section );
+// the ESVertexFormat a vertex section was packed with
+GLboolean ESUTIL_API esBundleVertexFormat( const ESBundleSection *section, ESVertexFormat *format );
+// create a buffer object from a vertex or index section, glBufferData reads the mapping directly.
+// Binds GL_ARRAY_BUFFER or, with VAO 0 bound, GL_ELEMENT_ARRAY_BUFFER
+GLuint ESUTIL_API esBundleUploadBuffer( const ESBundle *bundle, const ESBundleSection *section, GLenum usage,
+                                        ESStateCache *cache );
+// create a mipmapped GL_TEXTURE_2D from a texture section, bound to unit 0
+GLuint ESUTIL_API esBundleUploadTexture( const ESBundle *bundle, const ESBundleSection *section, ESStateCache *cache );
+
+void ESUTIL_API esBundleWriterInit( ESBundleWriter *writer );
+// free the section copies
+void ESUTIL_API esBundleWriterDestroy( ESBundleWriter *writer );
+// add numVertices vertices packed in format
+GLboolean ESUTIL_API esBundleAddVertices( ESBundleWriter *writer, const char *name, const ESVertexFormat *format,
+                                          const void *vertices, int numVertices );
+// add indices, stored as GL_UNSIGNED_SHORT when numVertices allows it
+GLboolean ESUTIL_API esBundleAddIndices( ESBundleWriter *writer, const char *name, const GLuint *indices, int numIndices,
+                                         int numVertices );
+// add a width x height image with channels bytes per pixel and its mip chain built with filter
+GLboolean ESUTIL_API esBundleAddTexture( ESBundleWriter *writer, const char *name, const GLubyte *pixels,
+                                         int width, int height, int channels, ESMipFilter filter );
+// write header, section table and the aligned blobs
+GLboolean ESUTIL_API esBundleWrite( const ESBundleWriter *writer, const char *fileName );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESBundle_h */
@@ -0,0 +1,633 @@
+//
+//  ESCull.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  Frustum culling. Object boxes sit in a 4-wide BVH whose nodes keep their
+//  children's boxes as structure-of-arrays, so a node is tested against a plane
+//  with a handful of SIMD instructions. The query carries down which planes a
+//  subtree still crosses; once a subtree is fully inside, it is emitted without
+//  further tests.
+//
+
+#include "ESCull.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined( __SSE__ ) || defined( _M_X64 )
+#define ES_CULL_SSE 1
+#include <xmmintrin.h>
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#define ES_CULL_NEON 1
+#include <arm_neon.h>
+#endif
+
+// esFrustumFromMatrix()
+//
+// The matrices here transform row vectors ( p * M ), so clip coordinate j is p dotted with
+// column j and the planes are -w <= x, y, z <= w rewritten as column sums
+void ESUTIL_API esFrustumFromMatrix( ESFrustum *frustum, const ESMatrix *matrix )
+{
+    int i;
+    
+    for( i = 0; i < 4; i++ )
+    {
+        GLfloat w = matrix->m[i][3];
+        
+        frustum->planes[ES_FRUSTUM_LEFT][i]   = w + matrix->m[i][0];
+        frustum->planes[ES_FRUSTUM_RIGHT][i]  = w - matrix->m[i][0];
+        frustum->planes[ES_FRUSTUM_BOTTOM][i] = w + matrix->m[i][1];
+        frustum->planes[ES_FRUSTUM_TOP][i]    = w - matrix->m[i][1];
+        frustum->planes[ES_FRUSTUM_NEAR][i]   = w + matrix->m[i][2];
+        frustum->planes[ES_FRUSTUM_FAR][i]    = w - matrix->m[i][2];
+    }
+}
+
+// esAABBTransform()
+//
+// The center goes through the matrix, the half size through its absolute values
+void ESUTIL_API esAABBTransform( ESAABB *result, const ESAABB *box, const ESMatrix *matrix )
+{
+    GLfloat center[3];
+    GLfloat extent[3];
+    int i;
+    int j;
+    
+    for( i = 0; i < 3; i++ )
+    {
+        center[i] = ( box->min[i] + box->max[i] ) * 0.5f;
+        extent[i] = ( box->max[i] - box->min[i] ) * 0.5f;
+    }
+    
+    for( j = 0; j < 3; j++ )
+    {
+        GLfloat c = matrix->m[3][j];
+        GLfloat e = 0.0f;
+        
+        for( i = 0; i < 3; i++ )
+        {
+            c += center[i] * matrix->m[i][j];
+            e += extent[i] * fabsf( matrix->m[i][j] );
+        }
+        
+        result->min[j] = c - e;
+        result->max[j] = c + e;
+    }
+}
+
+// esFrustumTestAABB()
+GLboolean ESUTIL_API esFrustumTestAABB( const ESFrustum *frustum, const ESAABB *box )
+{
+    int p;
+    
+    for( p = 0; p < ES_FRUSTUM_PLANES; p++ )
+    {
+        const GLfloat *plane = frustum->planes[p];
+        
+        // the corner furthest along the plane normal
+        GLfloat x = plane[0] >= 0.0f ? box->max[0] : box->min[0];
+        GLfloat y = plane[1] >= 0.0f ? box->max[1] : box->min[1];
+        GLfloat z = plane[2] >= 0.0f ? box->max[2] : box->min[2];
+        
+        if( plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f )
+        {
+            return GL_FALSE;
+        }
+    }
+    
+    return GL_TRUE;
+}
+
+//
+// Node test
+//
+// Tests the lanes of a node against the planes in mask. Returns the lanes entirely outside
+// one of them; bit i of straddle[p] is set when lane i crosses plane p. A box with center c
+// and half size e reaches d( c ) +- ( |a| ex + |b| ey + |c| ez ) along the plane
+//
+#if defined( ES_CULL_SSE )
+
+static int esCullTestNode( const ESCullNode *node, const ESFrustum *frustum, int mask, int *straddle )
+{
+    __m128 cx = _mm_loadu_ps( node->centerX );
+    __m128 cy = _mm_loadu_ps( node->centerY );
+    __m128 cz = _mm_loadu_ps( node->centerZ );
+    __m128 ex = _mm_loadu_ps( node->extentX );
+    __m128 ey = _mm_loadu_ps( node->extentY );
+    __m128 ez = _mm_loadu_ps( node->extentZ );
+    __m128 zero = _mm_setzero_ps();
+    int outside = 0;
+    int p;
+    
+    for( p = 0; p < ES_FRUSTUM_PLANES; p++ )
+    {
+        const GLfloat *plane = frustum->planes[p];
+        __m128 d;
+        __m128 r;
+        
+        if( !( mask & ( 1 << p ) ) )
+        {
+            straddle[p] = 0;
+            continue;
+        }
+        
+        d = _mm_add_ps( _mm_add_ps( _mm_mul_ps( cx, _mm_set1_ps( plane[0] ) ),
+                                    _mm_mul_ps( cy, _mm_set1_ps( plane[1] ) ) ),
+                        _mm_add_ps( _mm_mul_ps( cz, _mm_set1_ps( plane[2] ) ), _mm_set1_ps( plane[3] ) ) );
+        r = _mm_add_ps( _mm_add_ps( _mm_mul_ps( ex, _mm_set1_ps( fabsf( plane[0] ) ) ),
+                                    _mm_mul_ps( ey, _mm_set1_ps( fabsf( plane[1] ) ) ) ),
+                        _mm_mul_ps( ez, _mm_set1_ps( fabsf( plane[2] ) ) ) );
+        
+        outside    |= _mm_movemask_ps( _mm_cmplt_ps( _mm_add_ps( d, r ), zero ) );
+        straddle[p] = _mm_movemask_ps( _mm_cmplt_ps( _mm_sub_ps( d, r ), zero ) );
+    }
+    
+    return outside;
+}
+
+#elif defined( ES_CULL_NEON )
+
+// one bit per lane, like _mm_movemask_ps
+static int esCullMoveMask( uint32x4_t m )
+{
+    static const uint32_t laneBits[4] = { 1, 2, 4, 8 };
+    uint32x4_t bits = vandq_u32( m, vld1q_u32( laneBits ) );
+    uint32x2_t sum  = vadd_u32( vget_low_u32( bits ), vget_high_u32( bits ) );
+    
+    return ( int ) vget_lane_u32( vpadd_u32( sum, sum ), 0 );
+}
+
+static int esCullTestNode( const ESCullNode *node, const ESFrustum *frustum, int mask, int *straddle )
+{
+    float32x4_t cx = vld1q_f32( node->centerX );
+    float32x4_t cy = vld1q_f32( node->centerY );
+    float32x4_t cz = vld1q_f32( node->centerZ );
+    float32x4_t ex = vld1q_f32( node->extentX );
+    float32x4_t ey = vld1q_f32( node->extentY );
+    float32x4_t ez = vld1q_f32( node->extentZ );
+    float32x4_t zero = vdupq_n_f32( 0.0f );
+    int outside = 0;
+    int p;
+    
+    for( p = 0; p < ES_FRUSTUM_PLANES; p++ )
+    {
+        const GLfloat *plane = frustum->planes[p];
+        float32x4_t d;
+        float32x4_t r;
+        
+        if( !( mask & ( 1 << p ) ) )
+        {
+            straddle[p] = 0;
+            continue;
+        }
+        
+        d = vmlaq_n_f32( vdupq_n_f32( plane[3] ), cx, plane[0] );
+        d = vmlaq_n_f32( d, cy, plane[1] );
+        d = vmlaq_n_f32( d, cz, plane[2] );
+        r = vmulq_n_f32( ex, fabsf( plane[0] ) );
+        r = vmlaq_n_f32( r, ey, fabsf( plane[1] ) );
+        r = vmlaq_n_f32( r, ez, fabsf( plane[2] ) );
+        
+        outside    |= esCullMoveMask( vcltq_f32( vaddq_f32( d, r ), zero ) );
+        straddle[p] = esCullMoveMask( vcltq_f32( vsubq_f32( d, r ), zero ) );
+    }
+    
+    return outside;
+}
+
+#else
+
+static int esCullTestNode( const ESCullNode *node, const ESFrustum *frustum, int mask, int *straddle )
+{
+    int outside = 0;
+    int p;
+    int i;
+    
+    for( p = 0; p < ES_FRUSTUM_PLANES; p++ )
+    {
+        const GLfloat *plane = frustum->planes[p];
+        
+        straddle[p] = 0;
+        
+        if( !( mask & ( 1 << p ) ) )
+        {
+            continue;
+        }
+        
+        for( i = 0; i < ES_CULL_WIDTH; i++ )
+        {
+            GLfloat d = plane[0] * node->centerX[i] + plane[1] * node->centerY[i] +
+                        plane[2] * node->centerZ[i] + plane[3];
+            GLfloat r = fabsf( plane[0] ) * node->extentX[i] + fabsf( plane[1] ) * node->extentY[i] +
+                        fabsf( plane[2] ) * node->extentZ[i];
+            
+            if( d + r < 0.0f )
+            {
+                outside |= 1 << i;
+            }
+            
+            if( d - r < 0.0f )
+            {
+                straddle[p] |= 1 << i;
+            }
+        }
+    }
+    
+    return outside;
+}
+
+#endif
+
+//
+// Tree
+//
+static void esCullSetLane( ESCullNode *node, int lane, const ESAABB *box )
+{
+    node->centerX[lane] = ( box->min[0] + box->max[0] ) * 0.5f;
+    node->centerY[lane] = ( box->min[1] + box->max[1] ) * 0.5f;
+    node->centerZ[lane] = ( box->min[2] + box->max[2] ) * 0.5f;
+    node->extentX[lane] = ( box->max[0] - box->min[0] ) * 0.5f;
+    node->extentY[lane] = ( box->max[1] - box->min[1] ) * 0.5f;
+    node->extentZ[lane] = ( box->max[2] - box->min[2] ) * 0.5f;
+}
+
+// union of the lanes in use
+static void esCullNodeBounds( const ESCullNode *node, ESAABB *box )
+{
+    int i;
+    
+    box->min[0] = box->min[1] = box->min[2] = INFINITY;
+    box->max[0] = box->max[1] = box->max[2] = -INFINITY;
+    
+    for( i = 0; i < node->count; i++ )
+    {
+        box->min[0] = fminf( box->min[0], node->centerX[i] - node->extentX[i] );
+        box->min[1] = fminf( box->min[1], node->centerY[i] - node->extentY[i] );
+        box->min[2] = fminf( box->min[2], node->centerZ[i] - node->extentZ[i] );
+        box->max[0] = fmaxf( box->max[0], node->centerX[i] + node->extentX[i] );
+        box->max[1] = fmaxf( box->max[1], node->centerY[i] + node->extentY[i] );
+        box->max[2] = fmaxf( box->max[2], node->centerZ[i] + node->extentZ[i] );
+    }
+}
+
+// esCullTreeInit()
+GLboolean ESUTIL_API esCullTreeInit( ESCullTree *tree, int maxObjects )
+{
+    memset( tree, 0, sizeof( ESCullTree ) );
+    
+    if( maxObjects < 1 )
+    {
+        return GL_FALSE;
+    }
+    
+    // every node but the root splits at least in two, so there are fewer nodes than objects
+    tree->nodes      = malloc( sizeof( ESCullNode ) * maxObjects );
+    tree->objectNode = malloc( sizeof( int ) * maxObjects );
+    tree->objectLane = malloc( sizeof( int ) * maxObjects );
+    tree->order      = malloc( sizeof( int ) * maxObjects );
+    tree->centroids  = malloc( sizeof( GLfloat ) * 3 * maxObjects );
+    tree->maxObjects = maxObjects;
+    
+    if( tree->nodes == NULL || tree->objectNode == NULL || tree->objectLane == NULL ||
+        tree->order == NULL || tree->centroids == NULL )
+    {
+        esCullTreeDestroy( tree );
+        return GL_FALSE;
+    }
+    
+    return GL_TRUE;
+}
+
+// esCullTreeDestroy()
+void ESUTIL_API esCullTreeDestroy( ESCullTree *tree )
+{
+    free( tree->nodes );
+    free( tree->objectNode );
+    free( tree->objectLane );
+    free( tree->order );
+    free( tree->centroids );
+    
+    memset( tree, 0, sizeof( ESCullTree ) );
+}
+
+// move the k-th smallest centroid along axis to order[k], smaller ones before it and larger ones after
+static void esCullSelect( int *order, int count, int k, const GLfloat *centroids, int axis )
+{
+    int lo = 0;
+    int hi = count - 1;
+    
+    while( lo < hi )
+    {
+        GLfloat pivot = centroids[order[( lo + hi ) / 2] * 3 + axis];
+        int i = lo;
+        int j = hi;
+        
+        while( i <= j )
+        {
+            while( centroids[order[i] * 3 + axis] < pivot )
+            {
+                i++;
+            }
+            
+            while( centroids[order[j] * 3 + axis] > pivot )
+            {
+                j--;
+            }
+            
+            if( i <= j )
+            {
+                int tmp = order[i];
+                
+                order[i] = order[j];
+                order[j] = tmp;
+                i++;
+                j--;
+            }
+        }
+        
+        if( k <= j )
+        {
+            hi = j;
+        }
+        else if( k >= i )
+        {
+            lo = i;
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
+// median split along the widest spread of centroids, returns the size of the first half
+static int esCullSplit( ESCullTree *tree, int first, int count )
+{
+    GLfloat lo[3] = { INFINITY, INFINITY, INFINITY };
+    GLfloat hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+    int axis = 0;
+    int i;
+    int j;
+    
+    for( i = first; i < first + count; i++ )
+    {
+        const GLfloat *centroid = &tree->centroids[tree->order[i] * 3];
+        
+        for( j = 0; j < 3; j++ )
+        {
+            lo[j] = fminf( lo[j], centroid[j] );
+            hi[j] = fmaxf( hi[j], centroid[j] );
+        }
+    }
+    
+    if( hi[1] - lo[1] > hi[axis] - lo[axis] )
+    {
+        axis = 1;
+    }
+    
+    if( hi[2] - lo[2] > hi[axis] - lo[axis] )
+    {
+        axis = 2;
+    }
+    
+    esCullSelect( &tree->order[first], count, count / 2, tree->centroids, axis );
+    
+    return count / 2;
+}
+
+// build the node over order[first, first + count), count > 0. Nodes are numbered in
+// preorder so every parent comes before its children
+static int esCullBuildNode( ESCullTree *tree, const ESAABB *bounds, int first, int count, int parent, int parentLane )
+{
+    int groupFirst[ES_CULL_WIDTH];
+    int groupCount[ES_CULL_WIDTH];
+    int numGroups = 0;
+    int index = tree->numNodes++;
+    int half;
+    int i;
+    
+    // two levels of binary splits give up to four groups
+    if( count == 1 )
+    {
+        groupFirst[numGroups] = first;
+        groupCount[numGroups++] = 1;
+    }
+    else
+    {
+        int halfFirst[2];
+        int halfCount[2];
+        
+        half = esCullSplit( tree, first, count );
+        halfFirst[0] = first;
+        halfCount[0] = half;
+        halfFirst[1] = first + half;
+        halfCount[1] = count - half;
+        
+        for( i = 0; i < 2; i++ )
+        {
+            if( halfCount[i] == 1 )
+            {
+                groupFirst[numGroups] = halfFirst[i];
+                groupCount[numGroups++] = 1;
+            }
+            else
+            {
+                int quarter = esCullSplit( tree, halfFirst[i], halfCount[i] );
+                
+                groupFirst[numGroups] = halfFirst[i];
+                groupCount[numGroups++] = quarter;
+                groupFirst[numGroups] = halfFirst[i] + quarter;
+                groupCount[numGroups++] = halfCount[i] - quarter;
+            }
+        }
+    }
+    
+    tree->nodes[index].count      = numGroups;
+    tree->nodes[index].parent     = parent;
+    tree->nodes[index].parentLane = parentLane;
+    tree->nodes[index].dirty      = 0;
+    
+    for( i = 0; i < numGroups; i++ )
+    {
+        ESAABB box;
+        int child;
+        
+        if( groupCount[i] == 1 )
+        {
+            int object = tree->order[groupFirst[i]];
+            
+            tree->objectNode[object] = index;
+            tree->objectLane[object] = i;
+            child = -1 - object;
+            box = bounds[object];
+        }
+        else
+        {
+            child = esCullBuildNode( tree, bounds, groupFirst[i], groupCount[i], index, i );
+            esCullNodeBounds( &tree->nodes[child], &box );
+        }
+        
+        tree->nodes[index].child[i] = child;
+        esCullSetLane( &tree->nodes[index], i, &box );
+    }
+    
+    // unused lanes stay harmless for the SIMD tests
+    for( i = numGroups; i < ES_CULL_WIDTH; i++ )
+    {
+        ESAABB empty = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+        
+        tree->nodes[index].child[i] = 0;
+        esCullSetLane( &tree->nodes[index], i, &empty );
+    }
+    
+    return index;
+}
+
+// esCullTreeBuild()
+void ESUTIL_API esCullTreeBuild( ESCullTree *tree, const ESAABB *bounds, int count )
+{
+    int i;
+    
+    if( count > tree->maxObjects )
+    {
+        esLogMessage( "esCullTreeBuild: %d objects, room for %d\n", count, tree->maxObjects );
+        count = tree->maxObjects;
+    }
+    
+    tree->numNodes   = 0;
+    tree->numObjects = count;
+    tree->numDirty   = 0;
+    
+    if( count <= 0 )
+    {
+        return;
+    }
+    
+    for( i = 0; i < count; i++ )
+    {
+        tree->order[i] = i;
+        tree->centroids[i * 3 + 0] = ( bounds[i].min[0] + bounds[i].max[0] ) * 0.5f;
+        tree->centroids[i * 3 + 1] = ( bounds[i].min[1] + bounds[i].max[1] ) * 0.5f;
+        tree->centroids[i * 3 + 2] = ( bounds[i].min[2] + bounds[i].max[2] ) * 0.5f;
+    }
+    
+    esCullBuildNode( tree, bounds, 0, count, -1, 0 );
+}
+
+// esCullTreeSetBounds()
+void ESUTIL_API esCullTreeSetBounds( ESCullTree *tree, int object, const ESAABB *bounds )
+{
+    ESCullNode *node = &tree->nodes[tree->objectNode[object]];
+    
+    esCullSetLane( node, tree->objectLane[object], bounds );
+    
+    if( !node->dirty )
+    {
+        node->dirty = 1;
+        tree->numDirty++;
+    }
+}
+
+// esCullTreeRefit()
+//
+// Children come after their parents, so walking the nodes backwards finishes every
+// child before its parent is looked at
+void ESUTIL_API esCullTreeRefit( ESCullTree *tree )
+{
+    int i;
+    
+    if( tree->numDirty == 0 )
+    {
+        return;
+    }
+    
+    for( i = tree->numNodes - 1; i >= 0; i-- )
+    {
+        ESCullNode *node = &tree->nodes[i];
+        
+        if( !node->dirty )
+        {
+            continue;
+        }
+        
+        node->dirty = 0;
+        
+        if( node->parent >= 0 )
+        {
+            ESAABB box;
+            
+            esCullNodeBounds( node, &box );
+            esCullSetLane( &tree->nodes[node->parent], node->parentLane, &box );
+            tree->nodes[node->parent].dirty = 1;
+        }
+    }
+    
+    tree->numDirty = 0;
+}
+
+// esCullTreeQuery()
+int ESUTIL_API esCullTreeQuery( const ESCullTree *tree, const ESFrustum *frustum, int *visible )
+{
+    // node and the planes its box still crosses, 0 once it is entirely inside
+    int stackNode[ES_CULL_MAX_DEPTH * ES_CULL_WIDTH];
+    int stackPlanes[ES_CULL_MAX_DEPTH * ES_CULL_WIDTH];
+    int top = 0;
+    int numVisible = 0;
+    
+    if( tree->numNodes == 0 )
+    {
+        return 0;
+    }
+    
+    stackNode[top]     = 0;
+    stackPlanes[top++] = ( 1 << ES_FRUSTUM_PLANES ) - 1;
+    
+    while( top > 0 )
+    {
+        int index = stackNode[--top];
+        int planes = stackPlanes[top];
+        const ESCullNode *node = &tree->nodes[index];
+        int straddle[ES_FRUSTUM_PLANES];
+        int outside = 0;
+        int lane;
+        int p;
+        
+        if( planes != 0 )
+        {
+            outside = esCullTestNode( node, frustum, planes, straddle );
+        }
+        
+        for( lane = 0; lane < node->count; lane++ )
+        {
+            int child = node->child[lane];
+            int childPlanes = 0;
+            
+            if( outside & ( 1 << lane ) )
+            {
+                continue;
+            }
+            
+            if( child < 0 )
+            {
+                visible[numVisible++] = -1 - child;
+                continue;
+            }
+            
+            if( planes != 0 )
+            {
+                for( p = 0; p < ES_FRUSTUM_PLANES; p++ )
+                {
+                    childPlanes |= ( ( straddle[p] >> lane ) & 1 ) << p;
+                }
+            }
+            
+            stackNode[top]     = child;
+            stackPlanes[top++] = childPlanes;
+        }
+    }
+    
+    return numVisible;
+}
@@ -0,0 +1,109 @@
+//
+//  ESCull.h
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+
+#ifndef ESCull_h
+#define ESCull_h
+
+#include "ESUtil.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// Children per tree node, one SIMD lane each
+#define ES_CULL_WIDTH     4
+// Deepest traversal the query supports, far beyond what a balanced build of 2^31 objects needs
+#define ES_CULL_MAX_DEPTH 64
+
+typedef enum
+{
+    ES_FRUSTUM_LEFT = 0,
+    ES_FRUSTUM_RIGHT,
+    ES_FRUSTUM_BOTTOM,
+    ES_FRUSTUM_TOP,
+    ES_FRUSTUM_NEAR,
+    ES_FRUSTUM_FAR,
+    ES_FRUSTUM_PLANES
+} ESFrustumPlane;
+
+typedef struct
+{
+    // a, b, c, d of every plane, a * x + b * y + c * z + d >= 0 inside. Not normalized
+    GLfloat planes[ES_FRUSTUM_PLANES][4];
+} ESFrustum;
+
+typedef struct
+{
+    GLfloat min[3];
+    GLfloat max[3];
+} ESAABB;
+
+typedef struct
+{
+    // child boxes as center and half size, lane i belongs to child[i]
+    GLfloat centerX[ES_CULL_WIDTH];
+    GLfloat centerY[ES_CULL_WIDTH];
+    GLfloat centerZ[ES_CULL_WIDTH];
+    GLfloat extentX[ES_CULL_WIDTH];
+    GLfloat extentY[ES_CULL_WIDTH];
+    GLfloat extentZ[ES_CULL_WIDTH];
+    // >= 0 a node, < 0 the object -1 - child
+    int     child[ES_CULL_WIDTH];
+    // lanes in use, always the first ones
+    int     count;
+    // -1 for the root
+    int     parent;
+    int     parentLane;
+    // a lane changed since the last refit
+    int     dirty;
+} ESCullNode;
+
+// 4-wide bounding volume hierarchy over object boxes, one object per leaf lane
+typedef struct
+{
+    // parents come before their children
+    ESCullNode *nodes;
+    int         numNodes;
+    // node and lane holding each object
+    int        *objectNode;
+    int        *objectLane;
+    int         numObjects;
+    int         maxObjects;
+    // build scratch
+    int        *order;
+    GLfloat    *centroids;
+    // nodes marked dirty since the last refit
+    int         numDirty;
+} ESCullTree;
+
+// planes of the frustum a matrix ( projection, view * projection, ... ) maps to the clip volume,
+// in the space the matrix transforms from
+void ESUTIL_API esFrustumFromMatrix( ESFrustum *frustum, const ESMatrix *matrix );
+// bounds of box after transforming it by an affine matrix
+void ESUTIL_API esAABBTransform( ESAABB *result, const ESAABB *box, const ESMatrix *matrix );
+// GL_FALSE when the box is entirely outside one of the planes
+GLboolean ESUTIL_API esFrustumTestAABB( const ESFrustum *frustum, const ESAABB *box );
+
+// room for up to maxObjects objects
+GLboolean ESUTIL_API esCullTreeInit( ESCullTree *tree, int maxObjects );
+void ESUTIL_API esCullTreeDestroy( ESCullTree *tree );
+// rebuild the tree over count objects, object i has bounds[i]
+void ESUTIL_API esCullTreeBuild( ESCullTree *tree, const ESAABB *bounds, int count );
+// move an object, the nodes above it catch up on the next esCullTreeRefit
+void ESUTIL_API esCullTreeSetBounds( ESCullTree *tree, int object, const ESAABB *bounds );
+// grow or shrink the nodes above the moved objects, bottom-up through the dirty nodes only.
+// The tree shape stays, rebuild once objects have moved far from where they were built
+void ESUTIL_API esCullTreeRefit( ESCullTree *tree );
+// write the objects inside or crossing the frustum to visible, packed from index 0. Returns their number
+int ESUTIL_API esCullTreeQuery( const ESCullTree *tree, const ESFrustum *frustum, int *visible );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESCull_h */
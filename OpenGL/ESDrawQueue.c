@@ -0,0 +1,335 @@
+//
+//  ESDrawQueue.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  Deferred draw submission. Packets are collected during the frame, sorted
+//  by a packed 64 bit key so packets sharing a program, vertex array and
+//  texture end up next to each other, then emitted in one pass through the
+//  state cache which drops the bindings that did not change.
+//
+
+#include "ESDrawQueue.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Bits given to every object name in the key, names above that share a slot
+#define KEY_NAME_BITS  12
+#define KEY_NAME_MASK  ( ( 1ull << KEY_NAME_BITS ) - 1 )
+#define KEY_TRANSLUCENT ( 1ull << 63 )
+
+static const ESDrawQueueGL drawQueueGL =
+{
+    glDrawArrays,
+    glDrawElements,
+    glDrawArraysInstanced,
+    glDrawElementsInstanced,
+};
+
+static const ESDrawQueueGL *drawQueueBackend = &drawQueueGL;
+
+// esDrawQueueSetBackend()
+void ESUTIL_API esDrawQueueSetBackend( const ESDrawQueueGL *backend )
+{
+    drawQueueBackend = backend != NULL ? backend : &drawQueueGL;
+}
+
+// reallocate every per-packet array to hold capacity entries
+static GLboolean esDrawQueueGrow( ESDrawQueue *queue, int capacity )
+{
+    void *packets  = realloc( queue->packets, sizeof( ESDrawPacket ) * capacity );
+    void *keys     = NULL;
+    void *order    = NULL;
+    void *tmpKeys  = NULL;
+    void *tmpOrder = NULL;
+    
+    if( packets != NULL )
+    {
+        queue->packets = packets;
+        keys = realloc( queue->keys, sizeof( unsigned long long ) * capacity );
+    }
+    
+    if( keys != NULL )
+    {
+        queue->keys = keys;
+        order = realloc( queue->order, sizeof( unsigned int ) * capacity );
+    }
+    
+    if( order != NULL )
+    {
+        queue->order = order;
+        tmpKeys = realloc( queue->tmpKeys, sizeof( unsigned long long ) * capacity );
+    }
+    
+    if( tmpKeys != NULL )
+    {
+        queue->tmpKeys = tmpKeys;
+        tmpOrder = realloc( queue->tmpOrder, sizeof( unsigned int ) * capacity );
+    }
+    
+    if( tmpOrder == NULL )
+    {
+        // the arrays that did grow stay valid, capacity is only raised once all of them did
+        return GL_FALSE;
+    }
+    
+    queue->tmpOrder = tmpOrder;
+    queue->capacity = capacity;
+    
+    return GL_TRUE;
+}
+
+// esDrawQueueInit()
+GLboolean ESUTIL_API esDrawQueueInit( ESDrawQueue *queue, int capacity )
+{
+    memset( queue, 0, sizeof( ESDrawQueue ) );
+    queue->gl = drawQueueBackend;
+    
+    if( capacity < 1 )
+    {
+        capacity = 1;
+    }
+    
+    if( !esDrawQueueGrow( queue, capacity ) )
+    {
+        esDrawQueueDestroy( queue );
+        return GL_FALSE;
+    }
+    
+    return GL_TRUE;
+}
+
+// esDrawQueueDestroy()
+void ESUTIL_API esDrawQueueDestroy( ESDrawQueue *queue )
+{
+    free( queue->packets );
+    free( queue->keys );
+    free( queue->order );
+    free( queue->tmpKeys );
+    free( queue->tmpOrder );
+    
+    memset( queue, 0, sizeof( ESDrawQueue ) );
+}
+
+// esDrawQueueReset()
+void ESUTIL_API esDrawQueueReset( ESDrawQueue *queue )
+{
+    queue->numPackets = 0;
+    queue->sorted     = GL_FALSE;
+}
+
+// esDrawQueueSubmit()
+GLboolean ESUTIL_API esDrawQueueSubmit( ESDrawQueue *queue, const ESDrawPacket *packet )
+{
+    int index = queue->numPackets;
+    
+    if( index == queue->capacity && !esDrawQueueGrow( queue, queue->capacity * 2 ) )
+    {
+        esLogMessage( " esDrawQueueSubmit FAILED to grow the queue past %d packets\n ", queue->capacity );
+        return GL_FALSE;
+    }
+    
+    queue->packets[index] = *packet;
+    queue->keys[index]    = esDrawPacketKey( packet );
+    queue->order[index]   = ( unsigned int ) index;
+    queue->numPackets++;
+    queue->sorted = GL_FALSE;
+    
+    return GL_TRUE;
+}
+
+// esDrawPacketKey()
+unsigned long long ESUTIL_API esDrawPacketKey( const ESDrawPacket *packet )
+{
+    unsigned long long program     = packet->program & KEY_NAME_MASK;
+    unsigned long long vertexArray = packet->vertexArray & KEY_NAME_MASK;
+    unsigned long long texture     = packet->textures[0] & KEY_NAME_MASK;
+    unsigned int depthBits = 0;
+    
+    // Non-negative IEEE floats order like their bit patterns, negative depths and NaN clamp to 0
+    if( packet->depth > 0.0f )
+    {
+        memcpy( &depthBits, &packet->depth, sizeof( depthBits ) );
+    }
+    
+    if( packet->translucent )
+    {
+        // Blending needs back to front order first, state grouping only among equal depths
+        return KEY_TRANSLUCENT |
+               ( ( unsigned long long ) ( ~depthBits >> 1 ) << 32 ) |
+               ( program << 20 ) | ( vertexArray << 8 ) | ( texture & 0xFF );
+    }
+    
+    // Opaque: group by state, front to back inside a group for early depth rejection
+    return ( program << 51 ) | ( vertexArray << 39 ) | ( texture << 27 ) | ( depthBits >> 5 );
+}
+
+// esRadixSort64()
+void ESUTIL_API esRadixSort64( unsigned long long *keys, unsigned int *values,
+                               unsigned long long *tmpKeys, unsigned int *tmpValues, int count )
+{
+    unsigned int histograms[8][256];
+    unsigned long long *srcKeys = keys;
+    unsigned long long *dstKeys = tmpKeys;
+    unsigned int *srcValues = values;
+    unsigned int *dstValues = tmpValues;
+    int pass;
+    int i;
+    
+    if( count < 2 )
+    {
+        return;
+    }
+    
+    // One read of the keys builds the histograms of all eight digits
+    memset( histograms, 0, sizeof( histograms ) );
+    
+    for( i = 0; i < count; i++ )
+    {
+        unsigned long long key = keys[i];
+        
+        for( pass = 0; pass < 8; pass++ )
+        {
+            histograms[pass][ ( key >> ( pass * 8 ) ) & 0xFF ]++;
+        }
+    }
+    
+    for( pass = 0; pass < 8; pass++ )
+    {
+        unsigned int *histogram = histograms[pass];
+        unsigned int sum = 0;
+        int shift = pass * 8;
+        
+        // every key has the same digit here, the pass would not move anything
+        if( histogram[ ( keys[0] >> shift ) & 0xFF ] == ( unsigned int ) count )
+        {
+            continue;
+        }
+        
+        // counts to starting offsets
+        for( i = 0; i < 256; i++ )
+        {
+            unsigned int digitCount = histogram[i];
+            
+            histogram[i] = sum;
+            sum += digitCount;
+        }
+        
+        for( i = 0; i < count; i++ )
+        {
+            unsigned int slot = histogram[ ( srcKeys[i] >> shift ) & 0xFF ]++;
+            
+            dstKeys[slot]   = srcKeys[i];
+            dstValues[slot] = srcValues[i];
+        }
+        
+        // swap source and destination
+        {
+            unsigned long long *swapKeys = srcKeys;
+            unsigned int *swapValues = srcValues;
+            
+            srcKeys   = dstKeys;
+            dstKeys   = swapKeys;
+            srcValues = dstValues;
+            dstValues = swapValues;
+        }
+    }
+    
+    // An odd number of passes leaves the result in the scratch arrays
+    if( srcKeys != keys )
+    {
+        memcpy( keys, srcKeys, sizeof( unsigned long long ) * count );
+        memcpy( values, srcValues, sizeof( unsigned int ) * count );
+    }
+}
+
+// esDrawQueueSort()
+void ESUTIL_API esDrawQueueSort( ESDrawQueue *queue )
+{
+    if( queue->sorted )
+    {
+        return;
+    }
+    
+    esRadixSort64( queue->keys, queue->order, queue->tmpKeys, queue->tmpOrder, queue->numPackets );
+    queue->sorted = GL_TRUE;
+}
+
+// esDrawQueueFlush()
+void ESUTIL_API esDrawQueueFlush( ESDrawQueue *queue, ESStateCache *cache )
+{
+    const ESDrawQueueGL *gl = queue->gl;
+    GLuint program     = ES_STATE_UNKNOWN;
+    GLuint vertexArray = ES_STATE_UNKNOWN;
+    int i;
+    int unit;
+    
+    esDrawQueueSort( queue );
+    
+    queue->numDraws              = 0;
+    queue->numProgramChanges     = 0;
+    queue->numVertexArrayChanges = 0;
+    
+    for( i = 0; i < queue->numPackets; i++ )
+    {
+        const ESDrawPacket *packet = &queue->packets[ queue->order[i] ];
+        
+        if( packet->program != program )
+        {
+            program = packet->program;
+            queue->numProgramChanges++;
+        }
+        
+        if( packet->vertexArray != vertexArray )
+        {
+            vertexArray = packet->vertexArray;
+            queue->numVertexArrayChanges++;
+        }
+        
+        esStateUseProgram( cache, packet->program );
+        esStateBindVertexArray( cache, packet->vertexArray );
+        
+        for( unit = 0; unit < ES_DRAW_MAX_TEXTURES; unit++ )
+        {
+            if( packet->textures[unit] != 0 )
+            {
+                esStateBindTexture( cache, unit, GL_TEXTURE_2D, packet->textures[unit] );
+            }
+        }
+        
+        if( packet->setup != NULL )
+        {
+            packet->setup( packet->setupArg );
+        }
+        
+        if( packet->indexType != 0 )
+        {
+            if( packet->instanceCount > 1 )
+            {
+                gl->drawElementsInstanced( packet->mode, packet->count, packet->indexType,
+                                           ( const void * ) packet->first, packet->instanceCount );
+            }
+            else
+            {
+                gl->drawElements( packet->mode, packet->count, packet->indexType, ( const void * ) packet->first );
+            }
+        }
+        else
+        {
+            if( packet->instanceCount > 1 )
+            {
+                gl->drawArraysInstanced( packet->mode, ( GLint ) packet->first, packet->count, packet->instanceCount );
+            }
+            else
+            {
+                gl->drawArrays( packet->mode, ( GLint ) packet->first, packet->count );
+            }
+        }
+        
+        queue->numDraws++;
+    }
+    
+    esDrawQueueReset( queue );
+}
@@ -0,0 +1,105 @@
+//
+//  ESDrawQueue.h
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+
+#ifndef ESDrawQueue_h
+#define ESDrawQueue_h
+
+#include "ESUtil.h"
+#include "ESStateCache.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// Textures a packet can bind, on units 0 .. ES_DRAW_MAX_TEXTURES - 1
+#define ES_DRAW_MAX_TEXTURES 4
+
+// Per-packet hook run after the packet's program, VAO and textures are bound, e.g. to set uniforms
+typedef void ( ESCALLBACK *ESDrawSetupFunc )( void *arg );
+
+typedef struct
+{
+    GLuint    program;
+    GLuint    vertexArray;
+    // GL_TEXTURE_2D textures, 0 leaves the unit alone
+    GLuint    textures[ES_DRAW_MAX_TEXTURES];
+    
+    GLenum    mode;
+    // GL_UNSIGNED_BYTE/SHORT/INT for indexed draws, 0 for glDrawArrays
+    GLenum    indexType;
+    // first vertex, or the byte offset ( client pointer ) of the first index
+    GLintptr  first;
+    GLsizei   count;
+    // 0 or 1 is a plain draw, more goes through the instanced entry points
+    GLsizei   instanceCount;
+    
+    // view space distance, sorts opaque packets front to back and translucent ones back to front
+    GLfloat   depth;
+    GLboolean translucent;
+    
+    ESDrawSetupFunc setup;
+    void           *setupArg;
+} ESDrawPacket;
+
+// GL draw entry points used by the queue, swap them out to check the emitted order without a GPU
+typedef struct
+{
+    void ( GL_APIENTRY *drawArrays )( GLenum mode, GLint first, GLsizei count );
+    void ( GL_APIENTRY *drawElements )( GLenum mode, GLsizei count, GLenum type, const void *indices );
+    void ( GL_APIENTRY *drawArraysInstanced )( GLenum mode, GLint first, GLsizei count, GLsizei instanceCount );
+    void ( GL_APIENTRY *drawElementsInstanced )( GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instanceCount );
+} ESDrawQueueGL;
+
+typedef struct
+{
+    const ESDrawQueueGL *gl;
+    
+    ESDrawPacket       *packets;
+    // sort key and packet index, sorted together
+    unsigned long long *keys;
+    unsigned int       *order;
+    // radix sort scratch
+    unsigned long long *tmpKeys;
+    unsigned int       *tmpOrder;
+    int                 numPackets;
+    int                 capacity;
+    GLboolean           sorted;
+    
+    // draws emitted by the last flush, and how often it had to switch program/vertex array
+    unsigned int numDraws;
+    unsigned int numProgramChanges;
+    unsigned int numVertexArrayChanges;
+} ESDrawQueue;
+
+// install the GL entry points used by queues initialized afterwards, NULL restores the real GL
+void ESUTIL_API esDrawQueueSetBackend( const ESDrawQueueGL *backend );
+// allocate room for capacity packets, the queue grows when more are submitted
+GLboolean ESUTIL_API esDrawQueueInit( ESDrawQueue *queue, int capacity );
+void ESUTIL_API esDrawQueueDestroy( ESDrawQueue *queue );
+// drop the queued packets without drawing them
+void ESUTIL_API esDrawQueueReset( ESDrawQueue *queue );
+// copy packet into the queue, returns GL_FALSE if the queue could not grow
+GLboolean ESUTIL_API esDrawQueueSubmit( ESDrawQueue *queue, const ESDrawPacket *packet );
+// order the queued packets by their sort key
+void ESUTIL_API esDrawQueueSort( ESDrawQueue *queue );
+// sort if needed, emit every packet through cache and empty the queue
+void ESUTIL_API esDrawQueueFlush( ESDrawQueue *queue, ESStateCache *cache );
+// 64 bit key of a packet: translucency, then program, vertex array and first texture for opaque
+// packets ( depth for translucent ones ), then depth
+unsigned long long ESUTIL_API esDrawPacketKey( const ESDrawPacket *packet );
+
+// Stable LSD radix sort of count keys, values are moved along with them.
+// tmpKeys/tmpValues must hold count entries; bytes that are equal in every key are skipped
+void ESUTIL_API esRadixSort64( unsigned long long *keys, unsigned int *values,
+                               unsigned long long *tmpKeys, unsigned int *tmpValues, int count );
+                               
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESDrawQueue_h */
@@ -0,0 +1,451 @@
+//
+//  ESGLTrace.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  GL call counters. Every wrapper bumps the counter of its entry point and
+//  forwards the call to a dispatch table, the real GL unless a stub was
+//  installed. Built with ES_GL_TRACE the gl* names of every source including
+//  ESUtil.h turn into the wrappers, so the library, its backend tables and
+//  the samples are counted as they are.
+//
+
+#define ES_GL_TRACE_NO_REDIRECT
+#include "ESGLTrace.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+#define ES_GL_REAL( ID, Name, field, params, args )                  gl##Name,
+#define ES_GL_REAL_VALUE( type, ID, Name, field, params, args )      gl##Name,
+#define ES_GL_NAME( ID, Name, field, params, args )                  "gl" #Name,
+#define ES_GL_NAME_VALUE( type, ID, Name, field, params, args )      "gl" #Name,
+#define ES_GL_NOOP( ID, Name, field, params, args )                  esGLNoop##Name,
+#define ES_GL_NOOP_VALUE( type, ID, Name, field, params, args )      esGLNoop##Name,
+
+static const ESGLDispatch glReal =
+{
+    ES_GL_FUNCTIONS( ES_GL_REAL, ES_GL_REAL_VALUE )
+    ES_GL_MEASURED_FUNCTIONS( ES_GL_REAL, ES_GL_REAL_VALUE )
+};
+
+static const char *const glFunctionNames[ES_GL_NUM_FUNCTIONS] =
+{
+    ES_GL_FUNCTIONS( ES_GL_NAME, ES_GL_NAME_VALUE )
+    ES_GL_MEASURED_FUNCTIONS( ES_GL_NAME, ES_GL_NAME_VALUE )
+};
+
+// Entry points that add up to ESGLCounters.stateChanges
+static const int glStateFunctions[] =
+{
+    ES_GL_ACTIVE_TEXTURE,
+    ES_GL_BIND_BUFFER,
+    ES_GL_BIND_FRAMEBUFFER,
+    ES_GL_BIND_RENDERBUFFER,
+    ES_GL_BIND_TEXTURE,
+    ES_GL_BIND_VERTEX_ARRAY,
+    ES_GL_CLEAR_COLOR,
+    ES_GL_DISABLE_VERTEX_ATTRIB_ARRAY,
+    ES_GL_ENABLE_VERTEX_ATTRIB_ARRAY,
+    ES_GL_PIXEL_STOREI,
+    ES_GL_TEX_PARAMETERI,
+    ES_GL_USE_PROGRAM,
+    ES_GL_VERTEX_ATTRIB_4F,
+    ES_GL_VERTEX_ATTRIB_DIVISOR,
+    ES_GL_VERTEX_ATTRIB_POINTER,
+    ES_GL_VIEWPORT,
+};
+
+static const ESGLDispatch *glBackend = &glReal;
+
+// frame in progress and the last finished one
+static ESGLCounters glCounters;
+static ESGLCounters glFrameCounters;
+
+#define ES_GL_COUNT( ID, Name, field, params, args ) \
+    void GL_APIENTRY esGL##Name params \
+    { \
+        glCounters.calls[ES_GL_##ID]++; \
+        glBackend->field args; \
+    }
+#define ES_GL_COUNT_VALUE( type, ID, Name, field, params, args ) \
+    type GL_APIENTRY esGL##Name params \
+    { \
+        glCounters.calls[ES_GL_##ID]++; \
+        return glBackend->field args; \
+    }
+
+ES_GL_FUNCTIONS( ES_GL_COUNT, ES_GL_COUNT_VALUE )
+
+// esGLBufferData()
+void GL_APIENTRY esGLBufferData( GLenum target, GLsizeiptr size, const void *data, GLenum usage )
+{
+    glCounters.calls[ES_GL_BUFFER_DATA]++;
+    
+    // Without data the store is only allocated, nothing is uploaded
+    if( data != NULL && size > 0 )
+    {
+        glCounters.bufferDataBytes += ( unsigned long long ) size;
+    }
+    
+    glBackend->bufferData( target, size, data, usage );
+}
+
+// esGLBufferSubData()
+void GL_APIENTRY esGLBufferSubData( GLenum target, GLintptr offset, GLsizeiptr size, const void *data )
+{
+    glCounters.calls[ES_GL_BUFFER_SUB_DATA]++;
+    
+    if( size > 0 )
+    {
+        glCounters.bufferSubDataBytes += ( unsigned long long ) size;
+    }
+    
+    glBackend->bufferSubData( target, offset, size, data );
+}
+
+// esGLMapBufferRange()
+void *GL_APIENTRY esGLMapBufferRange( GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access )
+{
+    void *ptr;
+    
+    glCounters.calls[ES_GL_MAP_BUFFER_RANGE]++;
+    ptr = glBackend->mapBufferRange( target, offset, length, access );
+    
+    if( ptr != NULL )
+    {
+        glCounters.mappedBytes += ( unsigned long long ) length;
+    }
+    
+    return ptr;
+}
+
+// esGLDrawArrays()
+void GL_APIENTRY esGLDrawArrays( GLenum mode, GLint first, GLsizei count )
+{
+    glCounters.calls[ES_GL_DRAW_ARRAYS]++;
+    glCounters.drawCalls++;
+    glCounters.instances++;
+    glCounters.vertices += ( unsigned long long ) count;
+    
+    glBackend->drawArrays( mode, first, count );
+}
+
+// esGLDrawArraysInstanced()
+void GL_APIENTRY esGLDrawArraysInstanced( GLenum mode, GLint first, GLsizei count, GLsizei instancecount )
+{
+    glCounters.calls[ES_GL_DRAW_ARRAYS_INSTANCED]++;
+    glCounters.drawCalls++;
+    glCounters.instances += ( unsigned long long ) instancecount;
+    glCounters.vertices  += ( unsigned long long ) count;
+    
+    glBackend->drawArraysInstanced( mode, first, count, instancecount );
+}
+
+// esGLDrawElements()
+void GL_APIENTRY esGLDrawElements( GLenum mode, GLsizei count, GLenum type, const void *indices )
+{
+    glCounters.calls[ES_GL_DRAW_ELEMENTS]++;
+    glCounters.drawCalls++;
+    glCounters.instances++;
+    glCounters.indices += ( unsigned long long ) count;
+    
+    glBackend->drawElements( mode, count, type, indices );
+}
+
+// esGLDrawElementsInstanced()
+void GL_APIENTRY esGLDrawElementsInstanced( GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instancecount )
+{
+    glCounters.calls[ES_GL_DRAW_ELEMENTS_INSTANCED]++;
+    glCounters.drawCalls++;
+    glCounters.instances += ( unsigned long long ) instancecount;
+    glCounters.indices   += ( unsigned long long ) count;
+    
+    glBackend->drawElementsInstanced( mode, count, type, indices, instancecount );
+}
+
+//
+// Stub backend
+//
+
+// last name handed out by the stub
+static GLuint glStubNames;
+
+// Buffer targets the stub can map, each mapping gets memory of its own until it is unmapped
+static const GLenum glStubTargets[] =
+{
+    GL_ARRAY_BUFFER,
+    GL_ELEMENT_ARRAY_BUFFER,
+    GL_COPY_READ_BUFFER,
+    GL_COPY_WRITE_BUFFER,
+    GL_PIXEL_PACK_BUFFER,
+    GL_PIXEL_UNPACK_BUFFER,
+    GL_TRANSFORM_FEEDBACK_BUFFER,
+    GL_UNIFORM_BUFFER,
+};
+
+#define ES_GL_STUB_NUM_TARGETS ( int ) ( sizeof( glStubTargets ) / sizeof( glStubTargets[0] ) )
+
+static void *glStubMapped[ES_GL_STUB_NUM_TARGETS];
+
+// Never defined, only named in sizeof so the no-ops use their parameters without evaluating them
+int esGLNoopUse( int unused, ... );
+#define ES_GL_NOOP_USE( ... ) ( void ) sizeof( esGLNoopUse( 0, ##__VA_ARGS__ ) )
+
+#define ES_GL_DEFINE_NOOP( ID, Name, field, params, args ) \
+    static void GL_APIENTRY esGLNoop##Name params \
+    { \
+        ES_GL_NOOP_USE args; \
+    }
+#define ES_GL_DEFINE_NOOP_VALUE( type, ID, Name, field, params, args ) \
+    static type GL_APIENTRY esGLNoop##Name params \
+    { \
+        ES_GL_NOOP_USE args; \
+        return ( type ) 0; \
+    }
+
+ES_GL_FUNCTIONS( ES_GL_DEFINE_NOOP, ES_GL_DEFINE_NOOP_VALUE )
+ES_GL_MEASURED_FUNCTIONS( ES_GL_DEFINE_NOOP, ES_GL_DEFINE_NOOP_VALUE )
+
+static ESGLDispatch glStub =
+{
+    ES_GL_FUNCTIONS( ES_GL_NOOP, ES_GL_NOOP_VALUE )
+    ES_GL_MEASURED_FUNCTIONS( ES_GL_NOOP, ES_GL_NOOP_VALUE )
+};
+
+// glGenBuffers, glGenTextures and the like
+static void GL_APIENTRY esGLStubGenNames( GLsizei n, GLuint *names )
+{
+    GLsizei i;
+    
+    for( i = 0; i < n; i++ )
+    {
+        names[i] = ++glStubNames;
+    }
+}
+
+static GLuint GL_APIENTRY esGLStubCreateName( void )
+{
+    return ++glStubNames;
+}
+
+static GLuint GL_APIENTRY esGLStubCreateShaderName( GLenum type )
+{
+    ( void ) type;
+    
+    return ++glStubNames;
+}
+
+static GLenum GL_APIENTRY esGLStubFramebufferComplete( GLenum target )
+{
+    ( void ) target;
+    
+    return GL_FRAMEBUFFER_COMPLETE;
+}
+
+static GLsync GL_APIENTRY esGLStubFence( GLenum condition, GLbitfield flags )
+{
+    ( void ) condition;
+    ( void ) flags;
+    
+    return ( GLsync ) &glStub;
+}
+
+static GLenum GL_APIENTRY esGLStubSignaled( GLsync sync, GLbitfield flags, GLuint64 timeout )
+{
+    ( void ) sync;
+    ( void ) flags;
+    ( void ) timeout;
+    
+    return GL_ALREADY_SIGNALED;
+}
+
+static void GL_APIENTRY esGLStubGetZero( GLenum pname, GLint *data )
+{
+    ( void ) pname;
+    
+    *data = 0;
+}
+
+// glGetShaderiv and glGetProgramiv: every status is GL_TRUE, logs and binaries are empty
+static void GL_APIENTRY esGLStubGetObjectiv( GLuint object, GLenum pname, GLint *params )
+{
+    ( void ) object;
+    
+    *params = pname == GL_COMPILE_STATUS || pname == GL_LINK_STATUS || pname == GL_VALIDATE_STATUS ||
+              pname == GL_COMPLETION_STATUS_KHR;
+}
+
+static void GL_APIENTRY esGLStubGetInfoLog( GLuint object, GLsizei bufSize, GLsizei *length, GLchar *infoLog )
+{
+    ( void ) object;
+    
+    if( length != NULL )
+    {
+        *length = 0;
+    }
+    
+    if( bufSize > 0 )
+    {
+        infoLog[0] = '\0';
+    }
+}
+
+static void GL_APIENTRY esGLStubGetProgramBinary( GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary )
+{
+    ( void ) program;
+    ( void ) bufSize;
+    ( void ) binary;
+    
+    if( length != NULL )
+    {
+        *length = 0;
+    }
+    
+    *binaryFormat = 0;
+}
+
+static const GLubyte *GL_APIENTRY esGLStubGetString( GLenum name )
+{
+    return ( const GLubyte * ) ( name == GL_EXTENSIONS ? "" : "ESGLTrace stub" );
+}
+
+static int esGLStubTarget( GLenum target )
+{
+    int i;
+    
+    for( i = 0; i < ES_GL_STUB_NUM_TARGETS; i++ )
+    {
+        if( glStubTargets[i] == target )
+        {
+            return i;
+        }
+    }
+    
+    return -1;
+}
+
+// Like GL, a target that is already mapped cannot be mapped again before it is unmapped
+static void *GL_APIENTRY esGLStubMapBufferRange( GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access )
+{
+    int index = esGLStubTarget( target );
+    
+    ( void ) offset;
+    ( void ) access;
+    
+    if( index < 0 || length <= 0 || glStubMapped[index] != NULL )
+    {
+        return NULL;
+    }
+    
+    glStubMapped[index] = malloc( ( size_t ) length );
+    
+    return glStubMapped[index];
+}
+
+static GLboolean GL_APIENTRY esGLStubUnmapBuffer( GLenum target )
+{
+    int index = esGLStubTarget( target );
+    
+    if( index < 0 || glStubMapped[index] == NULL )
+    {
+        return GL_FALSE;
+    }
+    
+    free( glStubMapped[index] );
+    glStubMapped[index] = NULL;
+    
+    return GL_TRUE;
+}
+
+// esGLSetBackend()
+void ESUTIL_API esGLSetBackend( const ESGLDispatch *backend )
+{
+    glBackend = backend != NULL ? backend : &glReal;
+}
+
+// esGLStubBackend()
+const ESGLDispatch *ESUTIL_API esGLStubBackend( void )
+{
+    // Everything else stays a no-op returning 0
+    glStub.genBuffers             = esGLStubGenNames;
+    glStub.genFramebuffers        = esGLStubGenNames;
+    glStub.genRenderbuffers       = esGLStubGenNames;
+    glStub.genTextures            = esGLStubGenNames;
+    glStub.genVertexArrays        = esGLStubGenNames;
+    glStub.createProgram          = esGLStubCreateName;
+    glStub.createShader           = esGLStubCreateShaderName;
+    glStub.checkFramebufferStatus = esGLStubFramebufferComplete;
+    glStub.fenceSync              = esGLStubFence;
+    glStub.clientWaitSync         = esGLStubSignaled;
+    glStub.getIntegerv            = esGLStubGetZero;
+    glStub.getShaderiv            = esGLStubGetObjectiv;
+    glStub.getProgramiv           = esGLStubGetObjectiv;
+    glStub.getShaderInfoLog       = esGLStubGetInfoLog;
+    glStub.getProgramInfoLog      = esGLStubGetInfoLog;
+    glStub.getProgramBinary       = esGLStubGetProgramBinary;
+    glStub.getString              = esGLStubGetString;
+    glStub.mapBufferRange         = esGLStubMapBufferRange;
+    glStub.unmapBuffer            = esGLStubUnmapBuffer;
+    
+    return &glStub;
+}
+
+//
+// Counters
+//
+
+// copy source and fill in the totals
+static void esGLSumCounters( const ESGLCounters *source, ESGLCounters *counters )
+{
+    int i;
+    
+    *counters = *source;
+    counters->totalCalls   = 0;
+    counters->stateChanges = 0;
+    
+    for( i = 0; i < ES_GL_NUM_FUNCTIONS; i++ )
+    {
+        counters->totalCalls += counters->calls[i];
+    }
+    
+    for( i = 0; i < ( int ) ( sizeof( glStateFunctions ) / sizeof( glStateFunctions[0] ) ); i++ )
+    {
+        counters->stateChanges += counters->calls[glStateFunctions[i]];
+    }
+}
+
+// esGLEndFrame()
+void ESUTIL_API esGLEndFrame( void )
+{
+    glFrameCounters = glCounters;
+    memset( &glCounters, 0, sizeof( ESGLCounters ) );
+}
+
+// esGLGetFrameCounters()
+void ESUTIL_API esGLGetFrameCounters( ESGLCounters *counters )
+{
+    esGLSumCounters( &glFrameCounters, counters );
+}
+
+// esGLGetCounters()
+void ESUTIL_API esGLGetCounters( ESGLCounters *counters )
+{
+    esGLSumCounters( &glCounters, counters );
+}
+
+// esGLFunctionName()
+const char *ESUTIL_API esGLFunctionName( int function )
+{
+    if( function < 0 || function >= ES_GL_NUM_FUNCTIONS )
+    {
+        return NULL;
+    }
+    
+    return glFunctionNames[function];
+}
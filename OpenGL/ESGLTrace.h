@@ -0,0 +1,220 @@
+//
+//  ESGLTrace.h
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+
+#ifndef ESGLTrace_h
+#define ESGLTrace_h
+
+#include "ESUtil.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// Every GL entry point ESUtil and the samples call, as
+// FN( ID, Name, field, ( params ), ( args ) ) or FN_VALUE( type, ID, Name, field, ( params ), ( args ) ).
+// esGL<Name> counts a call to gl<Name> and forwards it to the backend's field
+#define ES_GL_FUNCTIONS( FN, FN_VALUE ) \
+    FN( ACTIVE_TEXTURE, ActiveTexture, activeTexture, ( GLenum texture ), ( texture ) ) \
+    FN( ATTACH_SHADER, AttachShader, attachShader, ( GLuint program, GLuint shader ), ( program, shader ) ) \
+    FN( BIND_BUFFER, BindBuffer, bindBuffer, ( GLenum target, GLuint buffer ), ( target, buffer ) ) \
+    FN( BIND_FRAMEBUFFER, BindFramebuffer, bindFramebuffer, ( GLenum target, GLuint framebuffer ), ( target, framebuffer ) ) \
+    FN( BIND_RENDERBUFFER, BindRenderbuffer, bindRenderbuffer, ( GLenum target, GLuint renderbuffer ), ( target, renderbuffer ) ) \
+    FN( BIND_TEXTURE, BindTexture, bindTexture, ( GLenum target, GLuint texture ), ( target, texture ) ) \
+    FN( BIND_VERTEX_ARRAY, BindVertexArray, bindVertexArray, ( GLuint array ), ( array ) ) \
+    FN_VALUE( GLenum, CHECK_FRAMEBUFFER_STATUS, CheckFramebufferStatus, checkFramebufferStatus, ( GLenum target ), ( target ) ) \
+    FN( CLEAR, Clear, clear, ( GLbitfield mask ), ( mask ) ) \
+    FN( CLEAR_COLOR, ClearColor, clearColor, ( GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha ), ( red, green, blue, alpha ) ) \
+    FN_VALUE( GLenum, CLIENT_WAIT_SYNC, ClientWaitSync, clientWaitSync, ( GLsync sync, GLbitfield flags, GLuint64 timeout ), ( sync, flags, timeout ) ) \
+    FN( COMPILE_SHADER, CompileShader, compileShader, ( GLuint shader ), ( shader ) ) \
+    FN_VALUE( GLuint, CREATE_PROGRAM, CreateProgram, createProgram, ( void ), () ) \
+    FN_VALUE( GLuint, CREATE_SHADER, CreateShader, createShader, ( GLenum type ), ( type ) ) \
+    FN( DELETE_BUFFERS, DeleteBuffers, deleteBuffers, ( GLsizei n, const GLuint *buffers ), ( n, buffers ) ) \
+    FN( DELETE_PROGRAM, DeleteProgram, deleteProgram, ( GLuint program ), ( program ) ) \
+    FN( DELETE_SHADER, DeleteShader, deleteShader, ( GLuint shader ), ( shader ) ) \
+    FN( DELETE_SYNC, DeleteSync, deleteSync, ( GLsync sync ), ( sync ) ) \
+    FN( DELETE_VERTEX_ARRAYS, DeleteVertexArrays, deleteVertexArrays, ( GLsizei n, const GLuint *arrays ), ( n, arrays ) ) \
+    FN( DISABLE_VERTEX_ATTRIB_ARRAY, DisableVertexAttribArray, disableVertexAttribArray, ( GLuint index ), ( index ) ) \
+    FN( ENABLE_VERTEX_ATTRIB_ARRAY, EnableVertexAttribArray, enableVertexAttribArray, ( GLuint index ), ( index ) ) \
+    FN_VALUE( GLsync, FENCE_SYNC, FenceSync, fenceSync, ( GLenum condition, GLbitfield flags ), ( condition, flags ) ) \
+    FN( FLUSH, Flush, flush, ( void ), () ) \
+    FN( FRAMEBUFFER_RENDERBUFFER, FramebufferRenderbuffer, framebufferRenderbuffer, ( GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer ), ( target, attachment, renderbuffertarget, renderbuffer ) ) \
+    FN( GEN_BUFFERS, GenBuffers, genBuffers, ( GLsizei n, GLuint *buffers ), ( n, buffers ) ) \
+    FN( GEN_FRAMEBUFFERS, GenFramebuffers, genFramebuffers, ( GLsizei n, GLuint *framebuffers ), ( n, framebuffers ) ) \
+    FN( GEN_RENDERBUFFERS, GenRenderbuffers, genRenderbuffers, ( GLsizei n, GLuint *renderbuffers ), ( n, renderbuffers ) ) \
+    FN( GEN_TEXTURES, GenTextures, genTextures, ( GLsizei n, GLuint *textures ), ( n, textures ) ) \
+    FN( GEN_VERTEX_ARRAYS, GenVertexArrays, genVertexArrays, ( GLsizei n, GLuint *arrays ), ( n, arrays ) ) \
+    FN( GENERATE_MIPMAP, GenerateMipmap, generateMipmap, ( GLenum target ), ( target ) ) \
+    FN( GET_INTEGERV, GetIntegerv, getIntegerv, ( GLenum pname, GLint *data ), ( pname, data ) ) \
+    FN( GET_PROGRAM_BINARY, GetProgramBinary, getProgramBinary, ( GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary ), ( program, bufSize, length, binaryFormat, binary ) ) \
+    FN( GET_PROGRAM_INFO_LOG, GetProgramInfoLog, getProgramInfoLog, ( GLuint program, GLsizei bufSize, GLsizei *length, GLchar *infoLog ), ( program, bufSize, length, infoLog ) ) \
+    FN( GET_PROGRAMIV, GetProgramiv, getProgramiv, ( GLuint program, GLenum pname, GLint *params ), ( program, pname, params ) ) \
+    FN( GET_SHADER_INFO_LOG, GetShaderInfoLog, getShaderInfoLog, ( GLuint shader, GLsizei bufSize, GLsizei *length, GLchar *infoLog ), ( shader, bufSize, length, infoLog ) ) \
+    FN( GET_SHADERIV, GetShaderiv, getShaderiv, ( GLuint shader, GLenum pname, GLint *params ), ( shader, pname, params ) ) \
+    FN_VALUE( const GLubyte *, GET_STRING, GetString, getString, ( GLenum name ), ( name ) ) \
+    FN_VALUE( GLint, GET_UNIFORM_LOCATION, GetUniformLocation, getUniformLocation, ( GLuint program, const GLchar *name ), ( program, name ) ) \
+    FN( LINK_PROGRAM, LinkProgram, linkProgram, ( GLuint program ), ( program ) ) \
+    FN( PIXEL_STOREI, PixelStorei, pixelStorei, ( GLenum pname, GLint param ), ( pname, param ) ) \
+    FN( PROGRAM_BINARY, ProgramBinary, programBinary, ( GLuint program, GLenum binaryFormat, const void *binary, GLsizei length ), ( program, binaryFormat, binary, length ) ) \
+    FN( PROGRAM_PARAMETERI, ProgramParameteri, programParameteri, ( GLuint program, GLenum pname, GLint value ), ( program, pname, value ) ) \
+    FN( RENDERBUFFER_STORAGE, RenderbufferStorage, renderbufferStorage, ( GLenum target, GLenum internalformat, GLsizei width, GLsizei height ), ( target, internalformat, width, height ) ) \
+    FN( SHADER_SOURCE, ShaderSource, shaderSource, ( GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length ), ( shader, count, string, length ) ) \
+    FN( TEX_IMAGE_2D, TexImage2D, texImage2D, ( GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels ), ( target, level, internalformat, width, height, border, format, type, pixels ) ) \
+    FN( TEX_PARAMETERI, TexParameteri, texParameteri, ( GLenum target, GLenum pname, GLint param ), ( target, pname, param ) ) \
+    FN( UNIFORM_1F, Uniform1f, uniform1f, ( GLint location, GLfloat v0 ), ( location, v0 ) ) \
+    FN( UNIFORM_MATRIX_4FV, UniformMatrix4fv, uniformMatrix4fv, ( GLint location, GLsizei count, GLboolean transpose, const GLfloat *value ), ( location, count, transpose, value ) ) \
+    FN_VALUE( GLboolean, UNMAP_BUFFER, UnmapBuffer, unmapBuffer, ( GLenum target ), ( target ) ) \
+    FN( USE_PROGRAM, UseProgram, useProgram, ( GLuint program ), ( program ) ) \
+    FN( VERTEX_ATTRIB_4F, VertexAttrib4f, vertexAttrib4f, ( GLuint index, GLfloat x, GLfloat y, GLfloat z, GLfloat w ), ( index, x, y, z, w ) ) \
+    FN( VERTEX_ATTRIB_DIVISOR, VertexAttribDivisor, vertexAttribDivisor, ( GLuint index, GLuint divisor ), ( index, divisor ) ) \
+    FN( VERTEX_ATTRIB_POINTER, VertexAttribPointer, vertexAttribPointer, ( GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer ), ( index, size, type, normalized, stride, pointer ) ) \
+    FN( VIEWPORT, Viewport, viewport, ( GLint x, GLint y, GLsizei width, GLsizei height ), ( x, y, width, height ) )
+
+// Entry points whose wrappers also add up bytes or draws
+#define ES_GL_MEASURED_FUNCTIONS( FN, FN_VALUE ) \
+    FN( BUFFER_DATA, BufferData, bufferData, ( GLenum target, GLsizeiptr size, const void *data, GLenum usage ), ( target, size, data, usage ) ) \
+    FN( BUFFER_SUB_DATA, BufferSubData, bufferSubData, ( GLenum target, GLintptr offset, GLsizeiptr size, const void *data ), ( target, offset, size, data ) ) \
+    FN( DRAW_ARRAYS, DrawArrays, drawArrays, ( GLenum mode, GLint first, GLsizei count ), ( mode, first, count ) ) \
+    FN( DRAW_ARRAYS_INSTANCED, DrawArraysInstanced, drawArraysInstanced, ( GLenum mode, GLint first, GLsizei count, GLsizei instancecount ), ( mode, first, count, instancecount ) ) \
+    FN( DRAW_ELEMENTS, DrawElements, drawElements, ( GLenum mode, GLsizei count, GLenum type, const void *indices ), ( mode, count, type, indices ) ) \
+    FN( DRAW_ELEMENTS_INSTANCED, DrawElementsInstanced, drawElementsInstanced, ( GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instancecount ), ( mode, count, type, indices, instancecount ) ) \
+    FN_VALUE( void *, MAP_BUFFER_RANGE, MapBufferRange, mapBufferRange, ( GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access ), ( target, offset, length, access ) )
+
+#define ES_GL_ENUM( ID, Name, field, params, args )                  ES_GL_##ID,
+#define ES_GL_ENUM_VALUE( type, ID, Name, field, params, args )      ES_GL_##ID,
+#define ES_GL_FIELD( ID, Name, field, params, args )                 void ( GL_APIENTRY *field ) params;
+#define ES_GL_FIELD_VALUE( type, ID, Name, field, params, args )     type ( GL_APIENTRY *field ) params;
+#define ES_GL_WRAPPER( ID, Name, field, params, args )               void GL_APIENTRY esGL##Name params;
+#define ES_GL_WRAPPER_VALUE( type, ID, Name, field, params, args )   type GL_APIENTRY esGL##Name params;
+
+// Wrapped entry points, used to index ESGLCounters.calls
+enum
+{
+    ES_GL_FUNCTIONS( ES_GL_ENUM, ES_GL_ENUM_VALUE )
+    ES_GL_MEASURED_FUNCTIONS( ES_GL_ENUM, ES_GL_ENUM_VALUE )
+    ES_GL_NUM_FUNCTIONS
+};
+
+// GL entry points the wrappers forward to, swap them for a stub to run without a GPU
+typedef struct
+{
+    ES_GL_FUNCTIONS( ES_GL_FIELD, ES_GL_FIELD_VALUE )
+    ES_GL_MEASURED_FUNCTIONS( ES_GL_FIELD, ES_GL_FIELD_VALUE )
+} ESGLDispatch;
+
+typedef struct
+{
+    // calls per entry point
+    unsigned int calls[ES_GL_NUM_FUNCTIONS];
+    unsigned int totalCalls;
+    // binds, attribute setup, viewport and other state setting calls
+    unsigned int stateChanges;
+    
+    // bytes handed to glBufferData ( non-NULL data only ), glBufferSubData and mapped by glMapBufferRange
+    unsigned long long bufferDataBytes;
+    unsigned long long bufferSubDataBytes;
+    unsigned long long mappedBytes;
+    
+    // glDraw* calls, the instances they drew ( 1 for the non-instanced ones ),
+    // and the count argument of the glDrawArrays* and glDrawElements* calls
+    unsigned int       drawCalls;
+    unsigned long long instances;
+    unsigned long long vertices;
+    unsigned long long indices;
+} ESGLCounters;
+
+// The wrappers, one per entry point. Building with ES_GL_TRACE routes every gl* call of the
+// sources that include ESUtil.h through them, without it they are only called explicitly.
+// Counting is not thread safe, only the thread with the current context may call them
+ES_GL_FUNCTIONS( ES_GL_WRAPPER, ES_GL_WRAPPER_VALUE )
+ES_GL_MEASURED_FUNCTIONS( ES_GL_WRAPPER, ES_GL_WRAPPER_VALUE )
+
+// install the GL entry points the wrappers forward to, NULL restores the real GL
+void ESUTIL_API esGLSetBackend( const ESGLDispatch *backend );
+// entry points that do nothing and report success: names are handed out, compiles and links
+// succeed, every mapped range gets scratch memory freed by its unmap. For running ESUtil without a GL context
+const ESGLDispatch *ESUTIL_API esGLStubBackend( void );
+// close the current frame, its counters become the ones esGLGetFrameCounters returns.
+// The esMainLoop/esRunFrames frame loop calls this after every swap
+void ESUTIL_API esGLEndFrame( void );
+// counters of the last frame closed by esGLEndFrame
+void ESUTIL_API esGLGetFrameCounters( ESGLCounters *counters );
+// counters of the frame in progress
+void ESUTIL_API esGLGetCounters( ESGLCounters *counters );
+// "glBindBuffer" for ES_GL_BIND_BUFFER and so on, NULL when out of range
+const char *ESUTIL_API esGLFunctionName( int function );
+
+// ESGLTrace.c defines ES_GL_TRACE_NO_REDIRECT to reach the real entry points
+#if defined( ES_GL_TRACE ) && !defined( ES_GL_TRACE_NO_REDIRECT )
+#define glActiveTexture            esGLActiveTexture
+#define glAttachShader             esGLAttachShader
+#define glBindBuffer               esGLBindBuffer
+#define glBindFramebuffer          esGLBindFramebuffer
+#define glBindRenderbuffer         esGLBindRenderbuffer
+#define glBindTexture              esGLBindTexture
+#define glBindVertexArray          esGLBindVertexArray
+#define glCheckFramebufferStatus   esGLCheckFramebufferStatus
+#define glClear                    esGLClear
+#define glClearColor               esGLClearColor
+#define glClientWaitSync           esGLClientWaitSync
+#define glCompileShader            esGLCompileShader
+#define glCreateProgram            esGLCreateProgram
+#define glCreateShader             esGLCreateShader
+#define glDeleteBuffers            esGLDeleteBuffers
+#define glDeleteProgram            esGLDeleteProgram
+#define glDeleteShader             esGLDeleteShader
+#define glDeleteSync               esGLDeleteSync
+#define glDeleteVertexArrays       esGLDeleteVertexArrays
+#define glDisableVertexAttribArray esGLDisableVertexAttribArray
+#define glEnableVertexAttribArray  esGLEnableVertexAttribArray
+#define glFenceSync                esGLFenceSync
+#define glFlush                    esGLFlush
+#define glFramebufferRenderbuffer  esGLFramebufferRenderbuffer
+#define glGenBuffers               esGLGenBuffers
+#define glGenFramebuffers          esGLGenFramebuffers
+#define glGenRenderbuffers         esGLGenRenderbuffers
+#define glGenTextures              esGLGenTextures
+#define glGenVertexArrays          esGLGenVertexArrays
+#define glGenerateMipmap           esGLGenerateMipmap
+#define glGetIntegerv              esGLGetIntegerv
+#define glGetProgramBinary         esGLGetProgramBinary
+#define glGetProgramInfoLog        esGLGetProgramInfoLog
+#define glGetProgramiv             esGLGetProgramiv
+#define glGetShaderInfoLog         esGLGetShaderInfoLog
+#define glGetShaderiv              esGLGetShaderiv
+#define glGetString                esGLGetString
+#define glGetUniformLocation       esGLGetUniformLocation
+#define glLinkProgram              esGLLinkProgram
+#define glPixelStorei              esGLPixelStorei
+#define glProgramBinary            esGLProgramBinary
+#define glProgramParameteri        esGLProgramParameteri
+#define glRenderbufferStorage      esGLRenderbufferStorage
+#define glShaderSource             esGLShaderSource
+#define glTexImage2D               esGLTexImage2D
+#define glTexParameteri            esGLTexParameteri
+#define glUniform1f                esGLUniform1f
+#define glUniformMatrix4fv         esGLUniformMatrix4fv
+#define glUnmapBuffer              esGLUnmapBuffer
+#define glUseProgram               esGLUseProgram
+#define glVertexAttrib4f           esGLVertexAttrib4f
+#define glVertexAttribDivisor      esGLVertexAttribDivisor
+#define glVertexAttribPointer      esGLVertexAttribPointer
+#define glViewport                 esGLViewport
+#define glBufferData               esGLBufferData
+#define glBufferSubData            esGLBufferSubData
+#define glDrawArrays               esGLDrawArrays
+#define glDrawArraysInstanced      esGLDrawArraysInstanced
+#define glDrawElements             esGLDrawElements
+#define glDrawElementsInstanced    esGLDrawElementsInstanced
+#define glMapBufferRange           esGLMapBufferRange
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESGLTrace_h */
@@ -0,0 +1,431 @@
+//
+//  ESImage.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  TGA loading without stdio. The file is mapped once; uncompressed images are
+//  handed out as a pointer into the mapping, everything else is decoded in a
+//  single pass straight into the caller's buffer.
+//
+
+#include "ESImage.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if ( defined( __GNUC__ ) || defined( __clang__ ) ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+// SSSE3 kernels are compiled per-function and picked at runtime
+#define ES_IMAGE_SSSE3 1
+#include <tmmintrin.h>
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#define ES_IMAGE_NEON 1
+#include <arm_neon.h>
+#endif
+
+#define TGA_HEADER_SIZE 18
+// descriptor bits
+#define TGA_RIGHT_TO_LEFT ( 1 << 4 )
+#define INVERTED_BIT      ( 1 << 5 )
+
+static unsigned short esReadLE16( const unsigned char *p )
+{
+    return ( unsigned short ) ( p[0] | ( p[1] << 8 ) );
+}
+
+//
+// BGR <-> RGB swizzle
+//
+
+static void esImageSwizzleScalar( unsigned char *dest, const unsigned char *src, int count, int channels )
+{
+    int i;
+    
+    for( i = 0; i < count; i++, dest += channels, src += channels )
+    {
+        unsigned char b = src[0];
+        
+        dest[0] = src[2];
+        dest[1] = src[1];
+        dest[2] = b;
+        
+        if( channels == 4 )
+        {
+            dest[3] = src[3];
+        }
+    }
+}
+
+#ifdef ES_IMAGE_SSSE3
+__attribute__ ( ( target( "ssse3" ) ) )
+static int esImageSwizzleSSSE3( unsigned char *dest, const unsigned char *src, int count, int channels )
+{
+    int i = 0;
+    
+    if( channels == 4 )
+    {
+        const __m128i mask = _mm_setr_epi8( 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15 );
+        
+        for( ; i + 4 <= count; i += 4 )
+        {
+            __m128i pixels = _mm_loadu_si128( ( const __m128i * ) ( src + i * 4 ) );
+            
+            _mm_storeu_si128( ( __m128i * ) ( dest + i * 4 ), _mm_shuffle_epi8( pixels, mask ) );
+        }
+    }
+    else
+    {
+        // Five pixels per register, the 16th byte is written back unchanged.
+        // Stop while a sixth pixel follows so the load and store stay inside the rows
+        const __m128i mask = _mm_setr_epi8( 2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15 );
+        
+        for( ; i + 6 <= count; i += 5 )
+        {
+            __m128i pixels = _mm_loadu_si128( ( const __m128i * ) ( src + i * 3 ) );
+            
+            _mm_storeu_si128( ( __m128i * ) ( dest + i * 3 ), _mm_shuffle_epi8( pixels, mask ) );
+        }
+    }
+    
+    return i;
+}
+#endif // ES_IMAGE_SSSE3
+
+#ifdef ES_IMAGE_NEON
+static int esImageSwizzleNEON( unsigned char *dest, const unsigned char *src, int count, int channels )
+{
+    int i = 0;
+    
+    if( channels == 4 )
+    {
+        for( ; i + 16 <= count; i += 16 )
+        {
+            uint8x16x4_t pixels = vld4q_u8( src + i * 4 );
+            uint8x16_t   blue   = pixels.val[0];
+            
+            pixels.val[0] = pixels.val[2];
+            pixels.val[2] = blue;
+            vst4q_u8( dest + i * 4, pixels );
+        }
+    }
+    else
+    {
+        for( ; i + 16 <= count; i += 16 )
+        {
+            uint8x16x3_t pixels = vld3q_u8( src + i * 3 );
+            uint8x16_t   blue   = pixels.val[0];
+            
+            pixels.val[0] = pixels.val[2];
+            pixels.val[2] = blue;
+            vst3q_u8( dest + i * 3, pixels );
+        }
+    }
+    
+    return i;
+}
+#endif // ES_IMAGE_NEON
+
+// esImageSwizzleBGR()
+void ESUTIL_API esImageSwizzleBGR( unsigned char *dest, const unsigned char *src, int count, int channels )
+{
+    int done = 0;
+
+#if defined( ES_IMAGE_SSSE3 )
+    static int hasSSSE3 = -1;
+    
+    if( hasSSSE3 < 0 )
+    {
+        // Racing threads all store the same value
+        __builtin_cpu_init();
+        hasSSSE3 = __builtin_cpu_supports( "ssse3" ) ? 1 : 0;
+    }
+    
+    if( hasSSSE3 )
+    {
+        done = esImageSwizzleSSSE3( dest, src, count, channels );
+    }
+#elif defined( ES_IMAGE_NEON )
+    done = esImageSwizzleNEON( dest, src, count, channels );
+#endif
+    
+    esImageSwizzleScalar( dest + done * channels, src + done * channels, count - done, channels );
+}
+
+// esImageOpenTGA()
+GLboolean ESUTIL_API esImageOpenTGA( ESImage *image, const char *fileName )
+{
+    const unsigned char *header;
+    int mapType;
+    int paletteDepth;
+    int descriptor;
+    int mapped;
+    size_t offset;
+    
+    memset( image, 0, sizeof( ESImage ) );
+    
+    image->data = esMapFile( fileName, &image->dataSize );
+    
+    if( image->data == NULL )
+    {
+        esLogMessage( " esImageOpenTGA FAILED to open : { %s }\n ", fileName );
+        return GL_FALSE;
+    }
+    
+    if( image->dataSize < TGA_HEADER_SIZE )
+    {
+        esLogMessage( " esImageOpenTGA: { %s } is too short\n ", fileName );
+        esImageClose( image );
+        return GL_FALSE;
+    }
+    
+    header = image->data;
+    mapType             = header[1];
+    image->imageType    = header[2];
+    image->paletteFirst = esReadLE16( header + 3 );
+    image->paletteSize  = esReadLE16( header + 5 );
+    paletteDepth        = header[7];
+    image->width        = esReadLE16( header + 12 );
+    image->height       = esReadLE16( header + 14 );
+    image->pixelDepth   = header[16];
+    descriptor          = header[17];
+    image->topDown      = ( descriptor & INVERTED_BIT ) ? GL_TRUE : GL_FALSE;
+    
+    mapped = image->imageType == ES_TGA_MAPPED || image->imageType == ES_TGA_RLE_MAPPED;
+    
+    switch( image->imageType )
+    {
+        case ES_TGA_TRUECOLOR:
+        case ES_TGA_RLE_TRUECOLOR:
+            image->channels = ( image->pixelDepth == 24 || image->pixelDepth == 32 ) ? image->pixelDepth / 8 : 0;
+            break;
+        case ES_TGA_GRAYSCALE:
+        case ES_TGA_RLE_GRAYSCALE:
+            image->channels = image->pixelDepth == 8 ? 1 : 0;
+            break;
+        case ES_TGA_MAPPED:
+        case ES_TGA_RLE_MAPPED:
+            image->channels = ( mapType == 1 && image->pixelDepth == 8 && ( paletteDepth == 24 || paletteDepth == 32 ) ) ?
+                              paletteDepth / 8 : 0;
+            break;
+        default:
+            image->channels = 0;
+            break;
+    }
+    
+    if( image->channels == 0 || image->width == 0 || image->height == 0 || ( descriptor & TGA_RIGHT_TO_LEFT ) )
+    {
+        esLogMessage( " esImageOpenTGA: { %s } has an unsupported format ( type %d, %d bits )\n ",
+                      fileName, image->imageType, image->pixelDepth );
+        esImageClose( image );
+        return GL_FALSE;
+    }
+    
+    // id field, then the color map, then the pixels
+    offset = TGA_HEADER_SIZE + header[0];
+    
+    if( mapType == 1 )
+    {
+        if( mapped )
+        {
+            image->palette = image->data + offset;
+        }
+        
+        offset += ( size_t ) image->paletteSize * ( ( paletteDepth + 7 ) / 8 );
+    }
+    
+    image->payloadOffset = offset;
+    
+    if( offset > image->dataSize )
+    {
+        esLogMessage( " esImageOpenTGA: { %s } is truncated\n ", fileName );
+        esImageClose( image );
+        return GL_FALSE;
+    }
+    
+    if( image->imageType == ES_TGA_TRUECOLOR || image->imageType == ES_TGA_GRAYSCALE )
+    {
+        if( image->dataSize - offset < esImageDecodedSize( image ) )
+        {
+            esLogMessage( " esImageOpenTGA: { %s } is truncated\n ", fileName );
+            esImageClose( image );
+            return GL_FALSE;
+        }
+        
+        // zero copy: stored pixels are the payload itself
+        image->pixels = image->data + offset;
+    }
+    
+    return GL_TRUE;
+}
+
+// esImageClose()
+void ESUTIL_API esImageClose( ESImage *image )
+{
+    if( image->data != NULL )
+    {
+        esUnmapFile( image->data, image->dataSize );
+    }
+    
+    memset( image, 0, sizeof( ESImage ) );
+}
+
+// esImageDecodedSize()
+size_t ESUTIL_API esImageDecodedSize( const ESImage *image )
+{
+    return ( size_t ) image->width * image->height * image->channels;
+}
+
+// destination of file row, rows are flipped so the bottom one ends up first
+static unsigned char *esImageRow( const ESImage *image, unsigned char *dest, int row )
+{
+    size_t rowSize = ( size_t ) image->width * image->channels;
+    
+    return dest + rowSize * ( image->topDown ? image->height - 1 - row : row );
+}
+
+// resolve one stored pixel to channels bytes, NULL for an index outside the color map
+static const unsigned char *esImageLookup( const ESImage *image, const unsigned char *src )
+{
+    int index;
+    
+    if( image->palette == NULL )
+    {
+        return src;
+    }
+    
+    index = src[0] - image->paletteFirst;
+    
+    return index >= 0 && index < image->paletteSize ? image->palette + index * image->channels : NULL;
+}
+
+// esImageDecode()
+GLboolean ESUTIL_API esImageDecode( const ESImage *image, void *dest )
+{
+    const unsigned char *src = image->data + image->payloadOffset;
+    const unsigned char *end = image->data + image->dataSize;
+    int channels  = image->channels;
+    int srcBytes  = image->pixelDepth / 8;
+    int rle       = image->imageType >= ES_TGA_RLE_MAPPED;
+    int x = 0;
+    int row = 0;
+    unsigned char *out;
+    
+    if( image->pixels != NULL )
+    {
+        size_t rowSize = ( size_t ) image->width * channels;
+        
+        // Uncompressed: copy and swizzle in the same pass over each row
+        for( row = 0; row < image->height; row++ )
+        {
+            out = esImageRow( image, dest, row );
+            
+            if( channels == 1 )
+            {
+                memcpy( out, image->pixels + rowSize * row, rowSize );
+            }
+            else
+            {
+                esImageSwizzleBGR( out, image->pixels + rowSize * row, image->width, channels );
+            }
+        }
+        
+        return GL_TRUE;
+    }
+    
+    out = esImageRow( image, dest, 0 );
+    
+    while( row < image->height )
+    {
+        int count;
+        int repeat = 0;
+        
+        if( rle )
+        {
+            if( src >= end )
+            {
+                return GL_FALSE;
+            }
+            
+            // packet header: high bit set for a run of one pixel, count - 1 in the low bits
+            repeat = *src & 0x80;
+            count  = ( *src++ & 0x7F ) + 1;
+        }
+        else
+        {
+            count = image->width - x;
+        }
+        
+        if( end - src < ( repeat ? 1 : count ) * srcBytes )
+        {
+            return GL_FALSE;
+        }
+        
+        // Packets may run across rows
+        while( count > 0 && row < image->height )
+        {
+            int n = count < image->width - x ? count : image->width - x;
+            unsigned char *pixel = out + x * channels;
+            int i;
+            
+            if( repeat )
+            {
+                const unsigned char *value = esImageLookup( image, src );
+                
+                if( value == NULL )
+                {
+                    return GL_FALSE;
+                }
+                
+                for( i = 0; i < n; i++, pixel += channels )
+                {
+                    memcpy( pixel, value, channels );
+                }
+            }
+            else if( image->palette == NULL )
+            {
+                memcpy( pixel, src, ( size_t ) n * channels );
+                src += n * channels;
+            }
+            else
+            {
+                for( i = 0; i < n; i++, pixel += channels, src++ )
+                {
+                    const unsigned char *value = esImageLookup( image, src );
+                    
+                    if( value == NULL )
+                    {
+                        return GL_FALSE;
+                    }
+                    
+                    memcpy( pixel, value, channels );
+                }
+            }
+            
+            x     += n;
+            count -= n;
+            
+            if( x == image->width )
+            {
+                x = 0;
+                
+                if( ++row < image->height )
+                {
+                    out = esImageRow( image, dest, row );
+                }
+            }
+        }
+        
+        if( repeat )
+        {
+            src += srcBytes;
+        }
+    }
+    
+    // Rows are contiguous, swizzle the whole image at once
+    if( channels > 1 )
+    {
+        esImageSwizzleBGR( dest, dest, image->width * image->height, channels );
+    }
+    
+    return GL_TRUE;
+}
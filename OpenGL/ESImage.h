@@ -0,0 +1,70 @@
+//
+//  ESImage.h
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+
+#ifndef ESImage_h
+#define ESImage_h
+
+#include "ESUtil.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// TGA image types
+#define ES_TGA_MAPPED          1
+#define ES_TGA_TRUECOLOR       2
+#define ES_TGA_GRAYSCALE       3
+#define ES_TGA_RLE_MAPPED      9
+#define ES_TGA_RLE_TRUECOLOR   10
+#define ES_TGA_RLE_GRAYSCALE   11
+
+typedef struct
+{
+    int width;
+    int height;
+    // channels of a decoded pixel: 1 ( grayscale ), 3 or 4 ( BGR/BGRA in the file, RGB/RGBA once decoded )
+    int channels;
+    int imageType;
+    // first row in the file is the top one ( descriptor bit 5 ), GL expects the bottom one first
+    GLboolean topDown;
+    
+    // Uncompressed, unmapped images only: the pixels as stored, pointing into the file mapping.
+    // Valid until esImageClose, NULL when the image has to go through esImageDecode
+    const unsigned char *pixels;
+    
+    // file mapping, owned by the image
+    const unsigned char *data;
+    size_t               dataSize;
+    size_t               payloadOffset;
+    // color map of ES_TGA_MAPPED / ES_TGA_RLE_MAPPED images, entries of channels bytes
+    // for the indices paletteFirst to paletteFirst + paletteSize - 1
+    const unsigned char *palette;
+    int                  paletteFirst;
+    int                  paletteSize;
+    // bits per pixel in the file
+    int                  pixelDepth;
+} ESImage;
+
+// memory-map a TGA file and parse its header, nothing is decoded or copied
+GLboolean ESUTIL_API esImageOpenTGA( ESImage *image, const char *fileName );
+// unmap the file, image->pixels becomes invalid
+void ESUTIL_API esImageClose( ESImage *image );
+// bytes esImageDecode writes: width * height * channels, rows tightly packed
+size_t ESUTIL_API esImageDecodedSize( const ESImage *image );
+// decode into dest as RGB/RGBA ( or grayscale ) rows, bottom row first as glTexImage2D expects.
+// Expands RLE and color maps, swizzles BGR and flips top-down images in one pass.
+// dest may be a pixel unpack buffer mapped with glMapBufferRange
+GLboolean ESUTIL_API esImageDecode( const ESImage *image, void *dest );
+// swap the first and third byte of count pixels of channels bytes ( 3 or 4 ), dest may be src
+void ESUTIL_API esImageSwizzleBGR( unsigned char *dest, const unsigned char *src, int count, int channels );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESImage_h */
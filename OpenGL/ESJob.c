@@ -0,0 +1,405 @@
+//
+//  ESJob.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  Small work-stealing job system. Every worker owns a deque: the owner pushes
+//  and pops at the bottom ( LIFO, cache friendly ), idle threads steal from the
+//  top ( FIFO, oldest and usually largest work first ).
+//
+
+#include "ESJob.h"
+#include "ESProfile.h"
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+
+// Types
+typedef struct
+{
+    ESJobFunc     func;
+    void         *arg;
+    ESJobCounter *counter;
+} ESJob;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    // top is where thieves take from, bottom is where the owner pushes/pops.
+    // Both only change under lock, the atomic stores make the unlocked peek in esJobQueueSteal safe
+    unsigned int    top;
+    unsigned int    bottom;
+    ESJob           jobs[ES_JOB_QUEUE_SIZE];
+} ESJobQueue;
+
+typedef struct
+{
+    int             numWorkers;
+    int             quit;
+    // jobs queued but not yet picked up, lets idle workers sleep
+    int             queued;
+    unsigned int    nextQueue;
+    pthread_mutex_t sleepLock;
+    pthread_cond_t  sleepCond;
+    pthread_t       threads[ES_JOB_MAX_WORKERS];
+    ESJobQueue      queues[ES_JOB_MAX_WORKERS];
+} ESJobSystem;
+
+typedef struct
+{
+    ESJobRangeFunc func;
+    void          *arg;
+    int            begin;
+    int            end;
+} ESJobRange;
+
+static ESJobSystem jobSystem;
+
+// index of the queue owned by this thread, -1 for threads that are not workers
+static __thread int jobWorkerIndex = -1;
+
+static int esJobQueuePush( ESJobQueue *queue, const ESJob *job )
+{
+    int pushed = GL_FALSE;
+    
+    pthread_mutex_lock( &queue->lock );
+    if( queue->bottom - queue->top < ES_JOB_QUEUE_SIZE )
+    {
+        queue->jobs[ queue->bottom % ES_JOB_QUEUE_SIZE ] = *job;
+        __atomic_store_n( &queue->bottom, queue->bottom + 1, __ATOMIC_RELAXED );
+        pushed = GL_TRUE;
+    }
+    pthread_mutex_unlock( &queue->lock );
+    
+    return pushed;
+}
+
+static int esJobQueuePop( ESJobQueue *queue, ESJob *job )
+{
+    int popped = GL_FALSE;
+    
+    pthread_mutex_lock( &queue->lock );
+    if( queue->bottom != queue->top )
+    {
+        __atomic_store_n( &queue->bottom, queue->bottom - 1, __ATOMIC_RELAXED );
+        *job = queue->jobs[ queue->bottom % ES_JOB_QUEUE_SIZE ];
+        popped = GL_TRUE;
+    }
+    pthread_mutex_unlock( &queue->lock );
+    
+    return popped;
+}
+
+static int esJobQueueSteal( ESJobQueue *queue, ESJob *job )
+{
+    int stolen = GL_FALSE;
+    
+    // Cheap unlocked peek so idle threads don't hammer empty queues
+    if( __atomic_load_n( &queue->bottom, __ATOMIC_RELAXED ) ==
+        __atomic_load_n( &queue->top, __ATOMIC_RELAXED ) )
+    {
+        return GL_FALSE;
+    }
+    
+    pthread_mutex_lock( &queue->lock );
+    if( queue->bottom != queue->top )
+    {
+        *job = queue->jobs[ queue->top % ES_JOB_QUEUE_SIZE ];
+        __atomic_store_n( &queue->top, queue->top + 1, __ATOMIC_RELAXED );
+        stolen = GL_TRUE;
+    }
+    pthread_mutex_unlock( &queue->lock );
+    
+    return stolen;
+}
+
+static void esJobRun( const ESJob *job )
+{
+    job->func( job->arg );
+    
+    if( job->counter != NULL )
+    {
+        __atomic_sub_fetch( &job->counter->pending, 1, __ATOMIC_RELEASE );
+    }
+}
+
+// find a job for the calling thread: own queue first, then steal round-robin
+static int esJobFind( ESJob *job )
+{
+    int self = jobWorkerIndex;
+    int i;
+    
+    if( self >= 0 && esJobQueuePop( &jobSystem.queues[self], job ) )
+    {
+        __atomic_sub_fetch( &jobSystem.queued, 1, __ATOMIC_RELAXED );
+        return GL_TRUE;
+    }
+    
+    for( i = 1; i <= jobSystem.numWorkers; i++ )
+    {
+        int victim = ( ( self < 0 ? 0 : self ) + i ) % jobSystem.numWorkers;
+        
+        if( esJobQueueSteal( &jobSystem.queues[victim], job ) )
+        {
+            __atomic_sub_fetch( &jobSystem.queued, 1, __ATOMIC_RELAXED );
+            return GL_TRUE;
+        }
+    }
+    
+    return GL_FALSE;
+}
+
+static void *esJobWorkerMain( void *arg )
+{
+    ESJob job;
+    char name[32];
+    
+    jobWorkerIndex = ( int ) ( size_t ) arg;
+    
+    snprintf( name, sizeof( name ), "job worker %d", jobWorkerIndex );
+    esProfileSetThreadName( name );
+    
+    for( ;; )
+    {
+        if( esJobFind( &job ) )
+        {
+            esJobRun( &job );
+            continue;
+        }
+        
+        pthread_mutex_lock( &jobSystem.sleepLock );
+        while( !jobSystem.quit && __atomic_load_n( &jobSystem.queued, __ATOMIC_ACQUIRE ) == 0 )
+        {
+            pthread_cond_wait( &jobSystem.sleepCond, &jobSystem.sleepLock );
+        }
+        
+        if( jobSystem.quit && __atomic_load_n( &jobSystem.queued, __ATOMIC_ACQUIRE ) == 0 )
+        {
+            pthread_mutex_unlock( &jobSystem.sleepLock );
+            break;
+        }
+        pthread_mutex_unlock( &jobSystem.sleepLock );
+    }
+    
+    return NULL;
+}
+
+// esJobSystemInit()
+int ESUTIL_API esJobSystemInit( int numThreads )
+{
+    int i;
+    
+    if( jobSystem.numWorkers > 0 )
+    {
+        return jobSystem.numWorkers;
+    }
+    
+    if( numThreads <= 0 )
+    {
+        numThreads = ( int ) sysconf( _SC_NPROCESSORS_ONLN ) - 1;
+    }
+    
+    if( numThreads > ES_JOB_MAX_WORKERS )
+    {
+        numThreads = ES_JOB_MAX_WORKERS;
+    }
+    
+    if( numThreads <= 0 )
+    {
+        // single core, every job runs inline
+        return 0;
+    }
+    
+    memset( &jobSystem, 0, sizeof( jobSystem ) );
+    pthread_mutex_init( &jobSystem.sleepLock, NULL );
+    pthread_cond_init( &jobSystem.sleepCond, NULL );
+    
+    for( i = 0; i < numThreads; i++ )
+    {
+        pthread_mutex_init( &jobSystem.queues[i].lock, NULL );
+    }
+    
+    // workers read numWorkers while stealing, publish it before they start
+    jobSystem.numWorkers = numThreads;
+    
+    for( i = 0; i < numThreads; i++ )
+    {
+        if( pthread_create( &jobSystem.threads[i], NULL, esJobWorkerMain, ( void * ) ( size_t ) i ) != 0 )
+        {
+            esLogMessage( " esJobSystemInit FAILED to start worker %d\n ", i );
+            jobSystem.numWorkers = i;
+            break;
+        }
+    }
+    
+    return jobSystem.numWorkers;
+}
+
+// esJobSystemShutdown()
+void ESUTIL_API esJobSystemShutdown( void )
+{
+    int i;
+    int numWorkers = jobSystem.numWorkers;
+    
+    if( numWorkers == 0 )
+    {
+        return;
+    }
+    
+    pthread_mutex_lock( &jobSystem.sleepLock );
+    jobSystem.quit = GL_TRUE;
+    pthread_cond_broadcast( &jobSystem.sleepCond );
+    pthread_mutex_unlock( &jobSystem.sleepLock );
+    
+    for( i = 0; i < numWorkers; i++ )
+    {
+        pthread_join( jobSystem.threads[i], NULL );
+    }
+    
+    for( i = 0; i < numWorkers; i++ )
+    {
+        pthread_mutex_destroy( &jobSystem.queues[i].lock );
+    }
+    
+    pthread_cond_destroy( &jobSystem.sleepCond );
+    pthread_mutex_destroy( &jobSystem.sleepLock );
+    jobSystem.numWorkers = 0;
+}
+
+// esJobNumThreads()
+int ESUTIL_API esJobNumThreads( void )
+{
+    return jobSystem.numWorkers + 1;
+}
+
+// esJobSubmit()
+void ESUTIL_API esJobSubmit( ESJobFunc func, void *arg, ESJobCounter *counter )
+{
+    ESJob job;
+    unsigned int queue;
+    
+    job.func    = func;
+    job.arg     = arg;
+    job.counter = counter;
+    
+    if( counter != NULL )
+    {
+        __atomic_add_fetch( &counter->pending, 1, __ATOMIC_RELAXED );
+    }
+    
+    if( jobSystem.numWorkers == 0 )
+    {
+        esJobRun( &job );
+        return;
+    }
+    
+    // Workers push to their own deque, other threads spread jobs round-robin
+    if( jobWorkerIndex >= 0 )
+    {
+        queue = ( unsigned int ) jobWorkerIndex;
+    }
+    else
+    {
+        queue = __atomic_fetch_add( &jobSystem.nextQueue, 1, __ATOMIC_RELAXED ) % jobSystem.numWorkers;
+    }
+    
+    __atomic_add_fetch( &jobSystem.queued, 1, __ATOMIC_RELEASE );
+    
+    if( !esJobQueuePush( &jobSystem.queues[queue], &job ) )
+    {
+        // queue is full, doing the work now is the cheapest form of back-pressure
+        __atomic_sub_fetch( &jobSystem.queued, 1, __ATOMIC_RELAXED );
+        esJobRun( &job );
+        return;
+    }
+    
+    pthread_mutex_lock( &jobSystem.sleepLock );
+    pthread_cond_signal( &jobSystem.sleepCond );
+    pthread_mutex_unlock( &jobSystem.sleepLock );
+}
+
+// esJobWait()
+void ESUTIL_API esJobWait( ESJobCounter *counter )
+{
+    ESJob job;
+    
+    while( __atomic_load_n( &counter->pending, __ATOMIC_ACQUIRE ) > 0 )
+    {
+        // Help out instead of blocking, this also makes nested waits deadlock free
+        if( jobSystem.numWorkers > 0 && esJobFind( &job ) )
+        {
+            esJobRun( &job );
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+}
+
+static void ESCALLBACK esJobRangeRun( void *arg )
+{
+    ESJobRange *range = ( ESJobRange * ) arg;
+    
+    range->func( range->arg, range->begin, range->end );
+}
+
+// esJobParallelFor()
+void ESUTIL_API esJobParallelFor( int count, int grainSize, ESJobRangeFunc func, void *arg )
+{
+    ESJobRange   ranges[ES_JOB_MAX_CHUNKS];
+    ESJobCounter counter = { 0 };
+    int numChunks;
+    int chunk;
+    int i;
+    
+    if( count <= 0 )
+    {
+        return;
+    }
+    
+    if( grainSize < 1 )
+    {
+        grainSize = 1;
+    }
+    
+    if( jobSystem.numWorkers == 0 || count <= grainSize )
+    {
+        func( arg, 0, count );
+        return;
+    }
+    
+    numChunks = ( count + grainSize - 1 ) / grainSize;
+    if( numChunks > ES_JOB_MAX_CHUNKS )
+    {
+        numChunks = ES_JOB_MAX_CHUNKS;
+    }
+    chunk = ( count + numChunks - 1 ) / numChunks;
+    
+    for( i = 0; i < numChunks; i++ )
+    {
+        ranges[i].func  = func;
+        ranges[i].arg   = arg;
+        ranges[i].begin = i * chunk;
+        ranges[i].end   = ( i + 1 ) * chunk < count ? ( i + 1 ) * chunk : count;
+        
+        if( ranges[i].begin >= ranges[i].end )
+        {
+            numChunks = i;
+            break;
+        }
+    }
+    
+    // Keep the first chunk for the calling thread
+    for( i = 1; i < numChunks; i++ )
+    {
+        esJobSubmit( esJobRangeRun, &ranges[i], &counter );
+    }
+    
+    esJobRangeRun( &ranges[0] );
+    esJobWait( &counter );
+}
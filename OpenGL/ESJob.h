@@ -0,0 +1,53 @@
+//
+//  ESJob.h
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+
+#ifndef ESJob_h
+#define ESJob_h
+
+#include "ESUtil.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// Maximum number of worker threads the job system will start
+#define ES_JOB_MAX_WORKERS   32
+// Jobs each worker deque can hold before esJobSubmit runs the job inline
+#define ES_JOB_QUEUE_SIZE    1024
+// Upper bound on the number of jobs a single esJobParallelFor call is split into
+#define ES_JOB_MAX_CHUNKS    256
+
+// Tracks a group of submitted jobs, zero it before the first esJobSubmit
+typedef struct
+{
+    int pending;
+} ESJobCounter;
+
+typedef void ( ESCALLBACK *ESJobFunc )( void *arg );
+typedef void ( ESCALLBACK *ESJobRangeFunc )( void *arg, int begin, int end );
+
+// start the worker threads, numThreads <= 0 uses one worker per core minus the calling thread
+// returns the number of workers started. Without workers every job runs inline on submit
+int ESUTIL_API esJobSystemInit( int numThreads );
+// wait for the workers to drain their queues and join them
+void ESUTIL_API esJobSystemShutdown( void );
+// number of threads that execute jobs, including the thread calling esJobWait
+int ESUTIL_API esJobNumThreads( void );
+// queue func( arg ), counter ( may be NULL ) is incremented now and decremented when the job finishes
+void ESUTIL_API esJobSubmit( ESJobFunc func, void *arg, ESJobCounter *counter );
+// block until every job tracked by counter finished, the caller runs queued jobs while it waits
+void ESUTIL_API esJobWait( ESJobCounter *counter );
+// run func( arg, begin, end ) over [ 0, count ) in chunks of at least grainSize and wait for all of them.
+// Every index is visited exactly once, so disjoint per-index writes give the same result as a serial loop
+void ESUTIL_API esJobParallelFor( int count, int grainSize, ESJobRangeFunc func, void *arg );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESJob_h */
@@ -0,0 +1,484 @@
+//
+//  ESMatrix.hpp
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  C++17 matrices on top of ESMatrix. es::Matrix and es::AffineMatrix derive
+//  from ESMatrix without adding members, so they pass straight to the C
+//  functions. Products are expression templates evaluated from the right on
+//  four rows at a time: model * view * projection becomes
+//  model * ( view * projection ), with every intermediate held in SSE/NEON
+//  registers and only the result stored. That is the work of two
+//  esMatrixMultiply calls without their stores, and when the right-hand factors
+//  do not change inside a loop the compiler hoists their product, leaving one
+//  4x4 multiply per matrix. A single chain outside a loop is built for
+//  baseline SSE2 and stays slower than esMatrixMultiply's AVX2 kernel; use the
+//  C call, or esMatrixMultiplyBatch, there. Affine operands ( last column
+//  0, 0, 0, 1 ) skip the terms that are known to be 0 or 1. Everything is
+//  constexpr, so matrices with constant parameters, perspective and frustum
+//  included, can be computed at compile time.
+//
+
+#ifndef ESMatrix_hpp
+#define ESMatrix_hpp
+
+#include "ESUtil.h"
+#include <type_traits>
+
+#if defined( __SSE__ ) || defined( _M_X64 )
+#define ES_MATRIX_HPP_SSE 1
+#include <xmmintrin.h>
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#define ES_MATRIX_HPP_NEON 1
+#include <arm_neon.h>
+#endif
+
+// The SIMD kernels are only taken outside constant evaluation
+#if ( defined( __GNUC__ ) || defined( __clang__ ) ) && ( defined( ES_MATRIX_HPP_SSE ) || defined( ES_MATRIX_HPP_NEON ) )
+#define ES_MATRIX_HPP_SIMD 1
+#define ES_MATRIX_HPP_RUNTIME() ( !__builtin_is_constant_evaluated() )
+// a whole chain has to collapse into the assignment for its rows to stay in registers
+#define ES_MATRIX_HPP_INLINE __attribute__(( always_inline )) inline
+#else
+#define ES_MATRIX_HPP_RUNTIME() false
+#endif
+
+namespace es
+{
+    // One row of a matrix expression
+    struct Row
+    {
+        GLfloat v[4];
+    };
+    
+    // All four rows of an evaluated expression
+    struct Rows
+    {
+        Row r[4];
+    };
+
+#ifdef ES_MATRIX_HPP_SIMD
+    namespace detail
+    {
+#if defined( ES_MATRIX_HPP_SSE )
+        using Vec = __m128;
+        
+        ES_MATRIX_HPP_INLINE Vec load( const GLfloat *p )
+        {
+            return _mm_loadu_ps( p );
+        }
+        
+        ES_MATRIX_HPP_INLINE void store( GLfloat *p, Vec v )
+        {
+            _mm_storeu_ps( p, v );
+        }
+        
+        ES_MATRIX_HPP_INLINE Vec add( Vec a, Vec b )
+        {
+            return _mm_add_ps( a, b );
+        }
+        
+        // b times element I of a, broadcast within registers
+        template< int I >
+        ES_MATRIX_HPP_INLINE Vec mulLane( Vec b, Vec a )
+        {
+            return _mm_mul_ps( b, _mm_shuffle_ps( a, a, _MM_SHUFFLE( I, I, I, I ) ) );
+        }
+#else
+        using Vec = float32x4_t;
+        
+        ES_MATRIX_HPP_INLINE Vec load( const GLfloat *p )
+        {
+            return vld1q_f32( p );
+        }
+        
+        ES_MATRIX_HPP_INLINE void store( GLfloat *p, Vec v )
+        {
+            vst1q_f32( p, v );
+        }
+        
+        ES_MATRIX_HPP_INLINE Vec add( Vec a, Vec b )
+        {
+            return vaddq_f32( a, b );
+        }
+        
+        template< int I >
+        ES_MATRIX_HPP_INLINE Vec mulLane( Vec b, Vec a )
+        {
+            return vmulq_lane_f32( b, I < 2 ? vget_low_f32( a ) : vget_high_f32( a ), I & 1 );
+        }
+#endif
+        
+        // Rows in registers
+        struct VecRows
+        {
+            Vec r[4];
+        };
+    }
+#endif
+    
+    template< typename Derived >
+    struct MatrixExpr
+    {
+        constexpr const Derived &derived() const
+        {
+            return static_cast< const Derived & >( *this );
+        }
+    };
+    
+    // Every expression E provides
+    //   rows()     E evaluated
+    //   times( b ) E * b for the rows b of an evaluated right-hand side
+    // and rowsVec/timesVec, the same in SIMD registers for runtime evaluation
+    
+    // An ESMatrix, Affine promises a last column of 0, 0, 0, 1
+    template< bool Affine >
+    struct BasicMatrix : ESMatrix, MatrixExpr< BasicMatrix< Affine > >
+    {
+        static constexpr bool affine = Affine;
+        
+        // identity
+        constexpr BasicMatrix() : ESMatrix{ { { 1.0f, 0.0f, 0.0f, 0.0f },
+                                              { 0.0f, 1.0f, 0.0f, 0.0f },
+                                              { 0.0f, 0.0f, 1.0f, 0.0f },
+                                              { 0.0f, 0.0f, 0.0f, 1.0f } } }
+        {
+        }
+        
+        // takes the C matrix as it is, affine or not is up to the caller
+        constexpr explicit BasicMatrix( const ESMatrix &matrix ) : ESMatrix( matrix )
+        {
+        }
+        
+        // evaluate an expression, only affine expressions fit an affine matrix
+        template< typename E, typename = std::enable_if_t< !Affine || E::affine > >
+        constexpr BasicMatrix( const MatrixExpr< E > &expr ) : ESMatrix{}
+        {
+            assign( expr.derived() );
+        }
+        
+        // the expression may read this matrix, it is evaluated in full before the first store
+        template< typename E, typename = std::enable_if_t< !Affine || E::affine > >
+        constexpr BasicMatrix &operator=( const MatrixExpr< E > &expr )
+        {
+            assign( expr.derived() );
+            return *this;
+        }
+        
+        constexpr Row row( int r ) const
+        {
+            return Row{ { m[r][0], m[r][1], m[r][2], m[r][3] } };
+        }
+        
+        constexpr Rows rows() const
+        {
+            return Rows{ { row( 0 ), row( 1 ), row( 2 ), row( 3 ) } };
+        }
+        
+        // row r of the result is the broadcast multiply-add of b's rows by row r of this matrix.
+        // Affine rows end in 0, or in 1 for row 3, so that term is skipped or a plain add
+        constexpr Rows times( const Rows &b ) const
+        {
+            Rows result = {};
+            constexpr int terms = Affine ? 3 : 4;
+            
+            for( int r = 0; r < 4; r++ )
+            {
+                for( int k = 0; k < terms; k++ )
+                {
+                    for( int c = 0; c < 4; c++ )
+                    {
+                        result.r[r].v[c] += m[r][k] * b.r[k].v[c];
+                    }
+                }
+            }
+            
+            if constexpr( Affine )
+            {
+                for( int c = 0; c < 4; c++ )
+                {
+                    result.r[3].v[c] += b.r[3].v[c];
+                }
+            }
+            
+            return result;
+        }
+
+#ifdef ES_MATRIX_HPP_SIMD
+        ES_MATRIX_HPP_INLINE detail::VecRows rowsVec() const
+        {
+            return detail::VecRows{ { detail::load( m[0] ), detail::load( m[1] ), detail::load( m[2] ), detail::load( m[3] ) } };
+        }
+        
+        ES_MATRIX_HPP_INLINE detail::VecRows timesVec( const detail::VecRows &b ) const
+        {
+            detail::VecRows result;
+            
+            for( int r = 0; r < 4; r++ )
+            {
+                detail::Vec a = detail::load( m[r] );
+                detail::Vec sum = detail::add( detail::add( detail::mulLane< 0 >( b.r[0], a ), detail::mulLane< 1 >( b.r[1], a ) ),
+                                               detail::mulLane< 2 >( b.r[2], a ) );
+                
+                if constexpr( !Affine )
+                {
+                    sum = detail::add( sum, detail::mulLane< 3 >( b.r[3], a ) );
+                }
+                else if( r == 3 )
+                {
+                    sum = detail::add( sum, b.r[3] );
+                }
+                
+                result.r[r] = sum;
+            }
+            
+            return result;
+        }
+#endif
+        
+        constexpr GLfloat operator()( int r, int c ) const
+        {
+            return m[r][c];
+        }
+    
+    private:
+        template< typename E >
+        constexpr void assign( const E &expr )
+        {
+#ifdef ES_MATRIX_HPP_SIMD
+            if( ES_MATRIX_HPP_RUNTIME() )
+            {
+                detail::VecRows result = expr.rowsVec();
+                
+                for( int r = 0; r < 4; r++ )
+                {
+                    detail::store( m[r], result.r[r] );
+                }
+                return;
+            }
+#endif
+            Rows result = expr.rows();
+            
+            for( int r = 0; r < 4; r++ )
+            {
+                for( int c = 0; c < 4; c++ )
+                {
+                    m[r][c] = result.r[r].v[c];
+                }
+            }
+        }
+    };
+    
+    using Matrix       = BasicMatrix< false >;
+    using AffineMatrix = BasicMatrix< true >;
+    
+    static_assert( sizeof( Matrix ) == sizeof( ESMatrix ) && sizeof( AffineMatrix ) == sizeof( ESMatrix ),
+                   "es::Matrix must stay layout compatible with ESMatrix" );
+    static_assert( std::is_standard_layout< Matrix >::value, "es::Matrix must stay layout compatible with ESMatrix" );
+    
+    template< typename T >
+    struct IsMatrix : std::false_type
+    {
+    };
+    
+    template< bool Affine >
+    struct IsMatrix< BasicMatrix< Affine > > : std::true_type
+    {
+    };
+    
+    // left * right in the esMatrixMultiply order. Matrix operands are referenced and nested
+    // products kept by value, no operand is ever stored as a 4x4 of its own. Assign products
+    // to a Matrix rather than keeping them in an auto variable
+    template< typename L, typename R >
+    struct MatrixProduct : MatrixExpr< MatrixProduct< L, R > >
+    {
+        static constexpr bool affine = L::affine && R::affine;
+        
+        template< typename T >
+        using Storage = std::conditional_t< IsMatrix< T >::value, const T &, T >;
+        
+        Storage< L > left;
+        Storage< R > right;
+        
+        constexpr MatrixProduct( const L &l, const R &r ) : left( l ), right( r )
+        {
+        }
+        
+        constexpr Rows rows() const
+        {
+            return left.times( right.rows() );
+        }
+        
+        // ( left * right ) * b = left * ( right * b )
+        constexpr Rows times( const Rows &b ) const
+        {
+            return left.times( right.times( b ) );
+        }
+
+#ifdef ES_MATRIX_HPP_SIMD
+        ES_MATRIX_HPP_INLINE detail::VecRows rowsVec() const
+        {
+            return left.timesVec( right.rowsVec() );
+        }
+        
+        ES_MATRIX_HPP_INLINE detail::VecRows timesVec( const detail::VecRows &b ) const
+        {
+            return left.timesVec( right.timesVec( b ) );
+        }
+#endif
+    };
+    
+    template< typename L, typename R >
+    constexpr MatrixProduct< L, R > operator*( const MatrixExpr< L > &left, const MatrixExpr< R > &right )
+    {
+        return MatrixProduct< L, R >( left.derived(), right.derived() );
+    }
+    
+    namespace detail
+    {
+        constexpr double pi = 3.1415926535897932384626433832795;
+        
+        // Taylor series, enough terms for float precision on [ -pi, pi ]
+        constexpr double sin( double x )
+        {
+            double term = 0.0;
+            double sum = 0.0;
+            
+            while( x > pi )
+            {
+                x -= 2.0 * pi;
+            }
+            
+            while( x < -pi )
+            {
+                x += 2.0 * pi;
+            }
+            
+            term = x;
+            sum  = x;
+            
+            for( int i = 1; i < 12; i++ )
+            {
+                term *= -x * x / ( ( 2 * i ) * ( 2 * i + 1 ) );
+                sum  += term;
+            }
+            
+            return sum;
+        }
+        
+        constexpr double cos( double x )
+        {
+            return sin( x + pi / 2.0 );
+        }
+        
+        // Newton's method, x >= 0
+        constexpr double sqrt( double x )
+        {
+            double guess = x > 1.0 ? x : 1.0;
+            
+            for( int i = 0; i < 64; i++ )
+            {
+                guess = 0.5 * ( guess + x / guess );
+            }
+            
+            return guess;
+        }
+    }
+    
+    constexpr AffineMatrix identity()
+    {
+        return AffineMatrix();
+    }
+    
+    // same as esTranslate on an identity matrix
+    constexpr AffineMatrix translation( GLfloat x, GLfloat y, GLfloat z )
+    {
+        AffineMatrix result;
+        
+        result.m[3][0] = x;
+        result.m[3][1] = y;
+        result.m[3][2] = z;
+        
+        return result;
+    }
+    
+    // same as esScale on an identity matrix
+    constexpr AffineMatrix scaling( GLfloat x, GLfloat y, GLfloat z )
+    {
+        AffineMatrix result;
+        
+        result.m[0][0] = x;
+        result.m[1][1] = y;
+        result.m[2][2] = z;
+        
+        return result;
+    }
+    
+    // same as esRotate on an identity matrix, angle in degrees
+    constexpr AffineMatrix rotation( GLfloat angle, GLfloat x, GLfloat y, GLfloat z )
+    {
+        AffineMatrix result;
+        double mag = detail::sqrt( double( x ) * x + double( y ) * y + double( z ) * z );
+        double s = detail::sin( angle * detail::pi / 180.0 );
+        double c = detail::cos( angle * detail::pi / 180.0 );
+        double nx = mag > 0.0 ? x / mag : 0.0;
+        double ny = mag > 0.0 ? y / mag : 0.0;
+        double nz = mag > 0.0 ? z / mag : 0.0;
+        
+        if( mag <= 0.0 )
+        {
+            return result;
+        }
+        
+        result.m[0][0] = GLfloat( ( 1.0 - c ) * nx * nx + c );
+        result.m[0][1] = GLfloat( ( 1.0 - c ) * nx * ny - nz * s );
+        result.m[0][2] = GLfloat( ( 1.0 - c ) * nz * nx + ny * s );
+        result.m[1][0] = GLfloat( ( 1.0 - c ) * nx * ny + nz * s );
+        result.m[1][1] = GLfloat( ( 1.0 - c ) * ny * ny + c );
+        result.m[1][2] = GLfloat( ( 1.0 - c ) * ny * nz - nx * s );
+        result.m[2][0] = GLfloat( ( 1.0 - c ) * nz * nx - ny * s );
+        result.m[2][1] = GLfloat( ( 1.0 - c ) * ny * nz + nx * s );
+        result.m[2][2] = GLfloat( ( 1.0 - c ) * nz * nz + c );
+        
+        return result;
+    }
+    
+    // same as esFrustum on an identity matrix, the identity for invalid planes like esFrustum
+    constexpr Matrix frustum( GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, GLfloat nearZ, GLfloat farZ )
+    {
+        Matrix result;
+        GLfloat deltaX = right - left;
+        GLfloat deltaY = top - bottom;
+        GLfloat deltaZ = farZ - nearZ;
+        
+        if( nearZ <= 0.0f || farZ <= 0.0f || deltaX <= 0.0f || deltaY <= 0.0f || deltaZ <= 0.0f )
+        {
+            return result;
+        }
+        
+        result.m[0][0] = 2.0f * nearZ / deltaX;
+        result.m[1][1] = 2.0f * nearZ / deltaY;
+        result.m[2][0] = ( right + left ) / deltaX;
+        result.m[2][1] = ( top + bottom ) / deltaY;
+        result.m[2][2] = -( nearZ + farZ ) / deltaZ;
+        result.m[2][3] = -1.0f;
+        result.m[3][2] = -2.0f * nearZ * farZ / deltaZ;
+        result.m[3][3] = 0.0f;
+        
+        return result;
+    }
+    
+    // same as esPerspective on an identity matrix, fovy in degrees
+    constexpr Matrix perspective( GLfloat fovy, GLfloat aspect, GLfloat nearZ, GLfloat farZ )
+    {
+        double halfAngle = fovy / 360.0 * detail::pi;
+        GLfloat frustumH = GLfloat( detail::sin( halfAngle ) / detail::cos( halfAngle ) * nearZ );
+        GLfloat frustumW = frustumH * aspect;
+        
+        return frustum( -frustumW, frustumW, -frustumH, frustumH, nearZ, farZ );
+    }
+}
+
+#endif /* ESMatrix_hpp */
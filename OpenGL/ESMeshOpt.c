@@ -0,0 +1,791 @@
+//
+//  ESMeshOpt.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  Index buffer optimization. Triangles are first reordered so the
+//  post-transform cache hits as often as possible ( Tom Forsyth, "Linear-Speed
+//  Vertex Cache Optimisation" ), then runs of them are reordered so outward
+//  facing parts are drawn first and occlude the rest, and finally the vertices
+//  are renumbered in first-use order so the pre-transform fetch streams
+//  through memory.
+//
+
+#include "ESMeshOpt.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Forsyth's tuning constants
+#define CACHE_DECAY_POWER   1.5f
+#define LAST_TRI_SCORE      0.75f
+#define VALENCE_BOOST_SCALE 2.0f
+#define VALENCE_BOOST_POWER 0.5f
+// Valences above this share the score of the last table entry
+#define MAX_VALENCE_SCORE   32
+// Side of the square esMeshAnalyzeOverdraw renders every view into
+#define OVERDRAW_GRID_SIZE  256
+
+static float cachePositionScores[ES_MESH_CACHE_SIZE];
+static float valenceScores[MAX_VALENCE_SCORE];
+static int   scoreTablesReady;
+
+static void esMeshInitScoreTables( void )
+{
+    int i;
+    
+    if( scoreTablesReady )
+    {
+        return;
+    }
+    
+    for( i = 0; i < ES_MESH_CACHE_SIZE; i++ )
+    {
+        if( i < 3 )
+        {
+            // The last triangle's vertices get a fixed score so the optimizer
+            // does not simply keep using the same edge
+            cachePositionScores[i] = LAST_TRI_SCORE;
+        }
+        else
+        {
+            float scaler = 1.0f / ( ES_MESH_CACHE_SIZE - 3 );
+            
+            cachePositionScores[i] = powf( 1.0f - ( i - 3 ) * scaler, CACHE_DECAY_POWER );
+        }
+    }
+    
+    // Vertices with few triangles left get a boost, finishing them frees cache entries
+    valenceScores[0] = 0.0f;
+    for( i = 1; i < MAX_VALENCE_SCORE; i++ )
+    {
+        valenceScores[i] = VALENCE_BOOST_SCALE * powf( ( float ) i, -VALENCE_BOOST_POWER );
+    }
+    
+    scoreTablesReady = GL_TRUE;
+}
+
+static float esMeshVertexScore( int cachePosition, int numActiveTris )
+{
+    float score = 0.0f;
+    
+    if( numActiveTris == 0 )
+    {
+        // no triangle needs the vertex anymore
+        return -1.0f;
+    }
+    
+    if( cachePosition >= 0 )
+    {
+        score = cachePositionScores[cachePosition];
+    }
+    
+    return score + valenceScores[ numActiveTris < MAX_VALENCE_SCORE ? numActiveTris : MAX_VALENCE_SCORE - 1 ];
+}
+
+// esMeshAnalyzeCache()
+void ESUTIL_API esMeshAnalyzeCache( const GLuint *indices, int numIndices, int numVertices, int cacheSize,
+                                    ESMeshCacheStats *stats )
+{
+    // a vertex is in the FIFO if it was inserted less than cacheSize misses ago
+    unsigned int *timestamps = calloc( numVertices > 0 ? numVertices : 1, sizeof( unsigned int ) );
+    unsigned int timestamp = cacheSize + 1;
+    int numUsed = 0;
+    int i;
+    
+    memset( stats, 0, sizeof( ESMeshCacheStats ) );
+    
+    if( timestamps == NULL || numIndices < 3 )
+    {
+        free( timestamps );
+        return;
+    }
+    
+    for( i = 0; i < numIndices; i++ )
+    {
+        GLuint index = indices[i];
+        
+        if( timestamps[index] == 0 )
+        {
+            numUsed++;
+        }
+        
+        if( timestamp - timestamps[index] > ( unsigned int ) cacheSize )
+        {
+            timestamps[index] = timestamp++;
+            stats->transforms++;
+        }
+    }
+    
+    stats->acmr = ( float ) stats->transforms / ( float ) ( numIndices / 3 );
+    stats->atvr = ( float ) stats->transforms / ( float ) numUsed;
+    
+    free( timestamps );
+}
+
+// esMeshOptimizeVertexCache()
+GLboolean ESUTIL_API esMeshOptimizeVertexCache( GLuint *destination, const GLuint *indices, int numIndices, int numVertices )
+{
+    int numTris = numIndices / 3;
+    GLuint *source        = malloc( sizeof( GLuint ) * numIndices );
+    int    *activeCounts  = calloc( numVertices, sizeof( int ) );
+    int    *triOffsets    = malloc( sizeof( int ) * ( numVertices + 1 ) );
+    int    *vertexTris    = malloc( sizeof( int ) * numIndices );
+    int    *cachePos      = malloc( sizeof( int ) * numVertices );
+    float  *vertexScores  = malloc( sizeof( float ) * numVertices );
+    float  *triScores     = malloc( sizeof( float ) * numTris );
+    char   *triAdded      = calloc( numTris, sizeof( char ) );
+    GLuint cache[ES_MESH_CACHE_SIZE + 3];
+    GLuint newCache[ES_MESH_CACHE_SIZE + 3];
+    int cacheCount = 0;
+    int bestTri = -1;
+    float bestScore = -1.0f;
+    int cursor = 0;
+    int out;
+    int i;
+    int v;
+    int t;
+    
+    if( numTris == 0 || source == NULL || activeCounts == NULL || triOffsets == NULL || vertexTris == NULL ||
+        cachePos == NULL || vertexScores == NULL || triScores == NULL || triAdded == NULL )
+    {
+        free( source );
+        free( activeCounts );
+        free( triOffsets );
+        free( vertexTris );
+        free( cachePos );
+        free( vertexScores );
+        free( triScores );
+        free( triAdded );
+        return numTris == 0;
+    }
+    
+    esMeshInitScoreTables();
+    
+    // work on a copy so destination may alias indices
+    memcpy( source, indices, sizeof( GLuint ) * numTris * 3 );
+    
+    // Vertex -> triangle adjacency. The first activeCounts[v] entries of a vertex's
+    // list are the triangles that still have to be emitted
+    for( i = 0; i < numTris * 3; i++ )
+    {
+        activeCounts[ source[i] ]++;
+    }
+    
+    triOffsets[0] = 0;
+    for( v = 0; v < numVertices; v++ )
+    {
+        triOffsets[v + 1] = triOffsets[v] + activeCounts[v];
+        activeCounts[v]   = 0;
+    }
+    
+    for( i = 0; i < numTris * 3; i++ )
+    {
+        GLuint index = source[i];
+        
+        vertexTris[ triOffsets[index] + activeCounts[index]++ ] = i / 3;
+    }
+    
+    for( v = 0; v < numVertices; v++ )
+    {
+        cachePos[v]     = -1;
+        vertexScores[v] = esMeshVertexScore( -1, activeCounts[v] );
+    }
+    
+    for( t = 0; t < numTris; t++ )
+    {
+        triScores[t] = vertexScores[ source[t * 3] ] + vertexScores[ source[t * 3 + 1] ] + vertexScores[ source[t * 3 + 2] ];
+        
+        if( triScores[t] > bestScore )
+        {
+            bestScore = triScores[t];
+            bestTri   = t;
+        }
+    }
+    
+    for( out = 0; out < numTris; out++ )
+    {
+        const GLuint *tri;
+        int newCount = 0;
+        
+        if( bestTri < 0 )
+        {
+            // Nothing in the cache touches a remaining triangle, continue with the next unused one
+            while( triAdded[cursor] )
+            {
+                cursor++;
+            }
+            bestTri = cursor;
+        }
+        
+        t   = bestTri;
+        tri = &source[t * 3];
+        
+        destination[out * 3 + 0] = tri[0];
+        destination[out * 3 + 1] = tri[1];
+        destination[out * 3 + 2] = tri[2];
+        triAdded[t] = 1;
+        
+        // Retire the triangle from its vertices' active lists
+        for( i = 0; i < 3; i++ )
+        {
+            int *list = &vertexTris[ triOffsets[ tri[i] ] ];
+            int count = activeCounts[ tri[i] ];
+            int j;
+            
+            for( j = 0; j < count; j++ )
+            {
+                if( list[j] == t )
+                {
+                    list[j] = list[count - 1];
+                    list[count - 1] = t;
+                    activeCounts[ tri[i] ]--;
+                    break;
+                }
+            }
+        }
+        
+        // LRU update: the triangle's vertices move to the front, the rest shift back
+        for( i = 0; i < 3; i++ )
+        {
+            if( ( i == 1 && tri[1] == tri[0] ) || ( i == 2 && ( tri[2] == tri[0] || tri[2] == tri[1] ) ) )
+            {
+                continue;
+            }
+            newCache[newCount++] = tri[i];
+        }
+        
+        for( i = 0; i < cacheCount; i++ )
+        {
+            if( cache[i] != tri[0] && cache[i] != tri[1] && cache[i] != tri[2] )
+            {
+                newCache[newCount++] = cache[i];
+            }
+        }
+        
+        // Rescore everything that moved, including the vertices that fell out of the cache
+        for( i = 0; i < newCount; i++ )
+        {
+            v = newCache[i];
+            cachePos[v]     = i < ES_MESH_CACHE_SIZE ? i : -1;
+            vertexScores[v] = esMeshVertexScore( cachePos[v], activeCounts[v] );
+        }
+        
+        cacheCount = newCount < ES_MESH_CACHE_SIZE ? newCount : ES_MESH_CACHE_SIZE;
+        memcpy( cache, newCache, sizeof( GLuint ) * cacheCount );
+        
+        // Only triangles around the touched vertices changed score, the best one is among them
+        bestTri   = -1;
+        bestScore = -1.0f;
+        
+        for( i = 0; i < newCount; i++ )
+        {
+            const int *list;
+            int j;
+            
+            v    = newCache[i];
+            list = &vertexTris[ triOffsets[v] ];
+            
+            for( j = 0; j < activeCounts[v]; j++ )
+            {
+                const GLuint *other = &source[ list[j] * 3 ];
+                float score = vertexScores[ other[0] ] + vertexScores[ other[1] ] + vertexScores[ other[2] ];
+                
+                triScores[ list[j] ] = score;
+                
+                if( score > bestScore )
+                {
+                    bestScore = score;
+                    bestTri   = list[j];
+                }
+            }
+        }
+    }
+    
+    free( source );
+    free( activeCounts );
+    free( triOffsets );
+    free( vertexTris );
+    free( cachePos );
+    free( vertexScores );
+    free( triScores );
+    free( triAdded );
+    
+    return GL_TRUE;
+}
+
+// FIFO cache of ES_MESH_CACHE_SIZE entries as in esMeshAnalyzeCache, returns the misses of one triangle.
+// Adding ES_MESH_CACHE_SIZE + 1 to timestamp empties the cache
+static int esMeshCacheMisses( unsigned int *timestamps, unsigned int *timestamp, const GLuint *tri )
+{
+    int misses = 0;
+    int i;
+    
+    for( i = 0; i < 3; i++ )
+    {
+        if( *timestamp - timestamps[ tri[i] ] > ES_MESH_CACHE_SIZE )
+        {
+            timestamps[ tri[i] ] = ( *timestamp )++;
+            misses++;
+        }
+    }
+    
+    return misses;
+}
+
+typedef struct
+{
+    float key;
+    int   cluster;
+} ESMeshClusterKey;
+
+// furthest out first, ties in the input order
+static int esMeshCompareClusters( const void *a, const void *b )
+{
+    const ESMeshClusterKey *x = a;
+    const ESMeshClusterKey *y = b;
+    
+    if( x->key != y->key )
+    {
+        return x->key > y->key ? -1 : 1;
+    }
+    
+    return x->cluster - y->cluster;
+}
+
+// esMeshOptimizeOverdraw()
+GLboolean ESUTIL_API esMeshOptimizeOverdraw( GLuint *destination, const GLuint *indices, int numIndices,
+                                             const GLfloat *positions, int numVertices, float threshold )
+{
+    int numTris = numIndices / 3;
+    GLuint *source             = malloc( sizeof( GLuint ) * numIndices );
+    unsigned int *timestamps   = calloc( numVertices > 0 ? numVertices : 1, sizeof( unsigned int ) );
+    int *hard                  = malloc( sizeof( int ) * ( numTris + 1 ) );
+    int *clusters              = malloc( sizeof( int ) * ( numTris + 1 ) );
+    ESMeshClusterKey *keys     = malloc( sizeof( ESMeshClusterKey ) * ( numTris + 1 ) );
+    unsigned int timestamp = ES_MESH_CACHE_SIZE + 1;
+    GLfloat center[3] = { 0.0f, 0.0f, 0.0f };
+    int numHard = 0;
+    int numClusters = 0;
+    int out = 0;
+    int h;
+    int i;
+    int t;
+    
+    if( numTris == 0 || source == NULL || timestamps == NULL || hard == NULL || clusters == NULL || keys == NULL )
+    {
+        free( source );
+        free( timestamps );
+        free( hard );
+        free( clusters );
+        free( keys );
+        return numTris == 0;
+    }
+    
+    // work on a copy so destination may alias indices
+    memcpy( source, indices, sizeof( GLuint ) * numTris * 3 );
+    
+    // Hard boundaries: triangles that miss on all three vertices, the cache order starts over there anyway
+    for( t = 0; t < numTris; t++ )
+    {
+        if( esMeshCacheMisses( timestamps, &timestamp, &source[t * 3] ) == 3 || t == 0 )
+        {
+            hard[numHard++] = t;
+        }
+    }
+    
+    hard[numHard] = numTris;
+    
+    // Soft boundaries: cut a hard cluster as soon as the part since the last cut, simulated from
+    // an empty cache, is within threshold of the ACMR of the whole hard cluster
+    for( h = 0; h < numHard; h++ )
+    {
+        int start = hard[h];
+        int end   = hard[h + 1];
+        int misses = 0;
+        int runMisses = 0;
+        int runTris = 0;
+        float target;
+        
+        timestamp += ES_MESH_CACHE_SIZE + 1;
+        
+        for( t = start; t < end; t++ )
+        {
+            misses += esMeshCacheMisses( timestamps, &timestamp, &source[t * 3] );
+        }
+        
+        target = threshold * ( float ) misses / ( float ) ( end - start );
+        clusters[numClusters++] = start;
+        timestamp += ES_MESH_CACHE_SIZE + 1;
+        
+        for( t = start; t < end; t++ )
+        {
+            runMisses += esMeshCacheMisses( timestamps, &timestamp, &source[t * 3] );
+            runTris++;
+            
+            if( ( float ) runMisses <= target * ( float ) runTris )
+            {
+                clusters[numClusters++] = t + 1;
+                timestamp += ES_MESH_CACHE_SIZE + 1;
+                runMisses = 0;
+                runTris   = 0;
+            }
+        }
+        
+        // The rest after the last cut is usually a few triangles with a poor ACMR, it joins the
+        // cluster before it. A cut right at the end is dropped the same way
+        if( clusters[numClusters - 1] != start )
+        {
+            numClusters--;
+        }
+    }
+    
+    clusters[numClusters] = numTris;
+    
+    for( i = 0; i < numVertices; i++ )
+    {
+        center[0] += positions[i * 3];
+        center[1] += positions[i * 3 + 1];
+        center[2] += positions[i * 3 + 2];
+    }
+    
+    for( i = 0; i < 3 && numVertices > 0; i++ )
+    {
+        center[i] /= ( GLfloat ) numVertices;
+    }
+    
+    // Sort key: how far the cluster's area weighted centroid lies out along its average normal.
+    // Clusters facing away from the center on the outside of the mesh tend to occlude the others
+    for( i = 0; i < numClusters; i++ )
+    {
+        GLfloat centroid[3] = { 0.0f, 0.0f, 0.0f };
+        GLfloat normal[3] = { 0.0f, 0.0f, 0.0f };
+        GLfloat area = 0.0f;
+        GLfloat length;
+        
+        for( t = clusters[i]; t < clusters[i + 1]; t++ )
+        {
+            const GLfloat *a = &positions[ source[t * 3] * 3 ];
+            const GLfloat *b = &positions[ source[t * 3 + 1] * 3 ];
+            const GLfloat *c = &positions[ source[t * 3 + 2] * 3 ];
+            GLfloat e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            GLfloat e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+            GLfloat n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            GLfloat triArea = sqrtf( n[0] * n[0] + n[1] * n[1] + n[2] * n[2] );
+            int k;
+            
+            for( k = 0; k < 3; k++ )
+            {
+                centroid[k] += ( a[k] + b[k] + c[k] ) * triArea;
+                normal[k]   += n[k];
+            }
+            
+            area += triArea;
+        }
+        
+        length = sqrtf( normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2] );
+        keys[i].key     = 0.0f;
+        keys[i].cluster = i;
+        
+        if( area > 0.0f && length > 0.0f )
+        {
+            keys[i].key = ( ( centroid[0] / ( area * 3.0f ) - center[0] ) * normal[0] +
+                            ( centroid[1] / ( area * 3.0f ) - center[1] ) * normal[1] +
+                            ( centroid[2] / ( area * 3.0f ) - center[2] ) * normal[2] ) / length;
+        }
+    }
+    
+    qsort( keys, numClusters, sizeof( ESMeshClusterKey ), esMeshCompareClusters );
+    
+    for( i = 0; i < numClusters; i++ )
+    {
+        int first = clusters[ keys[i].cluster ];
+        int count = clusters[ keys[i].cluster + 1 ] - first;
+        
+        memcpy( &destination[out * 3], &source[first * 3], sizeof( GLuint ) * 3 * count );
+        out += count;
+    }
+    
+    free( source );
+    free( timestamps );
+    free( hard );
+    free( clusters );
+    free( keys );
+    
+    return GL_TRUE;
+}
+
+// whether pixel centers exactly on the edge p -> q belong to the triangle. A shared edge runs the other
+// way in the neighbouring triangle, so exactly one of the two owns it ( the top-left rule )
+static int esMeshEdgeOwnsCenters( const long long *p, const long long *q )
+{
+    return q[1] < p[1] || ( q[1] == p[1] && q[0] > p[0] );
+}
+
+// edge function of p -> q at ( x, y ), positive on the inside of a counter-clockwise triangle
+static long long esMeshEdge( const long long *p, const long long *q, long long x, long long y )
+{
+    return ( q[0] - p[0] ) * ( y - p[1] ) - ( q[1] - p[1] ) * ( x - p[0] );
+}
+
+// one triangle of esMeshAnalyzeOverdraw in grid coordinates, z is the depth and smaller is closer.
+// x and y are snapped to 1/16 pixel so the edge functions are exact and shared edges are covered once
+static void esMeshRasterizeTriangle( float *depths, ESMeshOverdrawStats *stats, float corners[3][3] )
+{
+    long long v[3][2];
+    long long area;
+    long long minX, maxX, minY, maxY;
+    long long x, y;
+    int k;
+    
+    for( k = 0; k < 3; k++ )
+    {
+        v[k][0] = ( long long ) lrintf( corners[k][0] * 16.0f );
+        v[k][1] = ( long long ) lrintf( corners[k][1] * 16.0f );
+    }
+    
+    area = esMeshEdge( v[0], v[1], v[2][0], v[2][1] );
+    
+    // clockwise on screen is back facing
+    if( area <= 0 )
+    {
+        return;
+    }
+    
+    minX = v[0][0] < v[1][0] ? ( v[0][0] < v[2][0] ? v[0][0] : v[2][0] ) : ( v[1][0] < v[2][0] ? v[1][0] : v[2][0] );
+    maxX = v[0][0] > v[1][0] ? ( v[0][0] > v[2][0] ? v[0][0] : v[2][0] ) : ( v[1][0] > v[2][0] ? v[1][0] : v[2][0] );
+    minY = v[0][1] < v[1][1] ? ( v[0][1] < v[2][1] ? v[0][1] : v[2][1] ) : ( v[1][1] < v[2][1] ? v[1][1] : v[2][1] );
+    maxY = v[0][1] > v[1][1] ? ( v[0][1] > v[2][1] ? v[0][1] : v[2][1] ) : ( v[1][1] > v[2][1] ? v[1][1] : v[2][1] );
+    minX = minX / 16 < 0 ? 0 : minX / 16;
+    minY = minY / 16 < 0 ? 0 : minY / 16;
+    maxX = maxX / 16 > OVERDRAW_GRID_SIZE - 1 ? OVERDRAW_GRID_SIZE - 1 : maxX / 16;
+    maxY = maxY / 16 > OVERDRAW_GRID_SIZE - 1 ? OVERDRAW_GRID_SIZE - 1 : maxY / 16;
+    
+    for( y = minY; y <= maxY; y++ )
+    {
+        for( x = minX; x <= maxX; x++ )
+        {
+            // pixel center, the weights of corners 0, 1 and 2 times area
+            long long w0 = esMeshEdge( v[1], v[2], x * 16 + 8, y * 16 + 8 );
+            long long w1 = esMeshEdge( v[2], v[0], x * 16 + 8, y * 16 + 8 );
+            long long w2 = esMeshEdge( v[0], v[1], x * 16 + 8, y * 16 + 8 );
+            float *depth = &depths[ y * OVERDRAW_GRID_SIZE + x ];
+            float z;
+            
+            if( w0 < 0 || w1 < 0 || w2 < 0 ||
+                ( w0 == 0 && !esMeshEdgeOwnsCenters( v[1], v[2] ) ) ||
+                ( w1 == 0 && !esMeshEdgeOwnsCenters( v[2], v[0] ) ) ||
+                ( w2 == 0 && !esMeshEdgeOwnsCenters( v[0], v[1] ) ) )
+            {
+                continue;
+            }
+            
+            z = ( ( float ) w0 * corners[0][2] + ( float ) w1 * corners[1][2] + ( float ) w2 * corners[2][2] ) / ( float ) area;
+            
+            if( z < *depth )
+            {
+                stats->covered += *depth == FLT_MAX;
+                stats->shaded++;
+                *depth = z;
+            }
+        }
+    }
+}
+
+// esMeshAnalyzeOverdraw()
+void ESUTIL_API esMeshAnalyzeOverdraw( const GLuint *indices, int numIndices, const GLfloat *positions, int numVertices,
+                                       ESMeshOverdrawStats *stats )
+{
+    float *depths = malloc( sizeof( float ) * OVERDRAW_GRID_SIZE * OVERDRAW_GRID_SIZE );
+    GLfloat minPos[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    GLfloat extent = 0.0f;
+    float scale;
+    int view;
+    int i;
+    int k;
+    
+    memset( stats, 0, sizeof( ESMeshOverdrawStats ) );
+    
+    if( depths == NULL || numIndices < 3 || numVertices < 1 )
+    {
+        free( depths );
+        return;
+    }
+    
+    for( i = 0; i < numVertices; i++ )
+    {
+        for( k = 0; k < 3; k++ )
+        {
+            minPos[k] = fminf( minPos[k], positions[i * 3 + k] );
+        }
+    }
+    
+    for( i = 0; i < numVertices; i++ )
+    {
+        for( k = 0; k < 3; k++ )
+        {
+            extent = fmaxf( extent, positions[i * 3 + k] - minPos[k] );
+        }
+    }
+    
+    // the largest side of the bounding box spans the grid
+    scale = extent > 0.0f ? 1.0f / extent : 0.0f;
+    
+    // Looking down -axis and +axis for each axis. The screen axes follow the view axis cyclically,
+    // the view from the other side mirrors x so counter-clockwise stays front facing
+    for( view = 0; view < 6; view++ )
+    {
+        int axis = view / 2;
+        int flip = view & 1;
+        
+        for( i = 0; i < OVERDRAW_GRID_SIZE * OVERDRAW_GRID_SIZE; i++ )
+        {
+            depths[i] = FLT_MAX;
+        }
+        
+        for( i = 0; i + 2 < numIndices; i += 3 )
+        {
+            float corners[3][3];
+            
+            for( k = 0; k < 3; k++ )
+            {
+                const GLfloat *p = &positions[ indices[i + k] * 3 ];
+                float sx = ( p[( axis + 1 ) % 3] - minPos[( axis + 1 ) % 3] ) * scale;
+                float sy = ( p[( axis + 2 ) % 3] - minPos[( axis + 2 ) % 3] ) * scale;
+                float sz = ( p[axis] - minPos[axis] ) * scale;
+                
+                corners[k][0] = ( flip ? 1.0f - sx : sx ) * OVERDRAW_GRID_SIZE;
+                corners[k][1] = sy * OVERDRAW_GRID_SIZE;
+                corners[k][2] = flip ? sz : 1.0f - sz;
+            }
+            
+            esMeshRasterizeTriangle( depths, stats, corners );
+        }
+    }
+    
+    stats->overdraw = stats->covered > 0 ? ( float ) stats->shaded / ( float ) stats->covered : 0.0f;
+    
+    free( depths );
+}
+
+// esMeshVertexFetchRemap()
+int ESUTIL_API esMeshVertexFetchRemap( GLuint *remap, const GLuint *indices, int numIndices, int numVertices )
+{
+    int next = 0;
+    int i;
+    
+    for( i = 0; i < numVertices; i++ )
+    {
+        remap[i] = ES_MESH_UNUSED;
+    }
+    
+    for( i = 0; i < numIndices; i++ )
+    {
+        if( remap[ indices[i] ] == ES_MESH_UNUSED )
+        {
+            remap[ indices[i] ] = next++;
+        }
+    }
+    
+    return next;
+}
+
+// esMeshRemapIndices()
+void ESUTIL_API esMeshRemapIndices( GLuint *destination, const GLuint *indices, int numIndices, const GLuint *remap )
+{
+    int i;
+    
+    for( i = 0; i < numIndices; i++ )
+    {
+        destination[i] = remap[ indices[i] ];
+    }
+}
+
+// esMeshRemapVertices()
+void ESUTIL_API esMeshRemapVertices( void *destination, const void *vertices, int numVertices, int vertexSize,
+                                     const GLuint *remap )
+{
+    const unsigned char *src = vertices;
+    unsigned char *dst = destination;
+    int i;
+    
+    for( i = 0; i < numVertices; i++ )
+    {
+        if( remap[i] != ES_MESH_UNUSED )
+        {
+            memcpy( dst + ( size_t ) remap[i] * vertexSize, src + ( size_t ) i * vertexSize, vertexSize );
+        }
+    }
+}
+
+// remap one vertex stream of an esGen* shape in place, scratch holds a copy of the largest stream
+static void esMeshRemapStream( GLfloat *stream, int numVertices, int numComponents, const GLuint *remap, GLfloat *scratch )
+{
+    size_t size = sizeof( GLfloat ) * numComponents * numVertices;
+    
+    if( stream == NULL )
+    {
+        return;
+    }
+    
+    memcpy( scratch, stream, size );
+    esMeshRemapVertices( stream, scratch, numVertices, sizeof( GLfloat ) * numComponents, remap );
+}
+
+// esMeshOptimizeShape()
+GLboolean ESUTIL_API esMeshOptimizeShape( GLuint *indices, int numIndices, int numVertices,
+                                          GLfloat *vertices, GLfloat *normals, GLfloat *texCoords )
+{
+    ESMeshCacheStats before;
+    ESMeshCacheStats after;
+    GLuint  *remap   = malloc( sizeof( GLuint ) * numVertices );
+    GLfloat *scratch = malloc( sizeof( GLfloat ) * 3 * numVertices );
+    GLuint next;
+    int i;
+    
+    if( remap == NULL || scratch == NULL )
+    {
+        free( remap );
+        free( scratch );
+        return GL_FALSE;
+    }
+    
+    esMeshAnalyzeCache( indices, numIndices, numVertices, ES_MESH_CACHE_SIZE, &before );
+    
+    if( !esMeshOptimizeVertexCache( indices, indices, numIndices, numVertices ) ||
+        ( vertices != NULL &&
+          !esMeshOptimizeOverdraw( indices, indices, numIndices, vertices, numVertices, ES_MESH_OVERDRAW_THRESHOLD ) ) )
+    {
+        free( remap );
+        free( scratch );
+        return GL_FALSE;
+    }
+    
+    // Unreferenced vertices are moved to the end, the stream sizes stay the same
+    next = esMeshVertexFetchRemap( remap, indices, numIndices, numVertices );
+    
+    for( i = 0; i < numVertices; i++ )
+    {
+        if( remap[i] == ES_MESH_UNUSED )
+        {
+            remap[i] = next++;
+        }
+    }
+    
+    esMeshRemapIndices( indices, indices, numIndices, remap );
+    esMeshRemapStream( vertices, numVertices, 3, remap, scratch );
+    esMeshRemapStream( normals, numVertices, 3, remap, scratch );
+    esMeshRemapStream( texCoords, numVertices, 2, remap, scratch );
+    
+    free( remap );
+    free( scratch );
+    
+    esMeshAnalyzeCache( indices, numIndices, numVertices, ES_MESH_CACHE_SIZE, &after );
+    esLogMessage( " esMeshOptimizeShape: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+                  before.acmr, after.acmr, before.atvr, after.atvr );
+    
+    return GL_TRUE;
+}
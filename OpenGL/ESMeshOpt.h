@@ -0,0 +1,77 @@
+//
+//  ESMeshOpt.h
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+
+#ifndef ESMeshOpt_h
+#define ESMeshOpt_h
+
+#include "ESUtil.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// Post-transform cache size the optimizer scores for, a conservative guess for current GPUs
+#define ES_MESH_CACHE_SIZE 32
+// Written to a remap table for vertices no triangle references
+#define ES_MESH_UNUSED     0xFFFFFFFFu
+// ACMR the overdraw pass may give up per cluster, 1.05 keeps the cache order within 5%
+#define ES_MESH_OVERDRAW_THRESHOLD 1.05f
+
+typedef struct
+{
+    // vertex shader invocations of a FIFO cache
+    int   transforms;
+    // average cache miss ratio: transforms per triangle, 0.5 is the ideal for large regular meshes
+    float acmr;
+    // average transform to vertex ratio: transforms per referenced vertex, 1.0 is the ideal
+    float atvr;
+} ESMeshCacheStats;
+
+typedef struct
+{
+    // pixels covered and fragments that passed the depth test, summed over the six axis views
+    int   covered;
+    int   shaded;
+    // shaded per covered pixel, 1.0 is the ideal
+    float overdraw;
+} ESMeshOverdrawStats;
+
+// simulate a FIFO post-transform cache of cacheSize entries over a triangle list
+void ESUTIL_API esMeshAnalyzeCache( const GLuint *indices, int numIndices, int numVertices, int cacheSize,
+                                    ESMeshCacheStats *stats );
+// reorder the triangles for the post-transform cache ( Forsyth's linear-speed algorithm ).
+// destination may be indices
+GLboolean ESUTIL_API esMeshOptimizeVertexCache( GLuint *destination, const GLuint *indices, int numIndices, int numVertices );
+// rasterize the triangle list ( counter-clockwise front faces, back faces culled ) from the six axis
+// directions with a depth test and count how often covered pixels were shaded. positions are packed x, y, z
+void ESUTIL_API esMeshAnalyzeOverdraw( const GLuint *indices, int numIndices, const GLfloat *positions, int numVertices,
+                                       ESMeshOverdrawStats *stats );
+// reorder the clusters of a cache optimized triangle list so outward facing parts of the mesh come first
+// ( Sander, Nehab, Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" ).
+// Clusters are cut where the ACMR stays within threshold of the input's, ES_MESH_OVERDRAW_THRESHOLD.
+// destination may be indices
+GLboolean ESUTIL_API esMeshOptimizeOverdraw( GLuint *destination, const GLuint *indices, int numIndices,
+                                             const GLfloat *positions, int numVertices, float threshold );
+// build a remap table that renumbers the vertices in the order the indices first use them,
+// so vertex fetch walks memory linearly. Returns the number of referenced vertices
+int ESUTIL_API esMeshVertexFetchRemap( GLuint *remap, const GLuint *indices, int numIndices, int numVertices );
+// apply a remap table to an index buffer, destination may be indices
+void ESUTIL_API esMeshRemapIndices( GLuint *destination, const GLuint *indices, int numIndices, const GLuint *remap );
+// apply a remap table to one vertex stream of vertexSize bytes per vertex, destination must not alias vertices
+void ESUTIL_API esMeshRemapVertices( void *destination, const void *vertices, int numVertices, int vertexSize,
+                                     const GLuint *remap );
+// run the cache, overdraw ( needs vertices ) and fetch passes over the output of an esGen* shape generator
+// in place, any of the vertex streams may be NULL. Logs the ACMR/ATVR before and after
+GLboolean ESUTIL_API esMeshOptimizeShape( GLuint *indices, int numIndices, int numVertices,
+                                          GLfloat *vertices, GLfloat *normals, GLfloat *texCoords );
+                                          
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESMeshOpt_h */
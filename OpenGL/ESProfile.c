@@ -0,0 +1,330 @@
+//
+//  ESProfile.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  Scoped CPU zones. Every thread appends finished zones to a ring of its own,
+//  publishing each one by bumping its head, so recording takes no locks and
+//  never waits. The trace writer copies a ring and then re-reads its head to
+//  drop whatever the owner overwrote in the meantime.
+//
+
+#include "ESProfile.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    const char        *name;
+    unsigned long long start;
+    unsigned long long end;
+} ESProfileEvent;
+
+typedef struct
+{
+    // zones ever recorded, the last ES_PROFILE_RING_SIZE of them are in events
+    unsigned long long head;
+    // zones before this one were dropped by esProfileReset
+    unsigned long long floor;
+    // a running thread records into this ring, cleared when it exits
+    int                owned;
+    int                threadId;
+    char               name[32];
+    ESProfileEvent     events[ES_PROFILE_RING_SIZE];
+} ESProfileThread;
+
+int esProfileCapturing;
+
+static ESProfileThread *profileThreads[ES_PROFILE_MAX_THREADS];
+static int profileNumThreads;
+// trace timestamps count from here
+static unsigned long long profileEpoch;
+
+// ring of the calling thread, created on its first zone
+static __thread ESProfileThread *profileThread;
+// the calling thread found no free slot, don't try again
+static __thread int profileThreadFull;
+// esProfileSetThreadName before the ring exists
+static __thread char profileThreadName[32];
+
+// hands the ring back when its thread exits
+static pthread_key_t profileThreadKey;
+static pthread_once_t profileThreadKeyOnce = PTHREAD_ONCE_INIT;
+
+static void esProfileReleaseThread( void *arg )
+{
+    ESProfileThread *thread = arg;
+    
+    __atomic_store_n( &thread->owned, 0, __ATOMIC_RELEASE );
+}
+
+static void esProfileCreateThreadKey( void )
+{
+    pthread_key_create( &profileThreadKey, esProfileReleaseThread );
+}
+
+// take over the ring of an exited thread of the same name, threads started again
+// and again ( e.g. the update thread of every esMainLoop run ) stay on one track
+static ESProfileThread *esProfileAdoptThread( void )
+{
+    int count = __atomic_load_n( &profileNumThreads, __ATOMIC_RELAXED );
+    int i;
+    
+    if( profileThreadName[0] == '\0' )
+    {
+        return NULL;
+    }
+    
+    for( i = 0; i < count && i < ES_PROFILE_MAX_THREADS; i++ )
+    {
+        ESProfileThread *thread = __atomic_load_n( &profileThreads[i], __ATOMIC_ACQUIRE );
+        int owned = 0;
+        
+        if( thread != NULL && strcmp( thread->name, profileThreadName ) == 0 &&
+            __atomic_compare_exchange_n( &thread->owned, &owned, 1, GL_FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) )
+        {
+            return thread;
+        }
+    }
+    
+    return NULL;
+}
+
+static ESProfileThread *esProfileGetThread( void )
+{
+    ESProfileThread *thread;
+    int slot;
+    
+    if( profileThread != NULL || profileThreadFull )
+    {
+        return profileThread;
+    }
+    
+    pthread_once( &profileThreadKeyOnce, esProfileCreateThreadKey );
+    
+    thread = esProfileAdoptThread();
+    
+    if( thread != NULL )
+    {
+        pthread_setspecific( profileThreadKey, thread );
+        profileThread = thread;
+        return thread;
+    }
+    
+    slot = __atomic_fetch_add( &profileNumThreads, 1, __ATOMIC_RELAXED );
+    thread = slot < ES_PROFILE_MAX_THREADS ? calloc( 1, sizeof( ESProfileThread ) ) : NULL;
+    
+    if( thread == NULL )
+    {
+        profileThreadFull = GL_TRUE;
+        return NULL;
+    }
+    
+    thread->owned    = 1;
+    thread->threadId = slot + 1;
+    
+    if( profileThreadName[0] != '\0' )
+    {
+        memcpy( thread->name, profileThreadName, sizeof( thread->name ) );
+    }
+    else
+    {
+        snprintf( thread->name, sizeof( thread->name ), "thread %d", slot + 1 );
+    }
+    
+    // the ring is complete before the trace writer can see it
+    __atomic_store_n( &profileThreads[slot], thread, __ATOMIC_RELEASE );
+    pthread_setspecific( profileThreadKey, thread );
+    profileThread = thread;
+    
+    return thread;
+}
+
+// esProfileStart()
+void ESUTIL_API esProfileStart( void )
+{
+    if( profileEpoch == 0 )
+    {
+        profileEpoch = esGetTimeNs();
+    }
+    
+    __atomic_store_n( &esProfileCapturing, 1, __ATOMIC_RELAXED );
+}
+
+// esProfileStop()
+void ESUTIL_API esProfileStop( void )
+{
+    __atomic_store_n( &esProfileCapturing, 0, __ATOMIC_RELAXED );
+}
+
+// esProfileReset()
+void ESUTIL_API esProfileReset( void )
+{
+    int count = __atomic_load_n( &profileNumThreads, __ATOMIC_RELAXED );
+    int i;
+    
+    for( i = 0; i < count && i < ES_PROFILE_MAX_THREADS; i++ )
+    {
+        ESProfileThread *thread = __atomic_load_n( &profileThreads[i], __ATOMIC_ACQUIRE );
+        
+        if( thread != NULL )
+        {
+            __atomic_store_n( &thread->floor, __atomic_load_n( &thread->head, __ATOMIC_ACQUIRE ), __ATOMIC_RELAXED );
+        }
+    }
+    
+    profileEpoch = esGetTimeNs();
+}
+
+// esProfileSetThreadName()
+void ESUTIL_API esProfileSetThreadName( const char *name )
+{
+    // The ring is only made once the thread records something
+    snprintf( profileThreadName, sizeof( profileThreadName ), "%s", name );
+    
+    if( profileThread != NULL )
+    {
+        memcpy( profileThread->name, profileThreadName, sizeof( profileThread->name ) );
+    }
+}
+
+// esProfileRecord()
+void ESUTIL_API esProfileRecord( const char *name, unsigned long long start, unsigned long long end )
+{
+    ESProfileThread *thread = esProfileGetThread();
+    ESProfileEvent *event;
+    
+    if( thread == NULL )
+    {
+        return;
+    }
+    
+    // Fields are stored atomically only so the trace writer may read a slot being overwritten,
+    // such a slot is thrown away afterwards
+    event = &thread->events[thread->head % ES_PROFILE_RING_SIZE];
+    __atomic_store_n( &event->name, name, __ATOMIC_RELAXED );
+    __atomic_store_n( &event->start, start, __ATOMIC_RELAXED );
+    __atomic_store_n( &event->end, end, __ATOMIC_RELAXED );
+    __atomic_store_n( &thread->head, thread->head + 1, __ATOMIC_RELEASE );
+}
+
+// write s as the contents of a JSON string
+static void esProfileWriteString( FILE *fp, const char *s )
+{
+    for( ; *s != '\0'; s++ )
+    {
+        if( *s == '"' || *s == '\\' )
+        {
+            fputc( '\\', fp );
+            fputc( *s, fp );
+        }
+        else if( ( unsigned char ) *s >= 0x20 )
+        {
+            fputc( *s, fp );
+        }
+    }
+}
+
+// copy the zones of thread that are still intact, returns how many
+static int esProfileCopyThread( const ESProfileThread *thread, ESProfileEvent *events )
+{
+    unsigned long long head = __atomic_load_n( &thread->head, __ATOMIC_ACQUIRE );
+    unsigned long long first = head > ES_PROFILE_RING_SIZE ? head - ES_PROFILE_RING_SIZE : 0;
+    unsigned long long floor = __atomic_load_n( &thread->floor, __ATOMIC_RELAXED );
+    unsigned long long index;
+    int count = 0;
+    
+    first = first > floor ? first : floor;
+    
+    for( index = first; index < head; index++ )
+    {
+        const ESProfileEvent *event = &thread->events[index % ES_PROFILE_RING_SIZE];
+        
+        events[index - first].name  = __atomic_load_n( &event->name, __ATOMIC_RELAXED );
+        events[index - first].start = __atomic_load_n( &event->start, __ATOMIC_RELAXED );
+        events[index - first].end   = __atomic_load_n( &event->end, __ATOMIC_RELAXED );
+    }
+    
+    // The owner may have lapped us while copying. The slot of zone i is rewritten
+    // while zone i + ES_PROFILE_RING_SIZE is recorded, before head moves past it
+    __atomic_thread_fence( __ATOMIC_ACQUIRE );
+    index = __atomic_load_n( &thread->head, __ATOMIC_RELAXED );
+    
+    if( index >= first + ES_PROFILE_RING_SIZE )
+    {
+        unsigned long long lost = index - ES_PROFILE_RING_SIZE + 1 - first;
+        
+        if( lost >= head - first )
+        {
+            return 0;
+        }
+        
+        memmove( events, events + lost, sizeof( ESProfileEvent ) * ( size_t ) ( head - first - lost ) );
+        first += lost;
+    }
+    
+    count = ( int ) ( head - first );
+    return count;
+}
+
+// esProfileWriteTrace()
+GLboolean ESUTIL_API esProfileWriteTrace( const char *fileName )
+{
+    ESProfileEvent *events;
+    FILE *fp;
+    int numThreads = __atomic_load_n( &profileNumThreads, __ATOMIC_RELAXED );
+    int separator = GL_FALSE;
+    int i;
+    int k;
+    
+    numThreads = numThreads < ES_PROFILE_MAX_THREADS ? numThreads : ES_PROFILE_MAX_THREADS;
+    events = malloc( sizeof( ESProfileEvent ) * ES_PROFILE_RING_SIZE );
+    fp = events != NULL ? fopen( fileName, "w" ) : NULL;
+    
+    if( fp == NULL )
+    {
+        free( events );
+        return GL_FALSE;
+    }
+    
+    fputs( "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", fp );
+    
+    for( i = 0; i < numThreads; i++ )
+    {
+        const ESProfileThread *thread = __atomic_load_n( &profileThreads[i], __ATOMIC_ACQUIRE );
+        int count;
+        
+        if( thread == NULL )
+        {
+            continue;
+        }
+        
+        fprintf( fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"",
+                 separator ? "," : "", thread->threadId );
+        esProfileWriteString( fp, thread->name );
+        fputs( "\"}}", fp );
+        separator = GL_TRUE;
+        
+        count = esProfileCopyThread( thread, events );
+        
+        // Complete events in microseconds, the viewers nest them by time
+        for( k = 0; k < count; k++ )
+        {
+            long long start = ( long long ) ( events[k].start - profileEpoch );
+            
+            fputs( ",\n{\"name\":\"", fp );
+            esProfileWriteString( fp, events[k].name );
+            fprintf( fp, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                     thread->threadId, start * 1e-3, ( events[k].end - events[k].start ) * 1e-3 );
+        }
+    }
+    
+    fputs( "\n]}\n", fp );
+    free( events );
+    
+    return fclose( fp ) == 0 ? GL_TRUE : GL_FALSE;
+}
@@ -0,0 +1,82 @@
+//
+//  ESProfile.h
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+
+#ifndef ESProfile_h
+#define ESProfile_h
+
+#include "ESUtil.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// Zones a thread keeps, older ones are overwritten when it records more between two dumps
+#define ES_PROFILE_RING_SIZE   16384
+// Threads that can record, zones of any thread past this are dropped
+#define ES_PROFILE_MAX_THREADS 64
+
+typedef struct
+{
+    const char        *name;
+    // 0 when nothing was capturing as the zone opened
+    unsigned long long start;
+} ESProfileZone;
+
+// ES_PROFILE_ZONE( "name" ) times the rest of the enclosing block. name has to outlive the trace,
+// e.g. a string literal. Without ES_PROFILE defined it compiles to nothing, with it a zone costs
+// one load and branch while no capture is running
+#if defined( ES_PROFILE ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+#define ES_PROFILE_CONCAT2( a, b ) a##b
+#define ES_PROFILE_CONCAT( a, b )  ES_PROFILE_CONCAT2( a, b )
+#define ES_PROFILE_ZONE( name ) \
+    ESProfileZone ES_PROFILE_CONCAT( esProfileZone, __LINE__ ) \
+        __attribute__(( cleanup( esProfileZoneEnd ), unused )) = esProfileZoneBegin( name )
+#else
+#define ES_PROFILE_ZONE( name ) do { } while( 0 )
+#endif
+
+// start recording zones on every thread
+void ESUTIL_API esProfileStart( void );
+// stop recording, what was recorded stays until esProfileReset
+void ESUTIL_API esProfileStop( void );
+// drop everything recorded so far
+void ESUTIL_API esProfileReset( void );
+// name the calling thread in the trace, name is copied
+void ESUTIL_API esProfileSetThreadName( const char *name );
+// record a zone from explicit esGetTimeNs timestamps, e.g. one that spans callbacks
+void ESUTIL_API esProfileRecord( const char *name, unsigned long long start, unsigned long long end );
+// write what was recorded as Chrome trace event JSON, for chrome://tracing or ui.perfetto.dev.
+// Safe while other threads keep recording
+GLboolean ESUTIL_API esProfileWriteTrace( const char *fileName );
+
+// set while a capture runs, read by esProfileZoneBegin
+extern int esProfileCapturing;
+
+static inline ESProfileZone esProfileZoneBegin( const char *name )
+{
+    ESProfileZone zone;
+    
+    zone.name  = name;
+    zone.start = __atomic_load_n( &esProfileCapturing, __ATOMIC_RELAXED ) ? esGetTimeNs() : 0;
+    
+    return zone;
+}
+
+static inline void esProfileZoneEnd( ESProfileZone *zone )
+{
+    if( zone->start != 0 )
+    {
+        esProfileRecord( zone->name, zone->start, esGetTimeNs() );
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESProfile_h */
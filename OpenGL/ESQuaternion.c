@@ -0,0 +1,532 @@
+//
+//  ESQuaternion.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  Quaternions, dual quaternions and direct TRS matrix construction. A TRS
+//  matrix is three scaled rotation rows and the translation, so it is written
+//  out in place instead of going through identity, translate, rotate and scale
+//  with a 4x4 multiply each. The batch version builds four matrices at a time
+//  from structure-of-arrays input and transposes them into place.
+//
+
+#include "ESQuaternion.h"
+#include <math.h>
+
+#if defined( __SSE__ ) || defined( _M_X64 )
+#define ES_QUATERNION_SSE 1
+#include <xmmintrin.h>
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#define ES_QUATERNION_NEON 1
+#include <arm_neon.h>
+#endif
+
+#define PI 3.1415926535897932384626433832795f
+
+// Above this cosine slerp falls back to a normalized lerp, sin( theta ) is too small to divide by
+#define SLERP_LINEAR_THRESHOLD 0.9995f
+
+// esQuaternionIdentity()
+void ESUTIL_API esQuaternionIdentity( ESQuaternion *result )
+{
+    result->x = 0.0f;
+    result->y = 0.0f;
+    result->z = 0.0f;
+    result->w = 1.0f;
+}
+
+// esQuaternionFromAxisAngle()
+void ESUTIL_API esQuaternionFromAxisAngle( ESQuaternion *result, GLfloat angle, GLfloat x, GLfloat y, GLfloat z )
+{
+    GLfloat mag = sqrtf( x * x + y * y + z * z );
+    GLfloat halfAngle = angle * PI / 360.0f;
+    GLfloat s;
+    
+    // esRotate ignores a zero axis too
+    if( mag <= 0.0f )
+    {
+        esQuaternionIdentity( result );
+        return;
+    }
+    
+    s = sinf( halfAngle ) / mag;
+    
+    result->x = x * s;
+    result->y = y * s;
+    result->z = z * s;
+    result->w = cosf( halfAngle );
+}
+
+// esQuaternionMultiply()
+//
+// The Hamilton product a * b. esQuaternionToMatrix( a * b ) equals
+// esQuaternionToMatrix( a ) * esQuaternionToMatrix( b ), the esMatrixMultiply order
+void ESUTIL_API esQuaternionMultiply( ESQuaternion *result, const ESQuaternion *a, const ESQuaternion *b )
+{
+    ESQuaternion tmp;
+    
+    tmp.x = a->w * b->x + a->x * b->w + a->y * b->z - a->z * b->y;
+    tmp.y = a->w * b->y - a->x * b->z + a->y * b->w + a->z * b->x;
+    tmp.z = a->w * b->z + a->x * b->y - a->y * b->x + a->z * b->w;
+    tmp.w = a->w * b->w - a->x * b->x - a->y * b->y - a->z * b->z;
+    
+    *result = tmp;
+}
+
+// esQuaternionNormalize()
+void ESUTIL_API esQuaternionNormalize( ESQuaternion *result )
+{
+    GLfloat mag = sqrtf( result->x * result->x + result->y * result->y +
+                         result->z * result->z + result->w * result->w );
+    
+    if( mag > 0.0f )
+    {
+        GLfloat invMag = 1.0f / mag;
+        
+        result->x *= invMag;
+        result->y *= invMag;
+        result->z *= invMag;
+        result->w *= invMag;
+    }
+    else
+    {
+        esQuaternionIdentity( result );
+    }
+}
+
+// esQuaternionSlerp()
+void ESUTIL_API esQuaternionSlerp( ESQuaternion *result, const ESQuaternion *a, const ESQuaternion *b, GLfloat t )
+{
+    GLfloat cosTheta = a->x * b->x + a->y * b->y + a->z * b->z + a->w * b->w;
+    GLfloat sign = 1.0f;
+    GLfloat weightA;
+    GLfloat weightB;
+    
+    // q and -q are the same rotation, take the one on the near side of a
+    if( cosTheta < 0.0f )
+    {
+        cosTheta = -cosTheta;
+        sign = -1.0f;
+    }
+    
+    if( cosTheta > SLERP_LINEAR_THRESHOLD )
+    {
+        weightA = 1.0f - t;
+        weightB = t;
+    }
+    else
+    {
+        GLfloat theta = acosf( cosTheta );
+        GLfloat invSinTheta = 1.0f / sinf( theta );
+        
+        weightA = sinf( ( 1.0f - t ) * theta ) * invSinTheta;
+        weightB = sinf( t * theta ) * invSinTheta;
+    }
+    
+    weightB *= sign;
+    
+    result->x = weightA * a->x + weightB * b->x;
+    result->y = weightA * a->y + weightB * b->y;
+    result->z = weightA * a->z + weightB * b->z;
+    result->w = weightA * a->w + weightB * b->w;
+    
+    if( cosTheta > SLERP_LINEAR_THRESHOLD )
+    {
+        esQuaternionNormalize( result );
+    }
+}
+
+// esQuaternionToMatrix()
+void ESUTIL_API esQuaternionToMatrix( ESMatrix *result, const ESQuaternion *rotation )
+{
+    esMatrixFromTRS( result, NULL, rotation, NULL );
+}
+
+// esMatrixFromTRS()
+//
+// Row i is the rotation's row i times scale i, laid out like esRotate builds its rotMat
+void ESUTIL_API esMatrixFromTRS( ESMatrix *result, const GLfloat *translation, const ESQuaternion *rotation,
+                                 const GLfloat *scale )
+{
+    GLfloat x = rotation->x;
+    GLfloat y = rotation->y;
+    GLfloat z = rotation->z;
+    GLfloat w = rotation->w;
+    GLfloat sx = scale != NULL ? scale[0] : 1.0f;
+    GLfloat sy = scale != NULL ? scale[1] : 1.0f;
+    GLfloat sz = scale != NULL ? scale[2] : 1.0f;
+    
+    result->m[0][0] = sx * ( 1.0f - 2.0f * ( y * y + z * z ) );
+    result->m[0][1] = sx * ( 2.0f * ( x * y - z * w ) );
+    result->m[0][2] = sx * ( 2.0f * ( x * z + y * w ) );
+    result->m[0][3] = 0.0f;
+    
+    result->m[1][0] = sy * ( 2.0f * ( x * y + z * w ) );
+    result->m[1][1] = sy * ( 1.0f - 2.0f * ( x * x + z * z ) );
+    result->m[1][2] = sy * ( 2.0f * ( y * z - x * w ) );
+    result->m[1][3] = 0.0f;
+    
+    result->m[2][0] = sz * ( 2.0f * ( x * z - y * w ) );
+    result->m[2][1] = sz * ( 2.0f * ( y * z + x * w ) );
+    result->m[2][2] = sz * ( 1.0f - 2.0f * ( x * x + y * y ) );
+    result->m[2][3] = 0.0f;
+    
+    result->m[3][0] = translation != NULL ? translation[0] : 0.0f;
+    result->m[3][1] = translation != NULL ? translation[1] : 0.0f;
+    result->m[3][2] = translation != NULL ? translation[2] : 0.0f;
+    result->m[3][3] = 1.0f;
+}
+
+// element i of an optional array, fallback when the array is NULL
+static GLfloat esTRSComponent( const GLfloat *values, int i, GLfloat fallback )
+{
+    return values != NULL ? values[i] : fallback;
+}
+
+// esMatrixFromTRS for one element of the arrays
+static void esMatrixFromTRSElement( ESMatrix *result, const ESTRSArrays *trs, int i )
+{
+    GLfloat translation[3];
+    GLfloat scale[3];
+    ESQuaternion rotation;
+    
+    translation[0] = esTRSComponent( trs->positionX, i, 0.0f );
+    translation[1] = esTRSComponent( trs->positionY, i, 0.0f );
+    translation[2] = esTRSComponent( trs->positionZ, i, 0.0f );
+    rotation.x     = trs->rotationX[i];
+    rotation.y     = trs->rotationY[i];
+    rotation.z     = trs->rotationZ[i];
+    rotation.w     = trs->rotationW[i];
+    scale[0]       = esTRSComponent( trs->scaleX, i, 1.0f );
+    scale[1]       = esTRSComponent( trs->scaleY, i, 1.0f );
+    scale[2]       = esTRSComponent( trs->scaleZ, i, 1.0f );
+    
+    esMatrixFromTRS( result, translation, &rotation, scale );
+}
+
+#if defined( ES_QUATERNION_SSE )
+
+// lanes k = 0..3 hold component values[ indices[k] ] ( or values[k] )
+static __m128 esTRSLoad4( const GLfloat *values, const int *indices, GLfloat fallback )
+{
+    if( values == NULL )
+    {
+        return _mm_set1_ps( fallback );
+    }
+    
+    if( indices == NULL )
+    {
+        return _mm_loadu_ps( values );
+    }
+    
+    return _mm_setr_ps( values[indices[0]], values[indices[1]], values[indices[2]], values[indices[3]] );
+}
+
+// four matrices from elements indices[0..3] ( or 0..3 ) of the arrays
+static void esMatrixFromTRS4( ESMatrix *result, const ESTRSArrays *trs, const int *indices, int first )
+{
+    const int *lanes = indices != NULL ? &indices[first] : NULL;
+    int offset = indices != NULL ? 0 : first;
+    __m128 x  = esTRSLoad4( trs->rotationX + offset, lanes, 0.0f );
+    __m128 y  = esTRSLoad4( trs->rotationY + offset, lanes, 0.0f );
+    __m128 z  = esTRSLoad4( trs->rotationZ + offset, lanes, 0.0f );
+    __m128 w  = esTRSLoad4( trs->rotationW + offset, lanes, 1.0f );
+    __m128 sx = esTRSLoad4( trs->scaleX != NULL ? trs->scaleX + offset : NULL, lanes, 1.0f );
+    __m128 sy = esTRSLoad4( trs->scaleY != NULL ? trs->scaleY + offset : NULL, lanes, 1.0f );
+    __m128 sz = esTRSLoad4( trs->scaleZ != NULL ? trs->scaleZ + offset : NULL, lanes, 1.0f );
+    __m128 one = _mm_set1_ps( 1.0f );
+    __m128 x2 = _mm_add_ps( x, x );
+    __m128 y2 = _mm_add_ps( y, y );
+    __m128 z2 = _mm_add_ps( z, z );
+    __m128 xx = _mm_mul_ps( x, x2 );
+    __m128 yy = _mm_mul_ps( y, y2 );
+    __m128 zz = _mm_mul_ps( z, z2 );
+    __m128 xy = _mm_mul_ps( x, y2 );
+    __m128 xz = _mm_mul_ps( x, z2 );
+    __m128 yz = _mm_mul_ps( y, z2 );
+    __m128 wx = _mm_mul_ps( w, x2 );
+    __m128 wy = _mm_mul_ps( w, y2 );
+    __m128 wz = _mm_mul_ps( w, z2 );
+    __m128 row0[4];
+    __m128 row1[4];
+    __m128 row2[4];
+    __m128 row3[4];
+    int k;
+    
+    // one register per matrix element, lane k belongs to matrix k
+    row0[0] = _mm_mul_ps( sx, _mm_sub_ps( one, _mm_add_ps( yy, zz ) ) );
+    row0[1] = _mm_mul_ps( sx, _mm_sub_ps( xy, wz ) );
+    row0[2] = _mm_mul_ps( sx, _mm_add_ps( xz, wy ) );
+    row0[3] = _mm_setzero_ps();
+    row1[0] = _mm_mul_ps( sy, _mm_add_ps( xy, wz ) );
+    row1[1] = _mm_mul_ps( sy, _mm_sub_ps( one, _mm_add_ps( xx, zz ) ) );
+    row1[2] = _mm_mul_ps( sy, _mm_sub_ps( yz, wx ) );
+    row1[3] = _mm_setzero_ps();
+    row2[0] = _mm_mul_ps( sz, _mm_sub_ps( xz, wy ) );
+    row2[1] = _mm_mul_ps( sz, _mm_add_ps( yz, wx ) );
+    row2[2] = _mm_mul_ps( sz, _mm_sub_ps( one, _mm_add_ps( xx, yy ) ) );
+    row2[3] = _mm_setzero_ps();
+    row3[0] = esTRSLoad4( trs->positionX != NULL ? trs->positionX + offset : NULL, lanes, 0.0f );
+    row3[1] = esTRSLoad4( trs->positionY != NULL ? trs->positionY + offset : NULL, lanes, 0.0f );
+    row3[2] = esTRSLoad4( trs->positionZ != NULL ? trs->positionZ + offset : NULL, lanes, 0.0f );
+    row3[3] = one;
+    
+    // after the transposes register k is row r of matrix k
+    _MM_TRANSPOSE4_PS( row0[0], row0[1], row0[2], row0[3] );
+    _MM_TRANSPOSE4_PS( row1[0], row1[1], row1[2], row1[3] );
+    _MM_TRANSPOSE4_PS( row2[0], row2[1], row2[2], row2[3] );
+    _MM_TRANSPOSE4_PS( row3[0], row3[1], row3[2], row3[3] );
+    
+    for( k = 0; k < 4; k++ )
+    {
+        _mm_storeu_ps( result[k].m[0], row0[k] );
+        _mm_storeu_ps( result[k].m[1], row1[k] );
+        _mm_storeu_ps( result[k].m[2], row2[k] );
+        _mm_storeu_ps( result[k].m[3], row3[k] );
+    }
+}
+
+#elif defined( ES_QUATERNION_NEON )
+
+static float32x4_t esTRSLoad4( const GLfloat *values, const int *indices, GLfloat fallback )
+{
+    float32x4_t v;
+    
+    if( values == NULL )
+    {
+        return vdupq_n_f32( fallback );
+    }
+    
+    if( indices == NULL )
+    {
+        return vld1q_f32( values );
+    }
+    
+    v = vdupq_n_f32( values[indices[0]] );
+    v = vsetq_lane_f32( values[indices[1]], v, 1 );
+    v = vsetq_lane_f32( values[indices[2]], v, 2 );
+    v = vsetq_lane_f32( values[indices[3]], v, 3 );
+    
+    return v;
+}
+
+// transpose a, b, c, d in place like _MM_TRANSPOSE4_PS
+static void esTranspose4( float32x4_t *rows )
+{
+    float32x4x2_t ac = vzipq_f32( rows[0], rows[2] );
+    float32x4x2_t bd = vzipq_f32( rows[1], rows[3] );
+    float32x4x2_t lo = vzipq_f32( ac.val[0], bd.val[0] );
+    float32x4x2_t hi = vzipq_f32( ac.val[1], bd.val[1] );
+    
+    rows[0] = lo.val[0];
+    rows[1] = lo.val[1];
+    rows[2] = hi.val[0];
+    rows[3] = hi.val[1];
+}
+
+static void esMatrixFromTRS4( ESMatrix *result, const ESTRSArrays *trs, const int *indices, int first )
+{
+    const int *lanes = indices != NULL ? &indices[first] : NULL;
+    int offset = indices != NULL ? 0 : first;
+    float32x4_t x  = esTRSLoad4( trs->rotationX + offset, lanes, 0.0f );
+    float32x4_t y  = esTRSLoad4( trs->rotationY + offset, lanes, 0.0f );
+    float32x4_t z  = esTRSLoad4( trs->rotationZ + offset, lanes, 0.0f );
+    float32x4_t w  = esTRSLoad4( trs->rotationW + offset, lanes, 1.0f );
+    float32x4_t sx = esTRSLoad4( trs->scaleX != NULL ? trs->scaleX + offset : NULL, lanes, 1.0f );
+    float32x4_t sy = esTRSLoad4( trs->scaleY != NULL ? trs->scaleY + offset : NULL, lanes, 1.0f );
+    float32x4_t sz = esTRSLoad4( trs->scaleZ != NULL ? trs->scaleZ + offset : NULL, lanes, 1.0f );
+    float32x4_t one = vdupq_n_f32( 1.0f );
+    float32x4_t x2 = vaddq_f32( x, x );
+    float32x4_t y2 = vaddq_f32( y, y );
+    float32x4_t z2 = vaddq_f32( z, z );
+    float32x4_t xx = vmulq_f32( x, x2 );
+    float32x4_t yy = vmulq_f32( y, y2 );
+    float32x4_t zz = vmulq_f32( z, z2 );
+    float32x4_t xy = vmulq_f32( x, y2 );
+    float32x4_t xz = vmulq_f32( x, z2 );
+    float32x4_t yz = vmulq_f32( y, z2 );
+    float32x4_t wx = vmulq_f32( w, x2 );
+    float32x4_t wy = vmulq_f32( w, y2 );
+    float32x4_t wz = vmulq_f32( w, z2 );
+    float32x4_t row0[4];
+    float32x4_t row1[4];
+    float32x4_t row2[4];
+    float32x4_t row3[4];
+    int k;
+    
+    row0[0] = vmulq_f32( sx, vsubq_f32( one, vaddq_f32( yy, zz ) ) );
+    row0[1] = vmulq_f32( sx, vsubq_f32( xy, wz ) );
+    row0[2] = vmulq_f32( sx, vaddq_f32( xz, wy ) );
+    row0[3] = vdupq_n_f32( 0.0f );
+    row1[0] = vmulq_f32( sy, vaddq_f32( xy, wz ) );
+    row1[1] = vmulq_f32( sy, vsubq_f32( one, vaddq_f32( xx, zz ) ) );
+    row1[2] = vmulq_f32( sy, vsubq_f32( yz, wx ) );
+    row1[3] = vdupq_n_f32( 0.0f );
+    row2[0] = vmulq_f32( sz, vsubq_f32( xz, wy ) );
+    row2[1] = vmulq_f32( sz, vaddq_f32( yz, wx ) );
+    row2[2] = vmulq_f32( sz, vsubq_f32( one, vaddq_f32( xx, yy ) ) );
+    row2[3] = vdupq_n_f32( 0.0f );
+    row3[0] = esTRSLoad4( trs->positionX != NULL ? trs->positionX + offset : NULL, lanes, 0.0f );
+    row3[1] = esTRSLoad4( trs->positionY != NULL ? trs->positionY + offset : NULL, lanes, 0.0f );
+    row3[2] = esTRSLoad4( trs->positionZ != NULL ? trs->positionZ + offset : NULL, lanes, 0.0f );
+    row3[3] = one;
+    
+    esTranspose4( row0 );
+    esTranspose4( row1 );
+    esTranspose4( row2 );
+    esTranspose4( row3 );
+    
+    for( k = 0; k < 4; k++ )
+    {
+        vst1q_f32( result[k].m[0], row0[k] );
+        vst1q_f32( result[k].m[1], row1[k] );
+        vst1q_f32( result[k].m[2], row2[k] );
+        vst1q_f32( result[k].m[3], row3[k] );
+    }
+}
+
+#endif
+
+// esMatrixFromTRSBatch()
+void ESUTIL_API esMatrixFromTRSBatch( ESMatrix *result, const ESTRSArrays *trs, const int *indices, int count )
+{
+    int i = 0;
+
+#if defined( ES_QUATERNION_SSE ) || defined( ES_QUATERNION_NEON )
+    for( ; i + 4 <= count; i += 4 )
+    {
+        esMatrixFromTRS4( &result[i], trs, indices, i );
+    }
+#endif
+    
+    for( ; i < count; i++ )
+    {
+        esMatrixFromTRSElement( &result[i], trs, indices != NULL ? indices[i] : i );
+    }
+}
+
+//
+// Dual quaternions
+//
+// real * dual products below are the same Hamilton product as esQuaternionMultiply.
+// With dual = real * t / 2 the product ( ra + e da ) ( rb + e db ) moves the translation
+// of a through the rotation of b and adds the translation of b, the esMatrixMultiply order
+//
+
+// esDualQuaternionFromRotationTranslation()
+void ESUTIL_API esDualQuaternionFromRotationTranslation( ESDualQuaternion *result, const ESQuaternion *rotation,
+                                                         GLfloat tx, GLfloat ty, GLfloat tz )
+{
+    ESQuaternion t;
+    
+    t.x = tx * 0.5f;
+    t.y = ty * 0.5f;
+    t.z = tz * 0.5f;
+    t.w = 0.0f;
+    
+    result->real = *rotation;
+    esQuaternionMultiply( &result->dual, rotation, &t );
+}
+
+// esDualQuaternionMultiply()
+void ESUTIL_API esDualQuaternionMultiply( ESDualQuaternion *result, const ESDualQuaternion *a,
+                                          const ESDualQuaternion *b )
+{
+    ESQuaternion real;
+    ESQuaternion realDual;
+    ESQuaternion dualReal;
+    
+    esQuaternionMultiply( &real, &a->real, &b->real );
+    esQuaternionMultiply( &realDual, &a->real, &b->dual );
+    esQuaternionMultiply( &dualReal, &a->dual, &b->real );
+    
+    result->real   = real;
+    result->dual.x = realDual.x + dualReal.x;
+    result->dual.y = realDual.y + dualReal.y;
+    result->dual.z = realDual.z + dualReal.z;
+    result->dual.w = realDual.w + dualReal.w;
+}
+
+// esDualQuaternionNormalize()
+void ESUTIL_API esDualQuaternionNormalize( ESDualQuaternion *result )
+{
+    ESQuaternion *r = &result->real;
+    ESQuaternion *d = &result->dual;
+    GLfloat mag = sqrtf( r->x * r->x + r->y * r->y + r->z * r->z + r->w * r->w );
+    GLfloat invMag;
+    GLfloat dot;
+    
+    if( mag <= 0.0f )
+    {
+        esQuaternionIdentity( r );
+        d->x = d->y = d->z = d->w = 0.0f;
+        return;
+    }
+    
+    invMag = 1.0f / mag;
+    r->x *= invMag;
+    r->y *= invMag;
+    r->z *= invMag;
+    r->w *= invMag;
+    d->x *= invMag;
+    d->y *= invMag;
+    d->z *= invMag;
+    d->w *= invMag;
+    
+    // drop the part of the dual along the real, a rigid transform has none
+    dot = r->x * d->x + r->y * d->y + r->z * d->z + r->w * d->w;
+    d->x -= r->x * dot;
+    d->y -= r->y * dot;
+    d->z -= r->z * dot;
+    d->w -= r->w * dot;
+}
+
+// esDualQuaternionBlend()
+void ESUTIL_API esDualQuaternionBlend( ESDualQuaternion *result, const ESDualQuaternion *a,
+                                       const ESDualQuaternion *b, GLfloat t )
+{
+    GLfloat weightA = 1.0f - t;
+    GLfloat weightB = t;
+    
+    // blend towards whichever of b and -b is on a's side
+    if( a->real.x * b->real.x + a->real.y * b->real.y + a->real.z * b->real.z + a->real.w * b->real.w < 0.0f )
+    {
+        weightB = -weightB;
+    }
+    
+    result->real.x = weightA * a->real.x + weightB * b->real.x;
+    result->real.y = weightA * a->real.y + weightB * b->real.y;
+    result->real.z = weightA * a->real.z + weightB * b->real.z;
+    result->real.w = weightA * a->real.w + weightB * b->real.w;
+    result->dual.x = weightA * a->dual.x + weightB * b->dual.x;
+    result->dual.y = weightA * a->dual.y + weightB * b->dual.y;
+    result->dual.z = weightA * a->dual.z + weightB * b->dual.z;
+    result->dual.w = weightA * a->dual.w + weightB * b->dual.w;
+    
+    esDualQuaternionNormalize( result );
+}
+
+// esDualQuaternionToMatrix()
+//
+// The translation is 2 * conjugate( real ) * dual
+void ESUTIL_API esDualQuaternionToMatrix( ESMatrix *result, const ESDualQuaternion *transform )
+{
+    ESQuaternion conjugate;
+    ESQuaternion t;
+    GLfloat translation[3];
+    
+    conjugate.x = -transform->real.x;
+    conjugate.y = -transform->real.y;
+    conjugate.z = -transform->real.z;
+    conjugate.w = transform->real.w;
+    
+    esQuaternionMultiply( &t, &conjugate, &transform->dual );
+    
+    translation[0] = 2.0f * t.x;
+    translation[1] = 2.0f * t.y;
+    translation[2] = 2.0f * t.z;
+    
+    esMatrixFromTRS( result, translation, &transform->real, NULL );
+}
@@ -0,0 +1,87 @@
+//
+//  ESQuaternion.h
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+
+#ifndef ESQuaternion_h
+#define ESQuaternion_h
+
+#include "ESUtil.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// Rotations follow the ESMatrix conventions: esQuaternionToMatrix of a quaternion made
+// by esQuaternionFromAxisAngle is what esRotate multiplies in, and the products compose
+// in the same order as esMatrixMultiply
+typedef struct
+{
+    GLfloat x;
+    GLfloat y;
+    GLfloat z;
+    GLfloat w;
+} ESQuaternion;
+
+// Rotation followed by a translation. real is the rotation, dual is half of real * ( tx, ty, tz, 0 )
+typedef struct
+{
+    ESQuaternion real;
+    ESQuaternion dual;
+} ESDualQuaternion;
+
+// Structure-of-arrays input of esMatrixFromTRSBatch. The rotations have to be unit quaternions,
+// a NULL translation array reads as 0 and a NULL scale array as 1
+typedef struct
+{
+    const GLfloat *positionX;
+    const GLfloat *positionY;
+    const GLfloat *positionZ;
+    const GLfloat *rotationX;
+    const GLfloat *rotationY;
+    const GLfloat *rotationZ;
+    const GLfloat *rotationW;
+    const GLfloat *scaleX;
+    const GLfloat *scaleY;
+    const GLfloat *scaleZ;
+} ESTRSArrays;
+
+void ESUTIL_API esQuaternionIdentity( ESQuaternion *result );
+// rotation of angle degrees around ( x, y, z ), the same rotation as esRotate
+void ESUTIL_API esQuaternionFromAxisAngle( ESQuaternion *result, GLfloat angle, GLfloat x, GLfloat y, GLfloat z );
+// rotate by a, then by b. result may alias either
+void ESUTIL_API esQuaternionMultiply( ESQuaternion *result, const ESQuaternion *a, const ESQuaternion *b );
+void ESUTIL_API esQuaternionNormalize( ESQuaternion *result );
+// constant speed interpolation along the shorter arc, t in [ 0, 1 ]
+void ESUTIL_API esQuaternionSlerp( ESQuaternion *result, const ESQuaternion *a, const ESQuaternion *b, GLfloat t );
+void ESUTIL_API esQuaternionToMatrix( ESMatrix *result, const ESQuaternion *rotation );
+
+// scale, rotate, then translate, written straight into result. translation and scale may be NULL.
+// Same matrix as esMatrixLoadIdentity, esTranslate, esRotate, esScale in that order, without the multiplies
+void ESUTIL_API esMatrixFromTRS( ESMatrix *result, const GLfloat *translation, const ESQuaternion *rotation,
+                                 const GLfloat *scale );
+// result[i] is the TRS matrix of element indices[i] of trs, or element i when indices is NULL.
+// Builds four matrices per step with SSE or NEON
+void ESUTIL_API esMatrixFromTRSBatch( ESMatrix *result, const ESTRSArrays *trs, const int *indices, int count );
+
+void ESUTIL_API esDualQuaternionFromRotationTranslation( ESDualQuaternion *result, const ESQuaternion *rotation,
+                                                         GLfloat tx, GLfloat ty, GLfloat tz );
+// transform by a, then by b. result may alias either
+void ESUTIL_API esDualQuaternionMultiply( ESDualQuaternion *result, const ESDualQuaternion *a,
+                                          const ESDualQuaternion *b );
+// make the rotation unit length and the dual part orthogonal to it
+void ESUTIL_API esDualQuaternionNormalize( ESDualQuaternion *result );
+// normalized linear blend, the usual dual quaternion skinning interpolation, t in [ 0, 1 ]
+void ESUTIL_API esDualQuaternionBlend( ESDualQuaternion *result, const ESDualQuaternion *a,
+                                       const ESDualQuaternion *b, GLfloat t );
+// rigid transform of a unit dual quaternion
+void ESUTIL_API esDualQuaternionToMatrix( ESMatrix *result, const ESDualQuaternion *transform );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESQuaternion_h */
@@ -0,0 +1,214 @@
+//
+//  ESRingBuffer.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  Per-frame streaming allocator. One GL buffer is split into numRegions
+//  frame-sized regions, every frame sub-allocates from its own region with
+//  GL_MAP_UNSYNCHRONIZED_BIT, so mapping never waits for the previous frame's
+//  draws. A fence per region guards the wrap-around instead.
+//
+
+#include "ESRingBuffer.h"
+#include "ESProfile.h"
+#include <string.h>
+
+// Poll interval while waiting on a busy region, in nanoseconds
+#define RING_WAIT_TIMEOUT 1000000
+
+static const ESRingBufferGL ringBufferGL =
+{
+    glGenBuffers,
+    glDeleteBuffers,
+    glBindBuffer,
+    glBufferData,
+    glMapBufferRange,
+    glUnmapBuffer,
+    glFenceSync,
+    glClientWaitSync,
+    glDeleteSync,
+};
+
+static const ESRingBufferGL *ringBufferBackend = &ringBufferGL;
+
+// esRingBufferSetBackend()
+void ESUTIL_API esRingBufferSetBackend( const ESRingBufferGL *backend )
+{
+    ringBufferBackend = backend != NULL ? backend : &ringBufferGL;
+}
+
+// esRingBufferInit()
+GLboolean ESUTIL_API esRingBufferInit( ESRingBuffer *ring, GLenum target, GLsizeiptr regionSize, int numRegions )
+{
+    if( ring == NULL || regionSize <= 0 || numRegions < 1 || numRegions > ES_RING_MAX_REGIONS )
+    {
+        return GL_FALSE;
+    }
+    
+    memset( ring, 0, sizeof( ESRingBuffer ) );
+    ring->gl         = ringBufferBackend;
+    ring->target     = target;
+    ring->regionSize = regionSize;
+    ring->numRegions = numRegions;
+    
+    ring->gl->genBuffers( 1, &ring->buffer );
+    
+    if( ring->buffer == 0 )
+    {
+        return GL_FALSE;
+    }
+    
+    ring->gl->bindBuffer( target, ring->buffer );
+    ring->gl->bufferData( target, regionSize * numRegions, NULL, GL_DYNAMIC_DRAW );
+    
+    return GL_TRUE;
+}
+
+// esRingBufferDestroy()
+void ESUTIL_API esRingBufferDestroy( ESRingBuffer *ring )
+{
+    int i;
+    
+    if( ring == NULL || ring->gl == NULL )
+    {
+        return;
+    }
+    
+    if( ring->mapped )
+    {
+        esRingBufferUnmap( ring );
+    }
+    
+    for( i = 0; i < ES_RING_MAX_REGIONS; i++ )
+    {
+        if( ring->fences[i] != 0 )
+        {
+            ring->gl->deleteSync( ring->fences[i] );
+            ring->fences[i] = 0;
+        }
+    }
+    
+    if( ring->buffer != 0 )
+    {
+        ring->gl->deleteBuffers( 1, &ring->buffer );
+        ring->buffer = 0;
+    }
+}
+
+// wait until the GPU released the current region
+static void esRingBufferWaitRegion( ESRingBuffer *ring )
+{
+    GLsync fence = ring->fences[ring->region];
+    GLenum status;
+    
+    if( fence == 0 )
+    {
+        return;
+    }
+    
+    // A zero timeout poll is the common case: the region is already free
+    status = ring->gl->clientWaitSync( fence, 0, 0 );
+    
+    if( status == GL_TIMEOUT_EXPIRED )
+    {
+        ring->numWaits++;
+        
+        do
+        {
+            status = ring->gl->clientWaitSync( fence, GL_SYNC_FLUSH_COMMANDS_BIT, RING_WAIT_TIMEOUT );
+        } while( status == GL_TIMEOUT_EXPIRED );
+    }
+    
+    if( status == GL_WAIT_FAILED )
+    {
+        esLogMessage( " esRingBufferMap fence wait failed on region %d\n ", ring->region );
+    }
+    
+    ring->gl->deleteSync( fence );
+    ring->fences[ring->region] = 0;
+}
+
+// esRingBufferMap()
+void *ESUTIL_API esRingBufferMap( ESRingBuffer *ring, GLsizeiptr size, GLsizeiptr alignment, GLintptr *offset )
+{
+    GLsizeiptr head;
+    void *ptr;
+    
+    ES_PROFILE_ZONE( "esRingBufferMap" );
+    
+    if( ring->mapped || size <= 0 )
+    {
+        return NULL;
+    }
+    
+    if( alignment > 1 )
+    {
+        head = ( ring->head + alignment - 1 ) / alignment * alignment;
+    }
+    else
+    {
+        head = ring->head;
+    }
+    
+    if( head + size > ring->regionSize )
+    {
+        ring->numOverflows++;
+        esLogMessage( " esRingBufferMap region overflow: %ld bytes requested, %ld free\n ",
+                      ( long ) size, ( long ) ( ring->regionSize - head ) );
+        return NULL;
+    }
+    
+    esRingBufferWaitRegion( ring );
+    
+    *offset = ( GLintptr ) ring->region * ring->regionSize + head;
+    
+    ring->gl->bindBuffer( ring->target, ring->buffer );
+    ptr = ring->gl->mapBufferRange( ring->target, *offset, size,
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT );
+    
+    if( ptr == NULL )
+    {
+        return NULL;
+    }
+    
+    ring->head   = head + size;
+    ring->mapped = GL_TRUE;
+    
+    return ptr;
+}
+
+// esRingBufferUnmap()
+GLboolean ESUTIL_API esRingBufferUnmap( ESRingBuffer *ring )
+{
+    ES_PROFILE_ZONE( "esRingBufferUnmap" );
+    
+    if( !ring->mapped )
+    {
+        return GL_FALSE;
+    }
+    
+    ring->mapped = GL_FALSE;
+    ring->gl->bindBuffer( ring->target, ring->buffer );
+    
+    return ring->gl->unmapBuffer( ring->target );
+}
+
+// esRingBufferEndFrame()
+void ESUTIL_API esRingBufferEndFrame( ESRingBuffer *ring )
+{
+    if( ring->mapped )
+    {
+        esRingBufferUnmap( ring );
+    }
+    
+    // Nothing was written, the region can be reused without a fence
+    if( ring->head > 0 )
+    {
+        ring->fences[ring->region] = ring->gl->fenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+        ring->region = ( ring->region + 1 ) % ring->numRegions;
+    }
+    
+    ring->head = 0;
+}
@@ -0,0 +1,80 @@
+//
+//  ESRingBuffer.h
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+
+#ifndef ESRingBuffer_h
+#define ESRingBuffer_h
+
+#include "ESUtil.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// Most frames a ring can keep in flight
+#define ES_RING_MAX_REGIONS     4
+// Triple buffering: CPU writes frame N while the GPU may still read N-1 and N-2
+#define ES_RING_DEFAULT_REGIONS 3
+
+// GL entry points used by the ring, swap them out to run the ring logic without a GPU
+typedef struct
+{
+    void      ( GL_APIENTRY *genBuffers )( GLsizei n, GLuint *buffers );
+    void      ( GL_APIENTRY *deleteBuffers )( GLsizei n, const GLuint *buffers );
+    void      ( GL_APIENTRY *bindBuffer )( GLenum target, GLuint buffer );
+    void      ( GL_APIENTRY *bufferData )( GLenum target, GLsizeiptr size, const void *data, GLenum usage );
+    void *    ( GL_APIENTRY *mapBufferRange )( GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access );
+    GLboolean ( GL_APIENTRY *unmapBuffer )( GLenum target );
+    GLsync    ( GL_APIENTRY *fenceSync )( GLenum condition, GLbitfield flags );
+    GLenum    ( GL_APIENTRY *clientWaitSync )( GLsync sync, GLbitfield flags, GLuint64 timeout );
+    void      ( GL_APIENTRY *deleteSync )( GLsync sync );
+} ESRingBufferGL;
+
+typedef struct
+{
+    const ESRingBufferGL *gl;
+    
+    GLenum     target;
+    GLuint     buffer;
+    // bytes one frame may sub-allocate
+    GLsizeiptr regionSize;
+    int        numRegions;
+    // region written by the current frame
+    int        region;
+    // next free byte inside the current region
+    GLsizeiptr head;
+    // fence signalled once the GPU is done with each region
+    GLsync     fences[ES_RING_MAX_REGIONS];
+    GLboolean  mapped;
+    
+    // frames that had to block on a fence before reusing a region
+    unsigned int numWaits;
+    // allocations that did not fit in the current region
+    unsigned int numOverflows;
+} ESRingBuffer;
+
+// install the GL entry points used by rings created afterwards, NULL restores the real GL
+void ESUTIL_API esRingBufferSetBackend( const ESRingBufferGL *backend );
+// create one buffer holding numRegions frame-sized regions of regionSize bytes
+GLboolean ESUTIL_API esRingBufferInit( ESRingBuffer *ring, GLenum target, GLsizeiptr regionSize, int numRegions );
+// delete the buffer and any pending fences
+void ESUTIL_API esRingBufferDestroy( ESRingBuffer *ring );
+// sub-allocate size bytes from this frame's region and map them unsynchronized.
+// offset receives the byte offset to pass to glVertexAttribPointer/glDrawElements.
+// Returns NULL if the region is full or a previous range is still mapped
+void *ESUTIL_API esRingBufferMap( ESRingBuffer *ring, GLsizeiptr size, GLsizeiptr alignment, GLintptr *offset );
+// unmap the range returned by esRingBufferMap
+GLboolean ESUTIL_API esRingBufferUnmap( ESRingBuffer *ring );
+// call after the frame's draws were issued: fences the region and moves on to the next one.
+// The first esRingBufferMap of the next frame waits on that region's fence only if the GPU still reads it
+void ESUTIL_API esRingBufferEndFrame( ESRingBuffer *ring );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESRingBuffer_h */
@@ -0,0 +1,247 @@
+//
+//  ESScene.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  Hierarchical transforms. Setting a local transform only flags the node;
+//  esSceneUpdate walks the nodes from the first flagged one, pushes the flags
+//  down to the children ( parents always come first ) and rebuilds the world
+//  matrices of the flagged nodes. A scene where nothing moved costs one compare.
+//
+
+#include "ESScene.h"
+#include <stdlib.h>
+#include <string.h>
+
+// esSceneInit()
+GLboolean ESUTIL_API esSceneInit( ESScene *scene, int maxNodes )
+{
+    memset( scene, 0, sizeof( ESScene ) );
+    
+    if( maxNodes < 1 )
+    {
+        return GL_FALSE;
+    }
+    
+    scene->positionX = malloc( sizeof( GLfloat ) * maxNodes );
+    scene->positionY = malloc( sizeof( GLfloat ) * maxNodes );
+    scene->positionZ = malloc( sizeof( GLfloat ) * maxNodes );
+    scene->rotationX = malloc( sizeof( GLfloat ) * maxNodes );
+    scene->rotationY = malloc( sizeof( GLfloat ) * maxNodes );
+    scene->rotationZ = malloc( sizeof( GLfloat ) * maxNodes );
+    scene->rotationW = malloc( sizeof( GLfloat ) * maxNodes );
+    scene->scaleX    = malloc( sizeof( GLfloat ) * maxNodes );
+    scene->scaleY    = malloc( sizeof( GLfloat ) * maxNodes );
+    scene->scaleZ    = malloc( sizeof( GLfloat ) * maxNodes );
+    scene->parent    = malloc( sizeof( int ) * maxNodes );
+    scene->dirty     = malloc( sizeof( unsigned char ) * maxNodes );
+    scene->local     = malloc( sizeof( ESMatrix ) * maxNodes );
+    scene->world     = malloc( sizeof( ESMatrix ) * maxNodes );
+    scene->updated   = malloc( sizeof( int ) * maxNodes );
+    scene->maxNodes  = maxNodes;
+    
+    if( scene->positionX == NULL || scene->positionY == NULL || scene->positionZ == NULL ||
+        scene->rotationX == NULL || scene->rotationY == NULL || scene->rotationZ == NULL ||
+        scene->rotationW == NULL || scene->scaleX == NULL || scene->scaleY == NULL || scene->scaleZ == NULL ||
+        scene->parent == NULL || scene->dirty == NULL || scene->local == NULL || scene->world == NULL ||
+        scene->updated == NULL )
+    {
+        esSceneDestroy( scene );
+        return GL_FALSE;
+    }
+    
+    return GL_TRUE;
+}
+
+// esSceneDestroy()
+void ESUTIL_API esSceneDestroy( ESScene *scene )
+{
+    free( scene->positionX );
+    free( scene->positionY );
+    free( scene->positionZ );
+    free( scene->rotationX );
+    free( scene->rotationY );
+    free( scene->rotationZ );
+    free( scene->rotationW );
+    free( scene->scaleX );
+    free( scene->scaleY );
+    free( scene->scaleZ );
+    free( scene->parent );
+    free( scene->dirty );
+    free( scene->local );
+    free( scene->world );
+    free( scene->updated );
+    
+    memset( scene, 0, sizeof( ESScene ) );
+}
+
+// flag node for the next update
+static void esSceneMarkDirty( ESScene *scene, int node )
+{
+    scene->dirty[node] = 1;
+    
+    if( node < scene->firstDirty )
+    {
+        scene->firstDirty = node;
+    }
+}
+
+// esSceneAddNode()
+int ESUTIL_API esSceneAddNode( ESScene *scene, int parent )
+{
+    int node = scene->numNodes;
+    
+    if( node >= scene->maxNodes || parent >= node )
+    {
+        return -1;
+    }
+    
+    scene->positionX[node] = 0.0f;
+    scene->positionY[node] = 0.0f;
+    scene->positionZ[node] = 0.0f;
+    scene->rotationX[node] = 0.0f;
+    scene->rotationY[node] = 0.0f;
+    scene->rotationZ[node] = 0.0f;
+    scene->rotationW[node] = 1.0f;
+    scene->scaleX[node]    = 1.0f;
+    scene->scaleY[node]    = 1.0f;
+    scene->scaleZ[node]    = 1.0f;
+    scene->parent[node]    = parent < 0 ? -1 : parent;
+    
+    scene->numNodes++;
+    esSceneMarkDirty( scene, node );
+    
+    return node;
+}
+
+// esSceneSetTranslation()
+void ESUTIL_API esSceneSetTranslation( ESScene *scene, int node, GLfloat x, GLfloat y, GLfloat z )
+{
+    scene->positionX[node] = x;
+    scene->positionY[node] = y;
+    scene->positionZ[node] = z;
+    esSceneMarkDirty( scene, node );
+}
+
+// esSceneSetRotation()
+void ESUTIL_API esSceneSetRotation( ESScene *scene, int node, GLfloat angle, GLfloat x, GLfloat y, GLfloat z )
+{
+    ESQuaternion rotation;
+    
+    esQuaternionFromAxisAngle( &rotation, angle, x, y, z );
+    
+    scene->rotationX[node] = rotation.x;
+    scene->rotationY[node] = rotation.y;
+    scene->rotationZ[node] = rotation.z;
+    scene->rotationW[node] = rotation.w;
+    esSceneMarkDirty( scene, node );
+}
+
+// esSceneRotate()
+void ESUTIL_API esSceneRotate( ESScene *scene, int node, const ESQuaternion *delta )
+{
+    ESQuaternion rotation;
+    
+    rotation.x = scene->rotationX[node];
+    rotation.y = scene->rotationY[node];
+    rotation.z = scene->rotationZ[node];
+    rotation.w = scene->rotationW[node];
+    
+    esQuaternionMultiply( &rotation, &rotation, delta );
+    // keeps the rounding from piling up over many frames
+    esQuaternionNormalize( &rotation );
+    
+    scene->rotationX[node] = rotation.x;
+    scene->rotationY[node] = rotation.y;
+    scene->rotationZ[node] = rotation.z;
+    scene->rotationW[node] = rotation.w;
+    esSceneMarkDirty( scene, node );
+}
+
+// esSceneSetScale()
+void ESUTIL_API esSceneSetScale( ESScene *scene, int node, GLfloat x, GLfloat y, GLfloat z )
+{
+    scene->scaleX[node] = x;
+    scene->scaleY[node] = y;
+    scene->scaleZ[node] = z;
+    esSceneMarkDirty( scene, node );
+}
+
+// esSceneUpdate()
+int ESUTIL_API esSceneUpdate( ESScene *scene )
+{
+    ESTRSArrays trs;
+    int i;
+    int k;
+    
+    scene->numUpdated = 0;
+    
+    // Static scene
+    if( scene->firstDirty >= scene->numNodes )
+    {
+        return 0;
+    }
+    
+    // Push the flags down. A parent is final before any of its children is reached,
+    // and nothing below firstDirty can be flagged
+    for( i = scene->firstDirty; i < scene->numNodes; i++ )
+    {
+        int parent = scene->parent[i];
+        
+        if( parent >= 0 )
+        {
+            scene->dirty[i] |= scene->dirty[parent];
+        }
+        
+        if( scene->dirty[i] )
+        {
+            scene->updated[scene->numUpdated++] = i;
+        }
+    }
+    
+    // All local matrices at once, four per step
+    trs.positionX = scene->positionX;
+    trs.positionY = scene->positionY;
+    trs.positionZ = scene->positionZ;
+    trs.rotationX = scene->rotationX;
+    trs.rotationY = scene->rotationY;
+    trs.rotationZ = scene->rotationZ;
+    trs.rotationW = scene->rotationW;
+    trs.scaleX    = scene->scaleX;
+    trs.scaleY    = scene->scaleY;
+    trs.scaleZ    = scene->scaleZ;
+    esMatrixFromTRSBatch( scene->local, &trs, scene->updated, scene->numUpdated );
+    
+    // The list is in index order, so parents are again done before their children
+    for( k = 0; k < scene->numUpdated; k++ )
+    {
+        int node = scene->updated[k];
+        int parent = scene->parent[node];
+        
+        if( parent < 0 )
+        {
+            scene->world[node] = scene->local[k];
+        }
+        else
+        {
+            esMatrixMultiply( &scene->world[node], &scene->local[k], &scene->world[parent] );
+        }
+    }
+    
+    for( k = 0; k < scene->numUpdated; k++ )
+    {
+        scene->dirty[scene->updated[k]] = 0;
+    }
+    
+    scene->firstDirty = scene->numNodes;
+    
+    return scene->numUpdated;
+}
+
+// esSceneWorld()
+const ESMatrix *ESUTIL_API esSceneWorld( const ESScene *scene, int node )
+{
+    return &scene->world[node];
+}
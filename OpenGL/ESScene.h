@@ -0,0 +1,74 @@
+//
+//  ESScene.h
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+
+#ifndef ESScene_h
+#define ESScene_h
+
+#include "ESUtil.h"
+#include "ESQuaternion.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// Transform hierarchy, one array per component. Nodes are only appended and a parent
+// has to exist before its children, so every parent sits at a lower index than its children
+typedef struct
+{
+    // local translation
+    GLfloat       *positionX;
+    GLfloat       *positionY;
+    GLfloat       *positionZ;
+    // local rotation as a unit quaternion
+    GLfloat       *rotationX;
+    GLfloat       *rotationY;
+    GLfloat       *rotationZ;
+    GLfloat       *rotationW;
+    // local scale
+    GLfloat       *scaleX;
+    GLfloat       *scaleY;
+    GLfloat       *scaleZ;
+    // -1 for roots
+    int           *parent;
+    // local transform changed since the last update
+    unsigned char *dirty;
+    // local TRS matrices of the nodes in updated, scratch of esSceneUpdate
+    ESMatrix      *local;
+    // local * parent world, valid after esSceneUpdate
+    ESMatrix      *world;
+    int            numNodes;
+    int            maxNodes;
+    // lowest dirty node, numNodes when nothing changed
+    int            firstDirty;
+    // nodes whose world matrix the last update recomputed, in increasing order
+    int           *updated;
+    int            numUpdated;
+} ESScene;
+
+// room for maxNodes nodes
+GLboolean ESUTIL_API esSceneInit( ESScene *scene, int maxNodes );
+void ESUTIL_API esSceneDestroy( ESScene *scene );
+// add a node with the identity transform under parent ( -1 for a root ). Returns its index, -1 when full
+int ESUTIL_API esSceneAddNode( ESScene *scene, int parent );
+void ESUTIL_API esSceneSetTranslation( ESScene *scene, int node, GLfloat x, GLfloat y, GLfloat z );
+// rotation of angle degrees around ( x, y, z ), the same rotation as esRotate
+void ESUTIL_API esSceneSetRotation( ESScene *scene, int node, GLfloat angle, GLfloat x, GLfloat y, GLfloat z );
+// rotate node further by delta, cheaper than esSceneSetRotation when the angle advances every frame
+void ESUTIL_API esSceneRotate( ESScene *scene, int node, const ESQuaternion *delta );
+void ESUTIL_API esSceneSetScale( ESScene *scene, int node, GLfloat x, GLfloat y, GLfloat z );
+// recompute the world matrices of the dirty nodes and everything below them, walking forward from the first one.
+// Returns the number of nodes updated, 0 without touching anything when nothing changed
+int ESUTIL_API esSceneUpdate( ESScene *scene );
+// world matrix of node as of the last esSceneUpdate
+const ESMatrix *ESUTIL_API esSceneWorld( const ESScene *scene, int node );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESScene_h */
@@ -7,12 +7,15 @@
 //
 
 #include "ESUtil.h"
+#include "ESProfile.h"
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-GLuint ESUTIL_API esLoadShader( GLenum type, const char *shaderSrc )
+// Create the shader object and kick off compilation, without waiting for the result
+static GLuint esSubmitShader( GLenum type, const char *shaderSrc )
 {
     GLuint shader;
-    GLint compiled;
     
     // create the shader object
     shader = glCreateShader( type );
@@ -28,7 +31,14 @@ GLuint ESUTIL_API esLoadShader( GLenum type, const char *shaderSrc )
     // Compile the shader
     glCompileShader( shader );
     
-    // Check the compile status
+    return shader;
+}
+
+// Check the compile status, this is where the driver blocks until compilation is done
+static GLboolean esCheckShader( GLuint shader )
+{
+    GLint compiled;
+    
     glGetShaderiv( shader, GL_COMPILE_STATUS, &compiled );
     
     if( !compiled )
@@ -48,6 +58,56 @@ GLuint ESUTIL_API esLoadShader( GLenum type, const char *shaderSrc )
             free( infoLog );
         }
         
+        return GL_FALSE;
+    }
+    
+    return GL_TRUE;
+}
+
+// Check the link status, blocks until the link is done
+static GLboolean esCheckProgram( GLuint programObject )
+{
+    GLint linked;
+    
+    glGetProgramiv( programObject, GL_LINK_STATUS, &linked );
+    
+    if( !linked )
+    {
+        GLint infoLen = 0;
+        
+        glGetProgramiv( programObject, GL_INFO_LOG_LENGTH, &infoLen );
+        
+        if( infoLen > 1 )
+        {
+            char *infoLog = malloc( sizeof( char ) * infoLen );
+            
+            glGetProgramInfoLog( programObject , infoLen, NULL, infoLog );
+            esLogMessage( " Error linking program:\n%s\n ", infoLog );
+            
+            free( infoLog );
+        }
+        
+        return GL_FALSE;
+    }
+    
+    return GL_TRUE;
+}
+
+GLuint ESUTIL_API esLoadShader( GLenum type, const char *shaderSrc )
+{
+    GLuint shader;
+    
+    ES_PROFILE_ZONE( "esLoadShader" );
+    
+    shader = esSubmitShader( type, shaderSrc );
+    
+    if( shader == 0 )
+    {
+        return 0;
+    }
+    
+    if( !esCheckShader( shader ) )
+    {
         glDeleteShader( shader );
         
         return 0;
@@ -56,12 +116,236 @@ GLuint ESUTIL_API esLoadShader( GLenum type, const char *shaderSrc )
     return shader;
 }
 
+//
+// Program binary cache
+//
+// Binaries are stored as <dir>/<key>.glbin, key being a hash of both shader sources
+// and the driver identity strings, so a driver update simply misses the cache.
+//
+#define PROGRAM_CACHE_MAGIC   0x42505345 // 'ESPB'
+#define PROGRAM_CACHE_VERSION 1
+#define PROGRAM_CACHE_PATH    1024
+
+typedef struct
+{
+    unsigned int       magic;
+    unsigned int       version;
+    unsigned long long key;
+    GLenum             format;
+    GLint              length;
+} ProgramCacheHeader;
+
+static char programCacheDir[PROGRAM_CACHE_PATH];
+static GLboolean programCacheEnabled = GL_FALSE;
+static ESProgramCacheStats programCacheStats;
+
+// FNV-1a, the terminating zero is hashed too so ( "ab", "c" ) and ( "a", "bc" ) differ
+static unsigned long long esHashString( unsigned long long hash, const char *str )
+{
+    if( str == NULL )
+    {
+        str = "";
+    }
+    
+    do
+    {
+        hash ^= ( unsigned char ) *str;
+        hash *= 0x100000001b3ULL;
+    } while( *str++ != '\0' );
+    
+    return hash;
+}
+
+static unsigned long long esProgramCacheKey( const char *vertShaderSrc, const char *fragShaderSrc )
+{
+    unsigned long long hash = 0xcbf29ce484222325ULL;
+    
+    hash = esHashString( hash, vertShaderSrc );
+    hash = esHashString( hash, fragShaderSrc );
+    hash = esHashString( hash, ( const char * ) glGetString( GL_VENDOR ) );
+    hash = esHashString( hash, ( const char * ) glGetString( GL_RENDERER ) );
+    hash = esHashString( hash, ( const char * ) glGetString( GL_VERSION ) );
+    hash = esHashString( hash, ( const char * ) glGetString( GL_SHADING_LANGUAGE_VERSION ) );
+    
+    return hash;
+}
+
+// GL_FALSE if the path does not fit, the program is then neither loaded nor stored
+static GLboolean esProgramCachePath( char *path, unsigned long long key )
+{
+    int length = snprintf( path, PROGRAM_CACHE_PATH, "%s/%016llx.glbin", programCacheDir, key );
+    
+    return length >= 0 && length < PROGRAM_CACHE_PATH;
+}
+
+// Restore a program from the cache, 0 on miss or if the driver rejects the binary
+static GLuint esProgramCacheLoad( unsigned long long key )
+{
+    char path[PROGRAM_CACHE_PATH];
+    ProgramCacheHeader header;
+    GLuint programObject = 0;
+    GLint  linked = 0;
+    void  *binary;
+    FILE  *fp;
+    unsigned long long start = esGetTimeNs();
+    
+    if( !esProgramCachePath( path, key ) )
+    {
+        return 0;
+    }
+    
+    fp = fopen( path, "rb" );
+    
+    if( fp == NULL )
+    {
+        return 0;
+    }
+    
+    if( fread( &header, sizeof( header ), 1, fp ) != 1 ||
+        header.magic != PROGRAM_CACHE_MAGIC || header.version != PROGRAM_CACHE_VERSION ||
+        header.key != key || header.length <= 0 )
+    {
+        fclose( fp );
+        return 0;
+    }
+    
+    binary = malloc( header.length );
+    
+    if( binary != NULL && fread( binary, header.length, 1, fp ) == 1 )
+    {
+        programObject = glCreateProgram();
+        glProgramBinary( programObject, header.format, binary, header.length );
+        glGetProgramiv( programObject, GL_LINK_STATUS, &linked );
+        
+        if( !linked )
+        {
+            // Stale or foreign binary, drop it so the next launch rebuilds it
+            glDeleteProgram( programObject );
+            programObject = 0;
+            programCacheStats.rejected++;
+            remove( path );
+        }
+    }
+    
+    free( binary );
+    fclose( fp );
+    
+    if( programObject != 0 )
+    {
+        programCacheStats.hits++;
+        programCacheStats.loadMs += ( esGetTimeNs() - start ) / 1000000.0;
+    }
+    
+    return programObject;
+}
+
+static void esProgramCacheStore( unsigned long long key, GLuint programObject )
+{
+    char path[PROGRAM_CACHE_PATH];
+    ProgramCacheHeader header;
+    void *binary;
+    FILE *fp;
+    
+    header.magic   = PROGRAM_CACHE_MAGIC;
+    header.version = PROGRAM_CACHE_VERSION;
+    header.key     = key;
+    header.length  = 0;
+    
+    glGetProgramiv( programObject, GL_PROGRAM_BINARY_LENGTH, &header.length );
+    
+    if( header.length <= 0 )
+    {
+        return;
+    }
+    
+    binary = malloc( header.length );
+    
+    if( binary == NULL )
+    {
+        return;
+    }
+    
+    glGetProgramBinary( programObject, header.length, &header.length, &header.format, binary );
+    
+    fp = esProgramCachePath( path, key ) ? fopen( path, "wb" ) : NULL;
+    
+    if( fp != NULL )
+    {
+        if( fwrite( &header, sizeof( header ), 1, fp ) == 1 &&
+            fwrite( binary, header.length, 1, fp ) == 1 )
+        {
+            programCacheStats.stores++;
+        }
+        
+        fclose( fp );
+    }
+    
+    free( binary );
+}
+
+GLboolean ESUTIL_API esProgramCacheEnable( const char *dir )
+{
+    GLint numFormats = 0;
+    
+    if( dir == NULL )
+    {
+        programCacheEnabled = GL_FALSE;
+        return GL_TRUE;
+    }
+    
+    // Some drivers expose no binary format at all, there is nothing to cache then
+    glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats );
+    
+    if( numFormats <= 0 || strlen( dir ) + 32 >= PROGRAM_CACHE_PATH )
+    {
+        esLogMessage( " esProgramCacheEnable: program binaries not available\n " );
+        programCacheEnabled = GL_FALSE;
+        return GL_FALSE;
+    }
+    
+    strcpy( programCacheDir, dir );
+    programCacheEnabled = GL_TRUE;
+    
+    return GL_TRUE;
+}
+
+void ESUTIL_API esProgramCacheGetStats( ESProgramCacheStats *stats )
+{
+    *stats = programCacheStats;
+}
+
+void ESUTIL_API esProgramCacheLogStats( void )
+{
+    esLogMessage( " Program cache: %u hits, %u misses, %u rejected, %u stored, compile %.2f ms, load %.2f ms\n ",
+                  programCacheStats.hits, programCacheStats.misses, programCacheStats.rejected,
+                  programCacheStats.stores, programCacheStats.compileMs, programCacheStats.loadMs );
+}
+
 GLuint ESUTIL_API esLoadProgram( const char *vertShaderSrc, const char *fragShaderSrc )
 {
     GLuint vertexShader;
     GLuint fragmentShader;
     GLuint programObject;
-    GLint  linked;
+    GLboolean linked;
+    unsigned long long cacheKey = 0;
+    unsigned long long start;
+    
+    ES_PROFILE_ZONE( "esLoadProgram" );
+    
+    if( programCacheEnabled )
+    {
+        cacheKey = esProgramCacheKey( vertShaderSrc, fragShaderSrc );
+        programObject = esProgramCacheLoad( cacheKey );
+        
+        if( programObject != 0 )
+        {
+            return programObject;
+        }
+        
+        programCacheStats.misses++;
+    }
+    
+    start = esGetTimeNs();
     
     // Load the vertex/fragment shaders
     vertexShader = esLoadShader( GL_VERTEX_SHADER, vertShaderSrc );
@@ -73,7 +357,7 @@ GLuint ESUTIL_API esLoadProgram( const char *vertShaderSrc, const char *fragShad
     
     fragmentShader = esLoadShader( GL_FRAGMENT_SHADER, fragShaderSrc );
     
-    if( fragShaderSrc == 0 )
+    if( fragmentShader == 0 )
     {
         glDeleteShader( vertexShader );
         return 0;
@@ -89,35 +373,218 @@ GLuint ESUTIL_API esLoadProgram( const char *vertShaderSrc, const char *fragShad
     glAttachShader( programObject, vertexShader );
     glAttachShader( programObject, fragmentShader );
     
+    // Ask the driver to keep the binary around for glGetProgramBinary
+    if( programCacheEnabled )
+    {
+        glProgramParameteri( programObject, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+    }
+    
     // Link the program
     glLinkProgram( programObject );
     
     // Check the link status
-    glGetProgramiv( programObject, GL_LINK_STATUS, &linked );
+    linked = esCheckProgram( programObject );
+    
+    programCacheStats.compileMs += ( esGetTimeNs() - start ) / 1000000.0;
     
     if( !linked )
     {
-        GLint infoLen = 0;
+        glDeleteProgram( programObject );
+        return 0;
+    }
+    
+    if( programCacheEnabled )
+    {
+        esProgramCacheStore( cacheKey, programObject );
+    }
+    
+    // Free up no longer needed shader resources
+    glDeleteShader( vertexShader );
+    glDeleteShader( fragmentShader );
+    
+    return programObject;
+}
+
+//
+// Asynchronous compilation
+//
+// esLoadProgramsAsync submits every compile, then every link, and never asks for a
+// status, so the driver can work on all programs at once ( on its own threads when
+// GL_KHR_parallel_shader_compile is exposed ). Status is only read when the app polls.
+//
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef void ( GL_APIENTRY *MaxShaderCompilerThreadsFunc )( GLuint count );
+
+// -1 until the extension string was checked
+static int parallelCompileSupported = -1;
+
+static GLboolean esParallelCompileSupported( void )
+{
+    if( parallelCompileSupported < 0 )
+    {
+        const char *extensions = ( const char * ) glGetString( GL_EXTENSIONS );
         
-        glGetProgramiv( programObject, GL_INFO_LOG_LENGTH, &infoLen );
+        parallelCompileSupported = extensions != NULL &&
+                                   ( strstr( extensions, "GL_KHR_parallel_shader_compile" ) != NULL ||
+                                     strstr( extensions, "GL_ARB_parallel_shader_compile" ) != NULL );
+
+#ifndef __APPLE__
+        if( parallelCompileSupported )
+        {
+            MaxShaderCompilerThreadsFunc maxThreads = ( MaxShaderCompilerThreadsFunc )
+                eglGetProcAddress( "glMaxShaderCompilerThreadsKHR" );
+            
+            // Let the driver pick as many compiler threads as it wants
+            if( maxThreads != NULL )
+            {
+                maxThreads( 0xFFFFFFFFu );
+            }
+        }
+#endif
+    }
+    
+    return parallelCompileSupported ? GL_TRUE : GL_FALSE;
+}
+
+// Release the shaders and settle the future, storing the binary when the cache is on
+static void esProgramResolve( ESProgramFuture *future )
+{
+    unsigned long long start = esGetTimeNs();
+    GLboolean ok;
+    
+    ok = esCheckShader( future->vertexShader ) &&
+         esCheckShader( future->fragmentShader ) &&
+         esCheckProgram( future->programObject );
+    
+    glDeleteShader( future->vertexShader );
+    glDeleteShader( future->fragmentShader );
+    future->vertexShader   = 0;
+    future->fragmentShader = 0;
+    
+    if( ok )
+    {
+        if( programCacheEnabled )
+        {
+            esProgramCacheStore( future->cacheKey, future->programObject );
+        }
         
-        if( infoLen > 1 )
+        future->status = ES_PROGRAM_READY;
+    }
+    else
+    {
+        glDeleteProgram( future->programObject );
+        future->programObject = 0;
+        future->status = ES_PROGRAM_FAILED;
+    }
+    
+    programCacheStats.compileMs += ( esGetTimeNs() - start ) / 1000000.0;
+}
+
+void ESUTIL_API esLoadProgramsAsync( ESProgramFuture *futures, const char **vertShaderSrcs,
+                                     const char **fragShaderSrcs, int count )
+{
+    unsigned long long start;
+    int i;
+    
+    esParallelCompileSupported();
+    
+    for( i = 0; i < count; i++ )
+    {
+        memset( &futures[i], 0, sizeof( ESProgramFuture ) );
+        futures[i].status = ES_PROGRAM_PENDING;
+        
+        if( programCacheEnabled )
         {
-            char *infoLog = malloc( sizeof( char ) * infoLen );
+            futures[i].cacheKey = esProgramCacheKey( vertShaderSrcs[i], fragShaderSrcs[i] );
+            futures[i].programObject = esProgramCacheLoad( futures[i].cacheKey );
             
-            glGetProgramInfoLog( programObject , infoLen, NULL, infoLog );
-            esLogMessage( " Error linking program:\n%s\n ", infoLog );
+            if( futures[i].programObject != 0 )
+            {
+                futures[i].status = ES_PROGRAM_READY;
+                continue;
+            }
             
-            free( infoLog );
+            programCacheStats.misses++;
+        }
+    }
+    
+    start = esGetTimeNs();
+    
+    // Every compile first ...
+    for( i = 0; i < count; i++ )
+    {
+        if( futures[i].status != ES_PROGRAM_PENDING )
+        {
+            continue;
         }
         
-        glDeleteProgram( programObject );
-        return 0;
+        futures[i].vertexShader   = esSubmitShader( GL_VERTEX_SHADER, vertShaderSrcs[i] );
+        futures[i].fragmentShader = esSubmitShader( GL_FRAGMENT_SHADER, fragShaderSrcs[i] );
+        futures[i].programObject  = glCreateProgram();
+        
+        if( futures[i].vertexShader == 0 || futures[i].fragmentShader == 0 || futures[i].programObject == 0 )
+        {
+            glDeleteShader( futures[i].vertexShader );
+            glDeleteShader( futures[i].fragmentShader );
+            glDeleteProgram( futures[i].programObject );
+            futures[i].programObject = 0;
+            futures[i].status = ES_PROGRAM_FAILED;
+        }
     }
     
-    // Free up no longer needed shader resources
-    glDeleteShader( vertexShader );
-    glDeleteShader( fragmentShader );
+    // ... then every link, a link doesn't need the compile status to be queried
+    for( i = 0; i < count; i++ )
+    {
+        if( futures[i].status != ES_PROGRAM_PENDING )
+        {
+            continue;
+        }
+        
+        glAttachShader( futures[i].programObject, futures[i].vertexShader );
+        glAttachShader( futures[i].programObject, futures[i].fragmentShader );
+        
+        if( programCacheEnabled )
+        {
+            glProgramParameteri( futures[i].programObject, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+        }
+        
+        glLinkProgram( futures[i].programObject );
+    }
     
-    return programObject;
+    programCacheStats.compileMs += ( esGetTimeNs() - start ) / 1000000.0;
+}
+
+GLint ESUTIL_API esProgramPoll( ESProgramFuture *future )
+{
+    if( future->status == ES_PROGRAM_PENDING )
+    {
+        GLint done = GL_TRUE;
+        
+        // Without the extension there is no way to ask without blocking,
+        // so the first poll settles the program
+        if( esParallelCompileSupported() )
+        {
+            glGetProgramiv( future->programObject, GL_COMPLETION_STATUS_KHR, &done );
+        }
+        
+        if( done )
+        {
+            esProgramResolve( future );
+        }
+    }
+    
+    return future->status;
+}
+
+GLuint ESUTIL_API esProgramWait( ESProgramFuture *future )
+{
+    if( future->status == ES_PROGRAM_PENDING )
+    {
+        esProgramResolve( future );
+    }
+    
+    return future->programObject;
 }
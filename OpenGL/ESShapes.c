@@ -3,10 +3,39 @@
 //
 
 #include "ESUtil.h"
+#include "ESJob.h"
+#include "ESProfile.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
+// Vertices generated per job by the esGen*Into functions
+#define SHAPE_GRAIN_VERTICES 16384
+// Fewest slices that give a sphere two parallels, and fewest vertices along a grid side.
+// Smaller shapes generate nothing
+#define SHAPE_MIN_SLICES    4
+#define SHAPE_MIN_GRID_SIZE 2
+
+// i-th element of a strided stream with numComponents floats when tightly packed
+#define SHAPE_STREAM_AT( stream, stride, numComponents, i ) \
+    ( ( GLfloat * ) ( ( char * ) ( stream ) + ( size_t ) ( i ) * ( ( stride ) != 0 ? ( size_t ) ( stride ) : sizeof( GLfloat ) * ( numComponents ) ) ) )
+
+// What one job of esGenSphereInto/esGenSquareGridInto generates
+typedef struct
+{
+    // 0 for the square grid, the number of slices for a sphere
+    int                   numSlices;
+    int                   size;
+    float                 radius;
+    const ESShapeStreams *dest;
+    GLuint               *indices;
+    GLuint                baseVertex;
+    int                   numVertexRows;
+    int                   numQuadRows;
+    int                   verticesPerRow;
+    int                   indicesPerRow;
+} ESShapeJob;
+
 //
 /// \brief Generates geometry for a cube. Allocates memory for the vertex data and stores
 ///        the results in the arrays. Generate index list for a TRIANGLES
@@ -126,6 +155,8 @@ int ESUTIL_API esGenCube( float scale, GLfloat **vertices, GLfloat **normals,
         1.0f, 0.0f,
     };
     
+    ES_PROFILE_ZONE( "esGenCube" );
+    
     // allocate mem for buffers
     if( vertices != NULL )
     {
@@ -147,7 +178,7 @@ int ESUTIL_API esGenCube( float scale, GLfloat **vertices, GLfloat **normals,
     if( texCoords != NULL )
     {
         *texCoords = malloc( sizeof( GLfloat ) * 2 * numVertices );
-        memcpy( *texCoords, cubeTex, sizeof(texCoords));
+        memcpy( *texCoords, cubeTex, sizeof(cubeTex));
     }
     
     // Generate the indices
@@ -181,3 +212,464 @@ int ESUTIL_API esGenCube( float scale, GLfloat **vertices, GLfloat **normals,
     
     return numIndices;
 }
+
+//
+/// \brief Vertex and index counts of esGenSphere
+/// \param numSlices The number of slices in the sphere, at least 4
+/// \param numVertices If not NULL, receives the number of vertices
+/// \param numIndices If not NULL, receives the number of indices
+void ESUTIL_API esGenSphereSize( int numSlices, int *numVertices, int *numIndices )
+{
+    int numParallels = numSlices / 2;
+    int vertexCount  = ( numParallels + 1 ) * ( numSlices + 1 );
+    int indexCount   = numParallels * numSlices * 6;
+    
+    // Too few slices make no sphere
+    if( numSlices < SHAPE_MIN_SLICES )
+    {
+        vertexCount = 0;
+        indexCount  = 0;
+    }
+    
+    if( numVertices != NULL )
+    {
+        *numVertices = vertexCount;
+    }
+    
+    if( numIndices != NULL )
+    {
+        *numIndices = indexCount;
+    }
+}
+
+//
+/// \brief Writes the vertices of a range of sphere rows, without allocating anything
+/// \param numSlices The number of slices in the sphere
+/// \param radius The radius of the sphere
+/// \param firstRow First row to generate, rows run from the north pole ( 0 ) to the south pole ( numSlices / 2 )
+/// \param numRows The number of rows to generate
+/// \param dest Receives the first vertex of firstRow, NULL streams are skipped
+void ESUTIL_API esGenSphereVertices( int numSlices, float radius, int firstRow, int numRows, const ESShapeStreams *dest )
+{
+    int numParallels = numSlices / 2;
+    float angleStep = ( 2.0f * ( float ) M_PI ) / ( ( float ) numSlices );
+    int vertex = 0;
+    int i;
+    int j;
+    
+    ES_PROFILE_ZONE( "esGenSphereVertices" );
+    
+    if( numSlices < SHAPE_MIN_SLICES )
+    {
+        return;
+    }
+    
+    for( i = firstRow; i < firstRow + numRows; i++ )
+    {
+        float sinI = sinf( angleStep * ( float ) i );
+        float cosI = cosf( angleStep * ( float ) i );
+        
+        for( j = 0; j <= numSlices; j++, vertex++ )
+        {
+            float x = sinI * sinf( angleStep * ( float ) j );
+            float z = sinI * cosf( angleStep * ( float ) j );
+            
+            if( dest->positions != NULL )
+            {
+                GLfloat *position = SHAPE_STREAM_AT( dest->positions, dest->positionStride, 3, vertex );
+                
+                position[0] = radius * x;
+                position[1] = radius * cosI;
+                position[2] = radius * z;
+            }
+            
+            if( dest->normals != NULL )
+            {
+                GLfloat *normal = SHAPE_STREAM_AT( dest->normals, dest->normalStride, 3, vertex );
+                
+                normal[0] = x;
+                normal[1] = cosI;
+                normal[2] = z;
+            }
+            
+            if( dest->texCoords != NULL )
+            {
+                GLfloat *texCoord = SHAPE_STREAM_AT( dest->texCoords, dest->texCoordStride, 2, vertex );
+                
+                texCoord[0] = ( float ) j / ( float ) numSlices;
+                texCoord[1] = ( float ) i / ( float ) numParallels;
+            }
+        }
+    }
+}
+
+//
+/// \brief Writes the TRIANGLES indices of a range of sphere quad rows
+/// \param numSlices The number of slices in the sphere
+/// \param firstRow First quad row, between vertex rows firstRow and firstRow + 1
+/// \param numRows The number of quad rows, there are numSlices / 2 in total
+/// \param indices Receives the first index of firstRow
+/// \param baseVertex Added to every index, e.g. to append to a shared vertex buffer
+void ESUTIL_API esGenSphereIndices( int numSlices, int firstRow, int numRows, GLuint *indices, GLuint baseVertex )
+{
+    GLuint rowLength = numSlices + 1;
+    int i;
+    int j;
+    
+    ES_PROFILE_ZONE( "esGenSphereIndices" );
+    
+    if( numSlices < SHAPE_MIN_SLICES )
+    {
+        return;
+    }
+    
+    for( i = firstRow; i < firstRow + numRows; i++ )
+    {
+        GLuint row     = baseVertex + i * rowLength;
+        GLuint nextRow = row + rowLength;
+        
+        for( j = 0; j < numSlices; j++ )
+        {
+            *indices++ = row + j;
+            *indices++ = nextRow + j;
+            *indices++ = nextRow + j + 1;
+            
+            *indices++ = row + j;
+            *indices++ = nextRow + j + 1;
+            *indices++ = row + j + 1;
+        }
+    }
+}
+
+//
+/// \brief Vertex and index counts of esGenSquareGrid, a grid on the unit square at z = 0
+/// \param size The number of vertices along each side, at least 2
+/// \param numVertices If not NULL, receives the number of vertices
+/// \param numIndices If not NULL, receives the number of indices
+void ESUTIL_API esGenSquareGridSize( int size, int *numVertices, int *numIndices )
+{
+    int vertexCount = size * size;
+    int indexCount  = ( size - 1 ) * ( size - 1 ) * 2 * 3;
+    
+    // A smaller grid has no squares
+    if( size < SHAPE_MIN_GRID_SIZE )
+    {
+        vertexCount = 0;
+        indexCount  = 0;
+    }
+    
+    if( numVertices != NULL )
+    {
+        *numVertices = vertexCount;
+    }
+    
+    if( numIndices != NULL )
+    {
+        *numIndices = indexCount;
+    }
+}
+
+//
+/// \brief Writes the vertices of a range of grid rows, without allocating anything
+/// \param size The number of vertices along each side
+/// \param firstRow First row to generate, row i holds the vertices with x = i / ( size - 1 )
+/// \param numRows The number of rows to generate
+/// \param dest Receives the first vertex of firstRow, NULL streams are skipped
+void ESUTIL_API esGenSquareGridVertices( int size, int firstRow, int numRows, const ESShapeStreams *dest )
+{
+    float stepSize = 1.0f / ( float ) ( size - 1 );
+    int vertex = 0;
+    int i;
+    int j;
+    
+    ES_PROFILE_ZONE( "esGenSquareGridVertices" );
+    
+    if( size < SHAPE_MIN_GRID_SIZE )
+    {
+        return;
+    }
+    
+    for( i = firstRow; i < firstRow + numRows; i++ )
+    {
+        for( j = 0; j < size; j++, vertex++ )
+        {
+            float x = ( float ) i * stepSize;
+            float y = ( float ) j * stepSize;
+            
+            if( dest->positions != NULL )
+            {
+                GLfloat *position = SHAPE_STREAM_AT( dest->positions, dest->positionStride, 3, vertex );
+                
+                position[0] = x;
+                position[1] = y;
+                position[2] = 0.0f;
+            }
+            
+            if( dest->normals != NULL )
+            {
+                GLfloat *normal = SHAPE_STREAM_AT( dest->normals, dest->normalStride, 3, vertex );
+                
+                normal[0] = 0.0f;
+                normal[1] = 0.0f;
+                normal[2] = 1.0f;
+            }
+            
+            if( dest->texCoords != NULL )
+            {
+                GLfloat *texCoord = SHAPE_STREAM_AT( dest->texCoords, dest->texCoordStride, 2, vertex );
+                
+                texCoord[0] = x;
+                texCoord[1] = y;
+            }
+        }
+    }
+}
+
+//
+/// \brief Writes the TRIANGLES indices of a range of grid quad rows
+/// \param size The number of vertices along each side
+/// \param firstRow First quad row, between vertex rows firstRow and firstRow + 1
+/// \param numRows The number of quad rows, there are size - 1 in total
+/// \param indices Receives the first index of firstRow
+/// \param baseVertex Added to every index, e.g. to append to a shared vertex buffer
+void ESUTIL_API esGenSquareGridIndices( int size, int firstRow, int numRows, GLuint *indices, GLuint baseVertex )
+{
+    int i;
+    int j;
+    
+    ES_PROFILE_ZONE( "esGenSquareGridIndices" );
+    
+    if( size < SHAPE_MIN_GRID_SIZE )
+    {
+        return;
+    }
+    
+    for( i = firstRow; i < firstRow + numRows; i++ )
+    {
+        GLuint row     = baseVertex + i * size;
+        GLuint nextRow = row + size;
+        
+        for( j = 0; j < size - 1; j++ )
+        {
+            // two triangles per square
+            *indices++ = row + j;
+            *indices++ = nextRow + j;
+            *indices++ = nextRow + j + 1;
+            
+            *indices++ = row + j;
+            *indices++ = nextRow + j + 1;
+            *indices++ = row + j + 1;
+        }
+    }
+}
+
+// generate vertex rows [ begin, end ) and the quad rows starting in them
+static void ESCALLBACK esGenShapeRows( void *arg, int begin, int end )
+{
+    const ESShapeJob *job = ( const ESShapeJob * ) arg;
+    int numQuadRows;
+    
+    if( job->dest != NULL )
+    {
+        const ESShapeStreams *dest = job->dest;
+        int first = begin * job->verticesPerRow;
+        ESShapeStreams rows;
+        
+        // Point the streams at the first vertex of the range
+        rows = *dest;
+        rows.positions = dest->positions != NULL ? SHAPE_STREAM_AT( dest->positions, dest->positionStride, 3, first ) : NULL;
+        rows.normals   = dest->normals   != NULL ? SHAPE_STREAM_AT( dest->normals, dest->normalStride, 3, first ) : NULL;
+        rows.texCoords = dest->texCoords != NULL ? SHAPE_STREAM_AT( dest->texCoords, dest->texCoordStride, 2, first ) : NULL;
+        
+        if( job->numSlices > 0 )
+        {
+            esGenSphereVertices( job->numSlices, job->radius, begin, end - begin, &rows );
+        }
+        else
+        {
+            esGenSquareGridVertices( job->size, begin, end - begin, &rows );
+        }
+    }
+    
+    // There is one quad row less than vertex rows
+    numQuadRows = ( end < job->numQuadRows ? end : job->numQuadRows ) - begin;
+    
+    if( job->indices != NULL && numQuadRows > 0 )
+    {
+        GLuint *indices = job->indices + ( size_t ) begin * job->indicesPerRow;
+        
+        if( job->numSlices > 0 )
+        {
+            esGenSphereIndices( job->numSlices, begin, numQuadRows, indices, job->baseVertex );
+        }
+        else
+        {
+            esGenSquareGridIndices( job->size, begin, numQuadRows, indices, job->baseVertex );
+        }
+    }
+}
+
+// split the rows of a shape over the job workers
+static void esGenShapeParallel( ESShapeJob *job )
+{
+    int grain = SHAPE_GRAIN_VERTICES / job->verticesPerRow;
+    
+    esJobParallelFor( job->numVertexRows, grain > 0 ? grain : 1, esGenShapeRows, job );
+}
+
+//
+/// \brief Generates a sphere straight into caller-provided memory, e.g. mapped buffer objects.
+///        Rows are generated in parallel on the job workers when there are any
+/// \param numSlices The number of slices in the sphere
+/// \param radius The radius of the sphere
+/// \param dest If not NULL, receives esGenSphereSize() vertices
+/// \param indices If not NULL, receives esGenSphereSize() indices for TRIANGLES
+/// \param baseVertex Added to every index
+/// \return The number of indices
+int ESUTIL_API esGenSphereInto( int numSlices, float radius, const ESShapeStreams *dest, GLuint *indices, GLuint baseVertex )
+{
+    ESShapeJob job;
+    int numIndices;
+    
+    ES_PROFILE_ZONE( "esGenSphereInto" );
+    
+    esGenSphereSize( numSlices, NULL, &numIndices );
+    
+    if( numIndices == 0 )
+    {
+        return 0;
+    }
+    
+    memset( &job, 0, sizeof( ESShapeJob ) );
+    job.numSlices      = numSlices;
+    job.radius         = radius;
+    job.dest           = dest;
+    job.indices        = indices;
+    job.baseVertex     = baseVertex;
+    job.numVertexRows  = numSlices / 2 + 1;
+    job.numQuadRows    = numSlices / 2;
+    job.verticesPerRow = numSlices + 1;
+    job.indicesPerRow  = numSlices * 6;
+    
+    esGenShapeParallel( &job );
+    
+    return numIndices;
+}
+
+//
+/// \brief Generates a square grid straight into caller-provided memory, e.g. mapped buffer objects.
+///        Rows are generated in parallel on the job workers when there are any
+/// \param size The number of vertices along each side
+/// \param dest If not NULL, receives esGenSquareGridSize() vertices
+/// \param indices If not NULL, receives esGenSquareGridSize() indices for TRIANGLES
+/// \param baseVertex Added to every index
+/// \return The number of indices
+int ESUTIL_API esGenSquareGridInto( int size, const ESShapeStreams *dest, GLuint *indices, GLuint baseVertex )
+{
+    ESShapeJob job;
+    int numIndices;
+    
+    ES_PROFILE_ZONE( "esGenSquareGridInto" );
+    
+    esGenSquareGridSize( size, NULL, &numIndices );
+    
+    if( numIndices == 0 )
+    {
+        return 0;
+    }
+    
+    memset( &job, 0, sizeof( ESShapeJob ) );
+    job.size           = size;
+    job.dest           = dest;
+    job.indices        = indices;
+    job.baseVertex     = baseVertex;
+    job.numVertexRows  = size;
+    job.numQuadRows    = size - 1;
+    job.verticesPerRow = size;
+    job.indicesPerRow  = ( size - 1 ) * 6;
+    
+    esGenShapeParallel( &job );
+    
+    return numIndices;
+}
+
+//
+/// \brief Generates geometry for a sphere. Allocates memory for the vertex data and stores
+///        the results in the arrays. Generate index list for TRIANGLES
+/// \param numSlices The number of slices in the sphere
+/// \param radius The radius of the sphere
+/// \param vertices If not NULL, will contain array of float3 positions
+/// \param normals If not NULL, will contain array of float3 normals
+/// \param texCoords If not NULL, will contain array of float2 texCoords
+/// \param indices If not NULL, will contain the array of indices for the triangles
+/// \return The number of indices required for rendering the buffers ( the number of indices stored in the indices array
+///         if it is not NULL ) as GL_TRIANGLES
+int ESUTIL_API esGenSphere( int numSlices, float radius, GLfloat **vertices, GLfloat **normals,
+                            GLfloat **texCoords, GLuint **indices )
+{
+    ESShapeStreams dest;
+    int numVertices;
+    int numIndices;
+    
+    ES_PROFILE_ZONE( "esGenSphere" );
+    
+    esGenSphereSize( numSlices, &numVertices, &numIndices );
+    
+    memset( &dest, 0, sizeof( ESShapeStreams ) );
+    
+    // allocate mem for buffers
+    if( vertices != NULL )
+    {
+        *vertices = dest.positions = malloc( sizeof( GLfloat ) * 3 * numVertices );
+    }
+    
+    if( normals != NULL )
+    {
+        *normals = dest.normals = malloc( sizeof( GLfloat ) * 3 * numVertices );
+    }
+    
+    if( texCoords != NULL )
+    {
+        *texCoords = dest.texCoords = malloc( sizeof( GLfloat ) * 2 * numVertices );
+    }
+    
+    if( indices != NULL )
+    {
+        *indices = malloc( sizeof( GLuint ) * numIndices );
+    }
+    
+    return esGenSphereInto( numSlices, radius, &dest, indices != NULL ? *indices : NULL, 0 );
+}
+
+//
+/// \brief Generates a square grid consisting of triangles. Allocates memory for the vertex data and stores
+///         the results in the arrays. Generate index list as TRIANGLES
+/// \param size Create a grid of size by size ( number of triangles = ( size - 1 ) * ( size - 1 ) * 2 )
+/// \param vertices If not NULL, will contain array of float3 positions
+/// \param indices If not NULL, will contain the array of indices for the triangles
+/// \return The number of indices required for rendering the buffers ( the number of indices stored in the indices array
+///         if it is not NULL ) as GL_TRIANGLES
+int ESUTIL_API esGenSquareGrid( int size, GLfloat **vertices, GLuint **indices )
+{
+    ESShapeStreams dest;
+    int numVertices;
+    int numIndices;
+    
+    ES_PROFILE_ZONE( "esGenSquareGrid" );
+    
+    esGenSquareGridSize( size, &numVertices, &numIndices );
+    
+    memset( &dest, 0, sizeof( ESShapeStreams ) );
+    
+    if( vertices != NULL )
+    {
+        *vertices = dest.positions = malloc( sizeof( GLfloat ) * 3 * numVertices );
+    }
+    
+    if( indices != NULL )
+    {
+        *indices = malloc( sizeof( GLuint ) * numIndices );
+    }
+    
+    return esGenSquareGridInto( size, &dest, indices != NULL ? *indices : NULL, 0 );
+}
@@ -0,0 +1,357 @@
+//
+//  ESStateCache.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  Shadow copy of the GL state the library touches. A call only reaches the
+//  driver when it changes something; everything starts out unknown so the
+//  first call of each kind is always issued.
+//
+
+#include "ESStateCache.h"
+#include <string.h>
+
+static const ESStateCacheGL stateCacheGL =
+{
+    glBindBuffer,
+    glBindVertexArray,
+    glUseProgram,
+    glEnableVertexAttribArray,
+    glDisableVertexAttribArray,
+    glVertexAttribDivisor,
+    glViewport,
+    glActiveTexture,
+    glBindTexture,
+    glDeleteBuffers,
+    glDeleteVertexArrays,
+};
+
+static const ESStateCacheGL *stateCacheBackend = &stateCacheGL;
+
+static const char *stateCallNames[ES_STATE_NUM_CALLS] =
+{
+    "glBindBuffer",
+    "glBindVertexArray",
+    "glUseProgram",
+    "glEnableVertexAttribArray",
+    "glDisableVertexAttribArray",
+    "glVertexAttribDivisor",
+    "glViewport",
+    "glActiveTexture",
+    "glBindTexture",
+};
+
+// esStateCacheSetBackend()
+void ESUTIL_API esStateCacheSetBackend( const ESStateCacheGL *backend )
+{
+    stateCacheBackend = backend != NULL ? backend : &stateCacheGL;
+}
+
+// forget the state that belongs to the bound vertex array object
+static void esStateInvalidateVertexArrayState( ESStateCache *cache )
+{
+    cache->elementArrayBuffer = ES_STATE_UNKNOWN;
+    cache->attribKnown        = 0;
+    cache->attribEnabled      = 0;
+    cache->divisorKnown       = 0;
+}
+
+// esStateCacheInit()
+void ESUTIL_API esStateCacheInit( ESStateCache *cache )
+{
+    memset( cache, 0, sizeof( ESStateCache ) );
+    cache->gl = stateCacheBackend;
+    esStateCacheInvalidate( cache );
+}
+
+// esStateCacheInvalidate()
+void ESUTIL_API esStateCacheInvalidate( ESStateCache *cache )
+{
+    int i;
+    
+    cache->program       = ES_STATE_UNKNOWN;
+    cache->vertexArray   = ES_STATE_UNKNOWN;
+    cache->arrayBuffer   = ES_STATE_UNKNOWN;
+    cache->viewportKnown = GL_FALSE;
+    cache->activeTexture = ES_STATE_UNKNOWN;
+    
+    for( i = 0; i < ES_STATE_MAX_TEXTURE_UNITS; i++ )
+    {
+        cache->textures[i] = ES_STATE_UNKNOWN;
+    }
+    
+    esStateInvalidateVertexArrayState( cache );
+}
+
+// esStateCacheResetCounters()
+void ESUTIL_API esStateCacheResetCounters( ESStateCache *cache )
+{
+    memset( cache->issued, 0, sizeof( cache->issued ) );
+    memset( cache->elided, 0, sizeof( cache->elided ) );
+}
+
+// esStateCacheLogStats()
+void ESUTIL_API esStateCacheLogStats( const ESStateCache *cache )
+{
+    unsigned int issued = 0;
+    unsigned int elided = 0;
+    int i;
+    
+    for( i = 0; i < ES_STATE_NUM_CALLS; i++ )
+    {
+        esLogMessage( " %-28s issued %6u elided %6u\n", stateCallNames[i], cache->issued[i], cache->elided[i] );
+        issued += cache->issued[i];
+        elided += cache->elided[i];
+    }
+    
+    esLogMessage( " %-28s issued %6u elided %6u\n", "total", issued, elided );
+}
+
+// esStateBindBuffer()
+void ESUTIL_API esStateBindBuffer( ESStateCache *cache, GLenum target, GLuint buffer )
+{
+    GLuint *binding;
+    
+    switch( target )
+    {
+        case GL_ARRAY_BUFFER:
+            binding = &cache->arrayBuffer;
+            break;
+        case GL_ELEMENT_ARRAY_BUFFER:
+            binding = &cache->elementArrayBuffer;
+            break;
+        default:
+            // other targets are not tracked, always forward
+            binding = NULL;
+            break;
+    }
+    
+    if( binding != NULL && *binding == buffer )
+    {
+        cache->elided[ES_STATE_BIND_BUFFER]++;
+        return;
+    }
+    
+    cache->gl->bindBuffer( target, buffer );
+    cache->issued[ES_STATE_BIND_BUFFER]++;
+    
+    if( binding != NULL )
+    {
+        *binding = buffer;
+    }
+}
+
+// esStateBindVertexArray()
+void ESUTIL_API esStateBindVertexArray( ESStateCache *cache, GLuint array )
+{
+    if( cache->vertexArray == array )
+    {
+        cache->elided[ES_STATE_BIND_VERTEX_ARRAY]++;
+        return;
+    }
+    
+    cache->gl->bindVertexArray( array );
+    cache->issued[ES_STATE_BIND_VERTEX_ARRAY]++;
+    cache->vertexArray = array;
+    
+    // element binding, enables and divisors come from the new VAO
+    esStateInvalidateVertexArrayState( cache );
+}
+
+// esStateUseProgram()
+void ESUTIL_API esStateUseProgram( ESStateCache *cache, GLuint program )
+{
+    if( cache->program == program )
+    {
+        cache->elided[ES_STATE_USE_PROGRAM]++;
+        return;
+    }
+    
+    cache->gl->useProgram( program );
+    cache->issued[ES_STATE_USE_PROGRAM]++;
+    cache->program = program;
+}
+
+// esStateEnableVertexAttribArray()
+void ESUTIL_API esStateEnableVertexAttribArray( ESStateCache *cache, GLuint index )
+{
+    // untracked slots get no bit and are always forwarded
+    unsigned int bit = index < ES_STATE_MAX_ATTRIBS ? 1u << index : 0;
+    
+    if( ( cache->attribKnown & bit ) && ( cache->attribEnabled & bit ) )
+    {
+        cache->elided[ES_STATE_ENABLE_ATTRIB]++;
+        return;
+    }
+    
+    cache->gl->enableVertexAttribArray( index );
+    cache->issued[ES_STATE_ENABLE_ATTRIB]++;
+    
+    cache->attribKnown   |= bit;
+    cache->attribEnabled |= bit;
+}
+
+// esStateDisableVertexAttribArray()
+void ESUTIL_API esStateDisableVertexAttribArray( ESStateCache *cache, GLuint index )
+{
+    unsigned int bit = index < ES_STATE_MAX_ATTRIBS ? 1u << index : 0;
+    
+    if( ( cache->attribKnown & bit ) && !( cache->attribEnabled & bit ) )
+    {
+        cache->elided[ES_STATE_DISABLE_ATTRIB]++;
+        return;
+    }
+    
+    cache->gl->disableVertexAttribArray( index );
+    cache->issued[ES_STATE_DISABLE_ATTRIB]++;
+    
+    cache->attribKnown   |= bit;
+    cache->attribEnabled &= ~bit;
+}
+
+// esStateVertexAttribDivisor()
+void ESUTIL_API esStateVertexAttribDivisor( ESStateCache *cache, GLuint index, GLuint divisor )
+{
+    unsigned int bit = index < ES_STATE_MAX_ATTRIBS ? 1u << index : 0;
+    
+    if( ( cache->divisorKnown & bit ) && cache->divisors[index] == divisor )
+    {
+        cache->elided[ES_STATE_ATTRIB_DIVISOR]++;
+        return;
+    }
+    
+    cache->gl->vertexAttribDivisor( index, divisor );
+    cache->issued[ES_STATE_ATTRIB_DIVISOR]++;
+    
+    if( bit != 0 )
+    {
+        cache->divisorKnown    |= bit;
+        cache->divisors[index]  = divisor;
+    }
+}
+
+// esStateSetVertexAttribArrays()
+void ESUTIL_API esStateSetVertexAttribArrays( ESStateCache *cache, unsigned int enabledMask, GLuint numAttribs )
+{
+    GLuint i;
+    
+    for( i = 0; i < numAttribs; i++ )
+    {
+        if( enabledMask & ( 1u << i ) )
+        {
+            esStateEnableVertexAttribArray( cache, i );
+        }
+        else
+        {
+            esStateDisableVertexAttribArray( cache, i );
+        }
+    }
+}
+
+// esStateInvalidateBinding()
+void ESUTIL_API esStateInvalidateBinding( ESStateCache *cache, GLenum target )
+{
+    if( target == GL_ARRAY_BUFFER )
+    {
+        cache->arrayBuffer = ES_STATE_UNKNOWN;
+    }
+    else if( target == GL_ELEMENT_ARRAY_BUFFER )
+    {
+        cache->elementArrayBuffer = ES_STATE_UNKNOWN;
+    }
+}
+
+// esStateViewport()
+void ESUTIL_API esStateViewport( ESStateCache *cache, GLint x, GLint y, GLsizei width, GLsizei height )
+{
+    if( cache->viewportKnown &&
+        cache->viewport[0] == x && cache->viewport[1] == y &&
+        cache->viewport[2] == width && cache->viewport[3] == height )
+    {
+        cache->elided[ES_STATE_VIEWPORT]++;
+        return;
+    }
+    
+    cache->gl->viewport( x, y, width, height );
+    cache->issued[ES_STATE_VIEWPORT]++;
+    
+    cache->viewportKnown = GL_TRUE;
+    cache->viewport[0]   = x;
+    cache->viewport[1]   = y;
+    cache->viewport[2]   = width;
+    cache->viewport[3]   = height;
+}
+
+// esStateBindTexture()
+void ESUTIL_API esStateBindTexture( ESStateCache *cache, GLuint unit, GLenum target, GLuint texture )
+{
+    // only 2D bindings on the first units are tracked, anything else is always forwarded
+    GLboolean tracked = target == GL_TEXTURE_2D && unit < ES_STATE_MAX_TEXTURE_UNITS;
+    
+    if( tracked && cache->textures[unit] == texture )
+    {
+        cache->elided[ES_STATE_BIND_TEXTURE]++;
+        return;
+    }
+    
+    if( cache->activeTexture != unit )
+    {
+        cache->gl->activeTexture( GL_TEXTURE0 + unit );
+        cache->issued[ES_STATE_ACTIVE_TEXTURE]++;
+        cache->activeTexture = unit;
+    }
+    
+    cache->gl->bindTexture( target, texture );
+    cache->issued[ES_STATE_BIND_TEXTURE]++;
+    
+    if( tracked )
+    {
+        cache->textures[unit] = texture;
+    }
+}
+
+// esStateDeleteBuffers()
+void ESUTIL_API esStateDeleteBuffers( ESStateCache *cache, GLsizei n, const GLuint *buffers )
+{
+    GLsizei i;
+    
+    cache->gl->deleteBuffers( n, buffers );
+    
+    for( i = 0; i < n; i++ )
+    {
+        if( buffers[i] == 0 )
+        {
+            continue;
+        }
+        
+        if( cache->arrayBuffer == buffers[i] )
+        {
+            cache->arrayBuffer = 0;
+        }
+        
+        if( cache->elementArrayBuffer == buffers[i] )
+        {
+            cache->elementArrayBuffer = 0;
+        }
+    }
+}
+
+// esStateDeleteVertexArrays()
+void ESUTIL_API esStateDeleteVertexArrays( ESStateCache *cache, GLsizei n, const GLuint *arrays )
+{
+    GLsizei i;
+    
+    cache->gl->deleteVertexArrays( n, arrays );
+    
+    for( i = 0; i < n; i++ )
+    {
+        if( arrays[i] != 0 && cache->vertexArray == arrays[i] )
+        {
+            // GL falls back to the default vertex array object
+            cache->vertexArray = 0;
+            esStateInvalidateVertexArrayState( cache );
+        }
+    }
+}
@@ -0,0 +1,117 @@
+//
+//  ESStateCache.h
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+
+#ifndef ESStateCache_h
+#define ESStateCache_h
+
+#include "ESUtil.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// Vertex attribute slots tracked by the cache
+#define ES_STATE_MAX_ATTRIBS 16
+// Texture units tracked by the cache, only their GL_TEXTURE_2D binding
+#define ES_STATE_MAX_TEXTURE_UNITS 8
+// Binding value meaning "not known", the next call is always issued
+#define ES_STATE_UNKNOWN     0xFFFFFFFFu
+
+// Wrapped entry points, used to index the issued/elided counters
+enum
+{
+    ES_STATE_BIND_BUFFER = 0,
+    ES_STATE_BIND_VERTEX_ARRAY,
+    ES_STATE_USE_PROGRAM,
+    ES_STATE_ENABLE_ATTRIB,
+    ES_STATE_DISABLE_ATTRIB,
+    ES_STATE_ATTRIB_DIVISOR,
+    ES_STATE_VIEWPORT,
+    ES_STATE_ACTIVE_TEXTURE,
+    ES_STATE_BIND_TEXTURE,
+    ES_STATE_NUM_CALLS
+};
+
+// GL entry points the cache forwards to, swap them for a recording fake to test without a GPU
+typedef struct
+{
+    void ( GL_APIENTRY *bindBuffer )( GLenum target, GLuint buffer );
+    void ( GL_APIENTRY *bindVertexArray )( GLuint array );
+    void ( GL_APIENTRY *useProgram )( GLuint program );
+    void ( GL_APIENTRY *enableVertexAttribArray )( GLuint index );
+    void ( GL_APIENTRY *disableVertexAttribArray )( GLuint index );
+    void ( GL_APIENTRY *vertexAttribDivisor )( GLuint index, GLuint divisor );
+    void ( GL_APIENTRY *viewport )( GLint x, GLint y, GLsizei width, GLsizei height );
+    void ( GL_APIENTRY *activeTexture )( GLenum texture );
+    void ( GL_APIENTRY *bindTexture )( GLenum target, GLuint texture );
+    void ( GL_APIENTRY *deleteBuffers )( GLsizei n, const GLuint *buffers );
+    void ( GL_APIENTRY *deleteVertexArrays )( GLsizei n, const GLuint *arrays );
+} ESStateCacheGL;
+
+typedef struct
+{
+    const ESStateCacheGL *gl;
+    
+    GLuint program;
+    GLuint vertexArray;
+    GLuint arrayBuffer;
+    
+    // The rest is vertex array object state, forgotten whenever the VAO changes
+    GLuint       elementArrayBuffer;
+    unsigned int attribKnown;
+    unsigned int attribEnabled;
+    unsigned int divisorKnown;
+    GLuint       divisors[ES_STATE_MAX_ATTRIBS];
+    
+    GLboolean viewportKnown;
+    GLint     viewport[4];
+    
+    // active unit as an index ( GL_TEXTURE0 + activeTexture ) and the 2D texture bound to each unit
+    GLuint activeTexture;
+    GLuint textures[ES_STATE_MAX_TEXTURE_UNITS];
+    
+    // calls forwarded to GL and calls dropped as redundant, per entry point
+    unsigned int issued[ES_STATE_NUM_CALLS];
+    unsigned int elided[ES_STATE_NUM_CALLS];
+} ESStateCache;
+
+// install the GL entry points used by caches initialized afterwards, NULL restores the real GL
+void ESUTIL_API esStateCacheSetBackend( const ESStateCacheGL *backend );
+// start with every piece of state unknown
+void ESUTIL_API esStateCacheInit( ESStateCache *cache );
+// forget the tracked state, call after GL state was changed behind the cache's back
+void ESUTIL_API esStateCacheInvalidate( ESStateCache *cache );
+// zero the issued/elided counters, e.g. at the start of every frame
+void ESUTIL_API esStateCacheResetCounters( ESStateCache *cache );
+// print the issued/elided counters with esLogMessage
+void ESUTIL_API esStateCacheLogStats( const ESStateCache *cache );
+
+// Cached versions of the GL entry points, same arguments minus the cache
+void ESUTIL_API esStateBindBuffer( ESStateCache *cache, GLenum target, GLuint buffer );
+void ESUTIL_API esStateBindVertexArray( ESStateCache *cache, GLuint array );
+void ESUTIL_API esStateUseProgram( ESStateCache *cache, GLuint program );
+void ESUTIL_API esStateEnableVertexAttribArray( ESStateCache *cache, GLuint index );
+void ESUTIL_API esStateDisableVertexAttribArray( ESStateCache *cache, GLuint index );
+void ESUTIL_API esStateVertexAttribDivisor( ESStateCache *cache, GLuint index, GLuint divisor );
+void ESUTIL_API esStateViewport( ESStateCache *cache, GLint x, GLint y, GLsizei width, GLsizei height );
+// bind texture to target on texture unit ( 0 based ), switching the active unit only when needed
+void ESUTIL_API esStateBindTexture( ESStateCache *cache, GLuint unit, GLenum target, GLuint texture );
+// enable exactly the attribute arrays in enabledMask ( bit i = attribute i ) among the first numAttribs,
+// disabling the others. Arrays that are already in the wanted state cost nothing
+void ESUTIL_API esStateSetVertexAttribArrays( ESStateCache *cache, unsigned int enabledMask, GLuint numAttribs );
+// forget one buffer binding, for code that binds buffers without going through the cache
+void ESUTIL_API esStateInvalidateBinding( ESStateCache *cache, GLenum target );
+// deleting a bound object unbinds it in GL, so these keep the cache in sync
+void ESUTIL_API esStateDeleteBuffers( ESStateCache *cache, GLsizei n, const GLuint *buffers );
+void ESUTIL_API esStateDeleteVertexArrays( ESStateCache *cache, GLsizei n, const GLuint *arrays );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESStateCache_h */
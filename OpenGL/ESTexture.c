@@ -0,0 +1,671 @@
+//
+//  ESTexture.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  CPU side texture preparation: mip chains built with a box or Kaiser filter
+//  so uploads never wait on glGenerateMipmap, and a skyline packer that puts
+//  many small images into one atlas texture.
+//
+
+#include "ESTexture.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined( __SSE2__ ) || defined( _M_X64 )
+#define ES_TEXTURE_SSE2 1
+#include <emmintrin.h>
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#define ES_TEXTURE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Kaiser filter: taps per output pixel and window shape
+#define KAISER_TAPS  8
+#define KAISER_ALPHA 4.0
+
+//
+// Mip chains
+//
+
+// esTextureMipCount()
+int ESUTIL_API esTextureMipCount( int width, int height )
+{
+    int size = width > height ? width : height;
+    int levels = 1;
+    
+    while( size > 1 )
+    {
+        size >>= 1;
+        levels++;
+    }
+    
+    return levels;
+}
+
+// esTextureMipChainSize()
+size_t ESUTIL_API esTextureMipChainSize( int width, int height, int channels )
+{
+    size_t size = 0;
+    
+    while( width > 1 || height > 1 )
+    {
+        width  = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        size  += ( size_t ) width * height * channels;
+    }
+    
+    return size;
+}
+
+#ifdef ES_TEXTURE_SSE2
+// Two RGBA output pixels per iteration: widen to 16 bits, add the rows, then the pixel pairs
+static int esBoxRowRGBA( GLubyte *dest, const GLubyte *row0, const GLubyte *row1, int destWidth )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two  = _mm_set1_epi16( 2 );
+    int x = 0;
+    
+    for( ; x + 2 <= destWidth; x += 2 )
+    {
+        __m128i a  = _mm_loadu_si128( ( const __m128i * ) ( row0 + x * 8 ) );
+        __m128i b  = _mm_loadu_si128( ( const __m128i * ) ( row1 + x * 8 ) );
+        __m128i lo = _mm_add_epi16( _mm_unpacklo_epi8( a, zero ), _mm_unpacklo_epi8( b, zero ) );
+        __m128i hi = _mm_add_epi16( _mm_unpackhi_epi8( a, zero ), _mm_unpackhi_epi8( b, zero ) );
+        __m128i sum;
+        
+        lo  = _mm_add_epi16( lo, _mm_srli_si128( lo, 8 ) );
+        hi  = _mm_add_epi16( hi, _mm_srli_si128( hi, 8 ) );
+        sum = _mm_srli_epi16( _mm_add_epi16( _mm_unpacklo_epi64( lo, hi ), two ), 2 );
+        
+        _mm_storel_epi64( ( __m128i * ) ( dest + x * 4 ), _mm_packus_epi16( sum, sum ) );
+    }
+    
+    return x;
+}
+#elif defined( ES_TEXTURE_NEON )
+// Eight RGBA output pixels per iteration, channels deinterleaved so pairwise adds line up
+static int esBoxRowRGBA( GLubyte *dest, const GLubyte *row0, const GLubyte *row1, int destWidth )
+{
+    int x = 0;
+    
+    for( ; x + 8 <= destWidth; x += 8 )
+    {
+        uint8x16x4_t a = vld4q_u8( row0 + x * 8 );
+        uint8x16x4_t b = vld4q_u8( row1 + x * 8 );
+        uint8x8x4_t  out;
+        int c;
+        
+        for( c = 0; c < 4; c++ )
+        {
+            out.val[c] = vrshrn_n_u16( vaddq_u16( vpaddlq_u8( a.val[c] ), vpaddlq_u8( b.val[c] ) ), 2 );
+        }
+        
+        vst4_u8( dest + x * 4, out );
+    }
+    
+    return x;
+}
+#endif
+
+static void esDownsampleBox( GLubyte *dest, const GLubyte *src, int width, int height, int channels )
+{
+    int destWidth  = width > 1 ? width / 2 : 1;
+    int destHeight = height > 1 ? height / 2 : 1;
+    size_t rowSize = ( size_t ) width * channels;
+    int x;
+    int y;
+    
+    for( y = 0; y < destHeight; y++ )
+    {
+        // a 1 pixel high level averages a row with itself
+        const GLubyte *row0 = src + rowSize * ( 2 * y );
+        const GLubyte *row1 = height > 1 ? row0 + rowSize : row0;
+        GLubyte *out = dest + ( size_t ) destWidth * channels * y;
+        int c;
+        
+        x = 0;
+
+#if defined( ES_TEXTURE_SSE2 ) || defined( ES_TEXTURE_NEON )
+        if( channels == 4 && width > 1 )
+        {
+            x = esBoxRowRGBA( out, row0, row1, destWidth );
+        }
+#endif
+        
+        for( ; x < destWidth; x++ )
+        {
+            int x0 = 2 * x;
+            int x1 = width > 1 ? x0 + 1 : x0;
+            
+            for( c = 0; c < channels; c++ )
+            {
+                int sum = row0[ x0 * channels + c ] + row0[ x1 * channels + c ] +
+                          row1[ x0 * channels + c ] + row1[ x1 * channels + c ];
+                
+                out[ x * channels + c ] = ( GLubyte ) ( ( sum + 2 ) >> 2 );
+            }
+        }
+    }
+}
+
+// modified Bessel function of the first kind, order 0
+static double esBesselI0( double x )
+{
+    double sum  = 1.0;
+    double term = 1.0;
+    int k;
+    
+    for( k = 1; k < 32; k++ )
+    {
+        term *= ( x / ( 2.0 * k ) ) * ( x / ( 2.0 * k ) );
+        sum  += term;
+        
+        if( term < sum * 1e-12 )
+        {
+            break;
+        }
+    }
+    
+    return sum;
+}
+
+// Weights of the taps at source offsets -3.5 .. 3.5 from the output pixel center:
+// a sinc cut off at half the source rate under a Kaiser window, normalized
+static void esKaiserWeights( float weights[KAISER_TAPS] )
+{
+    double total = 0.0;
+    double w[KAISER_TAPS];
+    int k;
+    
+    for( k = 0; k < KAISER_TAPS; k++ )
+    {
+        double d = k - ( KAISER_TAPS - 1 ) * 0.5;
+        double t = d / ( KAISER_TAPS * 0.5 );
+        double x = M_PI * d * 0.5;
+        double sinc = x != 0.0 ? sin( x ) / x : 1.0;
+        
+        w[k]   = sinc * esBesselI0( KAISER_ALPHA * sqrt( 1.0 - t * t ) ) / esBesselI0( KAISER_ALPHA );
+        total += w[k];
+    }
+    
+    for( k = 0; k < KAISER_TAPS; k++ )
+    {
+        weights[k] = ( float ) ( w[k] / total );
+    }
+}
+
+static int esClampIndex( int i, int size )
+{
+    return i < 0 ? 0 : ( i >= size ? size - 1 : i );
+}
+
+// out[i] = sum of weights[k] * rows[k][i] over count floats, rounded and clamped to bytes
+static void esKaiserColumn( GLubyte *out, const float *rows[KAISER_TAPS], const float weights[KAISER_TAPS], int count )
+{
+    int i = 0;
+    int k;
+
+#ifdef ES_TEXTURE_SSE2
+    const __m128 lo = _mm_setzero_ps();
+    const __m128 hi = _mm_set1_ps( 255.0f );
+    
+    for( ; i + 4 <= count; i += 4 )
+    {
+        __m128 sum = _mm_setzero_ps();
+        __m128i packed;
+        
+        for( k = 0; k < KAISER_TAPS; k++ )
+        {
+            sum = _mm_add_ps( sum, _mm_mul_ps( _mm_set1_ps( weights[k] ), _mm_loadu_ps( rows[k] + i ) ) );
+        }
+        
+        // round to nearest and squeeze four ints into four bytes
+        packed = _mm_cvtps_epi32( _mm_min_ps( _mm_max_ps( sum, lo ), hi ) );
+        packed = _mm_packs_epi32( packed, packed );
+        packed = _mm_packus_epi16( packed, packed );
+        {
+            int bytes = _mm_cvtsi128_si32( packed );
+            
+            memcpy( out + i, &bytes, sizeof( bytes ) );
+        }
+    }
+#elif defined( ES_TEXTURE_NEON )
+    for( ; i + 4 <= count; i += 4 )
+    {
+        float32x4_t sum = vdupq_n_f32( 0.0f );
+        uint16x4_t  narrow;
+        
+        for( k = 0; k < KAISER_TAPS; k++ )
+        {
+            sum = vmlaq_n_f32( sum, vld1q_f32( rows[k] + i ), weights[k] );
+        }
+        
+        sum    = vminq_f32( vmaxq_f32( sum, vdupq_n_f32( 0.0f ) ), vdupq_n_f32( 255.0f ) );
+        narrow = vmovn_u32( vcvtq_u32_f32( vaddq_f32( sum, vdupq_n_f32( 0.5f ) ) ) );
+        out[i + 0] = ( GLubyte ) vget_lane_u16( narrow, 0 );
+        out[i + 1] = ( GLubyte ) vget_lane_u16( narrow, 1 );
+        out[i + 2] = ( GLubyte ) vget_lane_u16( narrow, 2 );
+        out[i + 3] = ( GLubyte ) vget_lane_u16( narrow, 3 );
+    }
+#endif
+    
+    for( ; i < count; i++ )
+    {
+        float sum = 0.0f;
+        
+        for( k = 0; k < KAISER_TAPS; k++ )
+        {
+            sum += weights[k] * rows[k][i];
+        }
+        
+        sum    = sum < 0.0f ? 0.0f : ( sum > 255.0f ? 255.0f : sum );
+        out[i] = ( GLubyte ) ( sum + 0.5f );
+    }
+}
+
+// Separable: horizontal pass into a float scratch of destWidth x height, then the vertical pass.
+// A dimension of 1 is passed through unfiltered. Returns GL_FALSE if the scratch can't be allocated
+static GLboolean esDownsampleKaiser( GLubyte *dest, const GLubyte *src, int width, int height, int channels )
+{
+    int destWidth  = width > 1 ? width / 2 : 1;
+    int destHeight = height > 1 ? height / 2 : 1;
+    size_t rowFloats = ( size_t ) destWidth * channels;
+    float weights[KAISER_TAPS];
+    float *scratch = malloc( sizeof( float ) * rowFloats * height );
+    int x;
+    int y;
+    int k;
+    int c;
+    
+    if( scratch == NULL )
+    {
+        return GL_FALSE;
+    }
+    
+    esKaiserWeights( weights );
+    
+    for( y = 0; y < height; y++ )
+    {
+        const GLubyte *row = src + ( size_t ) width * channels * y;
+        float *out = scratch + rowFloats * y;
+        
+        for( x = 0; x < destWidth; x++ )
+        {
+            for( c = 0; c < channels; c++ )
+            {
+                float sum = 0.0f;
+                
+                if( width == 1 )
+                {
+                    sum = row[c];
+                }
+                else
+                {
+                    for( k = 0; k < KAISER_TAPS; k++ )
+                    {
+                        int sx = esClampIndex( 2 * x - KAISER_TAPS / 2 + 1 + k, width );
+                        
+                        sum += weights[k] * row[ sx * channels + c ];
+                    }
+                }
+                
+                out[ x * channels + c ] = sum;
+            }
+        }
+    }
+    
+    for( y = 0; y < destHeight; y++ )
+    {
+        const float *rows[KAISER_TAPS];
+        float identity[KAISER_TAPS];
+        
+        for( k = 0; k < KAISER_TAPS; k++ )
+        {
+            if( height == 1 )
+            {
+                // every tap reads the only row, weight it once
+                rows[k]     = scratch;
+                identity[k] = k == 0 ? 1.0f : 0.0f;
+            }
+            else
+            {
+                rows[k] = scratch + rowFloats * esClampIndex( 2 * y - KAISER_TAPS / 2 + 1 + k, height );
+            }
+        }
+        
+        esKaiserColumn( dest + rowFloats * y, rows, height == 1 ? identity : weights, ( int ) rowFloats );
+    }
+    
+    free( scratch );
+    
+    return GL_TRUE;
+}
+
+// esTextureDownsample()
+void ESUTIL_API esTextureDownsample( GLubyte *dest, const GLubyte *src, int width, int height, int channels,
+                                     ESMipFilter filter )
+{
+    // the box filter needs no scratch, use it if the Kaiser one can't get any
+    if( filter != ES_MIP_KAISER || !esDownsampleKaiser( dest, src, width, height, channels ) )
+    {
+        esDownsampleBox( dest, src, width, height, channels );
+    }
+}
+
+// esTextureBuildMipChain()
+int ESUTIL_API esTextureBuildMipChain( const GLubyte *pixels, int width, int height, int channels, ESMipFilter filter,
+                                       GLubyte *chain, ESMipLevel *levels )
+{
+    int numLevels = 1;
+    
+    levels[0].width  = width;
+    levels[0].height = height;
+    levels[0].pixels = pixels;
+    
+    // Every level is filtered from the one above it
+    while( width > 1 || height > 1 )
+    {
+        const ESMipLevel *parent = &levels[ numLevels - 1 ];
+        
+        width  = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        
+        esTextureDownsample( chain, parent->pixels, parent->width, parent->height, channels, filter );
+        
+        levels[numLevels].width  = width;
+        levels[numLevels].height = height;
+        levels[numLevels].pixels = chain;
+        numLevels++;
+        
+        chain += ( size_t ) width * height * channels;
+    }
+    
+    return numLevels;
+}
+
+// esTextureUploadMipChain()
+void ESUTIL_API esTextureUploadMipChain( const ESMipLevel *levels, int numLevels, GLenum format )
+{
+    int level;
+    
+    // rows are tightly packed
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+    
+    for( level = 0; level < numLevels; level++ )
+    {
+        glTexImage2D( GL_TEXTURE_2D, level, format, levels[level].width, levels[level].height, 0,
+                      format, GL_UNSIGNED_BYTE, levels[level].pixels );
+    }
+    
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, numLevels - 1 );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+}
+
+//
+// Skyline atlas packer
+//
+
+// esAtlasInit()
+GLboolean ESUTIL_API esAtlasInit( ESAtlas *atlas, int width, int height, int padding )
+{
+    memset( atlas, 0, sizeof( ESAtlas ) );
+    
+    if( width < 1 || height < 1 || padding < 0 )
+    {
+        return GL_FALSE;
+    }
+    
+    atlas->width    = width;
+    atlas->height   = height;
+    atlas->padding  = padding;
+    // every node is at least one pixel wide, plus one for the insert before the split
+    atlas->maxNodes = width + 1;
+    atlas->nodes    = malloc( sizeof( ESSkylineNode ) * atlas->maxNodes );
+    
+    if( atlas->nodes == NULL )
+    {
+        return GL_FALSE;
+    }
+    
+    esAtlasReset( atlas );
+    
+    return GL_TRUE;
+}
+
+// esAtlasDestroy()
+void ESUTIL_API esAtlasDestroy( ESAtlas *atlas )
+{
+    free( atlas->nodes );
+    memset( atlas, 0, sizeof( ESAtlas ) );
+}
+
+// esAtlasReset()
+void ESUTIL_API esAtlasReset( ESAtlas *atlas )
+{
+    atlas->nodes[0].x     = 0;
+    atlas->nodes[0].y     = 0;
+    atlas->nodes[0].width = atlas->width;
+    atlas->numNodes = 1;
+    atlas->usedArea = 0;
+}
+
+// lowest y a width x height rectangle can sit at with its left edge on node i, -1 if it does not fit
+static int esSkylineFit( const ESAtlas *atlas, int i, int width, int height )
+{
+    int left = width;
+    int y;
+    
+    if( atlas->nodes[i].x + width > atlas->width )
+    {
+        return -1;
+    }
+    
+    y = atlas->nodes[i].y;
+    
+    for( ; left > 0; i++ )
+    {
+        if( atlas->nodes[i].y > y )
+        {
+            y = atlas->nodes[i].y;
+        }
+        
+        if( y + height > atlas->height )
+        {
+            return -1;
+        }
+        
+        left -= atlas->nodes[i].width;
+    }
+    
+    return y;
+}
+
+static void esSkylineRemove( ESAtlas *atlas, int i )
+{
+    memmove( &atlas->nodes[i], &atlas->nodes[i + 1], sizeof( ESSkylineNode ) * ( atlas->numNodes - i - 1 ) );
+    atlas->numNodes--;
+}
+
+// esAtlasPack()
+GLboolean ESUTIL_API esAtlasPack( ESAtlas *atlas, int width, int height, ESAtlasRect *rect )
+{
+    int paddedWidth  = width + atlas->padding;
+    int paddedHeight = height + atlas->padding;
+    int bestBottom = atlas->height + 1;
+    int bestWidth  = atlas->width + 1;
+    int bestIndex  = -1;
+    int bestY      = 0;
+    int i;
+    
+    memset( rect, 0, sizeof( ESAtlasRect ) );
+    
+    if( width < 1 || height < 1 )
+    {
+        return GL_FALSE;
+    }
+    
+    // Bottom-left rule: lowest top edge wins, the narrower segment breaks ties
+    for( i = 0; i < atlas->numNodes; i++ )
+    {
+        int y = esSkylineFit( atlas, i, paddedWidth, paddedHeight );
+        
+        if( y >= 0 && ( y + paddedHeight < bestBottom ||
+                        ( y + paddedHeight == bestBottom && atlas->nodes[i].width < bestWidth ) ) )
+        {
+            bestBottom = y + paddedHeight;
+            bestWidth  = atlas->nodes[i].width;
+            bestIndex  = i;
+            bestY      = y;
+        }
+    }
+    
+    if( bestIndex < 0 )
+    {
+        return GL_FALSE;
+    }
+    
+    rect->x      = atlas->nodes[bestIndex].x;
+    rect->y      = bestY;
+    rect->width  = width;
+    rect->height = height;
+    rect->u0     = ( GLfloat ) rect->x / atlas->width;
+    rect->v0     = ( GLfloat ) rect->y / atlas->height;
+    rect->u1     = ( GLfloat ) ( rect->x + width ) / atlas->width;
+    rect->v1     = ( GLfloat ) ( rect->y + height ) / atlas->height;
+    
+    // Raise the skyline over the rectangle
+    memmove( &atlas->nodes[bestIndex + 1], &atlas->nodes[bestIndex],
+             sizeof( ESSkylineNode ) * ( atlas->numNodes - bestIndex ) );
+    atlas->numNodes++;
+    atlas->nodes[bestIndex].y     = bestBottom;
+    atlas->nodes[bestIndex].width = paddedWidth;
+    
+    // and cut the segments it now covers
+    for( i = bestIndex + 1; i < atlas->numNodes; )
+    {
+        const ESSkylineNode *prev = &atlas->nodes[i - 1];
+        int shrink = prev->x + prev->width - atlas->nodes[i].x;
+        
+        if( shrink <= 0 )
+        {
+            break;
+        }
+        
+        atlas->nodes[i].x     += shrink;
+        atlas->nodes[i].width -= shrink;
+        
+        if( atlas->nodes[i].width > 0 )
+        {
+            break;
+        }
+        
+        esSkylineRemove( atlas, i );
+    }
+    
+    // Neighbours at the same height become one segment
+    for( i = 0; i + 1 < atlas->numNodes; )
+    {
+        if( atlas->nodes[i].y == atlas->nodes[i + 1].y )
+        {
+            atlas->nodes[i].width += atlas->nodes[i + 1].width;
+            esSkylineRemove( atlas, i + 1 );
+        }
+        else
+        {
+            i++;
+        }
+    }
+    
+    atlas->usedArea += ( long ) paddedWidth * paddedHeight;
+    
+    return GL_TRUE;
+}
+
+typedef struct
+{
+    int width;
+    int height;
+    int index;
+} ESAtlasItem;
+
+static int esAtlasItemCompare( const void *a, const void *b )
+{
+    const ESAtlasItem *itemA = ( const ESAtlasItem * ) a;
+    const ESAtlasItem *itemB = ( const ESAtlasItem * ) b;
+    
+    if( itemA->height != itemB->height )
+    {
+        return itemB->height - itemA->height;
+    }
+    
+    if( itemA->width != itemB->width )
+    {
+        return itemB->width - itemA->width;
+    }
+    
+    // stable for equal sizes
+    return itemA->index - itemB->index;
+}
+
+// esAtlasPackBatch()
+int ESUTIL_API esAtlasPackBatch( ESAtlas *atlas, const int *sizes, int count, ESAtlasRect *rects )
+{
+    ESAtlasItem *items = malloc( sizeof( ESAtlasItem ) * ( count > 0 ? count : 1 ) );
+    int numPacked = 0;
+    int i;
+    
+    if( items == NULL )
+    {
+        // unsorted still packs, just less tightly
+        for( i = 0; i < count; i++ )
+        {
+            numPacked += esAtlasPack( atlas, sizes[2 * i], sizes[2 * i + 1], &rects[i] ) ? 1 : 0;
+        }
+        
+        return numPacked;
+    }
+    
+    for( i = 0; i < count; i++ )
+    {
+        items[i].width  = sizes[2 * i];
+        items[i].height = sizes[2 * i + 1];
+        items[i].index  = i;
+    }
+    
+    qsort( items, count, sizeof( ESAtlasItem ), esAtlasItemCompare );
+    
+    for( i = 0; i < count; i++ )
+    {
+        numPacked += esAtlasPack( atlas, items[i].width, items[i].height, &rects[ items[i].index ] ) ? 1 : 0;
+    }
+    
+    free( items );
+    
+    return numPacked;
+}
+
+// esAtlasOccupancy()
+float ESUTIL_API esAtlasOccupancy( const ESAtlas *atlas )
+{
+    return ( float ) atlas->usedArea / ( ( float ) atlas->width * atlas->height );
+}
+
+// esAtlasBlit()
+void ESUTIL_API esAtlasBlit( GLubyte *atlasPixels, const ESAtlas *atlas, const ESAtlasRect *rect,
+                             const GLubyte *pixels, int channels )
+{
+    size_t rowSize = ( size_t ) rect->width * channels;
+    int y;
+    
+    for( y = 0; y < rect->height; y++ )
+    {
+        memcpy( atlasPixels + ( ( size_t ) ( rect->y + y ) * atlas->width + rect->x ) * channels,
+                pixels + rowSize * y, rowSize );
+    }
+}
@@ -0,0 +1,107 @@
+//
+//  ESTexture.h
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+
+#ifndef ESTexture_h
+#define ESTexture_h
+
+#include "ESUtil.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// Most mip levels of a 2D texture, enough for 65536 x 65536
+#define ES_TEXTURE_MAX_LEVELS 17
+
+typedef enum
+{
+    // 2x2 average, cheapest, slightly blurry
+    ES_MIP_BOX = 0,
+    // 8-tap Kaiser windowed sinc, keeps detail without ringing into the next levels
+    ES_MIP_KAISER
+} ESMipFilter;
+
+typedef struct
+{
+    int            width;
+    int            height;
+    // tightly packed rows, bottom row first like the source
+    const GLubyte *pixels;
+} ESMipLevel;
+
+typedef struct
+{
+    // pixel rectangle inside the atlas, padding excluded
+    int     x;
+    int     y;
+    int     width;
+    int     height;
+    // texture coordinates of the rectangle's corners
+    GLfloat u0;
+    GLfloat v0;
+    GLfloat u1;
+    GLfloat v1;
+} ESAtlasRect;
+
+typedef struct
+{
+    // one segment of the skyline: the free space above y starts at x for width pixels
+    int x;
+    int y;
+    int width;
+} ESSkylineNode;
+
+typedef struct
+{
+    int            width;
+    int            height;
+    // gap left right of and above every rectangle, keeps bilinear filtering from bleeding
+    int            padding;
+    ESSkylineNode *nodes;
+    int            numNodes;
+    int            maxNodes;
+    // pixels covered by packed rectangles, padding included
+    long           usedArea;
+} ESAtlas;
+
+// number of levels down to 1 x 1
+int ESUTIL_API esTextureMipCount( int width, int height );
+// bytes of levels 1 and below of a width x height image with channels bytes per pixel
+size_t ESUTIL_API esTextureMipChainSize( int width, int height, int channels );
+// halve one level ( each size rounded down, never below 1 ) from src into dest.
+// channels is 1 to 4, RGBA uses the SIMD kernels
+void ESUTIL_API esTextureDownsample( GLubyte *dest, const GLubyte *src, int width, int height, int channels,
+                                     ESMipFilter filter );
+// build the full chain of a level 0 image. chain holds esTextureMipChainSize bytes for levels 1 and below,
+// levels receives esTextureMipCount entries ( levels[0] points at pixels ). Returns the number of levels
+int ESUTIL_API esTextureBuildMipChain( const GLubyte *pixels, int width, int height, int channels, ESMipFilter filter,
+                                       GLubyte *chain, ESMipLevel *levels );
+// upload a chain to the bound GL_TEXTURE_2D with trilinear filtering, format is GL_RED, GL_RG, GL_RGB or GL_RGBA
+void ESUTIL_API esTextureUploadMipChain( const ESMipLevel *levels, int numLevels, GLenum format );
+
+// start an empty width x height skyline atlas
+GLboolean ESUTIL_API esAtlasInit( ESAtlas *atlas, int width, int height, int padding );
+void ESUTIL_API esAtlasDestroy( ESAtlas *atlas );
+// forget every rectangle
+void ESUTIL_API esAtlasReset( ESAtlas *atlas );
+// place one width x height image at the lowest spot of the skyline, GL_FALSE when it does not fit
+GLboolean ESUTIL_API esAtlasPack( ESAtlas *atlas, int width, int height, ESAtlasRect *rect );
+// place count images given as width/height pairs, tallest first which packs tighter than arrival order.
+// rects[i] belongs to sizes[2 * i]; images that do not fit get a zero sized rect. Returns the number placed
+int ESUTIL_API esAtlasPackBatch( ESAtlas *atlas, const int *sizes, int count, ESAtlasRect *rects );
+// fraction of the atlas covered so far
+float ESUTIL_API esAtlasOccupancy( const ESAtlas *atlas );
+// copy an image into its rectangle of the atlas pixels, both with channels bytes per pixel
+void ESUTIL_API esAtlasBlit( GLubyte *atlasPixels, const ESAtlas *atlas, const ESAtlasRect *rect,
+                             const GLubyte *pixels, int channels );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESTexture_h */
@@ -5,19 +5,34 @@
 #include <math.h>
 #include <string.h>
 
+#if defined( __SSE__ ) || defined( _M_X64 )
+#define ES_MATRIX_SSE 1
+#include <xmmintrin.h>
+#if ( defined( __GNUC__ ) || defined( __clang__ ) ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+// AVX2/FMA kernels are compiled per-function and picked at runtime
+#define ES_MATRIX_AVX2 1
+#include <immintrin.h>
+#endif
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#define ES_MATRIX_NEON 1
+#include <arm_neon.h>
+#endif
+
 
 #define PI 3.1415926535897932384626433832795f
 
-void ESUTIL_API
-esTranslate( ESMatrix *result, GLfloat tx, GLfloat ty, GLfloat tz )
-{
-    result->m[3][0] += ( result->m[0][0] * tx + result->m[1][0] * ty + result->m[2][0] * tz );
-    result->m[3][1] += ( result->m[0][1] * tx + result->m[1][1] * ty + result->m[2][1] * tz );
-    result->m[3][2] += ( result->m[0][2] * tx + result->m[1][2] * ty + result->m[2][2] * tz );
-    result->m[3][3] += ( result->m[0][3] * tx + result->m[1][3] * ty + result->m[2][3] * tz );
-}
-void ESUTIL_API
-esMatrixMultiply( ESMatrix *result, ESMatrix *srcA, ESMatrix *srcB )
+//
+// Matrix kernels
+//
+// Every kernel computes result row i as the sum over k of srcA->m[i][k] * srcB row k,
+// so a row of the product is four broadcast multiply-adds on whole rows of srcB.
+// All of srcA and srcB are loaded before anything is stored, which keeps the
+// esRotate()/esFrustum() style calls ( result aliasing one of the sources ) valid.
+//
+typedef void ( *ESMatrixMultiplyFunc )( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB );
+typedef void ( *ESMatrixMultiplyBatchFunc )( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB, int count );
+
+static void esMatrixMultiplyScalar( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB )
 {
     ESMatrix tmp;
     int i;
@@ -48,6 +63,282 @@ esMatrixMultiply( ESMatrix *result, ESMatrix *srcA, ESMatrix *srcB )
     memcpy( result, &tmp, sizeof( ESMatrix ));
 }
 
+static void esMatrixMultiplyBatchScalar( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB, int count )
+{
+    ESMatrix b;
+    int i;
+    
+    // srcB may live inside result, keep a private copy for the whole batch
+    memcpy( &b, srcB, sizeof( ESMatrix ));
+    
+    for( i = 0; i < count; i++ )
+    {
+        esMatrixMultiplyScalar( &result[i], &srcA[i], &b );
+    }
+}
+
+#ifdef ES_MATRIX_SSE
+static void esMatrixMultiplySSE( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB )
+{
+    __m128 b0 = _mm_loadu_ps( srcB->m[0] );
+    __m128 b1 = _mm_loadu_ps( srcB->m[1] );
+    __m128 b2 = _mm_loadu_ps( srcB->m[2] );
+    __m128 b3 = _mm_loadu_ps( srcB->m[3] );
+    __m128 a0 = _mm_loadu_ps( srcA->m[0] );
+    __m128 a1 = _mm_loadu_ps( srcA->m[1] );
+    __m128 a2 = _mm_loadu_ps( srcA->m[2] );
+    __m128 a3 = _mm_loadu_ps( srcA->m[3] );
+    
+#define ES_SSE_ROW( a ) \
+    _mm_add_ps( _mm_add_ps( _mm_add_ps( \
+        _mm_mul_ps( _mm_shuffle_ps( a, a, _MM_SHUFFLE( 0, 0, 0, 0 ) ), b0 ), \
+        _mm_mul_ps( _mm_shuffle_ps( a, a, _MM_SHUFFLE( 1, 1, 1, 1 ) ), b1 ) ), \
+        _mm_mul_ps( _mm_shuffle_ps( a, a, _MM_SHUFFLE( 2, 2, 2, 2 ) ), b2 ) ), \
+        _mm_mul_ps( _mm_shuffle_ps( a, a, _MM_SHUFFLE( 3, 3, 3, 3 ) ), b3 ) )
+    
+    _mm_storeu_ps( result->m[0], ES_SSE_ROW( a0 ) );
+    _mm_storeu_ps( result->m[1], ES_SSE_ROW( a1 ) );
+    _mm_storeu_ps( result->m[2], ES_SSE_ROW( a2 ) );
+    _mm_storeu_ps( result->m[3], ES_SSE_ROW( a3 ) );
+}
+
+static void esMatrixMultiplyBatchSSE( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB, int count )
+{
+    __m128 b0 = _mm_loadu_ps( srcB->m[0] );
+    __m128 b1 = _mm_loadu_ps( srcB->m[1] );
+    __m128 b2 = _mm_loadu_ps( srcB->m[2] );
+    __m128 b3 = _mm_loadu_ps( srcB->m[3] );
+    int i;
+    
+    for( i = 0; i < count; i++ )
+    {
+        __m128 a0 = _mm_loadu_ps( srcA[i].m[0] );
+        __m128 a1 = _mm_loadu_ps( srcA[i].m[1] );
+        __m128 a2 = _mm_loadu_ps( srcA[i].m[2] );
+        __m128 a3 = _mm_loadu_ps( srcA[i].m[3] );
+        
+        _mm_storeu_ps( result[i].m[0], ES_SSE_ROW( a0 ) );
+        _mm_storeu_ps( result[i].m[1], ES_SSE_ROW( a1 ) );
+        _mm_storeu_ps( result[i].m[2], ES_SSE_ROW( a2 ) );
+        _mm_storeu_ps( result[i].m[3], ES_SSE_ROW( a3 ) );
+    }
+#undef ES_SSE_ROW
+}
+#endif // ES_MATRIX_SSE
+
+#ifdef ES_MATRIX_AVX2
+// Two rows of srcA per 256-bit register, srcB rows duplicated into both lanes
+#define ES_AVX2_ROWS( a ) \
+    _mm256_fmadd_ps( _mm256_permute_ps( a, _MM_SHUFFLE( 3, 3, 3, 3 ) ), b3, \
+    _mm256_fmadd_ps( _mm256_permute_ps( a, _MM_SHUFFLE( 2, 2, 2, 2 ) ), b2, \
+    _mm256_fmadd_ps( _mm256_permute_ps( a, _MM_SHUFFLE( 1, 1, 1, 1 ) ), b1, \
+        _mm256_mul_ps( _mm256_permute_ps( a, _MM_SHUFFLE( 0, 0, 0, 0 ) ), b0 ) ) ) )
+
+__attribute__ ( ( target( "avx2,fma" ) ) )
+static void esMatrixMultiplyAVX2( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB )
+{
+    __m256 b0 = _mm256_broadcast_ps( ( const __m128 * ) srcB->m[0] );
+    __m256 b1 = _mm256_broadcast_ps( ( const __m128 * ) srcB->m[1] );
+    __m256 b2 = _mm256_broadcast_ps( ( const __m128 * ) srcB->m[2] );
+    __m256 b3 = _mm256_broadcast_ps( ( const __m128 * ) srcB->m[3] );
+    __m256 a01 = _mm256_loadu_ps( srcA->m[0] );
+    __m256 a23 = _mm256_loadu_ps( srcA->m[2] );
+    
+    _mm256_storeu_ps( result->m[0], ES_AVX2_ROWS( a01 ) );
+    _mm256_storeu_ps( result->m[2], ES_AVX2_ROWS( a23 ) );
+}
+
+__attribute__ ( ( target( "avx2,fma" ) ) )
+static void esMatrixMultiplyBatchAVX2( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB, int count )
+{
+    __m256 b0 = _mm256_broadcast_ps( ( const __m128 * ) srcB->m[0] );
+    __m256 b1 = _mm256_broadcast_ps( ( const __m128 * ) srcB->m[1] );
+    __m256 b2 = _mm256_broadcast_ps( ( const __m128 * ) srcB->m[2] );
+    __m256 b3 = _mm256_broadcast_ps( ( const __m128 * ) srcB->m[3] );
+    int i;
+    
+    for( i = 0; i < count; i++ )
+    {
+        __m256 a01 = _mm256_loadu_ps( srcA[i].m[0] );
+        __m256 a23 = _mm256_loadu_ps( srcA[i].m[2] );
+        
+        _mm256_storeu_ps( result[i].m[0], ES_AVX2_ROWS( a01 ) );
+        _mm256_storeu_ps( result[i].m[2], ES_AVX2_ROWS( a23 ) );
+    }
+}
+#undef ES_AVX2_ROWS
+#endif // ES_MATRIX_AVX2
+
+#ifdef ES_MATRIX_NEON
+#if defined( __aarch64__ )
+#define ES_NEON_ROW( a ) \
+    vfmaq_laneq_f32( vfmaq_laneq_f32( vfmaq_laneq_f32( \
+        vmulq_laneq_f32( b0, a, 0 ), b1, a, 1 ), b2, a, 2 ), b3, a, 3 )
+#else
+#define ES_NEON_ROW( a ) \
+    vmlaq_lane_f32( vmlaq_lane_f32( vmlaq_lane_f32( \
+        vmulq_lane_f32( b0, vget_low_f32( a ), 0 ), b1, vget_low_f32( a ), 1 ), \
+        b2, vget_high_f32( a ), 0 ), b3, vget_high_f32( a ), 1 )
+#endif
+
+static void esMatrixMultiplyNEON( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB )
+{
+    float32x4_t b0 = vld1q_f32( srcB->m[0] );
+    float32x4_t b1 = vld1q_f32( srcB->m[1] );
+    float32x4_t b2 = vld1q_f32( srcB->m[2] );
+    float32x4_t b3 = vld1q_f32( srcB->m[3] );
+    float32x4_t a0 = vld1q_f32( srcA->m[0] );
+    float32x4_t a1 = vld1q_f32( srcA->m[1] );
+    float32x4_t a2 = vld1q_f32( srcA->m[2] );
+    float32x4_t a3 = vld1q_f32( srcA->m[3] );
+    
+    vst1q_f32( result->m[0], ES_NEON_ROW( a0 ) );
+    vst1q_f32( result->m[1], ES_NEON_ROW( a1 ) );
+    vst1q_f32( result->m[2], ES_NEON_ROW( a2 ) );
+    vst1q_f32( result->m[3], ES_NEON_ROW( a3 ) );
+}
+
+static void esMatrixMultiplyBatchNEON( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB, int count )
+{
+    float32x4_t b0 = vld1q_f32( srcB->m[0] );
+    float32x4_t b1 = vld1q_f32( srcB->m[1] );
+    float32x4_t b2 = vld1q_f32( srcB->m[2] );
+    float32x4_t b3 = vld1q_f32( srcB->m[3] );
+    int i;
+    
+    for( i = 0; i < count; i++ )
+    {
+        float32x4_t a0 = vld1q_f32( srcA[i].m[0] );
+        float32x4_t a1 = vld1q_f32( srcA[i].m[1] );
+        float32x4_t a2 = vld1q_f32( srcA[i].m[2] );
+        float32x4_t a3 = vld1q_f32( srcA[i].m[3] );
+        
+        vst1q_f32( result[i].m[0], ES_NEON_ROW( a0 ) );
+        vst1q_f32( result[i].m[1], ES_NEON_ROW( a1 ) );
+        vst1q_f32( result[i].m[2], ES_NEON_ROW( a2 ) );
+        vst1q_f32( result[i].m[3], ES_NEON_ROW( a3 ) );
+    }
+}
+#undef ES_NEON_ROW
+#endif // ES_MATRIX_NEON
+
+static void esMatrixMultiplyResolve( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB );
+static void esMatrixMultiplyBatchResolve( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB, int count );
+
+// Both pointers start at the resolvers, which pick a kernel on first use and patch themselves out
+static ESMatrixMultiplyFunc      matrixMultiplyImpl      = esMatrixMultiplyResolve;
+static ESMatrixMultiplyBatchFunc matrixMultiplyBatchImpl = esMatrixMultiplyBatchResolve;
+static const char               *matrixImplName          = NULL;
+
+static void esMatrixSelectImpl( void )
+{
+    ESMatrixMultiplyFunc      multiply      = esMatrixMultiplyScalar;
+    ESMatrixMultiplyBatchFunc multiplyBatch = esMatrixMultiplyBatchScalar;
+    const char               *name          = "scalar";
+    
+#if defined( ES_MATRIX_SSE )
+    multiply      = esMatrixMultiplySSE;
+    multiplyBatch = esMatrixMultiplyBatchSSE;
+    name          = "sse";
+#if defined( ES_MATRIX_AVX2 )
+    __builtin_cpu_init();
+    if( __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" ) )
+    {
+        multiply      = esMatrixMultiplyAVX2;
+        multiplyBatch = esMatrixMultiplyBatchAVX2;
+        name          = "avx2";
+    }
+#endif
+#elif defined( ES_MATRIX_NEON )
+    multiply      = esMatrixMultiplyNEON;
+    multiplyBatch = esMatrixMultiplyBatchNEON;
+    name          = "neon";
+#endif
+    
+    // Racing threads all store the same values, so no locking is needed
+    matrixMultiplyImpl      = multiply;
+    matrixMultiplyBatchImpl = multiplyBatch;
+    matrixImplName          = name;
+}
+
+static void esMatrixMultiplyResolve( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB )
+{
+    esMatrixSelectImpl();
+    matrixMultiplyImpl( result, srcA, srcB );
+}
+
+static void esMatrixMultiplyBatchResolve( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB, int count )
+{
+    esMatrixSelectImpl();
+    matrixMultiplyBatchImpl( result, srcA, srcB, count );
+}
+
+const char *ESUTIL_API
+esMatrixImplName( void )
+{
+    if( matrixImplName == NULL )
+    {
+        esMatrixSelectImpl();
+    }
+    
+    return matrixImplName;
+}
+
+void ESUTIL_API
+esScale( ESMatrix *result, GLfloat sx, GLfloat sy, GLfloat sz )
+{
+    int i;
+    
+    for( i = 0; i < 4; i++ )
+    {
+        result->m[0][i] *= sx;
+        result->m[1][i] *= sy;
+        result->m[2][i] *= sz;
+    }
+}
+
+void ESUTIL_API
+esTranslate( ESMatrix *result, GLfloat tx, GLfloat ty, GLfloat tz )
+{
+#if defined( ES_MATRIX_SSE )
+    __m128 row = _mm_add_ps( _mm_add_ps(
+                    _mm_mul_ps( _mm_loadu_ps( result->m[0] ), _mm_set1_ps( tx ) ),
+                    _mm_mul_ps( _mm_loadu_ps( result->m[1] ), _mm_set1_ps( ty ) ) ),
+                    _mm_mul_ps( _mm_loadu_ps( result->m[2] ), _mm_set1_ps( tz ) ) );
+    
+    _mm_storeu_ps( result->m[3], _mm_add_ps( _mm_loadu_ps( result->m[3] ), row ) );
+#elif defined( ES_MATRIX_NEON )
+    float32x4_t row = vmlaq_n_f32( vmlaq_n_f32(
+                        vmulq_n_f32( vld1q_f32( result->m[0] ), tx ),
+                        vld1q_f32( result->m[1] ), ty ),
+                        vld1q_f32( result->m[2] ), tz );
+    
+    vst1q_f32( result->m[3], vaddq_f32( vld1q_f32( result->m[3] ), row ) );
+#else
+    result->m[3][0] += ( result->m[0][0] * tx + result->m[1][0] * ty + result->m[2][0] * tz );
+    result->m[3][1] += ( result->m[0][1] * tx + result->m[1][1] * ty + result->m[2][1] * tz );
+    result->m[3][2] += ( result->m[0][2] * tx + result->m[1][2] * ty + result->m[2][2] * tz );
+    result->m[3][3] += ( result->m[0][3] * tx + result->m[1][3] * ty + result->m[2][3] * tz );
+#endif
+}
+
+void ESUTIL_API
+esMatrixMultiply( ESMatrix *result, ESMatrix *srcA, ESMatrix *srcB )
+{
+    matrixMultiplyImpl( result, srcA, srcB );
+}
+
+void ESUTIL_API
+esMatrixMultiplyBatch( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB, int count )
+{
+    if( count <= 0 )
+    {
+        return;
+    }
+    
+    matrixMultiplyBatchImpl( result, srcA, srcB, count );
+}
+
 void ESUTIL_API
 esFrustum( ESMatrix *result, float left, float right, float bottom, float top, float nearZ, float farZ )
 {
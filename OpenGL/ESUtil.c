@@ -5,47 +5,110 @@
 //  Created by 姚隽楠 on 2021/9/6.
 //  Copyright © 2021 姚隽楠. All rights reserved.
 //
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "ESUtil.h"
-
-typedef FILE esFile;
-
-#ifdef __APPLE__
-//#include "FileWrappter.h"
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <windows.h>
 #endif
+#include "ESUtil.h"
+#include "ESImage.h"
+#include "ESProfile.h"
 
-// Macros
-#define INVERTED_BIT ( 1 << 5 )
-
-// Types
 #ifndef __APPLE__
-#pragma pack(push,x1)
-#pragma pack(1)
+#ifndef ES_HEADLESS_ONLY
+// create the native window and fill in eglNativeDisplay/eglNativeWindow, provided by the platform layer
+GLboolean WinCreate( ESContext *esContext, const char *title );
+// handle pending window events, GL_FALSE once the window was closed
+GLboolean WinProcessEvents( ESContext *esContext );
 #endif
 
-typedef struct
-#ifdef __APPLE__
-__attribute__ ( ( packed ))
-#endif
+// HasExtension()
+static GLboolean HasExtension( const char *extensions, const char *name )
 {
-    unsigned char IdSize,
-                MapType,
-                ImageType;
+    size_t length = strlen( name );
     
-    unsigned short PaletteStart,
-                PaletteSize;
-    unsigned char PaletteEntryDepth;
-    unsigned short X,Y,Width,Height;
-    unsigned char ColorDepth,Descriptor;
-} TGA_HEADER;
+    // match whole names only, some are prefixes of others
+    while( extensions != NULL && ( extensions = strstr( extensions, name ) ) != NULL )
+    {
+        if( extensions[length] == ' ' || extensions[length] == '\0' )
+        {
+            return GL_TRUE;
+        }
+        
+        extensions += length;
+    }
+    
+    return GL_FALSE;
+}
 
-#ifndef __APPLE__
-#pramga pack(pop,x1)
+// GetHeadlessDisplay()
+static EGLDisplay GetHeadlessDisplay( void )
+{
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLint majorVersion;
+    EGLint minorVersion;
+
+#ifdef EGL_MESA_platform_surfaceless
+    // no window system at all, works on a box without X, Wayland or a GPU ( llvmpipe )
+    if( HasExtension( eglQueryString( EGL_NO_DISPLAY, EGL_EXTENSIONS ), "EGL_MESA_platform_surfaceless" ) )
+    {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            ( PFNEGLGETPLATFORMDISPLAYEXTPROC ) eglGetProcAddress( "eglGetPlatformDisplayEXT" );
+        
+        if( getPlatformDisplay != NULL )
+        {
+            display = getPlatformDisplay( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL );
+        }
+        
+        if( display != EGL_NO_DISPLAY && eglInitialize( display, &majorVersion, &minorVersion ) )
+        {
+            return display;
+        }
+    }
 #endif
+    
+    // the default display still has pbuffers on most drivers
+    display = eglGetDisplay( EGL_DEFAULT_DISPLAY );
+    
+    if( display != EGL_NO_DISPLAY && eglInitialize( display, &majorVersion, &minorVersion ) )
+    {
+        return display;
+    }
+    
+    return EGL_NO_DISPLAY;
+}
+
+// CreateOffscreenFramebuffer()
+static GLboolean CreateOffscreenFramebuffer( ESContext *esContext )
+{
+    glGenRenderbuffers( 2, esContext->offscreenRenderbuffers );
+    glBindRenderbuffer( GL_RENDERBUFFER, esContext->offscreenRenderbuffers[0] );
+    glRenderbufferStorage( GL_RENDERBUFFER, GL_RGBA8, esContext->width, esContext->height );
+    glBindRenderbuffer( GL_RENDERBUFFER, esContext->offscreenRenderbuffers[1] );
+    glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, esContext->width, esContext->height );
+    glBindRenderbuffer( GL_RENDERBUFFER, 0 );
+    
+    glGenFramebuffers( 1, &esContext->offscreenFramebuffer );
+    glBindFramebuffer( GL_FRAMEBUFFER, esContext->offscreenFramebuffer );
+    glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                               esContext->offscreenRenderbuffers[0] );
+    glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER,
+                               esContext->offscreenRenderbuffers[1] );
+    glViewport( 0, 0, esContext->width, esContext->height );
+    
+    return glCheckFramebufferStatus( GL_FRAMEBUFFER ) == GL_FRAMEBUFFER_COMPLETE;
+}
 
-#ifndef __APPLE__
 // GetContextRenderableType()
 EGLint GetContextRenderableType( EGLDisplay eglDisplay )
 {
@@ -71,8 +134,7 @@ GLboolean ESUTIL_API esCreateWindow( ESContext *esContext, const char *title, GL
     
 #ifndef __APPLE__
     EGLConfig config;
-    EGLint majorVersion;
-    EGLint minorVersion;
+    GLboolean surfaceless = GL_FALSE;
     EGLint contextAtrribs[] = {
         EGL_CONTEXT_CLIENT_VERSION, 3,
         EGL_NONE
@@ -93,21 +155,42 @@ GLboolean ESUTIL_API esCreateWindow( ESContext *esContext, const char *title, GL
     esContext->height = height;
 #endif
     
-    if( !WinCreate( esContext, title ))
-    {
-        return GL_FALSE;
-    }
-    
-    esContext->eglDisplay = eglGetDisplay( esContext->eglNativeDisplay );
-    if( esContext->eglDisplay == EGL_NO_DISPLAY )
+    if( flags & ES_WINDOW_HEADLESS )
     {
-        return GL_FALSE;
+        esContext->eglNativeDisplay = EGL_DEFAULT_DISPLAY;
+        esContext->eglNativeWindow  = 0;
+        esContext->eglDisplay = GetHeadlessDisplay();
+        if( esContext->eglDisplay == EGL_NO_DISPLAY )
+        {
+            return GL_FALSE;
+        }
     }
-    
-    // Initialize EGL
-    if( !eglInitialize( esContext->eglDisplay, &majorVersion ) )
+    else
     {
+#ifdef ES_HEADLESS_ONLY
+        esLogMessage( "esCreateWindow: built without a window system, use ES_WINDOW_HEADLESS\n" );
         return GL_FALSE;
+#else
+        EGLint majorVersion;
+        EGLint minorVersion;
+        
+        if( !WinCreate( esContext, title ))
+        {
+            return GL_FALSE;
+        }
+        
+        esContext->eglDisplay = eglGetDisplay( esContext->eglNativeDisplay );
+        if( esContext->eglDisplay == EGL_NO_DISPLAY )
+        {
+            return GL_FALSE;
+        }
+        
+        // Initialize EGL
+        if( !eglInitialize( esContext->eglDisplay, &majorVersion, &minorVersion ) )
+        {
+            return GL_FALSE;
+        }
+#endif
     }
     
     {
@@ -122,6 +205,7 @@ GLboolean ESUTIL_API esCreateWindow( ESContext *esContext, const char *title, GL
             EGL_STENCIL_SIZE, ( flags & ES_WINDOW_STENCIL ) ? 8 : EGL_DONT_CARE,
             EGL_SAMPLE_BUFFERS, ( flags & ES_WINDOW_MUTISAMPLE ) ? 1 : 0,
             EGL_RENDERABLE_TYPE, GetContextRenderableType( esContext->eglDisplay ),
+            EGL_SURFACE_TYPE, ( flags & ES_WINDOW_HEADLESS ) ? EGL_PBUFFER_BIT : EGL_WINDOW_BIT,
             EGL_NONE
         };
     
@@ -132,6 +216,29 @@ GLboolean ESUTIL_API esCreateWindow( ESContext *esContext, const char *title, GL
             return GL_FALSE;
         }
         
+        // No pbuffer configs, a surfaceless context can still render into a framebuffer object
+        if( numConfigs < 1 && ( flags & ES_WINDOW_HEADLESS ) &&
+            HasExtension( eglQueryString( esContext->eglDisplay, EGL_EXTENSIONS ), "EGL_KHR_surfaceless_context" ) )
+        {
+            int i;
+            
+            // any surface type will do, find its value by key rather than by position
+            for( i = 0; attribList[i] != EGL_NONE; i += 2 )
+            {
+                if( attribList[i] == EGL_SURFACE_TYPE )
+                {
+                    attribList[i + 1] = 0;
+                }
+            }
+            
+            if( !eglChooseConfig( esContext->eglDisplay, attribList, &config, 1, &numConfigs ) )
+            {
+                return GL_FALSE;
+            }
+            
+            surfaceless = GL_TRUE;
+        }
+        
         if( numConfigs < 1 ){
             return GL_FALSE;
         }
@@ -150,15 +257,41 @@ GLboolean ESUTIL_API esCreateWindow( ESContext *esContext, const char *title, GL
 #endif // Android
     
     // create a surface
-    esContext->eglSurface = eglCreateWindowSurface(
-                                             esContext->eglDisplay, config, esContext->eglNativeWindow, NULL );
+    esContext->offscreenFramebuffer = 0;
     
-    if( esContext->eglSurface == EGL_NO_SURFACE )
+    if( surfaceless )
     {
-        return GL_FALSE;
+        esContext->eglSurface = EGL_NO_SURFACE;
+    }
+    else if( flags & ES_WINDOW_HEADLESS )
+    {
+        EGLint pbufferAttribs[] =
+        {
+            EGL_WIDTH,  width,
+            EGL_HEIGHT, height,
+            EGL_NONE
+        };
+        
+        esContext->eglSurface = eglCreatePbufferSurface( esContext->eglDisplay, config, pbufferAttribs );
+        
+        if( esContext->eglSurface == EGL_NO_SURFACE )
+        {
+            return GL_FALSE;
+        }
+    }
+    else
+    {
+        esContext->eglSurface = eglCreateWindowSurface(
+                                                 esContext->eglDisplay, config, esContext->eglNativeWindow, NULL );
+        
+        if( esContext->eglSurface == EGL_NO_SURFACE )
+        {
+            return GL_FALSE;
+        }
     }
     
     // create a GL context
+    eglBindAPI( EGL_OPENGL_ES_API );
     esContext->eglContext = eglCreateContext(
                                              esContext->eglDisplay, config,
                                                 EGL_NO_CONTEXT,
@@ -178,6 +311,12 @@ GLboolean ESUTIL_API esCreateWindow( ESContext *esContext, const char *title, GL
     {
             return GL_FALSE;
     }
+    
+    // Without a surface there is no default framebuffer, draw into one of our own instead
+    if( surfaceless && !CreateOffscreenFramebuffer( esContext ) )
+    {
+        return GL_FALSE;
+    }
 #endif // #ifndef __APPLE__
     
     return GL_TRUE;
@@ -207,117 +346,672 @@ void ESUTIL_API esRegisterKeyFunc( ESContext *esContext, void( ESCALLBACK *keyFu
     esContext->keyFunc = keyFunc;
 }
 
-//esLogMsg()
-void ESUTIL_API esLogMessage( const char *formatStr, ... )
+// frames slower than this count as this long, so a stall doesn't turn into a burst of catch-up updates
+#define ES_MAX_FRAME_DELTA_NS     250000000ULL
+// simulation step of esRunFrames without a fixed timestep
+#define ES_DETERMINISTIC_STEP_NS  16666667ULL
+// esMainLoop sleeps until this close to the end of a paced frame and spins the rest,
+// sleeps overshoot by up to a scheduler tick
+#define ES_SPIN_NS                1000000ULL
+// polls before a pipeline wait blocks, a frame handed over right away is picked up without sleeping
+#define ES_PIPELINE_SPINS         64
+
+// SleepNs()
+static void SleepNs( unsigned long long ns )
 {
-    va_list params;
-    char buf[ BUFSIZ ];
+#ifdef _WIN32
+    Sleep( ( DWORD ) ( ns / 1000000ULL ) );
+#else
+    struct timespec ts;
     
-    //va_start ( params, formatStr );
-    vsprintf( buf, formatStr, params );
+    ts.tv_sec  = ( time_t ) ( ns / 1000000000ULL );
+    ts.tv_nsec = ( long ) ( ns % 1000000000ULL );
+    nanosleep( &ts, NULL );
+#endif
+}
+
+// RecordFrameTime()
+static void RecordFrameTime( ESContext *esContext, unsigned long long ns )
+{
+    if( esContext->frameCount == 0 || ns < esContext->frameMinNs )
+    {
+        esContext->frameMinNs = ns;
+    }
     
-//#ifndef ANDROID
-    //__android_log_print( ANDROID_LOG_INFO, "esUtil", "%s", buf);
-//#else
-    printf("%s",buf);
-//#endif
-    //va_end( params );
+    if( ns > esContext->frameMaxNs )
+    {
+        esContext->frameMaxNs = ns;
+    }
+    
+    esContext->frameTotalNs += ns;
+    esContext->frameHistoryNs[esContext->frameCount % ES_FRAME_HISTORY] =
+        ns > 0xffffffffULL ? 0xffffffffU : ( unsigned int ) ns;
+    esContext->frameCount++;
+}
+
+struct ESPipeline
+{
+    // updateFunc runs on updateThread
+    GLboolean          threaded;
+    void              *snapshots[2];
+    size_t             snapshotSize;
+    float              interpolation[2];
+    // frames the update side finished and the draw side released, they never
+    // differ by more than the two snapshots. Only their owner thread writes them
+    unsigned int       simulated;
+    unsigned int       drawn;
+    // frame each side is working on, picks its snapshot
+    unsigned int       updateFrame;
+    unsigned int       drawFrame;
+    // draw side left the loop / update thread ran out of frames
+    int                quit;
+    int                updateDone;
+    pthread_t          updateThread;
+    // a side that spun out sleeps here until the other one publishes, only exist while the thread runs
+    pthread_mutex_t    waitLock;
+    pthread_cond_t     waitCond;
+};
+
+// Update side of a running loop, on whichever thread that is
+typedef struct
+{
+    ESContext         *esContext;
+    int                maxFrames;
+    GLboolean          deterministic;
+    unsigned long long stepNs;
+    unsigned long long accumulator;
+    unsigned long long last;
+} ESLoopUpdate;
+
+// UpdateFrame()
+static float UpdateFrame( ESLoopUpdate *loop, unsigned int frame )
+{
+    ESContext *esContext = loop->esContext;
+    ESPipeline *pipeline = esContext->pipeline;
+    unsigned long long now = esGetTimeNs();
+    unsigned long long delta;
+    
+    if( loop->deterministic )
+    {
+        delta = loop->stepNs ? loop->stepNs : ES_DETERMINISTIC_STEP_NS;
+    }
+    else
+    {
+        delta = now - loop->last;
+        delta = delta < ES_MAX_FRAME_DELTA_NS ? delta : ES_MAX_FRAME_DELTA_NS;
+    }
+    
+    loop->last = now;
+    
+    if( pipeline != NULL && pipeline->snapshotSize != 0 )
+    {
+        // updateFunc only has to write what changed
+        memcpy( pipeline->snapshots[frame & 1], pipeline->snapshots[( frame - 1 ) & 1], pipeline->snapshotSize );
+        pipeline->updateFrame = frame;
+    }
+    
+    if( loop->stepNs == 0 )
+    {
+        if( esContext->updateFunc != NULL )
+        {
+            ES_PROFILE_ZONE( "updateFunc" );
+            
+            esContext->updateFunc( esContext, ( float ) ( delta * 1e-9 ) );
+        }
+        
+        return 1.0f;
+    }
+    
+    // Consume real time in whole steps, the remainder carries over to the next frame
+    for( loop->accumulator += delta; loop->accumulator >= loop->stepNs; loop->accumulator -= loop->stepNs )
+    {
+        if( esContext->updateFunc != NULL )
+        {
+            ES_PROFILE_ZONE( "updateFunc" );
+            
+            esContext->updateFunc( esContext, esContext->fixedTimestep );
+        }
+    }
+    
+    return ( float ) loop->accumulator / ( float ) loop->stepNs;
+}
+
+// PipelineSignal()
+static void PipelineSignal( ESPipeline *pipeline )
+{
+    pthread_mutex_lock( &pipeline->waitLock );
+    pthread_cond_broadcast( &pipeline->waitCond );
+    pthread_mutex_unlock( &pipeline->waitLock );
+}
+
+// SnapshotBusy()
+static int SnapshotBusy( ESPipeline *pipeline, unsigned int frame )
+{
+    // The snapshot is free once frame - 2 was drawn
+    return frame - __atomic_load_n( &pipeline->drawn, __ATOMIC_ACQUIRE ) >= 2 &&
+           !__atomic_load_n( &pipeline->quit, __ATOMIC_ACQUIRE );
+}
+
+// UpdatePending()
+static int UpdatePending( ESPipeline *pipeline, unsigned int frame )
+{
+    return __atomic_load_n( &pipeline->simulated, __ATOMIC_ACQUIRE ) == frame &&
+           !__atomic_load_n( &pipeline->updateDone, __ATOMIC_ACQUIRE );
+}
+
+// UpdateThread()
+static void *UpdateThread( void *arg )
+{
+    ESLoopUpdate *loop = arg;
+    ESPipeline *pipeline = loop->esContext->pipeline;
+    int frames;
+    int spins;
+    
+    esProfileSetThreadName( "update" );
+    
+    for( frames = 0; loop->maxFrames < 0 || frames < loop->maxFrames; frames++ )
+    {
+        unsigned int frame = pipeline->simulated;
+        
+        for( spins = 0; spins < ES_PIPELINE_SPINS && SnapshotBusy( pipeline, frame ); spins++ )
+        {
+            sched_yield();
+        }
+        
+        // Paced by esSetMaxFrameRate the draw side sleeps most of every frame, block instead of spinning along
+        if( SnapshotBusy( pipeline, frame ) )
+        {
+            pthread_mutex_lock( &pipeline->waitLock );
+            while( SnapshotBusy( pipeline, frame ) )
+            {
+                pthread_cond_wait( &pipeline->waitCond, &pipeline->waitLock );
+            }
+            pthread_mutex_unlock( &pipeline->waitLock );
+        }
+        
+        if( __atomic_load_n( &pipeline->quit, __ATOMIC_ACQUIRE ) ||
+            __atomic_load_n( &loop->esContext->stopLoop, __ATOMIC_RELAXED ) )
+        {
+            break;
+        }
+        
+        pipeline->interpolation[frame & 1] = UpdateFrame( loop, frame );
+        __atomic_store_n( &pipeline->simulated, frame + 1, __ATOMIC_RELEASE );
+        PipelineSignal( pipeline );
+    }
+    
+    __atomic_store_n( &pipeline->updateDone, 1, __ATOMIC_RELEASE );
+    PipelineSignal( pipeline );
+    return NULL;
+}
+
+// WaitForUpdate()
+static GLboolean WaitForUpdate( ESPipeline *pipeline, unsigned int frame )
+{
+    int spins;
+    
+    ES_PROFILE_ZONE( "wait for update" );
+    
+    for( spins = 0; spins < ES_PIPELINE_SPINS && UpdatePending( pipeline, frame ); spins++ )
+    {
+        sched_yield();
+    }
+    
+    if( UpdatePending( pipeline, frame ) )
+    {
+        pthread_mutex_lock( &pipeline->waitLock );
+        while( UpdatePending( pipeline, frame ) )
+        {
+            pthread_cond_wait( &pipeline->waitCond, &pipeline->waitLock );
+        }
+        pthread_mutex_unlock( &pipeline->waitLock );
+    }
+    
+    // the last frame may have been published right before the thread finished
+    return __atomic_load_n( &pipeline->simulated, __ATOMIC_ACQUIRE ) != frame;
 }
 
-// esFileRead()
-static esFile *esFileOpen( void *ioContext, const char *fileName )
+// RunLoop()
+static int RunLoop( ESContext *esContext, int maxFrames, GLboolean deterministic )
 {
-    esFile *pFile = NULL;
+    ESPipeline *pipeline = esContext->pipeline;
+    ESLoopUpdate loop;
+    GLboolean threaded = GL_FALSE;
+    unsigned long long periodNs = !deterministic && esContext->maxFrameRate > 0.0f ?
+                                  ( unsigned long long ) ( 1e9 / esContext->maxFrameRate ) : 0;
+    unsigned long long deadline;
+    int frames = 0;
+    
+    loop.esContext     = esContext;
+    loop.maxFrames     = maxFrames;
+    loop.deterministic = deterministic;
+    loop.stepNs        = esContext->fixedTimestep > 0.0f ?
+                         ( unsigned long long ) ( esContext->fixedTimestep * 1e9 ) : 0;
+    loop.accumulator   = 0;
+    loop.last          = esGetTimeNs();
+    deadline           = loop.last + periodNs;
     
-/*#ifndef ANDROID
-    if( ioContext != NULL )
+    esContext->stopLoop     = GL_FALSE;
+    esContext->frameCount   = 0;
+    esContext->frameTotalNs = 0;
+    esContext->frameMinNs   = 0;
+    esContext->frameMaxNs   = 0;
+    
+    if( pipeline != NULL && pipeline->threaded )
     {
-        AAssetManager *assetManager = ( AAssetManager * ) ioContext;
-        pFile = AAssetManager_open( assetManager, fileName, AASSET_MODE_BUFFER );
+        pipeline->quit       = 0;
+        pipeline->updateDone = 0;
+        pthread_mutex_init( &pipeline->waitLock, NULL );
+        pthread_cond_init( &pipeline->waitCond, NULL );
+        // runs single threaded when there is no thread to be had
+        threaded = pthread_create( &pipeline->updateThread, NULL, UpdateThread, &loop ) == 0;
+        
+        if( !threaded )
+        {
+            pthread_cond_destroy( &pipeline->waitCond );
+            pthread_mutex_destroy( &pipeline->waitLock );
+        }
     }
-#else*/
+    
+    while( ( maxFrames < 0 || frames < maxFrames ) && !__atomic_load_n( &esContext->stopLoop, __ATOMIC_RELAXED ) )
+    {
+        unsigned long long frameStart = esGetTimeNs();
+        unsigned int frame = pipeline != NULL ? pipeline->drawn : 0;
+
+#if !defined( __APPLE__ ) && !defined( ES_HEADLESS_ONLY )
+        if( esContext->eglNativeWindow != 0 && !WinProcessEvents( esContext ) )
+        {
+            break;
+        }
+#endif
+        
+        if( threaded )
+        {
+            if( !WaitForUpdate( pipeline, frame ) )
+            {
+                break;
+            }
+            
+            esContext->interpolation = pipeline->interpolation[frame & 1];
+        }
+        else if( pipeline != NULL && pipeline->simulated != frame )
+        {
+            // simulated ahead by the update thread of an earlier run
+            esContext->interpolation = pipeline->interpolation[frame & 1];
+        }
+        else
+        {
+            esContext->interpolation = UpdateFrame( &loop, frame );
+            
+            if( pipeline != NULL )
+            {
+                pipeline->simulated = frame + 1;
+            }
+        }
+        
+        if( pipeline != NULL )
+        {
+            pipeline->drawFrame = frame;
+        }
+        
+        if( esContext->drawFunc != NULL )
+        {
+            ES_PROFILE_ZONE( "drawFunc" );
+            
+            esContext->drawFunc( esContext );
+        }
+        
+        // GL has copied whatever it needed, the update side can reuse the snapshot
+        if( pipeline != NULL )
+        {
+            __atomic_store_n( &pipeline->drawn, frame + 1, __ATOMIC_RELEASE );
+            
+            if( threaded )
+            {
+                PipelineSignal( pipeline );
+            }
+        }
+
 #ifndef __APPLE__
-    fileName = GetBundleFilename( fileName );
+        if( esContext->eglSurface != EGL_NO_SURFACE )
+        {
+            ES_PROFILE_ZONE( "eglSwapBuffers" );
+            
+            eglSwapBuffers( esContext->eglDisplay, esContext->eglSurface );
+        }
+        else
+        {
+            glFlush();
+        }
 #endif
-    pFile = fopen(fileName, "rb");
-//#endif
+
+#ifdef ES_GL_TRACE
+        esGLEndFrame();
+#endif
+        
+        if( periodNs != 0 )
+        {
+            unsigned long long now = esGetTimeNs();
+            
+            ES_PROFILE_ZONE( "frame pacing" );
+            
+            if( now + ES_SPIN_NS < deadline )
+            {
+                SleepNs( deadline - now - ES_SPIN_NS );
+            }
+            
+            while( esGetTimeNs() < deadline )
+            {
+            }
+            
+            // More than a frame late, start over from here instead of rushing the next ones
+            deadline = now > deadline ? now + periodNs : deadline + periodNs;
+        }
+        
+        RecordFrameTime( esContext, esGetTimeNs() - frameStart );
+        frames++;
+    }
+    
+    if( threaded )
+    {
+        // A frame the update thread already simulated is drawn first by the next run
+        __atomic_store_n( &pipeline->quit, 1, __ATOMIC_RELEASE );
+        PipelineSignal( pipeline );
+        pthread_join( pipeline->updateThread, NULL );
+        pthread_cond_destroy( &pipeline->waitCond );
+        pthread_mutex_destroy( &pipeline->waitLock );
+    }
     
-    return pFile;
+    return frames;
+}
+
+// esSetFixedTimestep()
+void ESUTIL_API esSetFixedTimestep( ESContext *esContext, float step )
+{
+    esContext->fixedTimestep = step > 0.0f ? step : 0.0f;
+}
+
+// esSetMaxFrameRate()
+void ESUTIL_API esSetMaxFrameRate( ESContext *esContext, float framesPerSecond )
+{
+    esContext->maxFrameRate = framesPerSecond > 0.0f ? framesPerSecond : 0.0f;
+}
+
+// esMainLoop()
+int ESUTIL_API esMainLoop( ESContext *esContext )
+{
+    return RunLoop( esContext, -1, GL_FALSE );
+}
+
+// esRunFrames()
+int ESUTIL_API esRunFrames( ESContext *esContext, int numFrames )
+{
+    return RunLoop( esContext, numFrames, GL_TRUE );
+}
+
+// esStopMainLoop()
+void ESUTIL_API esStopMainLoop( ESContext *esContext )
+{
+    esContext->stopLoop = GL_TRUE;
 }
 
-// esFileClose
-static void esFileClose( esFile *pFile )
+// GetPipeline()
+static ESPipeline *GetPipeline( ESContext *esContext )
 {
-    if( pFile != NULL )
+    if( esContext->pipeline == NULL )
     {
-#ifdef ANDROID
-        AAsset_close( pFile );
-#else
-        fclose( pFile );
-        pFile = NULL;
-#endif
+        esContext->pipeline = calloc( 1, sizeof( ESPipeline ) );
     }
+    
+    return esContext->pipeline;
 }
 
-// esFileRead()
-static int esFileRead ( esFile *pFile, int bytesToRead, void * buffer  )
+// ReleasePipeline()
+static void ReleasePipeline( ESContext *esContext )
 {
-    int bytesRead = 0;
+    ESPipeline *pipeline = esContext->pipeline;
+    
+    if( pipeline != NULL && !pipeline->threaded && pipeline->snapshotSize == 0 )
+    {
+        free( pipeline );
+        esContext->pipeline = NULL;
+    }
+}
+
+// esSetSnapshotSize()
+GLboolean ESUTIL_API esSetSnapshotSize( ESContext *esContext, size_t size )
+{
+    ESPipeline *pipeline = GetPipeline( esContext );
+    void *snapshots[2] = { NULL, NULL };
+    
+    if( pipeline == NULL )
+    {
+        return GL_FALSE;
+    }
     
-    if( pFile == NULL )
+    if( size != 0 )
     {
-        return bytesRead;
+        snapshots[0] = calloc( 1, size );
+        snapshots[1] = calloc( 1, size );
+        
+        if( snapshots[0] == NULL || snapshots[1] == NULL )
+        {
+            free( snapshots[0] );
+            free( snapshots[1] );
+            ReleasePipeline( esContext );
+            return GL_FALSE;
+        }
     }
     
+    free( pipeline->snapshots[0] );
+    free( pipeline->snapshots[1] );
+    pipeline->snapshots[0] = snapshots[0];
+    pipeline->snapshots[1] = snapshots[1];
+    pipeline->snapshotSize = size;
+    
+    ReleasePipeline( esContext );
+    return GL_TRUE;
+}
+
+// esSetPipelined()
+GLboolean ESUTIL_API esSetPipelined( ESContext *esContext, GLboolean pipelined )
+{
+    ESPipeline *pipeline = GetPipeline( esContext );
+    
+    if( pipeline == NULL )
+    {
+        return GL_FALSE;
+    }
+    
+    pipeline->threaded = pipelined ? GL_TRUE : GL_FALSE;
+    
+    ReleasePipeline( esContext );
+    return GL_TRUE;
+}
+
+// esUpdateSnapshot()
+void *ESUTIL_API esUpdateSnapshot( ESContext *esContext )
+{
+    ESPipeline *pipeline = esContext->pipeline;
+    
+    return pipeline != NULL ? pipeline->snapshots[pipeline->updateFrame & 1] : NULL;
+}
+
+// esDrawSnapshot()
+const void *ESUTIL_API esDrawSnapshot( ESContext *esContext )
+{
+    ESPipeline *pipeline = esContext->pipeline;
+    
+    return pipeline != NULL ? pipeline->snapshots[pipeline->drawFrame & 1] : NULL;
+}
+
+// CompareFrameTimes()
+static int CompareFrameTimes( const void *a, const void *b )
+{
+    unsigned int x = *( const unsigned int * ) a;
+    unsigned int y = *( const unsigned int * ) b;
+    
+    return ( x > y ) - ( x < y );
+}
+
+// esGetFrameStats()
+void ESUTIL_API esGetFrameStats( const ESContext *esContext, ESFrameStats *stats )
+{
+    unsigned int sorted[ES_FRAME_HISTORY];
+    int count = esContext->frameCount < ES_FRAME_HISTORY ? ( int ) esContext->frameCount : ES_FRAME_HISTORY;
+    
+    memset( stats, 0, sizeof( ESFrameStats ) );
+    
+    if( count == 0 )
+    {
+        return;
+    }
+    
+    memcpy( sorted, esContext->frameHistoryNs, sizeof( unsigned int ) * count );
+    qsort( sorted, count, sizeof( unsigned int ), CompareFrameTimes );
+    
+    stats->frames = esContext->frameCount;
+    stats->minMs  = esContext->frameMinNs * 1e-6;
+    stats->avgMs  = ( double ) esContext->frameTotalNs / esContext->frameCount * 1e-6;
+    stats->maxMs  = esContext->frameMaxNs * 1e-6;
+    // nearest rank
+    stats->p50Ms  = sorted[( count * 50 + 99 ) / 100 - 1] * 1e-6;
+    stats->p99Ms  = sorted[( count * 99 + 99 ) / 100 - 1] * 1e-6;
+}
+
+//esLogMsg()
+void ESUTIL_API esLogMessage( const char *formatStr, ... )
+{
+    va_list params;
+    char buf[ BUFSIZ ];
+    
+    va_start( params, formatStr );
+    vsnprintf( buf, sizeof( buf ), formatStr, params );
+    va_end( params );
+    
 //#ifndef ANDROID
-    //bytesRead = AAsset_read( pFile, buffer, bytesToRead );
+    //__android_log_print( ANDROID_LOG_INFO, "esUtil", "%s", buf);
 //#else
-    bytesToRead = fread( buffer, bytesToRead, 1, pFile);
+    printf("%s",buf);
 //#endif
+}
+
+// esGetTimeNs()
+unsigned long long ESUTIL_API esGetTimeNs( void )
+{
+    struct timespec ts;
+    
+    // monotonic, unaffected by wall clock changes
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    
+    return ( unsigned long long ) ts.tv_sec * 1000000000ULL + ( unsigned long long ) ts.tv_nsec;
+}
+
+// esMapFile()
+const unsigned char *ESUTIL_API esMapFile( const char *fileName, size_t *size )
+{
+#ifdef _WIN32
+    // no mmap, fall back to reading the whole file once
+    unsigned char *data = NULL;
+    FILE *fp = fopen( fileName, "rb" );
+    long length;
+    
+    if( fp == NULL )
+    {
+        return NULL;
+    }
     
-    return bytesRead;
+    if( fseek( fp, 0, SEEK_END ) == 0 && ( length = ftell( fp ) ) > 0 && fseek( fp, 0, SEEK_SET ) == 0 )
+    {
+        data = malloc( length );
+        
+        if( data != NULL && fread( data, length, 1, fp ) != 1 )
+        {
+            free( data );
+            data = NULL;
+        }
+        
+        *size = length;
+    }
+    
+    fclose( fp );
+    return data;
+#else
+    struct stat st;
+    void *data;
+    int fd = open( fileName, O_RDONLY );
+    
+    if( fd < 0 )
+    {
+        return NULL;
+    }
+    
+    if( fstat( fd, &st ) != 0 || st.st_size <= 0 )
+    {
+        close( fd );
+        return NULL;
+    }
+    
+    data = mmap( NULL, ( size_t ) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    // the mapping keeps its own reference to the file
+    close( fd );
+    
+    if( data == MAP_FAILED )
+    {
+        return NULL;
+    }
+    
+    // callers read the whole file right away
+    madvise( data, ( size_t ) st.st_size, MADV_WILLNEED );
+    
+    *size = ( size_t ) st.st_size;
+    return data;
+#endif
+}
+
+// esUnmapFile()
+void ESUTIL_API esUnmapFile( const unsigned char *data, size_t size )
+{
+#ifdef _WIN32
+    ( void ) size;
+    free( ( void * ) data );
+#else
+    munmap( ( void * ) data, size );
+#endif
 }
 
 // esLoadTGA()
 char *ESUTIL_API esLoadTGA( void *ioContext, const char *fileName, int *width, int *height )
 {
     char *buffer;
-    esFile *fp;
-    TGA_HEADER Header;
-    int bytesRead;
+    ESImage image;
     
-    // Open the file for reading
-    fp = esFileOpen( ioContext, fileName );
+    ES_PROFILE_ZONE( "esLoadTGA" );
     
-    if( fp == NULL )
+    ( void ) ioContext;
+    
+    if( !esImageOpenTGA( &image, fileName ) )
     {
         esLogMessage( " esLoadTGA FAILED to load : { %s }\n ", fileName );
         return NULL;
     }
     
-    bytesRead = esFileRead( fp, sizeof( TGA_HEADER ), &Header );
+    *width = image.width;
+    *height = image.height;
     
-    *width = Header.Width;
-    *height = Header.Height;
+    // Allocate the img data buffer and decode straight into it
+    buffer = ( char * ) malloc( esImageDecodedSize( &image ) );
     
-    if( Header.ColorDepth == 8 ||
-       Header.ColorDepth == 24 || Header.ColorDepth == 32 )
+    if( buffer != NULL && !esImageDecode( &image, buffer ) )
     {
-        int bytesToRead = sizeof( char ) * ( *width ) * ( *height ) * Header.ColorDepth / 8;
-        
-        // Allocate the img data buffer
-        buffer = ( char * ) malloc( bytesToRead );
-        
-        if( buffer )
-        {
-            bytesToRead = esFileRead( fp, bytesToRead, buffer );
-            esFileClose( fp );
-            
-            return ( buffer );
-        }
+        esLogMessage( " esLoadTGA FAILED to decode : { %s }\n ", fileName );
+        free( buffer );
+        buffer = NULL;
     }
     
-    return ( NULL );
+    esImageClose( &image );
+    
+    return buffer;
 }
 
 
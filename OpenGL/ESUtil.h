@@ -42,6 +42,9 @@ extern "C"{
 #define ES_WINDOW_STENCIL    4
 // esCreateWindow flag - multi-sample buffer
 #define ES_WINDOW_MUTISAMPLE 8
+// esCreateWindow flag - no native window, render offscreen into a pbuffer. Uses the
+// EGL_MESA_platform_surfaceless display when there is one, so it runs without X or a GPU
+#define ES_WINDOW_HEADLESS   16
 
 // Types
 #ifdef FALSE
@@ -56,7 +59,69 @@ typedef struct
     GLfloat m[4][4];
 } ESMatrix;
 
+typedef struct
+{
+    // programs restored from a cached binary
+    unsigned int hits;
+    // programs built from source while the cache was enabled
+    unsigned int misses;
+    // cached binaries the driver refused, e.g. after a driver update
+    unsigned int rejected;
+    // binaries written to the cache
+    unsigned int stores;
+    // time spent compiling and linking from source, in milliseconds
+    double compileMs;
+    // time spent restoring cached binaries, in milliseconds
+    double loadMs;
+} ESProgramCacheStats;
+
+// esProgramPoll status - still compiling/linking
+#define ES_PROGRAM_PENDING   0
+// esProgramPoll status - linked, programObject is usable
+#define ES_PROGRAM_READY     1
+// esProgramPoll status - compile or link failed, errors were logged
+#define ES_PROGRAM_FAILED    2
+
+typedef struct
+{
+    GLuint programObject;
+    GLuint vertexShader;
+    GLuint fragmentShader;
+    GLint  status;
+    unsigned long long cacheKey;
+} ESProgramFuture;
+
+// Destination of the esGen*Vertices/esGen*Into shape generators, e.g. a mapped VBO.
+// Any stream may be NULL, strides are in bytes and 0 means tightly packed
+typedef struct
+{
+    GLfloat *positions;
+    GLsizei  positionStride;
+    GLfloat *normals;
+    GLsizei  normalStride;
+    GLfloat *texCoords;
+    GLsizei  texCoordStride;
+} ESShapeStreams;
+
+// frames esGetFrameStats keeps for its percentiles
+#define ES_FRAME_HISTORY     1024
+
+typedef struct
+{
+    // frames run by the last esMainLoop/esRunFrames call
+    unsigned long long frames;
+    // frame times in milliseconds, from the start of a frame to the start of the next
+    double minMs;
+    double avgMs;
+    double maxMs;
+    // percentiles over the last ES_FRAME_HISTORY frames
+    double p50Ms;
+    double p99Ms;
+} ESFrameStats;
+
 typedef struct ESContext ESContext;
+// update/draw handoff state of the frame loop, see esSetPipelined
+typedef struct ESPipeline ESPipeline;
 
 struct ESContext
 {
@@ -80,9 +145,13 @@ struct ESContext
     // EGL display
     EGLDisplay eglDisplay;
     // EGL context
-    EGLContext elgContext;
-    // EGL surface
+    EGLContext eglContext;
+    // EGL surface, EGL_NO_SURFACE for a surfaceless headless context
     EGLSurface eglSurface;
+    // framebuffer a surfaceless headless context renders into, 0 otherwise
+    GLuint offscreenFramebuffer;
+    // its color and depth/stencil storage
+    GLuint offscreenRenderbuffers[2];
 #endif
     
     // Callbacks
@@ -90,6 +159,25 @@ struct ESContext
     void ( ESCALLBACK *shutdownFunc ) ( ESContext * );
     void ( ESCALLBACK *keyFunc ) ( ESContext *, unsigned char, int, int );
     void ( ESCALLBACK *updateFunc ) ( ESContext *, float deltaTime );
+    
+    // Frame loop
+    // seconds per updateFunc call, 0 for one call per frame with the measured delta
+    float fixedTimestep;
+    // frame rate esMainLoop paces to, 0 for uncapped
+    float maxFrameRate;
+    // how far into the next fixed step drawFunc is, in [ 0, 1 ), to interpolate between the last two
+    // simulation states. 1 without a fixed timestep
+    float interpolation;
+    // set by esStopMainLoop
+    GLboolean stopLoop;
+    // snapshots and update thread, NULL until esSetSnapshotSize or esSetPipelined
+    ESPipeline *pipeline;
+    // frame time accumulators behind esGetFrameStats
+    unsigned long long frameCount;
+    unsigned long long frameTotalNs;
+    unsigned long long frameMinNs;
+    unsigned long long frameMaxNs;
+    unsigned int       frameHistoryNs[ES_FRAME_HISTORY];
 };
 
 // create a window with specified params
@@ -102,22 +190,89 @@ void ESUTIL_API esRegisterShutdownFunc( ESContext *esContext, void ( ESCALLBACK
 void ESUTIL_API esRegisterUpdateFunc( ESContext *esContext, void( ESCALLBACK * updateFunc ) ( ESContext *, float ));
 // register a keyboard input processing callback function
 void ESUTIL_API esRegisterKeyFunc( ESContext *esContext, void( ESCALLBACK *keyFunc )( ESContext *, unsigned char, int,int ));
+// call updateFunc with a fixed deltaTime of step seconds, as many times per frame as real time has advanced.
+// 0 ( the default ) calls it once per frame with the measured frame time
+void ESUTIL_API esSetFixedTimestep( ESContext *esContext, float step );
+// pace esMainLoop to at most framesPerSecond, sleeping and then spinning out the rest of each frame. 0 for uncapped
+void ESUTIL_API esSetMaxFrameRate( ESContext *esContext, float framesPerSecond );
+// run update, draw and swap until esStopMainLoop or the window is closed. Returns the number of frames run,
+// shutdownFunc is left to the caller
+int ESUTIL_API esMainLoop( ESContext *esContext );
+// run numFrames frames back to back, each advancing the simulation by exactly one fixed step ( 1/60 s
+// without a fixed timestep ) whatever the real time, so a run is repeatable. Frame times are still measured
+int ESUTIL_API esRunFrames( ESContext *esContext, int numFrames );
+// make esMainLoop return after the current frame, e.g. from a callback
+void ESUTIL_API esStopMainLoop( ESContext *esContext );
+// double-buffered per-frame state handed from updateFunc to drawFunc, size bytes starting out zeroed.
+// Each frame's snapshot starts as a copy of the previous one. 0 frees them. Call it between loop runs
+GLboolean ESUTIL_API esSetSnapshotSize( ESContext *esContext, size_t size );
+// run updateFunc on its own thread, simulating frame N + 1 while drawFunc submits frame N. updateFunc
+// must not touch GL then, and drawFunc should only read simulation state from esDrawSnapshot.
+// Call it between loop runs
+GLboolean ESUTIL_API esSetPipelined( ESContext *esContext, GLboolean pipelined );
+// snapshot of the frame updateFunc is simulating, only valid inside updateFunc
+void *ESUTIL_API esUpdateSnapshot( ESContext *esContext );
+// snapshot of the frame drawFunc is drawing, only valid inside drawFunc
+const void *ESUTIL_API esDrawSnapshot( ESContext *esContext );
+// frame time statistics of the last esMainLoop/esRunFrames call, which also reset them
+void ESUTIL_API esGetFrameStats( const ESContext *esContext, ESFrameStats *stats );
 // log a message to the debug output for the platform
 void ESUTIL_API esLogMessage( const char *formatStr, ... );
+// return a monotonic timestamp in nanoseconds, only differences between two calls are meaningful
+unsigned long long ESUTIL_API esGetTimeNs( void );
+// map a whole file read-only ( read into memory where there is no mmap ), NULL on failure
+const unsigned char *ESUTIL_API esMapFile( const char *fileName, size_t *size );
+// release a mapping returned by esMapFile
+void ESUTIL_API esUnmapFile( const unsigned char *data, size_t size );
 // load a shader, check for compile errors, print error msgs to output log
 GLuint ESUTIL_API esLoadShader( GLenum type, const char *shaderSrc );
 // load a vertex and fragment shader, create a program obj, link program
 GLuint ESUTIL_API esLoadProgram( const char *vertShaderSrc, const char *fragShaderSrc );
+// enable the on-disk program binary cache used by esLoadProgram, dir must exist. NULL disables it
+GLboolean ESUTIL_API esProgramCacheEnable( const char *dir );
+// read the program cache counters
+void ESUTIL_API esProgramCacheGetStats( ESProgramCacheStats *stats );
+// print the program cache counters with esLogMessage
+void ESUTIL_API esProgramCacheLogStats( void );
+// submit compile and link of count vertex/fragment pairs at once without waiting on any of them,
+// futures[i] tracks program i
+void ESUTIL_API esLoadProgramsAsync( ESProgramFuture *futures, const char **vertShaderSrcs, const char **fragShaderSrcs, int count );
+// return the future status, only blocks when GL_KHR_parallel_shader_compile is not supported
+GLint ESUTIL_API esProgramPoll( ESProgramFuture *future );
+// block until the program is built, returns the program object or 0 on failure
+GLuint ESUTIL_API esProgramWait( ESProgramFuture *future );
 // generates geometry for a sphere. Allocate mem for the vertex data and stores the
-// results in the arrays. Generate index list for a TRIANGLE_STRIP
+// results in the arrays. Generate index list for TRIANGLES
 int ESUTIL_API esGenSphere( int numSlices, float radius, GLfloat **vertices, GLfloat **normals, GLfloat **texCoords, GLuint ** indices );
+// vertex and index counts of esGenSphere, without generating anything. Fewer than 4 slices make no sphere, both are 0
+void ESUTIL_API esGenSphereSize( int numSlices, int *numVertices, int *numIndices );
+// write the vertices of rows [ firstRow, firstRow + numRows ) of a sphere, there are numSlices / 2 + 1 rows
+// of numSlices + 1 vertices. dest receives the first vertex of firstRow
+void ESUTIL_API esGenSphereVertices( int numSlices, float radius, int firstRow, int numRows, const ESShapeStreams *dest );
+// write the indices of quad rows [ firstRow, firstRow + numRows ) of a sphere, there are numSlices / 2 rows.
+// indices receives the first index of firstRow, baseVertex is added to every index
+void ESUTIL_API esGenSphereIndices( int numSlices, int firstRow, int numRows, GLuint *indices, GLuint baseVertex );
+// generate a whole sphere straight into dest/indices ( either may be NULL ), spread over the job workers.
+// Returns the number of indices
+int ESUTIL_API esGenSphereInto( int numSlices, float radius, const ESShapeStreams *dest, GLuint *indices, GLuint baseVertex );
 // generates geometry for a cube. Allocate mem for the vertex data and stores the
 // results in the arrays. Generate index list for a TRIANGLES
 int ESUTIL_API esGenCube( float scale, GLfloat ** vertices, GLfloat **normal, GLfloat **texCoords, GLuint **indices );
 // generates a square grid consisting of triangles. Allocate mem for the vertex data and stores
 // the results in the arrays. Generate index list as TRIANGLES
-int ESUTIL_API esGenSquareGrid( int size, GLfloat **vertices, GLfloat **indices );
-// loads a 8-bit,24-bit or 32-bit TGA img from a file
+int ESUTIL_API esGenSquareGrid( int size, GLfloat **vertices, GLuint **indices );
+// vertex and index counts of esGenSquareGrid, without generating anything. A size below 2 makes no grid, both are 0
+void ESUTIL_API esGenSquareGridSize( int size, int *numVertices, int *numIndices );
+// write the vertices of rows [ firstRow, firstRow + numRows ) of a size x size grid on the unit square,
+// normals face +z and texture coordinates follow x/y. dest receives the first vertex of firstRow
+void ESUTIL_API esGenSquareGridVertices( int size, int firstRow, int numRows, const ESShapeStreams *dest );
+// write the indices of quad rows [ firstRow, firstRow + numRows ) of the grid, there are size - 1 rows.
+// indices receives the first index of firstRow, baseVertex is added to every index
+void ESUTIL_API esGenSquareGridIndices( int size, int firstRow, int numRows, GLuint *indices, GLuint baseVertex );
+// generate a whole grid straight into dest/indices ( either may be NULL ), spread over the job workers.
+// Returns the number of indices
+int ESUTIL_API esGenSquareGridInto( int size, const ESShapeStreams *dest, GLuint *indices, GLuint baseVertex );
+// loads an 8-bit, 24-bit or 32-bit TGA img ( RLE and color-mapped too ) as grayscale/RGB/RGBA, bottom row first
 char *ESUTIL_API esLoadTGA( void *ioContext, const char *fileName, int *width, int *height );
 // multiply matrix specified by result with a scaling matrix and return new matrix in result
 void ESUTIL_API esScale( ESMatrix *result, GLfloat sx, GLfloat sy, GLfloat sz );
@@ -133,6 +288,10 @@ void ESUTIL_API esPerspective( ESMatrix *result, float fovy, float aspect, float
 void ESUTIL_API esOrtho( ESMatrix *result, float left, float right, float bottom, float top, float nearZ, float farZ );
 // Perform the following op - result matrix = srcA matrix * srcB matrix
 void ESUTIL_API esMatrixMultiply( ESMatrix *result, ESMatrix *srcA, ESMatrix *srcB );
+// Perform result[i] = srcA[i] * srcB for count matrices, srcB is shared by the whole batch
+void ESUTIL_API esMatrixMultiplyBatch( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB, int count );
+// Return the name of the matrix kernel picked for this CPU ( "scalar", "sse", "avx2" or "neon" )
+const char *ESUTIL_API esMatrixImplName( void );
 // Return an identity matrix
 void ESUTIL_API esMatrixLoadIdentity( ESMatrix *result );
 // Generate a transformation matrix from eye pos, look at and up vectors
@@ -141,8 +300,13 @@ void ESUTIL_API esMatrixLookAt( ESMatrix *result,
                                float lookAtX, float lookAtY, float lookAtZ,
                                float upX, float upY, float upZ);
 
-#ifdef _cplusplus
+#ifdef __cplusplus
 }
 #endif
 
+// Counted GL calls, see ESGLTrace.h
+#ifdef ES_GL_TRACE
+#include "ESGLTrace.h"
+#endif
+
 #endif /* ESUtil_h */
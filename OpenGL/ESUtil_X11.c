@@ -0,0 +1,90 @@
+//
+//  ESUtil_X11.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  Native window for esCreateWindow on Linux/X11. Only built by the CMake
+//  build, the iOS target gets its surface from GLKView.
+//
+
+#include "ESUtil.h"
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+// window manager close request
+static Atom wmDeleteWindow;
+
+// WinCreate()
+GLboolean WinCreate( ESContext *esContext, const char *title )
+{
+    Display *display;
+    Window root;
+    Window window;
+    XSetWindowAttributes swa;
+    
+    display = XOpenDisplay( NULL );
+    
+    if( display == NULL )
+    {
+        return GL_FALSE;
+    }
+    
+    root = DefaultRootWindow( display );
+    
+    swa.event_mask = ExposureMask | PointerMotionMask | KeyPressMask | StructureNotifyMask;
+    window = XCreateWindow( display, root, 0, 0, esContext->width, esContext->height, 0,
+                            CopyFromParent, InputOutput, CopyFromParent, CWEventMask, &swa );
+    
+    wmDeleteWindow = XInternAtom( display, "WM_DELETE_WINDOW", False );
+    XSetWMProtocols( display, window, &wmDeleteWindow, 1 );
+    XStoreName( display, window, title != NULL ? title : "" );
+    XMapWindow( display, window );
+    XFlush( display );
+    
+    esContext->eglNativeDisplay = ( EGLNativeDisplayType ) display;
+    esContext->eglNativeWindow  = ( EGLNativeWindowType ) window;
+    
+    return GL_TRUE;
+}
+
+// WinProcessEvents()
+GLboolean WinProcessEvents( ESContext *esContext )
+{
+    Display *display = ( Display * ) esContext->eglNativeDisplay;
+    GLboolean open = GL_TRUE;
+    
+    while( XPending( display ) )
+    {
+        XEvent event;
+        
+        XNextEvent( display, &event );
+        
+        if( event.type == KeyPress && esContext->keyFunc != NULL )
+        {
+            KeySym key;
+            char text;
+            
+            if( XLookupString( &event.xkey, &text, 1, &key, NULL ) == 1 )
+            {
+                esContext->keyFunc( esContext, ( unsigned char ) text, event.xkey.x, event.xkey.y );
+            }
+        }
+        else if( event.type == ConfigureNotify )
+        {
+            esContext->width  = event.xconfigure.width;
+            esContext->height = event.xconfigure.height;
+        }
+        else if( event.type == ClientMessage && ( Atom ) event.xclient.data.l[0] == wmDeleteWindow )
+        {
+            open = GL_FALSE;
+        }
+        else if( event.type == DestroyNotify )
+        {
+            open = GL_FALSE;
+        }
+    }
+    
+    return open;
+}
@@ -0,0 +1,372 @@
+//
+//  ESVertexFormat.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  Interleaved, quantized vertex layouts. The shape generators work in
+//  separate float streams; this packs them into one buffer where a
+//  position/normal/uv vertex can shrink from 32 to 16 bytes.
+//
+
+#include "ESVertexFormat.h"
+#include "ESProfile.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// IEEE half with round to nearest even, overflow goes to infinity
+static GLushort esFloatToHalf( GLfloat value )
+{
+    unsigned int bits;
+    unsigned int sign;
+    unsigned int magnitude;
+    unsigned int half;
+    unsigned int remainder;
+    
+    memcpy( &bits, &value, sizeof( bits ) );
+    sign      = ( bits >> 16 ) & 0x8000;
+    magnitude = bits & 0x7FFFFFFF;
+    
+    if( magnitude >= 0x7F800000 )
+    {
+        // infinity stays infinity, NaN stays a quiet NaN
+        return ( GLushort ) ( sign | ( magnitude > 0x7F800000 ? 0x7E00 : 0x7C00 ) );
+    }
+    
+    if( magnitude >= 0x477FF000 )
+    {
+        // rounds past 65504, the largest half
+        return ( GLushort ) ( sign | 0x7C00 );
+    }
+    
+    if( magnitude < 0x38800000 )
+    {
+        // below 2^-14 the half is denormal, its mantissa counts units of 2^-24
+        GLfloat absValue;
+        
+        memcpy( &absValue, &magnitude, sizeof( absValue ) );
+        return ( GLushort ) ( sign | ( unsigned int ) rintf( absValue * 16777216.0f ) );
+    }
+    
+    // rebias the exponent from 127 to 15 and drop 13 mantissa bits
+    half      = ( magnitude - 0x38000000 ) >> 13;
+    remainder = magnitude & 0x1FFF;
+    
+    if( remainder > 0x1000 || ( remainder == 0x1000 && ( half & 1 ) ) )
+    {
+        half++;
+    }
+    
+    return ( GLushort ) ( sign | half );
+}
+
+static GLshort esFloatToSnorm16( GLfloat value )
+{
+    value = value < -1.0f ? -1.0f : ( value > 1.0f ? 1.0f : value );
+    
+    return ( GLshort ) lrintf( value * 32767.0f );
+}
+
+static GLushort esFloatToUnorm16( GLfloat value )
+{
+    value = value < 0.0f ? 0.0f : ( value > 1.0f ? 1.0f : value );
+    
+    return ( GLushort ) lrintf( value * 65535.0f );
+}
+
+// signed 10 bit x, y, z and w = 0 in GL_INT_2_10_10_10_REV order
+static GLuint esPackNormal2101010( const GLfloat *normal )
+{
+    GLuint packed = 0;
+    int i;
+    
+    for( i = 0; i < 3; i++ )
+    {
+        GLfloat value = normal[i] < -1.0f ? -1.0f : ( normal[i] > 1.0f ? 1.0f : normal[i] );
+        
+        packed |= ( ( GLuint ) lrintf( value * 511.0f ) & 0x3FF ) << ( i * 10 );
+    }
+    
+    return packed;
+}
+
+// bytes one attribute takes in the vertex, 0 if the encoding is not supported for it
+static GLsizei esAttribSize( ESAttribEncoding encoding, int numComponents, int isNormal )
+{
+    switch( encoding )
+    {
+        case ES_ATTRIB_NONE:
+            return 0;
+        case ES_ATTRIB_FLOAT:
+            return sizeof( GLfloat ) * numComponents;
+        case ES_ATTRIB_HALF:
+            // three component halves are padded to four to keep 4 byte alignment
+            return isNormal ? 0 : sizeof( GLushort ) * ( numComponents == 3 ? 4 : numComponents );
+        case ES_ATTRIB_SNORM16:
+            return numComponents == 3 && !isNormal ? sizeof( GLshort ) * 4 : 0;
+        case ES_ATTRIB_INT_2_10_10_10_REV:
+            return isNormal ? sizeof( GLuint ) : 0;
+        case ES_ATTRIB_UNORM16:
+            return numComponents == 2 ? sizeof( GLushort ) * 2 : 0;
+    }
+    
+    return 0;
+}
+
+// esVertexFormatInit()
+GLboolean ESUTIL_API esVertexFormatInit( ESVertexFormat *format, ESAttribEncoding position, ESAttribEncoding normal,
+                                         ESAttribEncoding texCoord, GLfloat positionScale )
+{
+    GLsizei positionSize = esAttribSize( position, 3, GL_FALSE );
+    GLsizei normalSize   = esAttribSize( normal, 3, GL_TRUE );
+    GLsizei texCoordSize = esAttribSize( texCoord, 2, GL_FALSE );
+    
+    memset( format, 0, sizeof( ESVertexFormat ) );
+    
+    if( ( position != ES_ATTRIB_NONE && positionSize == 0 ) ||
+        ( normal != ES_ATTRIB_NONE && normalSize == 0 ) ||
+        ( texCoord != ES_ATTRIB_NONE && texCoordSize == 0 ) ||
+        ( position == ES_ATTRIB_SNORM16 && positionScale <= 0.0f ) )
+    {
+        esLogMessage( " esVertexFormatInit: unsupported attribute encoding\n " );
+        return GL_FALSE;
+    }
+    
+    format->position       = position;
+    format->normal         = normal;
+    format->texCoord       = texCoord;
+    format->positionScale  = positionScale;
+    format->positionOffset = 0;
+    format->normalOffset   = positionSize;
+    format->texCoordOffset = positionSize + normalSize;
+    format->stride         = positionSize + normalSize + texCoordSize;
+    
+    return GL_TRUE;
+}
+
+// esVertexFormatPack()
+void ESUTIL_API esVertexFormatPack( const ESVertexFormat *format, void *dest, int numVertices,
+                                    const GLfloat *positions, const GLfloat *normals, const GLfloat *texCoords )
+{
+    unsigned char *vertex = dest;
+    GLfloat invScale = format->positionScale > 0.0f ? 1.0f / format->positionScale : 1.0f;
+    int i;
+    
+    for( i = 0; i < numVertices; i++, vertex += format->stride )
+    {
+        unsigned char *out;
+        
+        out = vertex + format->positionOffset;
+        switch( format->position )
+        {
+            case ES_ATTRIB_FLOAT:
+                memcpy( out, &positions[i * 3], sizeof( GLfloat ) * 3 );
+                break;
+            case ES_ATTRIB_HALF:
+            {
+                GLushort half[4];
+                
+                half[0] = esFloatToHalf( positions[i * 3 + 0] );
+                half[1] = esFloatToHalf( positions[i * 3 + 1] );
+                half[2] = esFloatToHalf( positions[i * 3 + 2] );
+                half[3] = 0x3C00; // 1.0
+                memcpy( out, half, sizeof( half ) );
+                break;
+            }
+            case ES_ATTRIB_SNORM16:
+            {
+                GLshort snorm[4];
+                
+                snorm[0] = esFloatToSnorm16( positions[i * 3 + 0] * invScale );
+                snorm[1] = esFloatToSnorm16( positions[i * 3 + 1] * invScale );
+                snorm[2] = esFloatToSnorm16( positions[i * 3 + 2] * invScale );
+                snorm[3] = 32767; // 1.0, not scaled
+                memcpy( out, snorm, sizeof( snorm ) );
+                break;
+            }
+            default:
+                break;
+        }
+        
+        out = vertex + format->normalOffset;
+        switch( format->normal )
+        {
+            case ES_ATTRIB_FLOAT:
+                memcpy( out, &normals[i * 3], sizeof( GLfloat ) * 3 );
+                break;
+            case ES_ATTRIB_INT_2_10_10_10_REV:
+            {
+                GLuint packed = esPackNormal2101010( &normals[i * 3] );
+                
+                memcpy( out, &packed, sizeof( packed ) );
+                break;
+            }
+            default:
+                break;
+        }
+        
+        out = vertex + format->texCoordOffset;
+        switch( format->texCoord )
+        {
+            case ES_ATTRIB_FLOAT:
+                memcpy( out, &texCoords[i * 2], sizeof( GLfloat ) * 2 );
+                break;
+            case ES_ATTRIB_HALF:
+            {
+                GLushort half[2];
+                
+                half[0] = esFloatToHalf( texCoords[i * 2 + 0] );
+                half[1] = esFloatToHalf( texCoords[i * 2 + 1] );
+                memcpy( out, half, sizeof( half ) );
+                break;
+            }
+            case ES_ATTRIB_UNORM16:
+            {
+                GLushort unorm[2];
+                
+                unorm[0] = esFloatToUnorm16( texCoords[i * 2 + 0] );
+                unorm[1] = esFloatToUnorm16( texCoords[i * 2 + 1] );
+                memcpy( out, unorm, sizeof( unorm ) );
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+// esVertexFormatSetup()
+void ESUTIL_API esVertexFormatSetup( const ESVertexFormat *format, GLuint positionLoc, GLuint normalLoc,
+                                     GLuint texCoordLoc, GLintptr baseOffset )
+{
+    const void *position = ( const void * ) ( baseOffset + format->positionOffset );
+    const void *normal   = ( const void * ) ( baseOffset + format->normalOffset );
+    const void *texCoord = ( const void * ) ( baseOffset + format->texCoordOffset );
+    
+    switch( format->position )
+    {
+        case ES_ATTRIB_FLOAT:
+            glVertexAttribPointer( positionLoc, 3, GL_FLOAT, GL_FALSE, format->stride, position );
+            break;
+        case ES_ATTRIB_HALF:
+            glVertexAttribPointer( positionLoc, 4, GL_HALF_FLOAT, GL_FALSE, format->stride, position );
+            break;
+        case ES_ATTRIB_SNORM16:
+            glVertexAttribPointer( positionLoc, 4, GL_SHORT, GL_TRUE, format->stride, position );
+            break;
+        default:
+            break;
+    }
+    
+    switch( format->normal )
+    {
+        case ES_ATTRIB_FLOAT:
+            glVertexAttribPointer( normalLoc, 3, GL_FLOAT, GL_FALSE, format->stride, normal );
+            break;
+        case ES_ATTRIB_INT_2_10_10_10_REV:
+            glVertexAttribPointer( normalLoc, 4, GL_INT_2_10_10_10_REV, GL_TRUE, format->stride, normal );
+            break;
+        default:
+            break;
+    }
+    
+    switch( format->texCoord )
+    {
+        case ES_ATTRIB_FLOAT:
+            glVertexAttribPointer( texCoordLoc, 2, GL_FLOAT, GL_FALSE, format->stride, texCoord );
+            break;
+        case ES_ATTRIB_HALF:
+            glVertexAttribPointer( texCoordLoc, 2, GL_HALF_FLOAT, GL_FALSE, format->stride, texCoord );
+            break;
+        case ES_ATTRIB_UNORM16:
+            glVertexAttribPointer( texCoordLoc, 2, GL_UNSIGNED_SHORT, GL_TRUE, format->stride, texCoord );
+            break;
+        default:
+            break;
+    }
+}
+
+// pack float streams of numVertices vertices into a new interleaved buffer and free the streams
+static void *esVertexFormatPackStreams( const ESVertexFormat *format, int numVertices,
+                                        GLfloat *positions, GLfloat *normals, GLfloat *texCoords )
+{
+    void *packed = malloc( ( size_t ) format->stride * numVertices );
+    
+    if( packed != NULL )
+    {
+        esVertexFormatPack( format, packed, numVertices, positions, normals, texCoords );
+    }
+    
+    free( positions );
+    free( normals );
+    free( texCoords );
+    
+    return packed;
+}
+
+// esGenCubeInterleaved()
+int ESUTIL_API esGenCubeInterleaved( float scale, const ESVertexFormat *format, void **vertices, GLuint **indices )
+{
+    GLfloat *positions = NULL;
+    GLfloat *normals   = NULL;
+    GLfloat *texCoords = NULL;
+    int numIndices;
+    
+    ES_PROFILE_ZONE( "esGenCubeInterleaved" );
+    
+    // only generate the streams the format keeps
+    numIndices = esGenCube( scale,
+                            format->position != ES_ATTRIB_NONE ? &positions : NULL,
+                            format->normal != ES_ATTRIB_NONE ? &normals : NULL,
+                            format->texCoord != ES_ATTRIB_NONE ? &texCoords : NULL,
+                            indices );
+    
+    if( vertices != NULL )
+    {
+        *vertices = esVertexFormatPackStreams( format, 24, positions, normals, texCoords );
+    }
+    else
+    {
+        free( positions );
+        free( normals );
+        free( texCoords );
+    }
+    
+    return numIndices;
+}
+
+// esGenSphereInterleaved()
+int ESUTIL_API esGenSphereInterleaved( int numSlices, float radius, const ESVertexFormat *format,
+                                       void **vertices, GLuint **indices )
+{
+    GLfloat *positions = NULL;
+    GLfloat *normals   = NULL;
+    GLfloat *texCoords = NULL;
+    int numVertices;
+    int numIndices;
+    
+    ES_PROFILE_ZONE( "esGenSphereInterleaved" );
+    
+    esGenSphereSize( numSlices, &numVertices, NULL );
+    
+    numIndices = esGenSphere( numSlices, radius,
+                              format->position != ES_ATTRIB_NONE ? &positions : NULL,
+                              format->normal != ES_ATTRIB_NONE ? &normals : NULL,
+                              format->texCoord != ES_ATTRIB_NONE ? &texCoords : NULL,
+                              indices );
+    
+    if( vertices != NULL )
+    {
+        *vertices = esVertexFormatPackStreams( format, numVertices, positions, normals, texCoords );
+    }
+    else
+    {
+        free( positions );
+        free( normals );
+        free( texCoords );
+    }
+    
+    return numIndices;
+}
@@ -0,0 +1,71 @@
+//
+//  ESVertexFormat.h
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+
+#ifndef ESVertexFormat_h
+#define ESVertexFormat_h
+
+#include "ESUtil.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// How one attribute is stored in an interleaved vertex
+typedef enum
+{
+    // attribute left out of the vertex
+    ES_ATTRIB_NONE = 0,
+    // 32-bit floats: 12 bytes for positions/normals, 8 for texture coordinates
+    ES_ATTRIB_FLOAT,
+    // GL_HALF_FLOAT: positions padded to xyz1 ( 8 bytes ), texture coordinates 4 bytes
+    ES_ATTRIB_HALF,
+    // normalized GL_SHORT positions divided by positionScale, padded to xyz1 ( 8 bytes )
+    ES_ATTRIB_SNORM16,
+    // normalized GL_INT_2_10_10_10_REV normals ( 4 bytes )
+    ES_ATTRIB_INT_2_10_10_10_REV,
+    // normalized GL_UNSIGNED_SHORT texture coordinates in [ 0, 1 ] ( 4 bytes )
+    ES_ATTRIB_UNORM16
+} ESAttribEncoding;
+
+typedef struct
+{
+    ESAttribEncoding position;
+    ESAttribEncoding normal;
+    ESAttribEncoding texCoord;
+    // snorm16 positions store position / positionScale, scale the model matrix by it to undo
+    GLfloat positionScale;
+    
+    // Filled in by esVertexFormatInit, in bytes
+    GLsizei stride;
+    GLsizei positionOffset;
+    GLsizei normalOffset;
+    GLsizei texCoordOffset;
+} ESVertexFormat;
+
+// describe an interleaved layout, returns GL_FALSE for encodings the attribute does not support
+GLboolean ESUTIL_API esVertexFormatInit( ESVertexFormat *format, ESAttribEncoding position, ESAttribEncoding normal,
+                                         ESAttribEncoding texCoord, GLfloat positionScale );
+// encode numVertices vertices from separate float streams ( float3 positions/normals, float2 texture coordinates )
+// into dest, which holds numVertices * format->stride bytes. Streams the format leaves out may be NULL
+void ESUTIL_API esVertexFormatPack( const ESVertexFormat *format, void *dest, int numVertices,
+                                    const GLfloat *positions, const GLfloat *normals, const GLfloat *texCoords );
+// glVertexAttribPointer for every attribute of the format, reading the bound GL_ARRAY_BUFFER from baseOffset.
+// Enabling the arrays is left to the caller
+void ESUTIL_API esVertexFormatSetup( const ESVertexFormat *format, GLuint positionLoc, GLuint normalLoc,
+                                     GLuint texCoordLoc, GLintptr baseOffset );
+// esGenCube packed into one interleaved buffer of the given format. Returns the number of indices
+int ESUTIL_API esGenCubeInterleaved( float scale, const ESVertexFormat *format, void **vertices, GLuint **indices );
+// esGenSphere packed into one interleaved buffer of the given format. Returns the number of indices
+int ESUTIL_API esGenSphereInterleaved( int numSlices, float radius, const ESVertexFormat *format,
+                                       void **vertices, GLuint **indices );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESVertexFormat_h */
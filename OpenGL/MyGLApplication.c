@@ -7,6 +7,16 @@
 //
 
 #include "ESUtil.h"
+#include "ESJob.h"
+#include "ESRingBuffer.h"
+#include "ESStateCache.h"
+#include "ESDrawQueue.h"
+#include "ESBatch.h"
+#include "ESMeshOpt.h"
+#include "ESAsset.h"
+#include "ESCull.h"
+#include "ESScene.h"
+#include "ESQuaternion.h"
 #include <string.h>
 #include <math.h>
 
@@ -14,6 +24,17 @@
 #define POSITION_LOC 0
 #define COLOR_LOC    1
 #define MVP_LOC      2
+// Attribute locations used by the shader, POSITION_LOC up to the last MVP row
+#define NUM_VERTEX_ATTRIBS ( MVP_LOC + 4 )
+// Instances handed to one job by UpdateCubesByInstancing
+#define INSTANCE_GRAIN_SIZE 256
+// Scene node of the camera, the node of instance i is INSTANCE_NODE( i )
+#define VIEW_NODE           0
+#define INSTANCE_NODE( i )  ( ( i ) + 1 )
+// Bytes of streamed geometry DrawPrimitiveWithRingBuffer can upload per frame
+#define STREAM_RING_SIZE    ( 64 * 1024 )
+// Render thread time spent per frame creating streamed GL objects
+#define ASSET_UPLOAD_BUDGET_NS ( 2 * 1000 * 1000 )
 
 typedef struct
 {
@@ -23,19 +44,56 @@ typedef struct
     GLuint vboIds[3];
     // VertexArrayObject Id
     GLuint vaoId;
+    // Streamed vertex/index data for DrawPrimitiveWithRingBuffer
+    ESRingBuffer streamRing;
     // x-offset uniform location
     GLuint offsetLoc;
+    // Shadowed GL bindings, the draw paths set their state through it
+    ESStateCache stateCache;
+    // Packets collected by Draw, sorted and emitted once per frame
+    ESDrawQueue drawQueue;
+    // Loads assets on the job workers, Draw uploads them a few at a time
+    ESAssetStreamer streamer;
     
     // Instancing
     // ---
     GLuint positionVBO;
-    GLuint colorVBO;
     GLuint mvpVBO;
     GLuint indicesIBO;
+    // Streamed cube geometry, positionVBO/indicesIBO once ready
+    ESAsset cubePositions;
+    ESAsset cubeIndices;
+    // Per-frame MVP storage, mvpVBO is the ring's buffer
+    ESRingBuffer mvpRing;
+    // Offset of this frame's MVPs and colors inside mvpVBO
+    GLintptr mvpOffset;
+    GLintptr colorOffset;
     // Number of indices
     int numIndices;
     // Rotation angle
     GLfloat angle[NUM_INSTANCES];
+    // Per-instance color, copied next to the MVPs of the visible instances
+    GLubyte colors[NUM_INSTANCES][4];
+    // The view node with one child per instance, their world matrices are the modelviews
+    ESScene scene;
+    // View space bounds of every instance and the tree they are culled with
+    ESAABB *bounds;
+    ESCullTree cullTree;
+    // Instances inside the frustum, the MVPs and colors are packed in this order
+    int *visible;
+    int numVisible;
+    // World matrices of the visible instances in the same order, contiguous for esMatrixMultiplyBatch
+    ESMatrix *visibleWorld;
+    // ---
+    
+    // Batching
+    // ---
+    // Cube positions and indices, the batcher adds the instance attributes
+    GLuint cubeVAO;
+    // CPU side MVPs handed to the batcher
+    ESMatrix *mvps;
+    // Groups the cube draws into instanced draws
+    ESBatch batch;
     // ---
     
     // Vertex
@@ -65,49 +123,82 @@ void GenerateCubeVertexShader(UserData *userData)
 {
     userData->numIndices = esGenCube( 1.0, &userData->vertices, NULL, NULL, &userData->indices );
     
+    // Reorder the triangles for the post-transform cache, logs ACMR/ATVR before and after
+    esMeshOptimizeShape( userData->indices, userData->numIndices, 24, userData->vertices, NULL, NULL );
+    
     userData->angle[0] = 45.0f;
 }
 
+// Cube geometry producers, run on a job worker while the first frames are drawn
+GLboolean ESCALLBACK ProduceCubeIndices( void *arg, void **data, GLsizeiptr *size )
+{
+    GLuint *indices;
+    int numIndices;
+    
+    // the render thread gets the count from the asset size, see CubeGeometryReady
+    ( void ) arg;
+    numIndices = esGenCube( 0.5f, NULL, NULL, NULL, &indices );
+    
+    *data = indices;
+    *size = sizeof( GLuint ) * numIndices;
+    
+    return GL_TRUE;
+}
+
+GLboolean ESCALLBACK ProduceCubePositions( void *arg, void **data, GLsizeiptr *size )
+{
+    GLfloat *positions;
+    
+    ( void ) arg;
+    esGenCube( 0.5f, &positions, NULL, NULL, NULL );
+    
+    *data = positions;
+    *size = 24 * sizeof( GLfloat ) * 3;
+    
+    return GL_TRUE;
+}
+
+// GL_TRUE once the streamed cube buffers exist, picks up their names and the index count.
+// esAssetReady's acquire load makes name and size visible
+GLboolean CubeGeometryReady( UserData *userData )
+{
+    if( !esAssetReady( &userData->cubeIndices ) || !esAssetReady( &userData->cubePositions ) )
+    {
+        return GL_FALSE;
+    }
+    
+    userData->indicesIBO  = userData->cubeIndices.name;
+    userData->positionVBO = userData->cubePositions.name;
+    userData->numIndices  = ( int ) ( userData->cubeIndices.size / sizeof( GLuint ) );
+    
+    return GL_TRUE;
+}
+
 void GenerateCubesByInstancing(UserData *userData)
 {
-   // generate the vertex data
-   GLfloat *positions;
-   GLuint  *indices;
-   userData->numIndices = esGenCube( 0.5f, &positions, NULL, NULL, &indices);
-       
-   // Index buffer obj
-   glGenBuffers( 1, &userData->indicesIBO );
-   glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, userData->indicesIBO);
-   glBufferData( GL_ELEMENT_ARRAY_BUFFER, sizeof( GLint ) * userData->numIndices, indices, GL_STATIC_DRAW );
-   glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
-   free( indices );
-    
-   // Position VBO for cube model
-   glGenBuffers( 1, &userData->positionVBO );
-   glBindBuffer( GL_ARRAY_BUFFER, userData->positionVBO );
-   glBufferData( GL_ARRAY_BUFFER, 24 * sizeof( GLfloat ) * 3, positions, GL_STATIC_DRAW);
-   free( positions );
+   ESStateCache *cache = &userData->stateCache;
+   
+   // Index buffer obj and position VBO for cube model, generated and uploaded in the background
+   esAssetLoadBuffer( &userData->streamer, &userData->cubeIndices, GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW,
+                      ProduceCubeIndices, userData );
+   esAssetLoadBuffer( &userData->streamer, &userData->cubePositions, GL_ARRAY_BUFFER, GL_STATIC_DRAW,
+                      ProduceCubePositions, userData );
    
    // Random color for each instance
    {
-       GLubyte colors[NUM_INSTANCES][4];
        int instance;
        
        srandom( 0 );
        
        for( instance = 0; instance < NUM_INSTANCES; instance++ )
        {
-           colors[instance][0] = random() % 255;
-           colors[instance][1] = random() % 255;
-           colors[instance][2] = random() % 255;
-           colors[instance][3] = 0;
+           userData->colors[instance][0] = random() % 255;
+           userData->colors[instance][1] = random() % 255;
+           userData->colors[instance][2] = random() % 255;
+           userData->colors[instance][3] = 0;
        }
-       
-       glGenBuffers( 1, &userData->colorVBO );
-       glBindBuffer( GL_ARRAY_BUFFER, userData->colorVBO );
-       glBufferData( GL_ARRAY_BUFFER, NUM_INSTANCES * 4, colors, GL_STATIC_DRAW );
    }
-    
+   
    // Allocate storage to store MVP per instance
    {
        int instance;
@@ -117,16 +208,68 @@ void GenerateCubesByInstancing(UserData *userData)
            userData->angle[instance] = (float) ( random() % 32768 ) / 32767.0f * 360.0f;
        }
        
-       glGenBuffers( 1, &userData->mvpVBO );
-       glBindBuffer( GL_ARRAY_BUFFER, userData->mvpVBO);
-       glBufferData( GL_ARRAY_BUFFER, NUM_INSTANCES * sizeof( ESMatrix ), NULL, GL_DYNAMIC_DRAW );
+       // One frame-sized region per frame in flight, written without waiting on the GPU.
+       // Holds the MVPs and then the colors of the visible instances
+       esRingBufferInit( &userData->mvpRing, GL_ARRAY_BUFFER, NUM_INSTANCES * ( sizeof( ESMatrix ) + 4 ),
+                         ES_RING_DEFAULT_REGIONS );
+       userData->mvpVBO      = userData->mvpRing.buffer;
+       userData->mvpOffset   = 0;
+       userData->colorOffset = 0;
+       
+       // Every cube hangs off the view node, 5 units in front of the viewer
+       esSceneInit( &userData->scene, INSTANCE_NODE( NUM_INSTANCES ) );
+       esSceneAddNode( &userData->scene, -1 );
+       esSceneSetTranslation( &userData->scene, VIEW_NODE, 0.0f, 0.0f, -5.0f );
+       
+       for( instance = 0; instance < NUM_INSTANCES; instance++ )
+       {
+           esSceneAddNode( &userData->scene, VIEW_NODE );
+           esSceneSetRotation( &userData->scene, INSTANCE_NODE( instance ), userData->angle[instance], 1.0f, 0.0f, 1.0f );
+       }
+       
+       userData->bounds     = malloc( NUM_INSTANCES * sizeof( ESAABB ) );
+       userData->visible    = malloc( NUM_INSTANCES * sizeof( int ) );
+       userData->numVisible = 0;
+       userData->visibleWorld = malloc( NUM_INSTANCES * sizeof( ESMatrix ) );
+       
+       // Built over the first frame's bounds
+       esCullTreeInit( &userData->cullTree, NUM_INSTANCES );
+       
+       // the ring bound its buffer itself
+       esStateInvalidateBinding( cache, GL_ARRAY_BUFFER );
    }
-   glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
+
+// Same cubes as the instancing path, but drawn as separate draws that the batcher
+// merges back into instanced ones
+void GenerateCubesByBatching(UserData *userData)
+{
+    GenerateCubesByInstancing( userData );
+    
+    userData->mvps = malloc( NUM_INSTANCES * sizeof( ESMatrix ) );
+    
+    esBatchInit( &userData->batch, NUM_INSTANCES, MVP_LOC, COLOR_LOC );
+}
+
+// The mesh part of the draw lives in a VAO, the batcher adds the instance attributes to it.
+// Built on the first frame the streamed geometry is ready
+void SetupCubeVAO(UserData *userData)
+{
+    ESStateCache *cache = &userData->stateCache;
+    
+    glGenVertexArrays( 1, &userData->cubeVAO );
+    esStateBindVertexArray( cache, userData->cubeVAO );
+    esStateBindBuffer( cache, GL_ARRAY_BUFFER, userData->positionVBO );
+    glVertexAttribPointer( POSITION_LOC, 3, GL_FLOAT, GL_FALSE, 3 * sizeof( GLfloat ), ( const void * ) NULL );
+    esStateEnableVertexAttribArray( cache, POSITION_LOC );
+    esStateBindBuffer( cache, GL_ELEMENT_ARRAY_BUFFER, userData->indicesIBO );
+    esStateBindVertexArray( cache, 0 );
 }
 
 int Init( ESContext *esContext )
 {
     UserData *userData = esContext->userData;
+    ESStateCache *cache = &userData->stateCache;
     char vShaderStr[] =
         "#version 300 es                          \n"
         "layout(location = 0) in vec4 a_position; \n"
@@ -153,6 +296,9 @@ int Init( ESContext *esContext )
         " outColor = v_color;                    \n"
         "}                                       \n";
     
+    const char *vShaderSrc = vShaderStr;
+    const char *fShaderSrc = fShaderStr;
+    ESProgramFuture programFuture;
     GLuint  programObject;
     
     // 3 vertices, with ( x,y,z ) , ( r, g, b, a ) per-vertex
@@ -167,19 +313,8 @@ int Init( ESContext *esContext )
     // Index buffer data
     //GLushort indices[3] = { 0, 1, 2 };
     
-    // Create the program object
-    programObject  = esLoadProgram( vShaderStr, fShaderStr );
-    // get uniform location
-    userData->offsetLoc = glGetUniformLocation( programObject, "u_offset" );
-    userData->mvpLoc = glGetUniformLocation( programObject, "u_mvpMatrix");
-    
-    if( programObject == 0 )
-    {
-        return GL_FALSE;
-    }
-    
-    // Store the program object
-    userData->programObject = programObject;
+    // Start building the program object, the geometry is generated while the driver compiles
+    esLoadProgramsAsync( &programFuture, &vShaderSrc, &fShaderSrc, 1 );
     
     // vbo
     userData->vboIds[0] = 0;
@@ -187,59 +322,108 @@ int Init( ESContext *esContext )
     userData->vboIds[2] = 0;
     //
     
+    userData->bounds     = NULL;
+    userData->visible    = NULL;
+    userData->visibleWorld = NULL;
+    userData->mvps       = NULL;
+    userData->cubeVAO    = 0;
+    memset( &userData->batch, 0, sizeof( ESBatch ) );
+    memset( &userData->mvpRing, 0, sizeof( ESRingBuffer ) );
+    memset( &userData->cullTree, 0, sizeof( ESCullTree ) );
+    memset( &userData->scene, 0, sizeof( ESScene ) );
+    memset( &userData->streamRing, 0, sizeof( ESRingBuffer ) );
+    memset( &userData->cubePositions, 0, sizeof( ESAsset ) );
+    memset( &userData->cubeIndices, 0, sizeof( ESAsset ) );
+    
+    // Nothing is known about the context's bindings yet
+    esStateCacheInit( cache );
+    
+    if( !esDrawQueueInit( &userData->drawQueue, 64 ) )
+    {
+        return GL_FALSE;
+    }
+    
+    // Worker threads for the per-instance updates and the asset loads
+    esJobSystemInit( 0 );
+    
+    if( !esAssetStreamerInit( &userData->streamer, 0 ) )
+    {
+        return GL_FALSE;
+    }
+    
     // GenerateCubeInstanced( userData );
+    // GenerateCubesByBatching( userData );
     
     GenerateCubeVertexShader( userData );
     
+    // Only now wait for the program
+    programObject = esProgramWait( &programFuture );
+    
+    if( programObject == 0 )
+    {
+        return GL_FALSE;
+    }
+    
+    // get uniform location
+    userData->offsetLoc = glGetUniformLocation( programObject, "u_offset" );
+    userData->mvpLoc = glGetUniformLocation( programObject, "u_mvpMatrix");
+    
+    // Store the program object
+    userData->programObject = programObject;
+    
     glClearColor( 1.0f, 1.0f, 1.0f, 0.0f);
     
     return GL_TRUE;
 }
 
+// State shared by the non-VAO triangle paths: default VAO, position and color arrays
+// enabled, everything else disabled, color advancing per vertex again after instancing
+void SetPerVertexState( ESStateCache *cache )
+{
+    esStateBindVertexArray( cache, 0 );
+    esStateSetVertexAttribArrays( cache, ( 1u << VERTEX_POS_INDX ) | ( 1u << VERTEX_COLOR_INDX ), NUM_VERTEX_ATTRIBS );
+    esStateVertexAttribDivisor( cache, VERTEX_COLOR_INDX, 0 );
+}
+
 void DrawPrimitiveviewWithVBOs( ESContext *esContext,
                                  GLint numVertices, GLfloat **vtxBuf,
                                  GLint *vtxStrides, GLint numIndices,
                                  GLushort *indices)
 {
     UserData *userData = esContext->userData;
+    ESStateCache *cache = &userData->stateCache;
     
     // vboIds[0] - used to store vertex position
     // vboIds[1] - used to store vertex color
     // vboIds[2] - used to store element indices
     
+    SetPerVertexState( cache );
+    
     if( userData->vboIds[0] == 0 && userData->vboIds[1] == 0 &&
          userData->vboIds[2] == 0 )
     {
         // only allocate on the first draw
         glGenBuffers( 2, userData->vboIds );
         
-        glBindBuffer( GL_ARRAY_BUFFER, userData->vboIds[0] );
+        esStateBindBuffer( cache, GL_ARRAY_BUFFER, userData->vboIds[0] );
         glBufferData( GL_ARRAY_BUFFER, vtxStrides[0] * numVertices, vtxBuf[0], GL_STATIC_DRAW );
         
-        glBindBuffer( GL_ARRAY_BUFFER, userData->vboIds[1]);
+        esStateBindBuffer( cache, GL_ARRAY_BUFFER, userData->vboIds[1]);
         glBufferData( GL_ARRAY_BUFFER, vtxStrides[1] * numVertices, vtxBuf[1], GL_STATIC_DRAW );
         
-        glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, userData->vboIds[2]);
+        esStateBindBuffer( cache, GL_ELEMENT_ARRAY_BUFFER, userData->vboIds[2]);
         glBufferData( GL_ELEMENT_ARRAY_BUFFER, sizeof( GLushort ) * numIndices, indices, GL_STATIC_DRAW );
     }
     
-    glBindBuffer( GL_ARRAY_BUFFER, userData->vboIds[0]);
-    glEnableVertexAttribArray( VERTEX_POS_INDX );
+    esStateBindBuffer( cache, GL_ARRAY_BUFFER, userData->vboIds[0]);
     glVertexAttribPointer( VERTEX_POS_INDX, VERTEX_POS_SIZE, GL_FLOAT, GL_FALSE, vtxStrides[0], 0);
     
-    glBindBuffer( GL_ARRAY_BUFFER, userData->vboIds[1]);
-    glEnableVertexAttribArray( VERTEX_COLOR_INDX );
+    esStateBindBuffer( cache, GL_ARRAY_BUFFER, userData->vboIds[1]);
     glVertexAttribPointer(VERTEX_COLOR_INDX, VERTEX_COLOR_SIZE, GL_FLOAT, GL_FALSE, vtxStrides[1], 0 );
     
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, userData->vboIds[2]);
+    esStateBindBuffer( cache, GL_ELEMENT_ARRAY_BUFFER, userData->vboIds[2]);
     
     glDrawElements(GL_TRIANGLES, numIndices, GL_UNSIGNED_SHORT, 0);
-    
-    glDisableVertexAttribArray(VERTEX_POS_INDX);
-    glDisableVertexAttribArray(VERTEX_COLOR_INDX);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
 void DrawPrimitiveWithVBOsV2( ESContext *esContext,
@@ -249,8 +433,11 @@ void DrawPrimitiveWithVBOsV2( ESContext *esContext,
 {
     
     UserData *userData = esContext->userData;
+    ESStateCache *cache = &userData->stateCache;
     GLuint offset = 0;
     
+    SetPerVertexState( cache );
+    
     // vboIds[0] - used to store vertex position
     // vboIds[1] - used to store vertex color
     // vboIds[2] - used to store element indices
@@ -260,18 +447,15 @@ void DrawPrimitiveWithVBOsV2( ESContext *esContext,
         // only allocate on the first draw
         glGenBuffers( 2, userData->vboIds );
         
-        glBindBuffer( GL_ARRAY_BUFFER, userData->vboIds[0] );
+        esStateBindBuffer( cache, GL_ARRAY_BUFFER, userData->vboIds[0] );
         glBufferData( GL_ARRAY_BUFFER, vtxStride * numVertices, vtxBuf, GL_STATIC_DRAW );
         
-        glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, userData->vboIds[1]);
+        esStateBindBuffer( cache, GL_ELEMENT_ARRAY_BUFFER, userData->vboIds[1]);
         glBufferData( GL_ELEMENT_ARRAY_BUFFER, sizeof( GLushort ) * numIndices, indices, GL_STATIC_DRAW );
     }
     
-    glBindBuffer( GL_ARRAY_BUFFER, userData->vboIds[0] );
-    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, userData->vboIds[1] );
-    
-    glEnableVertexAttribArray( VERTEX_POS_INDX );
-    glEnableVertexAttribArray( VERTEX_COLOR_INDX );
+    esStateBindBuffer( cache, GL_ARRAY_BUFFER, userData->vboIds[0] );
+    esStateBindBuffer( cache, GL_ELEMENT_ARRAY_BUFFER, userData->vboIds[1] );
     
     glVertexAttribPointer( VERTEX_POS_INDX, VERTEX_POS_SIZE, GL_FLOAT, GL_FALSE, vtxStride, (const void*) offset );
     
@@ -279,26 +463,22 @@ void DrawPrimitiveWithVBOsV2( ESContext *esContext,
     glVertexAttribPointer( VERTEX_COLOR_INDX, VERTEX_COLOR_SIZE, GL_FLOAT, GL_FALSE, vtxStride, (const void *) offset );
     
     glDrawElements( GL_TRIANGLES, numIndices, GL_UNSIGNED_SHORT, 0 );
-    
-    glDisableVertexAttribArray(VERTEX_POS_INDX);
-    glDisableVertexAttribArray(VERTEX_COLOR_INDX);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
-void DrawPrimitiveWithoutVBOs( GLfloat *vertices,
+void DrawPrimitiveWithoutVBOs( ESContext *esContext,
+                                GLfloat *vertices,
                                 GLint vtxStride,
                                  GLint numIndices,
                                   GLushort * indices )
 {
+    UserData *userData = esContext->userData;
+    ESStateCache *cache = &userData->stateCache;
     GLfloat *vtxBuf = vertices;
     
-    glBindBuffer( GL_ARRAY_BUFFER, 0 );
-    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+    SetPerVertexState( cache );
     
-    glEnableVertexAttribArray( VERTEX_POS_INDX );
-    glEnableVertexAttribArray( VERTEX_COLOR_INDX );
+    esStateBindBuffer( cache, GL_ARRAY_BUFFER, 0 );
+    esStateBindBuffer( cache, GL_ELEMENT_ARRAY_BUFFER, 0 );
     
     glVertexAttribPointer( VERTEX_POS_INDX, VERTEX_POS_SIZE,
                            GL_FLOAT, GL_FALSE, vtxStride,
@@ -312,9 +492,6 @@ void DrawPrimitiveWithoutVBOs( GLfloat *vertices,
     
     glDrawElements( GL_TRIANGLES, numIndices, GL_UNSIGNED_SHORT,
                     indices );
-    
-    glDisableVertexAttribArray( VERTEX_POS_INDX );
-    glDisableVertexAttribArray( VERTEX_COLOR_INDX );
 }
 
 void DrawPrimitiveWithVBOsMapBuffers( ESContext *esContext,
@@ -323,8 +500,11 @@ void DrawPrimitiveWithVBOsMapBuffers( ESContext *esContext,
                                       GLushort *indices)
 {
     UserData *userData = esContext->userData;
+    ESStateCache *cache = &userData->stateCache;
     GLuint offset = 0;
     
+    SetPerVertexState( cache );
+    
     // vboIds[0] - used to store vertex attributes data
     // vboIds[1] - used to store element indices
     if( userData->vboIds[0] == 0 && userData->vboIds[1] == 0 )
@@ -335,7 +515,7 @@ void DrawPrimitiveWithVBOsMapBuffers( ESContext *esContext,
         // only allocate on the first draw
         glGenBuffers( 2, userData->vboIds );
         
-        glBindBuffer( GL_ARRAY_BUFFER, userData->vboIds[0] );
+        esStateBindBuffer( cache, GL_ARRAY_BUFFER, userData->vboIds[0] );
         glBufferData( GL_ARRAY_BUFFER, vtxStride * numVertices, NULL, GL_STATIC_DRAW );
         
         vtxMappedBuf = ( GLfloat * ) glMapBufferRange( GL_ARRAY_BUFFER, 0, vtxStride * numVertices, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );
@@ -357,7 +537,7 @@ void DrawPrimitiveWithVBOsMapBuffers( ESContext *esContext,
         }
         
         // Map the index buffer
-        glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, userData->vboIds[1]);
+        esStateBindBuffer( cache, GL_ELEMENT_ARRAY_BUFFER, userData->vboIds[1]);
         glBufferData( GL_ELEMENT_ARRAY_BUFFER, sizeof( GLushort ) * numVertices, NULL, GL_STATIC_DRAW );
         
         idxMappedBuf = ( GLushort * )
@@ -380,11 +560,8 @@ void DrawPrimitiveWithVBOsMapBuffers( ESContext *esContext,
         }
     }
     
-    glBindBuffer( GL_ARRAY_BUFFER, userData->vboIds[0]);
-    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, userData->vboIds[1]);
-    
-    glEnableVertexAttribArray( VERTEX_POS_INDX );
-    glEnableVertexAttribArray( VERTEX_COLOR_INDX );
+    esStateBindBuffer( cache, GL_ARRAY_BUFFER, userData->vboIds[0]);
+    esStateBindBuffer( cache, GL_ELEMENT_ARRAY_BUFFER, userData->vboIds[1]);
     
     glVertexAttribPointer( VERTEX_POS_INDX , VERTEX_POS_SIZE, GL_FLOAT, GL_FALSE, vtxStride, ( const void * ) offset );
     
@@ -392,18 +569,77 @@ void DrawPrimitiveWithVBOsMapBuffers( ESContext *esContext,
     glVertexAttribPointer( VERTEX_COLOR_INDX, VERTEX_COLOR_SIZE, GL_FLOAT, GL_FALSE, vtxStride, ( const void * ) offset );
     
     glDrawElements( GL_TRIANGLES, numIndices, GL_UNSIGNED_SHORT, 0 );
+}
+
+// Same layout as DrawPrimitiveWithVBOsMapBuffers, but the vertices and indices are
+// re-uploaded every call through the stream ring instead of once into static VBOs.
+// Meant to be called once per frame, it closes the ring's frame after drawing
+void DrawPrimitiveWithRingBuffer( ESContext *esContext,
+                                  GLint numVertices, GLfloat *vtxBuf,
+                                  GLint vtxStride, GLint numIndices,
+                                  GLushort *indices )
+{
+    UserData *userData = esContext->userData;
+    ESStateCache *cache = &userData->stateCache;
+    GLintptr vtxOffset;
+    GLintptr idxOffset;
+    void *mappedBuf;
+    
+    SetPerVertexState( cache );
+    
+    if( userData->streamRing.buffer == 0 )
+    {
+        if( !esRingBufferInit( &userData->streamRing, GL_ARRAY_BUFFER, STREAM_RING_SIZE, ES_RING_DEFAULT_REGIONS ) )
+        {
+            esLogMessage( " Error creating stream ring buffer. " );
+            return;
+        }
+    }
+    
+    // Vertex attributes
+    mappedBuf = esRingBufferMap( &userData->streamRing, vtxStride * numVertices, sizeof( GLfloat ), &vtxOffset );
+    
+    if( mappedBuf == NULL )
+    {
+        esLogMessage( " Error mapping stream ring buffer. " );
+        return;
+    }
+    
+    memcpy( mappedBuf, vtxBuf, vtxStride * numVertices );
+    esRingBufferUnmap( &userData->streamRing );
     
-    glDisableVertexAttribArray( VERTEX_POS_INDX );
-    glDisableVertexAttribArray( VERTEX_COLOR_INDX );
+    // Element indices share the same buffer
+    mappedBuf = esRingBufferMap( &userData->streamRing, sizeof( GLushort ) * numIndices, sizeof( GLushort ), &idxOffset );
     
-    glBindBuffer( GL_ARRAY_BUFFER, 0 );
-    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+    if( mappedBuf == NULL )
+    {
+        esLogMessage( " Error mapping stream ring buffer. " );
+        return;
+    }
+    
+    memcpy( mappedBuf, indices, sizeof( GLushort ) * numIndices );
+    esRingBufferUnmap( &userData->streamRing );
+    
+    // Mapping went through the ring's own bindings
+    esStateInvalidateBinding( cache, GL_ARRAY_BUFFER );
+    
+    esStateBindBuffer( cache, GL_ARRAY_BUFFER, userData->streamRing.buffer );
+    esStateBindBuffer( cache, GL_ELEMENT_ARRAY_BUFFER, userData->streamRing.buffer );
+    
+    glVertexAttribPointer( VERTEX_POS_INDX, VERTEX_POS_SIZE, GL_FLOAT, GL_FALSE, vtxStride, ( const void * ) vtxOffset );
+    glVertexAttribPointer( VERTEX_COLOR_INDX, VERTEX_COLOR_SIZE, GL_FLOAT, GL_FALSE, vtxStride,
+                           ( const void * ) ( vtxOffset + VERTEX_POS_SIZE * sizeof( GLfloat ) ) );
+    
+    glDrawElements( GL_TRIANGLES, numIndices, GL_UNSIGNED_SHORT, ( const void * ) idxOffset );
+    
+    esRingBufferEndFrame( &userData->streamRing );
 }
 
 void DrawPrimitiveviewWithVAO( ESContext *esContext, GLint numVertices, GLfloat **vtxBuf, GLint vtxStride, GLint numIndices,
                                     GLushort *indices )
 {
     UserData *userData = esContext->userData;
+    ESStateCache *cache = &userData->stateCache;
     
     if( userData->vboIds[0] == 0
             && userData->vboIds[1] == 0 )
@@ -412,88 +648,137 @@ void DrawPrimitiveviewWithVAO( ESContext *esContext, GLint numVertices, GLfloat
         // Generate VBO Ids and load the VBOs with data
         glGenBuffers( 2, userData->vboIds );
         
-        glBindBuffer( GL_ARRAY_BUFFER, userData->vboIds[0] );
+        esStateBindBuffer( cache, GL_ARRAY_BUFFER, userData->vboIds[0] );
         
         glBufferData( GL_ARRAY_BUFFER, numVertices * vtxStride, vtxBuf, GL_STATIC_DRAW );
-         
-        glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, userData->vboIds[1]);
+        
+        esStateBindBuffer( cache, GL_ELEMENT_ARRAY_BUFFER, userData->vboIds[1]);
         
         glBufferData( GL_ELEMENT_ARRAY_BUFFER, numIndices, indices, GL_STATIC_DRAW );
-    
+        
         // Generate VAO id
         glGenVertexArrays( 1, &userData->vaoId );
-    
+        
         // Bind the VAO and then setup the vertex
         // attributes
-        glBindVertexArray( userData->vaoId );
+        esStateBindVertexArray( cache, userData->vaoId );
         
-        glBindBuffer( GL_ARRAY_BUFFER, userData->vboIds[0]);
-        glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, userData->vboIds[1]);
+        esStateBindBuffer( cache, GL_ARRAY_BUFFER, userData->vboIds[0]);
+        esStateBindBuffer( cache, GL_ELEMENT_ARRAY_BUFFER, userData->vboIds[1]);
         
-        glEnableVertexAttribArray( VERTEX_POS_INDX );
-        glEnableVertexAttribArray( VERTEX_COLOR_INDX );
+        esStateSetVertexAttribArrays( cache, ( 1u << VERTEX_POS_INDX ) | ( 1u << VERTEX_COLOR_INDX ), NUM_VERTEX_ATTRIBS );
         
         glVertexAttribPointer( VERTEX_POS_INDX, VERTEX_POS_SIZE, GL_FLOAT, GL_FALSE, VERTEX_STRIDE, ( const void * ) 0 );
         glVertexAttribPointer( VERTEX_COLOR_INDX, VERTEX_COLOR_SIZE, GL_FLOAT, GL_FALSE, VERTEX_STRIDE, ( const void * ) ( VERTEX_POS_SIZE * sizeof( GLfloat ) ) );
-        
-        // Reset to the default VAO
-        glBindVertexArray( 0 );
     }
     
     // Bind the VAO
-    glBindVertexArray( userData->vaoId );
+    esStateBindVertexArray( cache, userData->vaoId );
     // Draw with the VAO settings
     glDrawElements( GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, ( const void*) 0 );
-    // Return to the default VAO
-    glBindVertexArray( 0 );
 }
 
 void DrawCubesByInstancing( UserData *userData )
 {
+    ESStateCache *cache = &userData->stateCache;
+    
+    // Still streaming in, the MVPs written by Update are dropped
+    if( !CubeGeometryReady( userData ) )
+    {
+        esRingBufferEndFrame( &userData->mvpRing );
+        return;
+    }
+    
+    esStateBindVertexArray( cache, 0 );
+    
     // Load the vertex position
-    glBindBuffer( GL_ARRAY_BUFFER, userData->positionVBO );
+    esStateBindBuffer( cache, GL_ARRAY_BUFFER, userData->positionVBO );
     glVertexAttribPointer( POSITION_LOC, 3, GL_FLOAT, GL_FALSE, 3 * sizeof( GLfloat),( const void *) NULL);
-    glEnableVertexAttribArray( POSITION_LOC );
     
-    // Load the instance color buffer
-    glBindBuffer( GL_ARRAY_BUFFER, userData->colorVBO );
-    glVertexAttribPointer( COLOR_LOC, 4, GL_UNSIGNED_BYTE, GL_TRUE, 4 * sizeof( GLubyte ), (const void *)NULL);
-    glEnableVertexAttribArray( COLOR_LOC );
-    glVertexAttribDivisor( COLOR_LOC, 1 );
+    // Load the instance MVP buffer, the colors follow the MVPs in the same region
+    esStateBindBuffer( cache, GL_ARRAY_BUFFER, userData->mvpVBO);
     
-    // Load the instance MVP buffer
-    glBindBuffer( GL_ARRAY_BUFFER, userData->mvpVBO);
+    // Load the instance colors
+    glVertexAttribPointer( COLOR_LOC, 4, GL_UNSIGNED_BYTE, GL_TRUE, 4 * sizeof( GLubyte ), (const void *) ( userData->colorOffset ) );
+    esStateVertexAttribDivisor( cache, COLOR_LOC, 1 );
     
-    // Load each matrix row of the MVP, Each row gets an increasing attribute location
-    glVertexAttribPointer( MVP_LOC + 0, 4, GL_FLOAT, GL_FALSE, sizeof(ESMatrix), (const void *) NULL );
-    glVertexAttribPointer( MVP_LOC + 1, 4, GL_FLOAT, GL_FALSE, sizeof(ESMatrix), (const void *) ( sizeof(GLfloat) * 4 ) );
-    glVertexAttribPointer( MVP_LOC + 2, 4, GL_FLOAT, GL_FALSE, sizeof(ESMatrix), (const void *) ( sizeof(GLfloat) * 8 ) );
-    glVertexAttribPointer( MVP_LOC + 3, 4, GL_FLOAT, GL_FALSE, sizeof(ESMatrix), (const void *) ( sizeof(GLfloat) * 12 ) );
+    // Load each matrix row of the MVP, Each row gets an increasing attribute location.
+    // This frame's matrices start at mvpOffset inside the ring
+    glVertexAttribPointer( MVP_LOC + 0, 4, GL_FLOAT, GL_FALSE, sizeof(ESMatrix), (const void *) ( userData->mvpOffset ) );
+    glVertexAttribPointer( MVP_LOC + 1, 4, GL_FLOAT, GL_FALSE, sizeof(ESMatrix), (const void *) ( userData->mvpOffset + sizeof(GLfloat) * 4 ) );
+    glVertexAttribPointer( MVP_LOC + 2, 4, GL_FLOAT, GL_FALSE, sizeof(ESMatrix), (const void *) ( userData->mvpOffset + sizeof(GLfloat) * 8 ) );
+    glVertexAttribPointer( MVP_LOC + 3, 4, GL_FLOAT, GL_FALSE, sizeof(ESMatrix), (const void *) ( userData->mvpOffset + sizeof(GLfloat) * 12 ) );
     
-    glEnableVertexAttribArray( MVP_LOC + 0 );
-    glEnableVertexAttribArray( MVP_LOC + 1 );
-    glEnableVertexAttribArray( MVP_LOC + 2 );
-    glEnableVertexAttribArray( MVP_LOC + 3 );
+    esStateSetVertexAttribArrays( cache, ( 1u << POSITION_LOC ) | ( 1u << COLOR_LOC ) | ( 0xFu << MVP_LOC ), NUM_VERTEX_ATTRIBS );
     
     // One MVP per instance
-    glVertexAttribDivisor( MVP_LOC + 0, 1 );
-    glVertexAttribDivisor( MVP_LOC + 1, 1 );
-    glVertexAttribDivisor( MVP_LOC + 2, 1 );
-    glVertexAttribDivisor( MVP_LOC + 3, 1 );
+    esStateVertexAttribDivisor( cache, MVP_LOC + 0, 1 );
+    esStateVertexAttribDivisor( cache, MVP_LOC + 1, 1 );
+    esStateVertexAttribDivisor( cache, MVP_LOC + 2, 1 );
+    esStateVertexAttribDivisor( cache, MVP_LOC + 3, 1 );
     
     // Bind the index buffer
-    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, userData->indicesIBO);
+    esStateBindBuffer( cache, GL_ELEMENT_ARRAY_BUFFER, userData->indicesIBO);
+    
+    // Only the instances that survived culling
+    if( userData->numVisible > 0 )
+    {
+        glDrawElementsInstanced( GL_TRIANGLES, userData->numIndices, GL_UNSIGNED_INT, (const void *) NULL,
+                                 userData->numVisible );
+    }
     
-    glDrawElementsInstanced( GL_TRIANGLES, userData->numIndices, GL_UNSIGNED_INT, (const void *) NULL, NUM_INSTANCES );
+    // Fence this frame's MVP region
+    esRingBufferEndFrame( &userData->mvpRing );
 }
 
-void DrawCubeByVertexShader( ESContext *esContext )
+void DrawCubesByBatching( UserData *userData )
 {
-    UserData *userData = esContext->userData;
+    ESBatchMesh mesh;
+    int i;
+    
+    // Still streaming in
+    if( !CubeGeometryReady( userData ) )
+    {
+        return;
+    }
+    
+    if( userData->cubeVAO == 0 )
+    {
+        SetupCubeVAO( userData );
+    }
+    
+    mesh.program     = userData->programObject;
+    mesh.vertexArray = userData->cubeVAO;
+    mesh.mode        = GL_TRIANGLES;
+    mesh.indexType   = GL_UNSIGNED_INT;
+    mesh.indexOffset = 0;
+    mesh.count       = userData->numIndices;
+    
+    // One draw per visible cube, as a scene would submit them
+    for( i = 0; i < userData->numVisible; i++ )
+    {
+        esBatchAdd( &userData->batch, &mesh, &userData->mvps[i], userData->colors[userData->visible[i]] );
+    }
+    
+    // All of them share mesh and program, this ends up as a single instanced draw
+    esBatchFlush( &userData->batch, &userData->stateCache );
+}
+
+// Packet setup for DrawCubeByVertexShader, runs once the program is bound
+void ESCALLBACK SetupCubeByVertexShader( void *arg )
+{
+    UserData *userData = ( UserData * ) arg;
+    ESStateCache *cache = &userData->stateCache;
+    
+    // Client-side arrays, only the position comes from an array so the
+    // constant color below applies
+    esStateBindVertexArray( cache, 0 );
+    esStateBindBuffer( cache, GL_ARRAY_BUFFER, 0 );
+    esStateBindBuffer( cache, GL_ELEMENT_ARRAY_BUFFER, 0 );
+    esStateSetVertexAttribArrays( cache, 1u << POSITION_LOC, NUM_VERTEX_ATTRIBS );
     
     // Load the vertex position
     glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof( GLfloat ), userData->vertices );
-    glEnableVertexAttribArray( 0 );
     
     // Set the vertex position
     glVertexAttrib4f( 1, 1.0f, 0.0f, 0.0f, 1.0f );
@@ -501,69 +786,183 @@ void DrawCubeByVertexShader( ESContext *esContext )
     // Load the MVP matrix
     glUniformMatrix4fv( userData->mvpLoc, 1, GL_FALSE, ( GLfloat * )
                        &userData->mvpMatrix.m[0][0] );
-    
-    // Draw the cube
-    glDrawElements( GL_TRIANGLES, userData->numIndices, GL_UNSIGNED_INT, userData->indices);
 }
-                            
-void UpdateCubesByInstancing( ESContext *esContext, float deltaTime )
+
+void DrawCubeByVertexShader( ESContext *esContext )
 {
-    UserData *useData = ( UserData * ) esContext->userData;
+    UserData *userData = esContext->userData;
+    ESDrawPacket packet;
+    
+    memset( &packet, 0, sizeof( ESDrawPacket ) );
+    packet.program   = userData->programObject;
+    packet.mode      = GL_TRIANGLES;
+    packet.indexType = GL_UNSIGNED_INT;
+    // No element buffer is bound, the indices are a client pointer
+    packet.first     = ( GLintptr ) userData->indices;
+    packet.count     = userData->numIndices;
+    // The cube sits 2 units in front of the camera ( UpdateCubeByVertexShader )
+    packet.depth     = 2.0f;
+    packet.setup     = SetupCubeByVertexShader;
+    packet.setupArg  = userData;
+    
+    // Queue the cube, Draw emits the whole frame at once
+    esDrawQueueSubmit( &userData->drawQueue, &packet );
+}
+
+typedef struct
+{
+    UserData *userData;
+    // Mapped mvpVBO storage
     ESMatrix *matrixBuf;
-    ESMatrix perspective;
+    // Colors packed after the MVPs, NULL when the draw reads them from userData
+    GLubyte ( *colorBuf )[4];
+    ESMatrix  perspective;
+} InstanceUpdate;
+
+// Model space bounds of the cubes, esGenCube( 0.5f ) spans -0.25 to 0.25
+static const ESAABB cubeBounds = { { -0.25f, -0.25f, -0.25f }, { 0.25f, 0.25f, 0.25f } };
+
+// View space boxes of the moved instances, [ begin, end ) indexes the scene's updated list
+void ESCALLBACK UpdateBoundsRange( void *arg, int begin, int end )
+{
+    InstanceUpdate *update = ( InstanceUpdate * ) arg;
+    UserData *useData = update->userData;
+    ESScene *scene = &useData->scene;
+    int i;
+    
+    for( i = begin; i < end; i++ )
+    {
+        int node = scene->updated[i];
+        
+        if( node != VIEW_NODE )
+        {
+            esAABBTransform( &useData->bounds[node - INSTANCE_NODE( 0 )], &cubeBounds, esSceneWorld( scene, node ) );
+        }
+    }
+}
+
+// Compute the MVPs of the visible instances [ begin, end ), packed in the order of the visible list.
+// The scattered world matrices are gathered first, so the whole range is a single batched multiply
+void ESCALLBACK GatherVisibleRange( void *arg, int begin, int end )
+{
+    InstanceUpdate *update = ( InstanceUpdate * ) arg;
+    UserData *useData = update->userData;
+    int i;
+    
+    for( i = begin; i < end; i++ )
+    {
+        int instance = useData->visible[i];
+        
+        useData->visibleWorld[i] = useData->scene.world[INSTANCE_NODE( instance )];
+        
+        if( update->colorBuf != NULL )
+        {
+            memcpy( update->colorBuf[i], useData->colors[instance], 4 );
+        }
+    }
+    
+    esMatrixMultiplyBatch( &update->matrixBuf[begin], &useData->visibleWorld[begin], &update->perspective, end - begin );
+}
+
+// Move the instances, cull them against the view frustum and compute an MVP per visible
+// instance, spread over the job workers straight into matrixBuf
+void UpdateInstances( ESContext *esContext, float deltaTime, ESMatrix *matrixBuf, GLubyte ( *colorBuf )[4] )
+{
+    UserData *userData = ( UserData * ) esContext->userData;
+    InstanceUpdate update;
+    ESQuaternion spin;
+    ESFrustum frustum;
     float aspect;
-    int instance = 0;
-    int numRows;
-    int numCols;
+    int instance;
+    int i;
     
     // Compute the win aspect ratio
     aspect = ( GLfloat ) esContext->width / ( GLfloat ) esContext->height;
     
     // Generate a perspective matrix with a 60 degree FOV
-    esMatrixLoadIdentity( &perspective );
-    esPerspective( &perspective, 60.0f, aspect, 1.0f, 20.0f );
+    esMatrixLoadIdentity( &update.perspective );
+    esPerspective( &update.perspective, 60.0f, aspect, 1.0f, 20.0f );
     
-    glBindBuffer( GL_ARRAY_BUFFER, useData->mvpVBO );
-    matrixBuf = ( ESMatrix * ) glMapBufferRange( GL_ARRAY_BUFFER, 0, sizeof( ESMatrix ) * NUM_INSTANCES, GL_MAP_WRITE_BIT );
+    update.matrixBuf = matrixBuf;
+    update.colorBuf  = colorBuf;
+    update.userData  = userData;
     
-    // Compute a per-instance MVP that translates and rotates each instance differently
-    numRows = (int)sqrtf( NUM_INSTANCES );
-    numCols = numRows;
+    // Every cube turns 40 degrees a second around the same axis, so one
+    // quaternion advances them all without any per-cube trigonometry
+    esQuaternionFromAxisAngle( &spin, deltaTime * 40.0f, 1.0f, 0.0f, 1.0f );
     
     for( instance = 0; instance < NUM_INSTANCES; instance++ )
     {
-        ESMatrix modelview;
-        float translateX = 0.0f;//( ( float ) ( instance % numRows ) / ( float ) numRows ) * 2.0f - 1.0f;
-        float translateY = 0.0f;//( ( float ) ( instance / numCols ) / ( float ) numCols ) * 2.0f - 1.0f;
-        
-        // Generate a mode view matrix to rotate/translate the cube
-        esMatrixLoadIdentity( &modelview );
-        
-        // Per-instance translation
-        esTranslate( &modelview, translateX, translateY, -5.0f);
-        
-        // Compute a rotation angle based on time to rotate the cube
-        useData->angle[instance] += ( deltaTime * 40.0f );
-        if( useData->angle[instance] >= 360.0f )
+        esSceneRotate( &userData->scene, INSTANCE_NODE( instance ), &spin );
+    }
+    
+    // Only the moved nodes get new world matrices and bounds
+    esSceneUpdate( &userData->scene );
+    esJobParallelFor( userData->scene.numUpdated, INSTANCE_GRAIN_SIZE, UpdateBoundsRange, &update );
+    
+    // The bounds are in view space, so the frustum comes from the perspective alone
+    if( userData->cullTree.numObjects == 0 )
+    {
+        esCullTreeBuild( &userData->cullTree, userData->bounds, NUM_INSTANCES );
+    }
+    else
+    {
+        for( i = 0; i < userData->scene.numUpdated; i++ )
         {
-            useData->angle[instance] -= 360.0f;
+            int moved = userData->scene.updated[i] - INSTANCE_NODE( 0 );
+            
+            // the view node itself has no bounds
+            if( moved >= 0 )
+            {
+                esCullTreeSetBounds( &userData->cullTree, moved, &userData->bounds[moved] );
+            }
         }
         
-        // Rotate the cube
-        esRotate( &modelview, useData->angle[instance], 1.0f, 0.0, 1.0 );
-        
-        //esRotate( &modelview, 0.0, 1.0f, 0.0, 1.0 );
-        // Compute the final MVP by multiplying the
-        // modelview and perspective matrices together
-        esMatrixMultiply( &matrixBuf[instance], &modelview, &perspective);
+        esCullTreeRefit( &userData->cullTree );
+    }
+    
+    esFrustumFromMatrix( &frustum, &update.perspective );
+    userData->numVisible = esCullTreeQuery( &userData->cullTree, &frustum, userData->visible );
+    
+    esJobParallelFor( userData->numVisible, INSTANCE_GRAIN_SIZE, GatherVisibleRange, &update );
+}
+
+void UpdateCubesByInstancing( ESContext *esContext, float deltaTime )
+{
+    UserData *useData = ( UserData * ) esContext->userData;
+    ESMatrix *matrixBuf;
+    
+    matrixBuf = ( ESMatrix * ) esRingBufferMap( &useData->mvpRing, ( sizeof( ESMatrix ) + 4 ) * NUM_INSTANCES,
+                                                sizeof( ESMatrix ), &useData->mvpOffset );
+    
+    if( matrixBuf == NULL )
+    {
+        esLogMessage( " Error mapping mvp buffer object. " );
+        return;
     }
     
-    glUnmapBuffer( GL_ARRAY_BUFFER );
+    // The colors follow the room for every instance's MVP
+    UpdateInstances( esContext, deltaTime, matrixBuf, ( GLubyte ( * )[4] ) ( matrixBuf + NUM_INSTANCES ) );
+    useData->colorOffset = useData->mvpOffset + sizeof( ESMatrix ) * NUM_INSTANCES;
+    
+    esRingBufferUnmap( &useData->mvpRing );
+    esStateInvalidateBinding( &useData->stateCache, GL_ARRAY_BUFFER );
+}
+
+void UpdateCubesByBatching( ESContext *esContext, float deltaTime )
+{
+    UserData *useData = ( UserData * ) esContext->userData;
+    
+    // The batcher copies the MVPs into its own instance buffer when drawing
+    UpdateInstances( esContext, deltaTime, useData->mvps, NULL );
 }
 
 void UpdateCubeByVertexShader( ESContext *esContext, float deltaTime )
 {
     UserData *useData = ( UserData * ) esContext->userData;
+    // Translate away from the viewer
+    const GLfloat translation[3] = { 0.0f, 0.0f, -2.0f };
+    ESQuaternion rotation;
     ESMatrix perspective;
     ESMatrix modelview;
     float aspect;
@@ -583,14 +982,10 @@ void UpdateCubeByVertexShader( ESContext *esContext, float deltaTime )
     esMatrixLoadIdentity( &perspective );
     esPerspective( &perspective, 60.0f, aspect, 1.0, 20.0f );
     
-    // Generate a model view matrix to rotate/translate the cube
-    esMatrixLoadIdentity( &modelview );
-    
-    // Translate away from the viewer
-    esTranslate( &modelview, 0.0f, 0.0f, -2.0);
-    
-    // Rotate the cube
-    esRotate( &modelview, useData->angle[0], 1.0, 0.0, 1.0 );
+    // Generate a model view matrix to rotate/translate the cube, written directly
+    // instead of identity, translate and rotate
+    esQuaternionFromAxisAngle( &rotation, useData->angle[0], 1.0f, 0.0f, 1.0f );
+    esMatrixFromTRS( &modelview, translation, &rotation, NULL );
     
     // Compute the final MVP by multiplying the
     // modelview and perspective matrices together
@@ -600,6 +995,7 @@ void UpdateCubeByVertexShader( ESContext *esContext, float deltaTime )
 void Update( ESContext *esContext, float deltaTime )
 {
     // UpdateCubesByInstanced( esContext, deltaTime );
+    // UpdateCubesByBatching( esContext, deltaTime );
     
     UpdateCubeByVertexShader( esContext, deltaTime );
 }
@@ -658,15 +1054,18 @@ void Draw( ESContext *esContext )
     };
     GLushort indices[3] = { 0, 1, 2 };
     
+    // Turn a few finished loads into GL objects, the rest waits for the next frames
+    esAssetPump( &userData->streamer, &userData->stateCache, ASSET_UPLOAD_BUDGET_NS );
+    
     // set the viewport
-    glViewport( 0, 0, esContext->width, esContext->height);
+    esStateViewport( &userData->stateCache, 0, 0, esContext->width, esContext->height );
     // clear the color buffer
     glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
     // use the program object
-    glUseProgram( userData->programObject );
+    esStateUseProgram( &userData->stateCache, userData->programObject );
     
     //glUniform1f( userData->offsetLoc, 0.0f );
-    //DrawPrimitiveWithoutVBOs( vertices, sizeof( GLfloat ) * ( VERTEX_POS_SIZE + VERTEX_COLOR_SIZE ) , 3, indices );
+    //DrawPrimitiveWithoutVBOs( esContext, vertices, sizeof( GLfloat ) * ( VERTEX_POS_SIZE + VERTEX_COLOR_SIZE ) , 3, indices );
     
     //DrawPrimitiveWithVBOsMapBuffers( esContext, 3, vertices, sizeof(GL_FLOAT) * ( VERTEX_POS_SIZE + VERTEX_COLOR_SIZE ), 3, indices);
     //DrawPrimitiveviewWithVAO( esContext, 3, vertices, sizeof( GL_FLOAT ) * ( VERTEX_POS_SIZE + VERTEX_COLOR_SIZE ), sizeof( GLushort ) * 3, //indices );
@@ -675,8 +1074,12 @@ void Draw( ESContext *esContext )
     //DrawPrimitiveWithVBOsV2( esContext, 3, vertices, sizeof( GLfloat ) * ( VERTEX_POS_SIZE + VERTEX_COLOR_SIZE ), 3, indices );
     
     // DrawCubsWithVBOs( userData );
+    // DrawCubesByBatching( userData );
     
     DrawCubeByVertexShader( esContext );
+    
+    // Sort the frame's packets by state and depth and issue them
+    esDrawQueueFlush( &userData->drawQueue, &userData->stateCache );
 }
 
 void Shutdown( ESContext *esContext )
@@ -693,7 +1096,47 @@ void Shutdown( ESContext *esContext )
         free( userData->indices );
     }
     
+    if( userData->mvps != NULL )
+    {
+        free( userData->mvps );
+    }
+    
+    if( userData->bounds != NULL )
+    {
+        free( userData->bounds );
+    }
+    
+    if( userData->visible != NULL )
+    {
+        free( userData->visible );
+    }
+    
+    if( userData->visibleWorld != NULL )
+    {
+        free( userData->visibleWorld );
+    }
+    
+    esCullTreeDestroy( &userData->cullTree );
+    esSceneDestroy( &userData->scene );
+    
+    if( userData->cubeVAO != 0 )
+    {
+        esStateDeleteVertexArrays( &userData->stateCache, 1, &userData->cubeVAO );
+    }
+    
+    esBatchDestroy( &userData->batch );
+    
+    esRingBufferDestroy( &userData->mvpRing );
+    esRingBufferDestroy( &userData->streamRing );
+    
+    esDrawQueueDestroy( &userData->drawQueue );
+    
+    // Waits for loads still running
+    esAssetStreamerDestroy( &userData->streamer );
+    
     glDeleteProgram( userData->programObject );
+    
+    esJobSystemShutdown();
 }
 
 int esMain( ESContext *esContext)
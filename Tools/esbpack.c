@@ -0,0 +1,265 @@
+//
+//  esbpack.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  Offline packer for .esb bundles. Generates the ESUtil shapes and reads TGA
+//  files, does every conversion the runtime would otherwise do ( interleaving,
+//  quantization, vertex cache ordering, BGR swizzle, mip chains ) and writes
+//  the result GPU-ready.
+//
+//  esbpack [-q] [-f box|kaiser] output.esb item...
+//      cube:NAME[:SCALE]
+//      sphere:NAME[:SLICES[:RADIUS]]
+//      grid:NAME[:SIZE]
+//      tga:NAME:FILE
+//  Meshes become the sections NAME.vertices and NAME.indices, images NAME.
+//  -q packs vertices as half positions, 2_10_10_10 normals and unorm16 uvs
+//
+
+#include "ESBundle.h"
+#include "ESImage.h"
+#include "ESMeshOpt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Kept off the stack, the writer holds the whole section table
+static ESBundleWriter writer;
+
+static void usage( void )
+{
+    fprintf( stderr, "usage: esbpack [-q] [-f box|kaiser] output.esb item...\n"
+                     "  cube:NAME[:SCALE]\n"
+                     "  sphere:NAME[:SLICES[:RADIUS]]\n"
+                     "  grid:NAME[:SIZE]\n"
+                     "  tga:NAME:FILE\n" );
+}
+
+// Optimize the float streams, pack them into format and add both sections
+static int addMesh( const char *name, const ESVertexFormat *format, GLfloat *positions, GLfloat *normals,
+                    GLfloat *texCoords, int numVertices, GLuint *indices, int numIndices )
+{
+    char sectionName[ES_BUNDLE_NAME_SIZE + 16];
+    void *vertices = malloc( ( size_t ) format->stride * numVertices );
+    int ok = vertices != NULL;
+    
+    if( ok )
+    {
+        esMeshOptimizeShape( indices, numIndices, numVertices, positions, normals, texCoords );
+        esVertexFormatPack( format, vertices, numVertices, positions, normals, texCoords );
+        
+        snprintf( sectionName, sizeof( sectionName ), "%s.vertices", name );
+        ok = esBundleAddVertices( &writer, sectionName, format, vertices, numVertices );
+        
+        snprintf( sectionName, sizeof( sectionName ), "%s.indices", name );
+        ok = ok && esBundleAddIndices( &writer, sectionName, indices, numIndices, numVertices );
+    }
+    
+    printf( "%-24s %6d vertices %7d indices %3d bytes per vertex\n", name, numVertices, numIndices, format->stride );
+    
+    free( vertices );
+    free( positions );
+    free( normals );
+    free( texCoords );
+    free( indices );
+    
+    return ok;
+}
+
+static int addGrid( const char *name, const ESVertexFormat *format, int size )
+{
+    ESShapeStreams dest;
+    GLuint *indices;
+    int numVertices;
+    int numIndices;
+    
+    esGenSquareGridSize( size, &numVertices, &numIndices );
+    
+    if( numIndices == 0 )
+    {
+        return 0;
+    }
+    
+    memset( &dest, 0, sizeof( ESShapeStreams ) );
+    dest.positions = malloc( sizeof( GLfloat ) * 3 * numVertices );
+    dest.normals   = malloc( sizeof( GLfloat ) * 3 * numVertices );
+    dest.texCoords = malloc( sizeof( GLfloat ) * 2 * numVertices );
+    indices        = malloc( sizeof( GLuint ) * numIndices );
+    
+    if( dest.positions == NULL || dest.normals == NULL || dest.texCoords == NULL || indices == NULL )
+    {
+        free( dest.positions );
+        free( dest.normals );
+        free( dest.texCoords );
+        free( indices );
+        return 0;
+    }
+    
+    esGenSquareGridInto( size, &dest, indices, 0 );
+    
+    return addMesh( name, format, dest.positions, dest.normals, dest.texCoords, numVertices, indices, numIndices );
+}
+
+static int addImage( const char *name, const char *fileName, ESMipFilter filter )
+{
+    ESImage image;
+    GLubyte *pixels;
+    int ok;
+    
+    if( !esImageOpenTGA( &image, fileName ) )
+    {
+        return 0;
+    }
+    
+    pixels = malloc( esImageDecodedSize( &image ) );
+    ok     = pixels != NULL && esImageDecode( &image, pixels ) &&
+             esBundleAddTexture( &writer, name, pixels, image.width, image.height, image.channels, filter );
+    
+    printf( "%-24s %4d x %-4d %d channels\n", name, image.width, image.height, image.channels );
+    
+    free( pixels );
+    esImageClose( &image );
+    
+    return ok;
+}
+
+static int addItem( const char *item, const ESVertexFormat *format, ESMipFilter filter )
+{
+    char kind[16];
+    char name[ES_BUNDLE_NAME_SIZE];
+    const char *args;
+    const char *colon = strchr( item, ':' );
+    size_t length;
+    
+    if( colon == NULL || ( size_t ) ( colon - item ) >= sizeof( kind ) )
+    {
+        return 0;
+    }
+    
+    memcpy( kind, item, colon - item );
+    kind[ colon - item ] = '\0';
+    
+    // NAME runs up to the next colon
+    args   = strchr( colon + 1, ':' );
+    length = args != NULL ? ( size_t ) ( args - colon - 1 ) : strlen( colon + 1 );
+    
+    if( length == 0 || length >= sizeof( name ) - 16 )
+    {
+        return 0;
+    }
+    
+    memcpy( name, colon + 1, length );
+    name[length] = '\0';
+    args = args != NULL ? args + 1 : "";
+    
+    if( strcmp( kind, "cube" ) == 0 )
+    {
+        GLfloat *positions;
+        GLfloat *normals;
+        GLfloat *texCoords;
+        GLuint  *indices;
+        float scale = *args ? ( float ) atof( args ) : 1.0f;
+        int numIndices = esGenCube( scale, &positions, &normals, &texCoords, &indices );
+        
+        return addMesh( name, format, positions, normals, texCoords, 24, indices, numIndices );
+    }
+    
+    if( strcmp( kind, "sphere" ) == 0 )
+    {
+        GLfloat *positions;
+        GLfloat *normals;
+        GLfloat *texCoords;
+        GLuint  *indices;
+        int numSlices = *args ? atoi( args ) : 20;
+        const char *radius = strchr( args, ':' );
+        int numVertices;
+        int numIndices;
+        
+        esGenSphereSize( numSlices, &numVertices, NULL );
+        
+        if( numVertices == 0 )
+        {
+            return 0;
+        }
+        
+        numIndices = esGenSphere( numSlices, radius != NULL ? ( float ) atof( radius + 1 ) : 1.0f,
+                                  &positions, &normals, &texCoords, &indices );
+        
+        return addMesh( name, format, positions, normals, texCoords, numVertices, indices, numIndices );
+    }
+    
+    if( strcmp( kind, "grid" ) == 0 )
+    {
+        return addGrid( name, format, *args ? atoi( args ) : 16 );
+    }
+    
+    if( strcmp( kind, "tga" ) == 0 && *args )
+    {
+        return addImage( name, args, filter );
+    }
+    
+    return 0;
+}
+
+int main( int argc, char *argv[] )
+{
+    ESVertexFormat format;
+    ESMipFilter filter = ES_MIP_KAISER;
+    int quantize = 0;
+    int arg = 1;
+    int ok = 1;
+    int i;
+    
+    for( ; arg < argc && argv[arg][0] == '-'; arg++ )
+    {
+        if( strcmp( argv[arg], "-q" ) == 0 )
+        {
+            quantize = 1;
+        }
+        else if( strcmp( argv[arg], "-f" ) == 0 && arg + 1 < argc )
+        {
+            filter = strcmp( argv[++arg], "box" ) == 0 ? ES_MIP_BOX : ES_MIP_KAISER;
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    
+    if( argc - arg < 2 )
+    {
+        usage();
+        return 1;
+    }
+    
+    if( quantize )
+    {
+        esVertexFormatInit( &format, ES_ATTRIB_HALF, ES_ATTRIB_INT_2_10_10_10_REV, ES_ATTRIB_UNORM16, 1.0f );
+    }
+    else
+    {
+        esVertexFormatInit( &format, ES_ATTRIB_FLOAT, ES_ATTRIB_FLOAT, ES_ATTRIB_FLOAT, 1.0f );
+    }
+    
+    esBundleWriterInit( &writer );
+    
+    for( i = arg + 1; ok && i < argc; i++ )
+    {
+        ok = addItem( argv[i], &format, filter );
+        
+        if( !ok )
+        {
+            fprintf( stderr, "esbpack: can't pack %s\n", argv[i] );
+        }
+    }
+    
+    ok = ok && esBundleWrite( &writer, argv[arg] );
+    
+    esBundleWriterDestroy( &writer );
+    
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,364 @@
+//
+//  ESAssetTest.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  esAsset buffer streaming against recording GL tables: more loads than the
+//  upload queue holds, with the loads running inline on the render thread,
+//  must neither block nor fail, and destroying the streamer fails whatever
+//  was not uploaded yet.
+//
+
+#include "ESAsset.h"
+#include "ESTest.h"
+#include <stdlib.h>
+
+// well past ES_ASSET_QUEUE_SIZE, and past ES_JOB_QUEUE_SIZE so submitting runs loads inline
+#define NUM_LOADS    300
+#define NUM_THREADED ( ES_JOB_QUEUE_SIZE * 3 )
+
+static GLuint mockNextName;
+static int    mockBufferDatas;
+// the first word of every uploaded buffer, by buffer name
+static int    mockUploaded[NUM_THREADED + 16];
+
+static void GL_APIENTRY mockGenTextures( GLsizei n, GLuint *textures )
+{
+    ( void ) n;
+    
+    textures[0] = ++mockNextName;
+}
+
+static void GL_APIENTRY mockTexImage2D( GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+                                        GLint border, GLenum format, GLenum type, const void *pixels )
+{
+    ( void ) target;
+    ( void ) level;
+    ( void ) internalformat;
+    ( void ) width;
+    ( void ) height;
+    ( void ) border;
+    ( void ) format;
+    ( void ) type;
+    ( void ) pixels;
+}
+
+static void GL_APIENTRY mockTexParameteri( GLenum target, GLenum pname, GLint param )
+{
+    ( void ) target;
+    ( void ) pname;
+    ( void ) param;
+}
+
+static void GL_APIENTRY mockPixelStorei( GLenum pname, GLint param )
+{
+    ( void ) pname;
+    ( void ) param;
+}
+
+static void GL_APIENTRY mockGenBuffers( GLsizei n, GLuint *buffers )
+{
+    ( void ) n;
+    
+    buffers[0] = ++mockNextName;
+}
+
+static void GL_APIENTRY mockDeleteBuffers( GLsizei n, const GLuint *buffers )
+{
+    ( void ) n;
+    ( void ) buffers;
+}
+
+static void GL_APIENTRY mockBindBuffer( GLenum target, GLuint buffer )
+{
+    ( void ) target;
+    ( void ) buffer;
+}
+
+static void GL_APIENTRY mockBufferData( GLenum target, GLsizeiptr size, const void *data, GLenum usage )
+{
+    ( void ) target;
+    ( void ) size;
+    ( void ) usage;
+    
+    if( data != NULL && mockNextName < sizeof( mockUploaded ) / sizeof( mockUploaded[0] ) )
+    {
+        mockUploaded[mockNextName] = *( const int * ) data;
+    }
+    
+    mockBufferDatas++;
+}
+
+static void *GL_APIENTRY mockMapBufferRange( GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access )
+{
+    ( void ) target;
+    ( void ) offset;
+    ( void ) length;
+    ( void ) access;
+    
+    return NULL;
+}
+
+static GLboolean GL_APIENTRY mockUnmapBuffer( GLenum target )
+{
+    ( void ) target;
+    
+    return GL_TRUE;
+}
+
+static GLsync GL_APIENTRY mockFenceSync( GLenum condition, GLbitfield flags )
+{
+    ( void ) condition;
+    ( void ) flags;
+    
+    return ( GLsync ) 1;
+}
+
+static GLenum GL_APIENTRY mockClientWaitSync( GLsync sync, GLbitfield flags, GLuint64 timeout )
+{
+    ( void ) sync;
+    ( void ) flags;
+    ( void ) timeout;
+    
+    return GL_ALREADY_SIGNALED;
+}
+
+static void GL_APIENTRY mockDeleteSync( GLsync sync )
+{
+    ( void ) sync;
+}
+
+static void GL_APIENTRY mockBindVertexArray( GLuint array )
+{
+    ( void ) array;
+}
+
+static void GL_APIENTRY mockUseProgram( GLuint program )
+{
+    ( void ) program;
+}
+
+static void GL_APIENTRY mockAttribArray( GLuint index )
+{
+    ( void ) index;
+}
+
+static void GL_APIENTRY mockVertexAttribDivisor( GLuint index, GLuint divisor )
+{
+    ( void ) index;
+    ( void ) divisor;
+}
+
+static void GL_APIENTRY mockViewport( GLint x, GLint y, GLsizei width, GLsizei height )
+{
+    ( void ) x;
+    ( void ) y;
+    ( void ) width;
+    ( void ) height;
+}
+
+static void GL_APIENTRY mockActiveTexture( GLenum texture )
+{
+    ( void ) texture;
+}
+
+static void GL_APIENTRY mockBindTexture( GLenum target, GLuint texture )
+{
+    ( void ) target;
+    ( void ) texture;
+}
+
+static void GL_APIENTRY mockDeleteVertexArrays( GLsizei n, const GLuint *arrays )
+{
+    ( void ) n;
+    ( void ) arrays;
+}
+
+static const ESAssetGL mockAssetGL =
+{
+    mockGenTextures,
+    mockTexImage2D,
+    mockTexParameteri,
+    mockPixelStorei,
+    mockGenBuffers,
+    mockBindBuffer,
+    mockBufferData,
+};
+
+static const ESRingBufferGL mockRingGL =
+{
+    mockGenBuffers,
+    mockDeleteBuffers,
+    mockBindBuffer,
+    mockBufferData,
+    mockMapBufferRange,
+    mockUnmapBuffer,
+    mockFenceSync,
+    mockClientWaitSync,
+    mockDeleteSync,
+};
+
+static const ESStateCacheGL mockCacheGL =
+{
+    mockBindBuffer,
+    mockBindVertexArray,
+    mockUseProgram,
+    mockAttribArray,
+    mockAttribArray,
+    mockVertexAttribDivisor,
+    mockViewport,
+    mockActiveTexture,
+    mockBindTexture,
+    mockDeleteBuffers,
+    mockDeleteVertexArrays,
+};
+
+static ESAsset assets[NUM_THREADED];
+static int     values[NUM_THREADED];
+
+// one int holding the load's index
+static GLboolean ESCALLBACK ProduceValue( void *arg, void **data, GLsizeiptr *size )
+{
+    int *value = malloc( sizeof( int ) );
+    
+    if( value == NULL )
+    {
+        return GL_FALSE;
+    }
+    
+    *value = *( const int * ) arg;
+    *data  = value;
+    *size  = sizeof( int );
+    
+    return GL_TRUE;
+}
+
+static void LoadValues( ESAssetStreamer *streamer, int count )
+{
+    int i;
+    
+    for( i = 0; i < count; i++ )
+    {
+        values[i] = i;
+        esAssetLoadBuffer( streamer, &assets[i], GL_ARRAY_BUFFER, GL_STATIC_DRAW, ProduceValue, &values[i] );
+    }
+}
+
+static int CountState( int count, ESAssetState state )
+{
+    int i, n = 0;
+    
+    for( i = 0; i < count; i++ )
+    {
+        n += __atomic_load_n( &assets[i].state, __ATOMIC_ACQUIRE ) == ( int ) state;
+    }
+    
+    return n;
+}
+
+// Without workers every load runs inside esAssetLoadBuffer, on the thread that pumps
+static void TestInlineOverflow( ESStateCache *cache )
+{
+    ESAssetStreamer streamer;
+    int i, ordered = 1;
+    GLuint firstName;
+    
+    ES_CHECK( esAssetStreamerInit( &streamer, 0 ) );
+    firstName = mockNextName + 1;
+    
+    LoadValues( &streamer, NUM_LOADS );
+    
+    ES_CHECK( CountState( NUM_LOADS, ES_ASSET_PENDING ) == NUM_LOADS );
+    ES_CHECK( esAssetPending( &streamer ) == NUM_LOADS );
+    ES_CHECK( streamer.numOverflows == NUM_LOADS - ES_ASSET_QUEUE_SIZE );
+    
+    mockBufferDatas = 0;
+    ES_CHECK( esAssetPump( &streamer, cache, ~0ull ) == NUM_LOADS );
+    ES_CHECK( mockBufferDatas == NUM_LOADS );
+    ES_CHECK( CountState( NUM_LOADS, ES_ASSET_READY ) == NUM_LOADS );
+    ES_CHECK( esAssetPending( &streamer ) == 0 );
+    
+    // queued and overflowed uploads both come out in posting order, each with its own data
+    for( i = 0; i < NUM_LOADS; i++ )
+    {
+        ordered &= assets[i].name == firstName + i && mockUploaded[assets[i].name] == i &&
+                   assets[i].size == sizeof( int );
+    }
+    
+    ES_CHECK( ordered );
+    ES_CHECK( esAssetPump( &streamer, cache, ~0ull ) == 0 );
+    
+    esAssetStreamerDestroy( &streamer );
+}
+
+static void TestDestroyPending( ESStateCache *cache )
+{
+    ESAssetStreamer streamer;
+    
+    ES_CHECK( esAssetStreamerInit( &streamer, 0 ) );
+    
+    LoadValues( &streamer, NUM_LOADS );
+    
+    // one upload per pump once the budget is spent
+    ES_CHECK( esAssetPump( &streamer, cache, 0 ) == 1 );
+    ES_CHECK( streamer.numDeferred == 1 );
+    
+    esAssetStreamerDestroy( &streamer );
+    
+    ES_CHECK( CountState( NUM_LOADS, ES_ASSET_READY ) == 1 );
+    ES_CHECK( CountState( NUM_LOADS, ES_ASSET_FAILED ) == NUM_LOADS - 1 );
+    ES_CHECK( esAssetPending( &streamer ) == 0 );
+    ES_CHECK( streamer.overflow == NULL && streamer.overflowTaken == NULL );
+}
+
+// Submitting more loads than the worker deques hold runs the rest on this thread,
+// which must come back without anybody pumping
+static void TestThreaded( ESStateCache *cache )
+{
+    ESAssetStreamer streamer;
+    int ready = 0;
+    
+    esJobSystemInit( 2 );
+    ES_CHECK( esAssetStreamerInit( &streamer, 0 ) );
+    
+    LoadValues( &streamer, NUM_THREADED );
+    
+    while( esAssetPending( &streamer ) > 0 )
+    {
+        ready += esAssetPump( &streamer, cache, ~0ull );
+    }
+    
+    ES_CHECK( ready == NUM_THREADED );
+    ES_CHECK( CountState( NUM_THREADED, ES_ASSET_READY ) == NUM_THREADED );
+    
+    // destroying with loads still running must not wait on a pump either
+    LoadValues( &streamer, NUM_THREADED );
+    esAssetStreamerDestroy( &streamer );
+    
+    ES_CHECK( CountState( NUM_THREADED, ES_ASSET_FAILED ) == NUM_THREADED );
+    ES_CHECK( esAssetPending( &streamer ) == 0 );
+    
+    esJobSystemShutdown();
+}
+
+int main( void )
+{
+    ESStateCache cache;
+    
+    esAssetSetBackend( &mockAssetGL );
+    esRingBufferSetBackend( &mockRingGL );
+    esStateCacheSetBackend( &mockCacheGL );
+    esStateCacheInit( &cache );
+    
+    TestInlineOverflow( &cache );
+    TestDestroyPending( &cache );
+    TestThreaded( &cache );
+    
+    esAssetSetBackend( NULL );
+    esRingBufferSetBackend( NULL );
+    esStateCacheSetBackend( NULL );
+    
+    return ES_TEST_RESULT();
+}
@@ -0,0 +1,391 @@
+//
+//  ESBatchTest.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  esBatch against recording ESBatchGL, ESRingBufferGL and ESStateCacheGL
+//  tables: interleaved draws of a few meshes come out as one instanced draw
+//  per mesh, with that mesh's MVPs and colors contiguous in the mapped ring
+//  in the order they were added, and the counters add up.
+//
+
+#include "ESBatch.h"
+#include "ESTest.h"
+#include <string.h>
+
+#define MAX_INSTANCES 64
+#define NUM_MESHES    3
+#define MVP_LOC       2
+#define COLOR_LOC     6
+
+// ring storage, as ESMatrix so mapped MVPs are aligned
+static ESMatrix   mockStore[MAX_INSTANCES * ES_RING_MAX_REGIONS * 2];
+static GLsizeiptr mockStoreSize;
+static GLuint     mockProgram;
+static GLuint     mockVertexArray;
+// attribute pointers by location, byte offsets into the ring
+static GLintptr   mockPointers[8];
+static GLsizei    mockStrides[8];
+
+typedef struct
+{
+    GLuint   program;
+    GLuint   vertexArray;
+    GLenum   mode;
+    GLsizei  count;
+    GLenum   type;
+    GLintptr indices;
+    GLsizei  instanceCount;
+    GLintptr mvpRows[4];
+    GLintptr colors;
+} MockDraw;
+
+static MockDraw mockDraws[MAX_INSTANCES];
+static int      mockNumDraws;
+
+static void GL_APIENTRY mockGenBuffers( GLsizei n, GLuint *buffers )
+{
+    ( void ) n;
+    buffers[0] = 9;
+}
+
+static void GL_APIENTRY mockDeleteBuffers( GLsizei n, const GLuint *buffers )
+{
+    ( void ) n;
+    ( void ) buffers;
+}
+
+static void GL_APIENTRY mockBindBuffer( GLenum target, GLuint buffer )
+{
+    ( void ) target;
+    ( void ) buffer;
+}
+
+static void GL_APIENTRY mockBufferData( GLenum target, GLsizeiptr size, const void *data, GLenum usage )
+{
+    ( void ) target;
+    ( void ) data;
+    ( void ) usage;
+    mockStoreSize = size;
+}
+
+static void *GL_APIENTRY mockMapBufferRange( GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access )
+{
+    ( void ) target;
+    ( void ) access;
+    
+    if( offset + length > ( GLintptr ) sizeof( mockStore ) )
+    {
+        return NULL;
+    }
+    
+    // stale bytes must not pass for the batch's data
+    memset( ( GLubyte * ) mockStore + offset, 0xCD, length );
+    
+    return ( GLubyte * ) mockStore + offset;
+}
+
+static GLboolean GL_APIENTRY mockUnmapBuffer( GLenum target )
+{
+    ( void ) target;
+    return GL_TRUE;
+}
+
+static GLsync GL_APIENTRY mockFenceSync( GLenum condition, GLbitfield flags )
+{
+    ( void ) condition;
+    ( void ) flags;
+    return ( GLsync ) 1;
+}
+
+static GLenum GL_APIENTRY mockClientWaitSync( GLsync sync, GLbitfield flags, GLuint64 timeout )
+{
+    ( void ) sync;
+    ( void ) flags;
+    ( void ) timeout;
+    return GL_ALREADY_SIGNALED;
+}
+
+static void GL_APIENTRY mockDeleteSync( GLsync sync )
+{
+    ( void ) sync;
+}
+
+static void GL_APIENTRY mockBindVertexArray( GLuint array )
+{
+    mockVertexArray = array;
+}
+
+static void GL_APIENTRY mockUseProgram( GLuint program )
+{
+    mockProgram = program;
+}
+
+static void GL_APIENTRY mockAttribArray( GLuint index )
+{
+    ( void ) index;
+}
+
+static void GL_APIENTRY mockVertexAttribDivisor( GLuint index, GLuint divisor )
+{
+    ( void ) index;
+    ( void ) divisor;
+}
+
+static void GL_APIENTRY mockViewport( GLint x, GLint y, GLsizei width, GLsizei height )
+{
+    ( void ) x;
+    ( void ) y;
+    ( void ) width;
+    ( void ) height;
+}
+
+static void GL_APIENTRY mockActiveTexture( GLenum texture )
+{
+    ( void ) texture;
+}
+
+static void GL_APIENTRY mockBindTexture( GLenum target, GLuint texture )
+{
+    ( void ) target;
+    ( void ) texture;
+}
+
+static void GL_APIENTRY mockDeleteVertexArrays( GLsizei n, const GLuint *arrays )
+{
+    ( void ) n;
+    ( void ) arrays;
+}
+
+static void GL_APIENTRY mockVertexAttribPointer( GLuint index, GLint size, GLenum type, GLboolean normalized,
+                                                 GLsizei stride, const void *pointer )
+{
+    ( void ) size;
+    ( void ) type;
+    ( void ) normalized;
+    
+    if( index < sizeof( mockPointers ) / sizeof( mockPointers[0] ) )
+    {
+        mockPointers[index] = ( GLintptr ) pointer;
+        mockStrides[index]  = stride;
+    }
+}
+
+static void GL_APIENTRY mockDrawElementsInstanced( GLenum mode, GLsizei count, GLenum type, const void *indices,
+                                                   GLsizei instanceCount )
+{
+    MockDraw *draw = &mockDraws[mockNumDraws++];
+    int row;
+    
+    draw->program       = mockProgram;
+    draw->vertexArray   = mockVertexArray;
+    draw->mode          = mode;
+    draw->count         = count;
+    draw->type          = type;
+    draw->indices       = ( GLintptr ) indices;
+    draw->instanceCount = instanceCount;
+    draw->colors        = mockPointers[COLOR_LOC];
+    
+    for( row = 0; row < 4; row++ )
+    {
+        draw->mvpRows[row] = mockPointers[MVP_LOC + row];
+    }
+}
+
+static const ESRingBufferGL mockRingGL =
+{
+    mockGenBuffers,
+    mockDeleteBuffers,
+    mockBindBuffer,
+    mockBufferData,
+    mockMapBufferRange,
+    mockUnmapBuffer,
+    mockFenceSync,
+    mockClientWaitSync,
+    mockDeleteSync,
+};
+
+static const ESStateCacheGL mockCacheGL =
+{
+    mockBindBuffer,
+    mockBindVertexArray,
+    mockUseProgram,
+    mockAttribArray,
+    mockAttribArray,
+    mockVertexAttribDivisor,
+    mockViewport,
+    mockActiveTexture,
+    mockBindTexture,
+    mockDeleteBuffers,
+    mockDeleteVertexArrays,
+};
+
+static const ESBatchGL mockBatchGL =
+{
+    mockVertexAttribPointer,
+    mockDrawElementsInstanced,
+};
+
+// two meshes share a program and a vertex array and differ in their index range only
+static const ESBatchMesh meshes[NUM_MESHES] =
+{
+    { 1, 1, GL_TRIANGLES, GL_UNSIGNED_INT, 0, 36 },
+    { 1, 1, GL_TRIANGLES, GL_UNSIGNED_INT, 144, 24 },
+    { 2, 3, GL_TRIANGLE_STRIP, GL_UNSIGNED_SHORT, 0, 100 },
+};
+
+// the draw's id in m[0][0] and its mesh in m[3][3], its id again in the color
+static void MakeInstance( int id, ESMatrix *mvp, GLubyte color[4] )
+{
+    esMatrixLoadIdentity( mvp );
+    mvp->m[0][0] = ( GLfloat ) id;
+    mvp->m[1][2] = ( GLfloat ) -id;
+    mvp->m[3][3] = ( GLfloat ) ( id % NUM_MESHES );
+    
+    color[0] = ( GLubyte ) id;
+    color[1] = ( GLubyte ) ( id * 3 );
+    color[2] = ( GLubyte ) ( id % NUM_MESHES );
+    color[3] = 255;
+}
+
+static const ESBatchMesh *FindMesh( const MockDraw *draw )
+{
+    int i;
+    
+    for( i = 0; i < NUM_MESHES; i++ )
+    {
+        if( meshes[i].program == draw->program && meshes[i].vertexArray == draw->vertexArray &&
+            meshes[i].indexOffset == draw->indices && meshes[i].count == draw->count &&
+            meshes[i].mode == draw->mode && meshes[i].indexType == draw->type )
+        {
+            return &meshes[i];
+        }
+    }
+    
+    return NULL;
+}
+
+// add count draws cycling through the meshes, one frame
+static void CheckFrame( ESBatch *batch, ESStateCache *cache, int count )
+{
+    int found[NUM_MESHES] = { 0 };
+    int numGroups = count < NUM_MESHES ? count : NUM_MESHES;
+    int i, d;
+    
+    for( i = 0; i < count; i++ )
+    {
+        ESMatrix mvp;
+        GLubyte color[4];
+        
+        MakeInstance( i, &mvp, color );
+        ES_CHECK( esBatchAdd( batch, &meshes[i % NUM_MESHES], &mvp, color ) );
+    }
+    
+    mockNumDraws = 0;
+    esBatchFlush( batch, cache );
+    
+    ES_CHECK( mockNumDraws == numGroups );
+    ES_CHECK( batch->numDrawsAdded == ( unsigned int ) count );
+    ES_CHECK( batch->numDrawsIssued == ( unsigned int ) numGroups );
+    ES_CHECK( batch->numDrawsSaved == ( unsigned int ) ( count - numGroups ) );
+    ES_CHECK( batch->numInstances == 0 && batch->numGroups == 0 );
+    
+    for( d = 0; d < mockNumDraws; d++ )
+    {
+        const MockDraw *draw = &mockDraws[d];
+        const ESBatchMesh *mesh = FindMesh( draw );
+        const ESMatrix *mvps = ( const ESMatrix * ) ( ( const GLubyte * ) mockStore + draw->mvpRows[0] );
+        const GLubyte *colors = ( const GLubyte * ) mockStore + draw->colors;
+        int meshIndex, expected, row, n;
+        int inOrder = 1;
+        
+        ES_CHECK( mesh != NULL );
+        
+        if( mesh == NULL )
+        {
+            continue;
+        }
+        
+        meshIndex = ( int ) ( mesh - meshes );
+        found[meshIndex]++;
+        ES_CHECK( draw->instanceCount == ( count - meshIndex + NUM_MESHES - 1 ) / NUM_MESHES );
+        
+        // the four row attributes step through one MVP per instance
+        for( row = 0; row < 4; row++ )
+        {
+            ES_CHECK( draw->mvpRows[row] == draw->mvpRows[0] + row * 4 * ( GLintptr ) sizeof( GLfloat ) );
+            ES_CHECK( mockStrides[MVP_LOC + row] == sizeof( ESMatrix ) );
+        }
+        
+        ES_CHECK( draw->mvpRows[0] % sizeof( ESMatrix ) == 0 );
+        ES_CHECK( mockStrides[COLOR_LOC] == 4 );
+        
+        // this mesh's draws, contiguous and in the order they were added
+        for( n = 0, expected = meshIndex; n < draw->instanceCount; n++, expected += NUM_MESHES )
+        {
+            ESMatrix mvp;
+            GLubyte color[4];
+            
+            MakeInstance( expected, &mvp, color );
+            inOrder &= memcmp( &mvps[n], &mvp, sizeof( ESMatrix ) ) == 0 &&
+                       memcmp( &colors[n * 4], color, 4 ) == 0;
+        }
+        
+        ES_CHECK( inOrder );
+    }
+    
+    for( i = 0; i < numGroups; i++ )
+    {
+        ES_CHECK( found[i] == 1 );
+    }
+}
+
+int main( void )
+{
+    ESStateCache cache;
+    ESBatch batch;
+    ESMatrix mvp;
+    GLubyte color[4];
+    int i;
+    
+    esRingBufferSetBackend( &mockRingGL );
+    esStateCacheSetBackend( &mockCacheGL );
+    esBatchSetBackend( &mockBatchGL );
+    esStateCacheInit( &cache );
+    
+    ES_CHECK( esBatchInit( &batch, MAX_INSTANCES, MVP_LOC, COLOR_LOC ) );
+    ES_CHECK( mockStoreSize <= ( GLsizeiptr ) sizeof( mockStore ) );
+    
+    // several frames, so the instances land in every region of the ring
+    CheckFrame( &batch, &cache, 40 );
+    CheckFrame( &batch, &cache, MAX_INSTANCES );
+    CheckFrame( &batch, &cache, 2 );
+    CheckFrame( &batch, &cache, 7 );
+    
+    // An empty frame draws nothing and saves nothing
+    mockNumDraws = 0;
+    esBatchFlush( &batch, &cache );
+    ES_CHECK( mockNumDraws == 0 && batch.numDrawsSaved == 0 );
+    
+    // Draws past maxInstances are dropped and counted
+    for( i = 0; i < MAX_INSTANCES + 5; i++ )
+    {
+        MakeInstance( i, &mvp, color );
+        esBatchAdd( &batch, &meshes[0], &mvp, color );
+    }
+    
+    ES_CHECK( batch.numOverflows == 5 );
+    esBatchFlush( &batch, &cache );
+    ES_CHECK( mockNumDraws == 1 && mockDraws[0].instanceCount == MAX_INSTANCES );
+    ES_CHECK( batch.numDrawsSaved == MAX_INSTANCES - 1 );
+    
+    esBatchDestroy( &batch );
+    
+    esBatchSetBackend( NULL );
+    esStateCacheSetBackend( NULL );
+    esRingBufferSetBackend( NULL );
+    
+    return ES_TEST_RESULT();
+}
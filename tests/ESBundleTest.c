@@ -0,0 +1,279 @@
+//
+//  ESBundleTest.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  esBundleWriter to file and back through esBundleOpen: every section comes
+//  back aligned and byte for byte, and files whose size or section table do
+//  not add up are refused.
+//
+
+#include "ESBundle.h"
+#include "ESTest.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define FILE_NAME    "ESBundleTest.esb"
+#define BAD_NAME     "ESBundleTestBad.esb"
+#define NUM_SECTIONS 5
+#define TEX_WIDTH    13
+#define TEX_HEIGHT   7
+#define NUM_LARGE    300
+// more vertices than GL_UNSIGNED_SHORT indices can reach
+#define LARGE_MESH   70000
+
+static ESBundleWriter writer;
+static unsigned char *fileData;
+static size_t fileSize;
+
+static void BuildWriter( void )
+{
+    static const char *const names[NUM_SECTIONS] = { "cube.vertices", "cube.indices", "sphere.vertices",
+                                                     "large.indices", "checker" };
+    static GLubyte pixels[TEX_WIDTH * TEX_HEIGHT * 4];
+    static GLuint largeIndices[NUM_LARGE];
+    ESVertexFormat packed;
+    ESVertexFormat full;
+    void *vertices = NULL;
+    GLuint *indices = NULL;
+    int numVertices;
+    int numIndices;
+    int i;
+    
+    esBundleWriterInit( &writer );
+    
+    ES_CHECK( esVertexFormatInit( &packed, ES_ATTRIB_HALF, ES_ATTRIB_INT_2_10_10_10_REV, ES_ATTRIB_UNORM16, 1.0f ) );
+    ES_CHECK( esVertexFormatInit( &full, ES_ATTRIB_FLOAT, ES_ATTRIB_FLOAT, ES_ATTRIB_FLOAT, 1.0f ) );
+    
+    numIndices = esGenCubeInterleaved( 1.0f, &packed, &vertices, &indices );
+    ES_CHECK( esBundleAddVertices( &writer, names[0], &packed, vertices, 24 ) );
+    ES_CHECK( esBundleAddIndices( &writer, names[1], indices, numIndices, 24 ) );
+    free( vertices );
+    free( indices );
+    
+    esGenSphereSize( 7, &numVertices, &numIndices );
+    esGenSphereInterleaved( 7, 0.5f, &full, &vertices, &indices );
+    ES_CHECK( esBundleAddVertices( &writer, names[2], &full, vertices, numVertices ) );
+    free( vertices );
+    free( indices );
+    
+    for( i = 0; i < NUM_LARGE; i++ )
+    {
+        largeIndices[i] = ( GLuint ) ( ( i * 7919u ) % LARGE_MESH );
+    }
+    
+    ES_CHECK( esBundleAddIndices( &writer, names[3], largeIndices, NUM_LARGE, LARGE_MESH ) );
+    
+    for( i = 0; i < TEX_WIDTH * TEX_HEIGHT * 4; i++ )
+    {
+        pixels[i] = ( GLubyte ) ( i * 37 + ( i >> 2 ) );
+    }
+    
+    ES_CHECK( esBundleAddTexture( &writer, names[4], pixels, TEX_WIDTH, TEX_HEIGHT, 4, ES_MIP_BOX ) );
+    ES_CHECK( writer.numSections == NUM_SECTIONS );
+}
+
+static GLboolean ReadFile( const char *fileName )
+{
+    FILE *fp = fopen( fileName, "rb" );
+    long size;
+    
+    if( fp == NULL )
+    {
+        return GL_FALSE;
+    }
+    
+    fseek( fp, 0, SEEK_END );
+    size = ftell( fp );
+    fseek( fp, 0, SEEK_SET );
+    
+    fileSize = size > 0 ? ( size_t ) size : 0;
+    fileData = malloc( fileSize > 0 ? fileSize : 1 );
+    
+    if( fileData == NULL || fread( fileData, fileSize, 1, fp ) != 1 )
+    {
+        fclose( fp );
+        return GL_FALSE;
+    }
+    
+    fclose( fp );
+    
+    return GL_TRUE;
+}
+
+static GLboolean WriteFile( const char *fileName, const void *data, size_t size )
+{
+    FILE *fp = fopen( fileName, "wb" );
+    GLboolean written;
+    
+    if( fp == NULL )
+    {
+        return GL_FALSE;
+    }
+    
+    written = size == 0 || fwrite( data, size, 1, fp ) == 1;
+    
+    return fclose( fp ) == 0 && written;
+}
+
+static void CheckRoundTrip( void )
+{
+    ESBundle bundle;
+    ESVertexFormat format;
+    int i;
+    
+    ES_CHECK( esBundleWrite( &writer, FILE_NAME ) );
+    
+    if( !esBundleOpen( &bundle, FILE_NAME ) )
+    {
+        fprintf( stderr, "esBundleOpen refused the file esBundleWrite wrote\n" );
+        esTestFailures++;
+        return;
+    }
+    
+    ES_CHECK( bundle.numSections == NUM_SECTIONS );
+    ES_CHECK( bundle.header->fileSize == bundle.dataSize );
+    
+    for( i = 0; i < bundle.numSections && i < NUM_SECTIONS; i++ )
+    {
+        const ESBundleSection *expected = &writer.sections[i];
+        const ESBundleSection *section = esBundleFind( &bundle, expected->name );
+        
+        ES_CHECK( section == &bundle.sections[i] );
+        
+        if( section == NULL )
+        {
+            continue;
+        }
+        
+        ES_CHECK( section->type == expected->type );
+        ES_CHECK( section->format == expected->format );
+        ES_CHECK( section->count == expected->count );
+        ES_CHECK( section->stride == expected->stride );
+        ES_CHECK( section->width == expected->width && section->height == expected->height );
+        ES_CHECK( section->size == expected->size );
+        ES_CHECK( section->offset % ES_BUNDLE_ALIGNMENT == 0 );
+        ES_CHECK( ( ( size_t ) esBundleSectionData( &bundle, section ) - ( size_t ) bundle.data ) == section->offset );
+        ES_CHECK( memcmp( esBundleSectionData( &bundle, section ), writer.blobs[i], ( size_t ) section->size ) == 0 );
+    }
+    
+    ES_CHECK( esBundleFind( &bundle, "missing" ) == NULL );
+    
+    ES_CHECK( bundle.numSections > 3 && bundle.sections[1].format == GL_UNSIGNED_SHORT );
+    ES_CHECK( bundle.numSections > 3 && bundle.sections[3].format == GL_UNSIGNED_INT );
+    ES_CHECK( esBundleVertexFormat( &bundle.sections[0], &format ) );
+    ES_CHECK( format.position == ES_ATTRIB_HALF && format.normal == ES_ATTRIB_INT_2_10_10_10_REV &&
+              format.texCoord == ES_ATTRIB_UNORM16 );
+    ES_CHECK( !esBundleVertexFormat( &bundle.sections[1], &format ) );
+    
+    esBundleClose( &bundle );
+    ES_CHECK( bundle.data == NULL && bundle.numSections == 0 );
+}
+
+// write the changed copy of the good file and expect esBundleOpen to refuse it
+static void CheckRefused( const unsigned char *data, size_t size, const char *what )
+{
+    ESBundle bundle;
+    
+    ES_CHECK( WriteFile( BAD_NAME, data, size ) );
+    
+    if( esBundleOpen( &bundle, BAD_NAME ) )
+    {
+        fprintf( stderr, "esBundleOpen accepted a bundle with %s\n", what );
+        esTestFailures++;
+        esBundleClose( &bundle );
+    }
+}
+
+static void CheckCorrupt( void )
+{
+    ESBundle bundle;
+    unsigned char *copy;
+    ESBundleHeader *header;
+    ESBundleSection *sections;
+    
+    if( !ReadFile( FILE_NAME ) )
+    {
+        fprintf( stderr, "can't read back %s\n", FILE_NAME );
+        esTestFailures++;
+        return;
+    }
+    
+    copy = malloc( fileSize );
+    
+    if( copy == NULL )
+    {
+        free( fileData );
+        esTestFailures++;
+        return;
+    }
+    
+    header   = ( ESBundleHeader * ) copy;
+    sections = ( ESBundleSection * ) ( copy + sizeof( ESBundleHeader ) );
+    
+    // cut anywhere: in the last section, at the table, inside the header, empty
+    CheckRefused( fileData, fileSize - 1, "its last byte cut" );
+    CheckRefused( fileData, sizeof( ESBundleHeader ) + sizeof( ESBundleSection ) * NUM_SECTIONS, "only its table" );
+    CheckRefused( fileData, sizeof( ESBundleHeader ) - 4, "a cut header" );
+    CheckRefused( fileData, 0, "nothing in it" );
+    
+    // a truncated file whose header was patched to match
+    memcpy( copy, fileData, fileSize );
+    header->fileSize = sections[NUM_SECTIONS - 1].offset + 1;
+    CheckRefused( copy, ( size_t ) header->fileSize, "its last section truncated" );
+    
+    memcpy( copy, fileData, fileSize );
+    header->magic ^= 1;
+    CheckRefused( copy, fileSize, "a wrong magic" );
+    
+    memcpy( copy, fileData, fileSize );
+    header->numSections = ES_BUNDLE_MAX_SECTIONS + 1;
+    CheckRefused( copy, fileSize, "too many sections" );
+    
+    memcpy( copy, fileData, fileSize );
+    sections[2].offset = fileSize + ES_BUNDLE_ALIGNMENT;
+    CheckRefused( copy, fileSize, "a section past the end" );
+    
+    memcpy( copy, fileData, fileSize );
+    sections[2].size = fileSize - sections[2].offset + 1;
+    CheckRefused( copy, fileSize, "a section running past the end" );
+    
+    // size chosen so offset + size wraps around
+    memcpy( copy, fileData, fileSize );
+    sections[2].size = ~( uint64_t ) 0 - sections[2].offset + 2;
+    CheckRefused( copy, fileSize, "a section size that wraps" );
+    
+    memcpy( copy, fileData, fileSize );
+    sections[0].offset = 0;
+    CheckRefused( copy, fileSize, "a section over the header" );
+    
+    // still inside the file, only off the alignment
+    memcpy( copy, fileData, fileSize );
+    sections[1].offset += 4;
+    sections[1].size   -= sections[1].size >= 4 ? 4 : sections[1].size;
+    CheckRefused( copy, fileSize, "a misaligned section" );
+    
+    // the untouched copy is still fine, so the refusals above came from the changes
+    memcpy( copy, fileData, fileSize );
+    ES_CHECK( WriteFile( BAD_NAME, copy, fileSize ) );
+    ES_CHECK( esBundleOpen( &bundle, BAD_NAME ) );
+    esBundleClose( &bundle );
+    
+    free( copy );
+    free( fileData );
+}
+
+int main( void )
+{
+    BuildWriter();
+    CheckRoundTrip();
+    CheckCorrupt();
+    
+    esBundleWriterDestroy( &writer );
+    remove( FILE_NAME );
+    remove( BAD_NAME );
+    
+    return ES_TEST_RESULT();
+}
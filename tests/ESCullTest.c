@@ -0,0 +1,263 @@
+//
+//  ESCullTest.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  esCullTreeQuery against esFrustumTestAABB on every box: the same objects,
+//  each reported once, for frusta looking into, across and away from 5000
+//  random boxes, after the build and again after moving a third of them
+//  with esCullTreeSetBounds and esCullTreeRefit.
+//
+
+#include "ESCull.h"
+#include "ESTest.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_BOXES   5000
+#define NUM_FRUSTA  8
+#define WORLD_SIZE  100.0f
+// The tree tests boxes as center and half size, the brute force as corners. Boxes this close
+// to a plane may round either way and are left out of the comparison
+#define PLANE_SLACK 1e-3f
+
+static ESAABB boxes[NUM_BOXES];
+static ESFrustum frusta[NUM_FRUSTA];
+static int visible[NUM_BOXES];
+static int seen[NUM_BOXES];
+
+static float Random( float low, float high )
+{
+    return low + ( high - low ) * ( float ) rand() / ( float ) RAND_MAX;
+}
+
+static void RandomBox( ESAABB *box )
+{
+    // mostly small, a few large enough to cross several planes at once
+    float size = rand() % 10 == 0 ? Random( 5.0f, 40.0f ) : Random( 0.05f, 4.0f );
+    int i;
+    
+    for( i = 0; i < 3; i++ )
+    {
+        float center = Random( -WORLD_SIZE, WORLD_SIZE );
+        float extent = size * Random( 0.2f, 1.0f );
+        
+        box->min[i] = center - extent;
+        box->max[i] = center + extent;
+    }
+}
+
+static void BuildFrusta( void )
+{
+    static const float cameras[NUM_FRUSTA][5] =
+    {
+        // eye, then yaw and pitch in degrees, 0 looking down -z
+        { 0.0f, 0.0f, 150.0f, 0.0f, 0.0f },
+        { 0.0f, 0.0f, 0.0f, 70.0f, 10.0f },
+        { 80.0f, 60.0f, -20.0f, -120.0f, -25.0f },
+        { -30.0f, 10.0f, 40.0f, 200.0f, 15.0f },
+        { 0.0f, 200.0f, 0.0f, 0.0f, -90.0f },
+        { 50.0f, -50.0f, 50.0f, 45.0f, 30.0f },
+        // looking away from the world
+        { 0.0f, 0.0f, 300.0f, 180.0f, 0.0f },
+        { 10.0f, 20.0f, -40.0f, 0.0f, 0.0f },
+    };
+    int f;
+    
+    for( f = 0; f < NUM_FRUSTA; f++ )
+    {
+        ESMatrix view;
+        ESMatrix projection;
+        ESMatrix viewProjection;
+        
+        esMatrixLoadIdentity( &projection );
+        
+        // the last one off center, the rest symmetric with different fields of view
+        if( f == NUM_FRUSTA - 1 )
+        {
+            esFrustum( &projection, -3.0f, 5.0f, -2.0f, 2.5f, 1.0f, 120.0f );
+        }
+        else
+        {
+            esPerspective( &projection, 30.0f + f * 15.0f, 1.0f + f * 0.2f, 0.5f + f, 80.0f + f * 40.0f );
+        }
+        
+        // the world moved to the eye, then turned against the camera
+        esMatrixLoadIdentity( &view );
+        esRotate( &view, cameras[f][4], 1.0f, 0.0f, 0.0f );
+        esRotate( &view, -cameras[f][3], 0.0f, 1.0f, 0.0f );
+        esTranslate( &view, -cameras[f][0], -cameras[f][1], -cameras[f][2] );
+        esMatrixMultiply( &viewProjection, &view, &projection );
+        esFrustumFromMatrix( &frusta[f], &viewProjection );
+    }
+}
+
+// the box touches a plane within the slack
+static GLboolean NearPlane( const ESFrustum *frustum, const ESAABB *box )
+{
+    int p;
+    
+    for( p = 0; p < ES_FRUSTUM_PLANES; p++ )
+    {
+        const GLfloat *plane = frustum->planes[p];
+        float x = plane[0] >= 0.0f ? box->max[0] : box->min[0];
+        float y = plane[1] >= 0.0f ? box->max[1] : box->min[1];
+        float z = plane[2] >= 0.0f ? box->max[2] : box->min[2];
+        float distance = plane[0] * x + plane[1] * y + plane[2] * z + plane[3];
+        float scale = fabsf( plane[0] ) + fabsf( plane[1] ) + fabsf( plane[2] );
+        
+        if( fabsf( distance ) <= PLANE_SLACK * scale )
+        {
+            return GL_TRUE;
+        }
+    }
+    
+    return GL_FALSE;
+}
+
+// Returns the number of boxes visible to the brute force
+static int CheckQuery( const ESCullTree *tree, const ESFrustum *frustum, int *slack )
+{
+    int numVisible = esCullTreeQuery( tree, frustum, visible );
+    int expected = 0;
+    int duplicates = 0;
+    int mismatches = 0;
+    int i;
+    
+    ES_CHECK( numVisible >= 0 && numVisible <= NUM_BOXES );
+    memset( seen, 0, sizeof( seen ) );
+    
+    for( i = 0; i < numVisible; i++ )
+    {
+        ES_CHECK( visible[i] >= 0 && visible[i] < NUM_BOXES );
+        
+        if( visible[i] >= 0 && visible[i] < NUM_BOXES && seen[visible[i]]++ )
+        {
+            duplicates++;
+        }
+    }
+    
+    for( i = 0; i < NUM_BOXES; i++ )
+    {
+        GLboolean inside = esFrustumTestAABB( frustum, &boxes[i] );
+        
+        expected += inside;
+        
+        if( inside != ( seen[i] != 0 ) )
+        {
+            if( NearPlane( frustum, &boxes[i] ) )
+            {
+                ( *slack )++;
+            }
+            else
+            {
+                mismatches++;
+            }
+        }
+    }
+    
+    ES_CHECK( duplicates == 0 );
+    ES_CHECK( mismatches == 0 );
+    
+    return expected;
+}
+
+static void CheckFrusta( const ESCullTree *tree )
+{
+    int slack = 0;
+    int seenSome = 0;
+    int seenAll = 0;
+    int seenNone = 0;
+    int f;
+    
+    for( f = 0; f < NUM_FRUSTA; f++ )
+    {
+        int expected = CheckQuery( tree, &frusta[f], &slack );
+        
+        seenSome += expected > 0 && expected < NUM_BOXES;
+        seenAll  += expected == NUM_BOXES;
+        seenNone += expected == 0;
+    }
+    
+    // the frusta are worth comparing: most see part of the world, the one looking away sees nothing
+    ES_CHECK( seenSome >= NUM_FRUSTA - 2 );
+    ES_CHECK( seenNone >= 1 );
+    ES_CHECK( seenAll == 0 );
+    // rounding differences stay rare
+    ES_CHECK( slack <= 2 );
+}
+
+static void CheckSmallTrees( void )
+{
+    ESCullTree tree;
+    ESAABB box;
+    
+    ES_CHECK( esCullTreeInit( &tree, 4 ) );
+    
+    esCullTreeBuild( &tree, boxes, 0 );
+    ES_CHECK( esCullTreeQuery( &tree, &frusta[0], visible ) == 0 );
+    
+    // one object, 50 in front of the first camera
+    box.min[0] = box.min[1] = -1.0f;
+    box.max[0] = box.max[1] = 1.0f;
+    box.min[2] = 99.0f;
+    box.max[2] = 101.0f;
+    esCullTreeBuild( &tree, &box, 1 );
+    ES_CHECK( esCullTreeQuery( &tree, &frusta[0], visible ) == 1 && visible[0] == 0 );
+    
+    // moved out of it behind the eye
+    box.min[2] = 399.0f;
+    box.max[2] = 401.0f;
+    esCullTreeSetBounds( &tree, 0, &box );
+    esCullTreeRefit( &tree );
+    ES_CHECK( esCullTreeQuery( &tree, &frusta[0], visible ) == 0 );
+    
+    esCullTreeDestroy( &tree );
+}
+
+int main( void )
+{
+    ESCullTree tree;
+    int i;
+    
+    srand( 5 );
+    
+    for( i = 0; i < NUM_BOXES; i++ )
+    {
+        RandomBox( &boxes[i] );
+    }
+    
+    BuildFrusta();
+    ES_CHECK( esCullTreeInit( &tree, NUM_BOXES ) );
+    esCullTreeBuild( &tree, boxes, NUM_BOXES );
+    CheckFrusta( &tree );
+    
+    // Move a third of the boxes, some far from where the tree was built
+    for( i = 0; i < NUM_BOXES; i += 3 )
+    {
+        RandomBox( &boxes[i] );
+        esCullTreeSetBounds( &tree, i, &boxes[i] );
+    }
+    
+    esCullTreeRefit( &tree );
+    CheckFrusta( &tree );
+    
+    // a second round of moves on a refitted tree
+    for( i = 1; i < NUM_BOXES; i += 7 )
+    {
+        boxes[i].min[1] += 30.0f;
+        boxes[i].max[1] += 30.0f;
+        esCullTreeSetBounds( &tree, i, &boxes[i] );
+    }
+    
+    esCullTreeRefit( &tree );
+    CheckFrusta( &tree );
+    
+    esCullTreeDestroy( &tree );
+    
+    CheckSmallTrees();
+    
+    return ES_TEST_RESULT();
+}
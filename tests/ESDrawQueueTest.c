@@ -0,0 +1,414 @@
+//
+//  ESDrawQueueTest.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  esDrawQueue against recording ESDrawQueueGL and ESStateCacheGL tables:
+//  opaque packets grouped by program, vertex array and texture and front to
+//  back inside a group, translucent packets back to front after them, each
+//  binding issued once per change, and esRadixSort64 against qsort.
+//
+
+#include "ESDrawQueue.h"
+#include "ESTest.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_PACKETS 500
+#define NUM_KEYS    4000
+
+// what a packet looked like when it was drawn, first holds its submit index
+typedef struct
+{
+    int     packet;
+    GLuint  program;
+    GLuint  vertexArray;
+    GLuint  texture;
+    GLenum  entry;
+} MockDraw;
+
+static GLuint   mockProgram;
+static GLuint   mockVertexArray;
+static GLuint   mockTexture;
+static int      mockBinds;
+static MockDraw mockDraws[NUM_PACKETS * 2];
+static int      mockNumDraws;
+
+static void GL_APIENTRY mockBindBuffer( GLenum target, GLuint buffer )
+{
+    ( void ) target;
+    ( void ) buffer;
+}
+
+static void GL_APIENTRY mockBindVertexArray( GLuint array )
+{
+    mockVertexArray = array;
+    mockBinds++;
+}
+
+static void GL_APIENTRY mockUseProgram( GLuint program )
+{
+    mockProgram = program;
+    mockBinds++;
+}
+
+static void GL_APIENTRY mockAttribArray( GLuint index )
+{
+    ( void ) index;
+}
+
+static void GL_APIENTRY mockVertexAttribDivisor( GLuint index, GLuint divisor )
+{
+    ( void ) index;
+    ( void ) divisor;
+}
+
+static void GL_APIENTRY mockViewport( GLint x, GLint y, GLsizei width, GLsizei height )
+{
+    ( void ) x;
+    ( void ) y;
+    ( void ) width;
+    ( void ) height;
+}
+
+static void GL_APIENTRY mockActiveTexture( GLenum texture )
+{
+    ( void ) texture;
+}
+
+static void GL_APIENTRY mockBindTexture( GLenum target, GLuint texture )
+{
+    ( void ) target;
+    mockTexture = texture;
+    mockBinds++;
+}
+
+static void GL_APIENTRY mockDelete( GLsizei n, const GLuint *names )
+{
+    ( void ) n;
+    ( void ) names;
+}
+
+static void RecordDraw( GLint first, GLenum entry )
+{
+    MockDraw *draw = &mockDraws[mockNumDraws++];
+    
+    draw->packet      = first;
+    draw->program     = mockProgram;
+    draw->vertexArray = mockVertexArray;
+    draw->texture     = mockTexture;
+    draw->entry       = entry;
+}
+
+// the entry point is told apart by a made up enum per function
+static void GL_APIENTRY mockDrawArrays( GLenum mode, GLint first, GLsizei count )
+{
+    ( void ) mode;
+    ( void ) count;
+    RecordDraw( first, 1 );
+}
+
+static void GL_APIENTRY mockDrawElements( GLenum mode, GLsizei count, GLenum type, const void *indices )
+{
+    ( void ) mode;
+    ( void ) count;
+    ( void ) type;
+    RecordDraw( ( GLint ) ( GLintptr ) indices, 2 );
+}
+
+static void GL_APIENTRY mockDrawArraysInstanced( GLenum mode, GLint first, GLsizei count, GLsizei instanceCount )
+{
+    ( void ) mode;
+    ( void ) count;
+    ( void ) instanceCount;
+    RecordDraw( first, 3 );
+}
+
+static void GL_APIENTRY mockDrawElementsInstanced( GLenum mode, GLsizei count, GLenum type, const void *indices,
+                                                   GLsizei instanceCount )
+{
+    ( void ) mode;
+    ( void ) count;
+    ( void ) type;
+    ( void ) instanceCount;
+    RecordDraw( ( GLint ) ( GLintptr ) indices, 4 );
+}
+
+static const ESStateCacheGL mockCacheGL =
+{
+    mockBindBuffer,
+    mockBindVertexArray,
+    mockUseProgram,
+    mockAttribArray,
+    mockAttribArray,
+    mockVertexAttribDivisor,
+    mockViewport,
+    mockActiveTexture,
+    mockBindTexture,
+    mockDelete,
+    mockDelete,
+};
+
+static const ESDrawQueueGL mockDrawGL =
+{
+    mockDrawArrays,
+    mockDrawElements,
+    mockDrawArraysInstanced,
+    mockDrawElementsInstanced,
+};
+
+static ESDrawPacket packets[NUM_PACKETS];
+static int setupsBound;
+
+// setup runs with the packet's state already bound
+static void ESCALLBACK CheckSetup( void *arg )
+{
+    const ESDrawPacket *packet = ( const ESDrawPacket * ) arg;
+    
+    setupsBound += mockProgram == packet->program && mockVertexArray == packet->vertexArray &&
+                   mockTexture == packet->textures[0];
+}
+
+static void MakePackets( void )
+{
+    int i;
+    
+    srand( 11 );
+    
+    for( i = 0; i < NUM_PACKETS; i++ )
+    {
+        ESDrawPacket *packet = &packets[i];
+        
+        memset( packet, 0, sizeof( ESDrawPacket ) );
+        packet->program     = 1 + rand() % 3;
+        packet->vertexArray = 1 + rand() % 2;
+        packet->textures[0] = 1 + rand() % 2;
+        packet->mode        = GL_TRIANGLES;
+        packet->count       = 36;
+        // quarter steps survive the depth bits the opaque key drops
+        packet->depth       = 0.25f * ( float ) ( rand() % 400 );
+        packet->translucent = rand() % 4 == 0;
+        packet->setup       = CheckSetup;
+        packet->setupArg    = packet;
+        
+        // one entry point per packet kind, the draw is matched back to its packet by first
+        switch( i % 4 )
+        {
+            case 1:
+                packet->indexType = GL_UNSIGNED_SHORT;
+                break;
+            case 2:
+                packet->instanceCount = 5;
+                break;
+            case 3:
+                packet->indexType     = GL_UNSIGNED_INT;
+                packet->instanceCount = 2;
+                break;
+        }
+        
+        packet->first = i;
+    }
+}
+
+static int SameState( const MockDraw *a, const MockDraw *b )
+{
+    return a->program == b->program && a->vertexArray == b->vertexArray && a->texture == b->texture;
+}
+
+static void TestOrder( ESStateCache *cache )
+{
+    ESDrawQueue queue;
+    int seen[NUM_PACKETS] = { 0 };
+    int numOpaque = 0;
+    int grouped = 1, frontToBack = 1, backToFront = 1, layered = 1, routed = 1, drawnOnce = 1;
+    int programChanges = 0, vertexArrayChanges = 0, textureChanges = 0;
+    int i, j;
+    
+    MakePackets();
+    
+    // starts small so submitting has to grow it
+    ES_CHECK( esDrawQueueInit( &queue, 8 ) );
+    
+    for( i = 0; i < NUM_PACKETS; i++ )
+    {
+        ES_CHECK( esDrawQueueSubmit( &queue, &packets[i] ) );
+        numOpaque += !packets[i].translucent;
+    }
+    
+    esStateCacheResetCounters( cache );
+    esStateCacheInvalidate( cache );
+    mockNumDraws = 0;
+    mockBinds    = 0;
+    setupsBound  = 0;
+    
+    esDrawQueueFlush( &queue, cache );
+    
+    ES_CHECK( mockNumDraws == NUM_PACKETS );
+    ES_CHECK( queue.numDraws == NUM_PACKETS );
+    ES_CHECK( queue.numPackets == 0 );
+    ES_CHECK( setupsBound == NUM_PACKETS );
+    
+    for( i = 0; i < NUM_PACKETS; i++ )
+    {
+        const MockDraw *draw = &mockDraws[i];
+        const ESDrawPacket *packet = &packets[draw->packet];
+        static const GLenum entries[4] = { 1, 2, 3, 4 };
+        
+        drawnOnce &= seen[draw->packet]++ == 0;
+        routed    &= draw->entry == entries[draw->packet % 4];
+        layered   &= packet->translucent == ( i >= numOpaque );
+        
+        if( i > 0 )
+        {
+            const MockDraw *prev = &mockDraws[i - 1];
+            const ESDrawPacket *prevPacket = &packets[prev->packet];
+            
+            programChanges     += prev->program != draw->program;
+            vertexArrayChanges += prev->vertexArray != draw->vertexArray;
+            textureChanges     += prev->texture != draw->texture;
+            
+            if( i < numOpaque && SameState( prev, draw ) )
+            {
+                frontToBack &= prevPacket->depth <= packet->depth;
+            }
+            
+            if( i > numOpaque )
+            {
+                backToFront &= prevPacket->depth >= packet->depth;
+            }
+        }
+        
+        // an opaque state combination shows up as one run, never again after it ended
+        if( i < numOpaque && i > 0 && !SameState( &mockDraws[i - 1], draw ) )
+        {
+            for( j = 0; j < i - 1; j++ )
+            {
+                grouped &= !SameState( &mockDraws[j], draw );
+            }
+        }
+    }
+    
+    ES_CHECK( drawnOnce );
+    ES_CHECK( routed );
+    ES_CHECK( layered );
+    ES_CHECK( grouped );
+    ES_CHECK( frontToBack );
+    ES_CHECK( backToFront );
+    
+    // Only real changes reach GL, the first draw binds everything after the invalidation
+    ES_CHECK( queue.numProgramChanges == ( unsigned int ) programChanges + 1 );
+    ES_CHECK( queue.numVertexArrayChanges == ( unsigned int ) vertexArrayChanges + 1 );
+    ES_CHECK( cache->issued[ES_STATE_USE_PROGRAM] == queue.numProgramChanges );
+    ES_CHECK( cache->issued[ES_STATE_BIND_VERTEX_ARRAY] == queue.numVertexArrayChanges );
+    ES_CHECK( cache->issued[ES_STATE_BIND_TEXTURE] == ( unsigned int ) textureChanges + 1 );
+    ES_CHECK( cache->elided[ES_STATE_USE_PROGRAM] == NUM_PACKETS - queue.numProgramChanges );
+    ES_CHECK( mockBinds == programChanges + vertexArrayChanges + textureChanges + 3 );
+    
+    // Repeats of one packet bind its state at most once
+    for( i = 0; i < 3; i++ )
+    {
+        ES_CHECK( esDrawQueueSubmit( &queue, &packets[0] ) );
+    }
+    
+    mockBinds = 0;
+    esDrawQueueFlush( &queue, cache );
+    ES_CHECK( mockNumDraws == NUM_PACKETS + 3 );
+    ES_CHECK( mockBinds <= 3 );
+    
+    esDrawQueueDestroy( &queue );
+}
+
+typedef struct
+{
+    unsigned long long key;
+    unsigned int       value;
+} KeyValue;
+
+// by key, then by original position, which is what a stable sort gives
+static int CompareKeyValue( const void *a, const void *b )
+{
+    const KeyValue *x = ( const KeyValue * ) a;
+    const KeyValue *y = ( const KeyValue * ) b;
+    
+    if( x->key != y->key )
+    {
+        return x->key < y->key ? -1 : 1;
+    }
+    
+    return x->value < y->value ? -1 : x->value > y->value;
+}
+
+static unsigned long long RandomKey( void )
+{
+    unsigned long long key = 0;
+    int i;
+    
+    for( i = 0; i < 4; i++ )
+    {
+        key = ( key << 16 ) | ( unsigned long long ) ( rand() & 0xFFFF );
+    }
+    
+    return key;
+}
+
+// mask keeps only some digits, so the passes over equal digits are skipped and the pass count gets odd
+static void CheckRadixSort( int count, unsigned long long mask )
+{
+    static unsigned long long keys[NUM_KEYS], tmpKeys[NUM_KEYS];
+    static unsigned int values[NUM_KEYS], tmpValues[NUM_KEYS];
+    static KeyValue expected[NUM_KEYS];
+    int same = 1;
+    int i;
+    
+    for( i = 0; i < count; i++ )
+    {
+        keys[i]   = RandomKey() & mask;
+        values[i] = ( unsigned int ) i;
+        expected[i].key   = keys[i];
+        expected[i].value = values[i];
+    }
+    
+    esRadixSort64( keys, values, tmpKeys, tmpValues, count );
+    qsort( expected, count, sizeof( KeyValue ), CompareKeyValue );
+    
+    for( i = 0; i < count; i++ )
+    {
+        same &= keys[i] == expected[i].key && values[i] == expected[i].value;
+    }
+    
+    ES_CHECK( same );
+}
+
+static void TestRadixSort( void )
+{
+    srand( 5 );
+    
+    CheckRadixSort( 0, ~0ull );
+    CheckRadixSort( 1, ~0ull );
+    CheckRadixSort( 2, ~0ull );
+    CheckRadixSort( NUM_KEYS, ~0ull );
+    // small digit ranges give many equal keys, the order among them has to stay
+    CheckRadixSort( NUM_KEYS, 0x0300000000000007ull );
+    CheckRadixSort( NUM_KEYS, 0xFF00FF0000FF0000ull );
+    CheckRadixSort( NUM_KEYS, 0 );
+    CheckRadixSort( 777, 0x8000000000000000ull | 0xFFFFFull );
+}
+
+int main( void )
+{
+    ESStateCache cache;
+    
+    esStateCacheSetBackend( &mockCacheGL );
+    esDrawQueueSetBackend( &mockDrawGL );
+    esStateCacheInit( &cache );
+    
+    TestOrder( &cache );
+    TestRadixSort();
+    
+    esDrawQueueSetBackend( NULL );
+    esStateCacheSetBackend( NULL );
+    
+    return ES_TEST_RESULT();
+}
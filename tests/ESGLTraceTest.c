@@ -0,0 +1,181 @@
+//
+//  ESGLTraceTest.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  The counting wrappers in front of the stub GL: calls per entry point,
+//  state changes, bytes and draw totals of a known frame, the hand over to
+//  the frame counters in esGLEndFrame, and the stub's mapped ranges.
+//
+
+#include "ESGLTrace.h"
+#include "ESTest.h"
+#include <string.h>
+
+static const GLushort indices[6] = { 0, 1, 2, 2, 1, 3 };
+
+// one frame of known calls: 2 binds, 2 attribute calls, 3 draws and 96 bytes of buffer data
+static void RecordFrame( void )
+{
+    GLuint buffer = 0;
+    GLfloat vertices[16];
+    
+    memset( vertices, 0, sizeof( vertices ) );
+    
+    esGLGenBuffers( 1, &buffer );
+    esGLBindBuffer( GL_ARRAY_BUFFER, buffer );
+    esGLBufferData( GL_ARRAY_BUFFER, sizeof( vertices ), vertices, GL_STATIC_DRAW );
+    // allocation only, no bytes uploaded
+    esGLBufferData( GL_ELEMENT_ARRAY_BUFFER, 1024, NULL, GL_STREAM_DRAW );
+    esGLBufferSubData( GL_ARRAY_BUFFER, 0, 32, vertices );
+    esGLUseProgram( 3 );
+    esGLEnableVertexAttribArray( 0 );
+    esGLVertexAttribPointer( 0, 4, GL_FLOAT, GL_FALSE, 0, NULL );
+    esGLDrawArrays( GL_TRIANGLES, 0, 3 );
+    esGLDrawElements( GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices );
+    esGLDrawElementsInstanced( GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices, 10 );
+}
+
+static void CheckFrame( const ESGLCounters *counters )
+{
+    ES_CHECK( counters->calls[ES_GL_GEN_BUFFERS] == 1 );
+    ES_CHECK( counters->calls[ES_GL_BIND_BUFFER] == 1 );
+    ES_CHECK( counters->calls[ES_GL_BUFFER_DATA] == 2 );
+    ES_CHECK( counters->calls[ES_GL_BUFFER_SUB_DATA] == 1 );
+    ES_CHECK( counters->calls[ES_GL_DRAW_ARRAYS] == 1 );
+    ES_CHECK( counters->calls[ES_GL_DRAW_ELEMENTS] == 1 );
+    ES_CHECK( counters->calls[ES_GL_DRAW_ELEMENTS_INSTANCED] == 1 );
+    ES_CHECK( counters->calls[ES_GL_CLEAR] == 0 );
+    ES_CHECK( counters->totalCalls == 11 );
+    // glBindBuffer, glUseProgram, glEnableVertexAttribArray and glVertexAttribPointer
+    ES_CHECK( counters->stateChanges == 4 );
+    ES_CHECK( counters->bufferDataBytes == 16 * sizeof( GLfloat ) );
+    ES_CHECK( counters->bufferSubDataBytes == 32 );
+    ES_CHECK( counters->mappedBytes == 0 );
+    ES_CHECK( counters->drawCalls == 3 );
+    ES_CHECK( counters->instances == 1 + 1 + 10 );
+    ES_CHECK( counters->vertices == 3 );
+    ES_CHECK( counters->indices == 6 + 6 );
+}
+
+static void CheckCounters( void )
+{
+    ESGLCounters counters;
+    ESGLCounters empty;
+    
+    memset( &empty, 0, sizeof( empty ) );
+    
+    // a frame of its own, whatever came before is forgotten
+    esGLEndFrame();
+    RecordFrame();
+    
+    esGLGetCounters( &counters );
+    CheckFrame( &counters );
+    
+    esGLEndFrame();
+    esGLGetFrameCounters( &counters );
+    CheckFrame( &counters );
+    
+    // The frame in progress starts from zero, the closed one stays readable
+    esGLGetCounters( &counters );
+    ES_CHECK( memcmp( &counters, &empty, sizeof( counters ) ) == 0 );
+    
+    esGLClear( GL_COLOR_BUFFER_BIT );
+    esGLGetCounters( &counters );
+    ES_CHECK( counters.calls[ES_GL_CLEAR] == 1 );
+    ES_CHECK( counters.totalCalls == 1 );
+    esGLGetFrameCounters( &counters );
+    CheckFrame( &counters );
+    
+    // the next close replaces the frame counters
+    esGLEndFrame();
+    esGLGetFrameCounters( &counters );
+    ES_CHECK( counters.totalCalls == 1 );
+    ES_CHECK( counters.drawCalls == 0 );
+    
+    esGLEndFrame();
+    esGLGetFrameCounters( &counters );
+    ES_CHECK( memcmp( &counters, &empty, sizeof( counters ) ) == 0 );
+}
+
+static void CheckStub( void )
+{
+    ESGLCounters counters;
+    GLuint names[3] = { 0, 0, 0 };
+    GLint status = 0;
+    unsigned char *vertices;
+    unsigned char *indexBytes;
+    unsigned char *again;
+    int i;
+    
+    esGLEndFrame();
+    
+    esGLGenTextures( 3, names );
+    ES_CHECK( names[0] != 0 && names[1] == names[0] + 1 && names[2] == names[1] + 1 );
+    ES_CHECK( esGLCreateProgram() > names[2] );
+    ES_CHECK( esGLCheckFramebufferStatus( GL_FRAMEBUFFER ) == GL_FRAMEBUFFER_COMPLETE );
+    esGLGetShaderiv( 1, GL_COMPILE_STATUS, &status );
+    ES_CHECK( status == GL_TRUE );
+    
+    // Ranges mapped on different targets are distinct and stay valid until their unmap
+    vertices   = esGLMapBufferRange( GL_ARRAY_BUFFER, 0, 64, GL_MAP_WRITE_BIT );
+    indexBytes = esGLMapBufferRange( GL_ELEMENT_ARRAY_BUFFER, 0, 4096, GL_MAP_WRITE_BIT );
+    ES_CHECK( vertices != NULL && indexBytes != NULL && vertices != indexBytes );
+    
+    if( vertices != NULL && indexBytes != NULL )
+    {
+        memset( indexBytes, 0xEE, 4096 );
+        memset( vertices, 0x11, 64 );
+        
+        for( i = 0; i < 64; i++ )
+        {
+            ES_CHECK( vertices[i] == 0x11 );
+        }
+        
+        ES_CHECK( indexBytes[0] == 0xEE && indexBytes[4095] == 0xEE );
+    }
+    
+    // already mapped, GL refuses the second map as well
+    ES_CHECK( esGLMapBufferRange( GL_ARRAY_BUFFER, 0, 128, GL_MAP_WRITE_BIT ) == NULL );
+    
+    ES_CHECK( esGLUnmapBuffer( GL_ARRAY_BUFFER ) == GL_TRUE );
+    ES_CHECK( esGLUnmapBuffer( GL_ARRAY_BUFFER ) == GL_FALSE );
+    
+    again = esGLMapBufferRange( GL_ARRAY_BUFFER, 0, 128, GL_MAP_WRITE_BIT );
+    ES_CHECK( again != NULL );
+    
+    if( again != NULL )
+    {
+        memset( again, 0x22, 128 );
+    }
+    
+    ES_CHECK( indexBytes == NULL || ( indexBytes[0] == 0xEE && indexBytes[4095] == 0xEE ) );
+    ES_CHECK( esGLUnmapBuffer( GL_ARRAY_BUFFER ) == GL_TRUE );
+    ES_CHECK( esGLUnmapBuffer( GL_ELEMENT_ARRAY_BUFFER ) == GL_TRUE );
+    ES_CHECK( esGLMapBufferRange( GL_ARRAY_BUFFER, 0, 0, GL_MAP_WRITE_BIT ) == NULL );
+    
+    // only the three maps that returned memory count their bytes
+    esGLGetCounters( &counters );
+    ES_CHECK( counters.calls[ES_GL_MAP_BUFFER_RANGE] == 5 );
+    ES_CHECK( counters.calls[ES_GL_UNMAP_BUFFER] == 4 );
+    ES_CHECK( counters.mappedBytes == 64 + 4096 + 128 );
+}
+
+int main( void )
+{
+    esGLSetBackend( esGLStubBackend() );
+    
+    CheckCounters();
+    CheckStub();
+    
+    ES_CHECK( strcmp( esGLFunctionName( ES_GL_BIND_BUFFER ), "glBindBuffer" ) == 0 );
+    ES_CHECK( strcmp( esGLFunctionName( ES_GL_MAP_BUFFER_RANGE ), "glMapBufferRange" ) == 0 );
+    ES_CHECK( esGLFunctionName( -1 ) == NULL );
+    ES_CHECK( esGLFunctionName( ES_GL_NUM_FUNCTIONS ) == NULL );
+    
+    esGLSetBackend( NULL );
+    
+    return ES_TEST_RESULT();
+}
@@ -0,0 +1,376 @@
+//
+//  ESImageTest.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  esImageDecode and esLoadTGA on hand-built TGAs: truecolor, grayscale and
+//  color mapped, raw and RLE, stored bottom-up and top-down, at widths that
+//  are no multiple of the vector swizzle. Also the vector swizzle itself
+//  against a plain loop.
+//
+
+#include "ESImage.h"
+#include "ESTest.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_WIDTH     37
+#define MAX_HEIGHT    9
+#define MAX_PIXELS    ( MAX_WIDTH * MAX_HEIGHT )
+#define NUM_COLORS    20
+// color map entries start at this index, stored indices are color + PALETTE_FIRST
+#define PALETTE_FIRST 5
+#define MAX_SWIZZLE   70
+#define GUARD         0x5A
+#define FILE_NAME     "ESImageTest.tga"
+
+// RGBA, the red byte doubles as the gray level
+static unsigned char colors[NUM_COLORS][4];
+// color of every pixel in file order
+static int pixelColors[MAX_PIXELS];
+static unsigned char file[18 + 255 + NUM_COLORS * 4 + MAX_PIXELS * 5];
+static unsigned char expected[MAX_PIXELS * 4];
+static unsigned char decoded[MAX_PIXELS * 4 + 16];
+
+static int IsMapped( int type )
+{
+    return type == ES_TGA_MAPPED || type == ES_TGA_RLE_MAPPED;
+}
+
+static int IsRLE( int type )
+{
+    return type >= ES_TGA_RLE_MAPPED;
+}
+
+static void PutLE16( unsigned char *p, int value )
+{
+    p[0] = ( unsigned char ) value;
+    p[1] = ( unsigned char ) ( value >> 8 );
+}
+
+// one pixel as the file stores it: an index, a gray level or BGR(A)
+static unsigned char *PutPixel( unsigned char *p, int type, int channels, int color )
+{
+    if( IsMapped( type ) )
+    {
+        *p++ = ( unsigned char ) ( color + PALETTE_FIRST );
+    }
+    else if( channels == 1 )
+    {
+        *p++ = colors[color][0];
+    }
+    else
+    {
+        p[0] = colors[color][2];
+        p[1] = colors[color][1];
+        p[2] = colors[color][0];
+        
+        if( channels == 4 )
+        {
+            p[3] = colors[color][3];
+        }
+        
+        p += channels;
+    }
+    
+    return p;
+}
+
+// Colors held for a random stretch, so RLE runs span rows and raw packets sit between them
+static void FillPixels( int count )
+{
+    int color = 0;
+    int hold = 0;
+    int i;
+    
+    for( i = 0; i < count; i++ )
+    {
+        if( hold-- <= 0 )
+        {
+            color = rand() % NUM_COLORS;
+            hold  = rand() % 3 == 0 ? rand() % 50 : rand() % 2;
+        }
+        
+        pixelColors[i] = color;
+    }
+}
+
+// TGA file of pixelColors, returns its size. channels are the decoded ones, the color map depth for mapped images
+static int BuildTGA( int type, int channels, int width, int height, GLboolean topDown, int idLength )
+{
+    int count = width * height;
+    unsigned char *p = file;
+    int i;
+    
+    memset( file, 0, 18 );
+    file[0] = ( unsigned char ) idLength;
+    file[2] = ( unsigned char ) type;
+    PutLE16( file + 12, width );
+    PutLE16( file + 14, height );
+    file[16] = ( unsigned char ) ( IsMapped( type ) ? 8 : channels * 8 );
+    file[17] = ( unsigned char ) ( ( topDown ? 0x20 : 0 ) | ( channels == 4 ? 8 : 0 ) );
+    p += 18;
+    
+    memset( p, 0xAB, idLength );
+    p += idLength;
+    
+    if( IsMapped( type ) )
+    {
+        file[1] = 1;
+        PutLE16( file + 3, PALETTE_FIRST );
+        PutLE16( file + 5, NUM_COLORS );
+        file[7] = ( unsigned char ) ( channels * 8 );
+        
+        for( i = 0; i < NUM_COLORS; i++ )
+        {
+            p = PutPixel( p, ES_TGA_TRUECOLOR, channels, i );
+        }
+    }
+    
+    for( i = 0; i < count; )
+    {
+        int run = 1;
+        int raw = 1;
+        
+        if( !IsRLE( type ) )
+        {
+            p = PutPixel( p, type, channels, pixelColors[i++] );
+            continue;
+        }
+        
+        while( i + run < count && run < 128 && pixelColors[i + run] == pixelColors[i] )
+        {
+            run++;
+        }
+        
+        if( run >= 2 )
+        {
+            *p++ = ( unsigned char ) ( 0x80 | ( run - 1 ) );
+            p = PutPixel( p, type, channels, pixelColors[i] );
+            i += run;
+            continue;
+        }
+        
+        // raw up to where the next run starts
+        while( i + raw < count && raw < 128 &&
+               !( i + raw + 1 < count && pixelColors[i + raw] == pixelColors[i + raw + 1] ) )
+        {
+            raw++;
+        }
+        
+        *p++ = ( unsigned char ) ( raw - 1 );
+        
+        for( ; raw > 0; raw-- )
+        {
+            p = PutPixel( p, type, channels, pixelColors[i++] );
+        }
+    }
+    
+    return ( int ) ( p - file );
+}
+
+// what glTexImage2D wants: RGB(A) or gray, bottom row first
+static void BuildExpected( int channels, int width, int height, GLboolean topDown )
+{
+    int i;
+    int c;
+    
+    for( i = 0; i < width * height; i++ )
+    {
+        int row = i / width;
+        int x = i % width;
+        unsigned char *out = &expected[( ( topDown ? height - 1 - row : row ) * width + x ) * channels];
+        
+        for( c = 0; c < channels; c++ )
+        {
+            out[c] = colors[pixelColors[i]][c];
+        }
+    }
+}
+
+static GLboolean WriteFile( int size )
+{
+    FILE *fp = fopen( FILE_NAME, "wb" );
+    GLboolean written;
+    
+    if( fp == NULL )
+    {
+        return GL_FALSE;
+    }
+    
+    written = fwrite( file, ( size_t ) size, 1, fp ) == 1;
+    
+    return fclose( fp ) == 0 && written;
+}
+
+static void CheckImage( int type, int channels, int width, int height, GLboolean topDown )
+{
+    size_t size = ( size_t ) width * height * channels;
+    ESImage image;
+    char *loaded;
+    int loadedWidth = 0;
+    int loadedHeight = 0;
+    size_t i;
+    
+    FillPixels( width * height );
+    BuildExpected( channels, width, height, topDown );
+    ES_CHECK( WriteFile( BuildTGA( type, channels, width, height, topDown, width % 2 ? 3 : 0 ) ) );
+    
+    if( !esImageOpenTGA( &image, FILE_NAME ) )
+    {
+        fprintf( stderr, "type %d, %d channels, %dx%d, top-down %d: esImageOpenTGA failed\n",
+                 type, channels, width, height, topDown );
+        esTestFailures++;
+        return;
+    }
+    
+    ES_CHECK( image.imageType == type );
+    ES_CHECK( image.width == width && image.height == height );
+    ES_CHECK( image.channels == channels );
+    ES_CHECK( image.topDown == topDown );
+    ES_CHECK( esImageDecodedSize( &image ) == size );
+    // only raw, unmapped images are handed out in place
+    ES_CHECK( ( image.pixels != NULL ) == ( type == ES_TGA_TRUECOLOR || type == ES_TGA_GRAYSCALE ) );
+    
+    memset( decoded, GUARD, sizeof( decoded ) );
+    ES_CHECK( esImageDecode( &image, decoded ) );
+    
+    if( memcmp( decoded, expected, size ) != 0 )
+    {
+        fprintf( stderr, "type %d, %d channels, %dx%d, top-down %d: decoded pixels differ\n",
+                 type, channels, width, height, topDown );
+        esTestFailures++;
+    }
+    
+    for( i = size; i < sizeof( decoded ); i++ )
+    {
+        ES_CHECK( decoded[i] == GUARD );
+    }
+    
+    esImageClose( &image );
+    
+    loaded = esLoadTGA( NULL, FILE_NAME, &loadedWidth, &loadedHeight );
+    ES_CHECK( loaded != NULL );
+    ES_CHECK( loadedWidth == width && loadedHeight == height );
+    ES_CHECK( loaded == NULL || memcmp( loaded, expected, size ) == 0 );
+    free( loaded );
+}
+
+static void CheckImages( void )
+{
+    static const int types[] = { ES_TGA_TRUECOLOR, ES_TGA_GRAYSCALE, ES_TGA_RLE_MAPPED,
+                                 ES_TGA_RLE_TRUECOLOR, ES_TGA_RLE_GRAYSCALE, ES_TGA_MAPPED };
+    static const int widths[] = { 1, 7, 13, 16, MAX_WIDTH };
+    static const int heights[] = { 1, 4, MAX_HEIGHT };
+    int t, w, h;
+    int channels;
+    int topDown;
+    
+    for( t = 0; t < ( int ) ( sizeof( types ) / sizeof( types[0] ) ); t++ )
+    {
+        int grayscale = types[t] == ES_TGA_GRAYSCALE || types[t] == ES_TGA_RLE_GRAYSCALE;
+        
+        for( channels = grayscale ? 1 : 3; channels <= ( grayscale ? 1 : 4 ); channels++ )
+        {
+            for( topDown = 0; topDown < 2; topDown++ )
+            {
+                for( w = 0; w < ( int ) ( sizeof( widths ) / sizeof( widths[0] ) ); w++ )
+                {
+                    for( h = 0; h < ( int ) ( sizeof( heights ) / sizeof( heights[0] ) ); h++ )
+                    {
+                        CheckImage( types[t], channels, widths[w], heights[h], topDown ? GL_TRUE : GL_FALSE );
+                    }
+                }
+            }
+        }
+    }
+}
+
+// A short payload is refused by the open when raw, by the decode when RLE
+static void CheckTruncated( void )
+{
+    ESImage image;
+    int size;
+    
+    FillPixels( MAX_PIXELS );
+    
+    size = BuildTGA( ES_TGA_TRUECOLOR, 3, MAX_WIDTH, MAX_HEIGHT, GL_FALSE, 0 );
+    ES_CHECK( WriteFile( size - 1 ) );
+    ES_CHECK( !esImageOpenTGA( &image, FILE_NAME ) );
+    
+    size = BuildTGA( ES_TGA_RLE_TRUECOLOR, 4, MAX_WIDTH, MAX_HEIGHT, GL_TRUE, 0 );
+    ES_CHECK( WriteFile( size - 1 ) );
+    ES_CHECK( esImageOpenTGA( &image, FILE_NAME ) );
+    ES_CHECK( !esImageDecode( &image, decoded ) );
+    esImageClose( &image );
+    
+    ES_CHECK( esLoadTGA( NULL, FILE_NAME, &size, &size ) == NULL );
+}
+
+static void CheckSwizzle( void )
+{
+    static unsigned char src[MAX_SWIZZLE * 4 + 16];
+    static unsigned char dest[MAX_SWIZZLE * 4 + 16];
+    static unsigned char reference[MAX_SWIZZLE * 4];
+    int channels;
+    int count;
+    int i;
+    
+    for( channels = 3; channels <= 4; channels++ )
+    {
+        for( count = 0; count < MAX_SWIZZLE; count++ )
+        {
+            int bytes = count * channels;
+            
+            for( i = 0; i < bytes; i++ )
+            {
+                src[i] = ( unsigned char ) rand();
+            }
+            
+            for( i = 0; i < bytes; i += channels )
+            {
+                memcpy( &reference[i], &src[i], channels );
+                reference[i]     = src[i + 2];
+                reference[i + 2] = src[i];
+            }
+            
+            memset( dest, GUARD, sizeof( dest ) );
+            esImageSwizzleBGR( dest, src, count, channels );
+            ES_CHECK( memcmp( dest, reference, bytes ) == 0 );
+            
+            for( i = bytes; i < ( int ) sizeof( dest ); i++ )
+            {
+                ES_CHECK( dest[i] == GUARD );
+            }
+            
+            // in place, as esImageDecode does after an RLE decode
+            esImageSwizzleBGR( src, src, count, channels );
+            ES_CHECK( memcmp( src, reference, bytes ) == 0 );
+        }
+    }
+}
+
+int main( void )
+{
+    int i;
+    
+    srand( 12 );
+    
+    for( i = 0; i < NUM_COLORS; i++ )
+    {
+        colors[i][0] = ( unsigned char ) rand();
+        colors[i][1] = ( unsigned char ) rand();
+        colors[i][2] = ( unsigned char ) rand();
+        colors[i][3] = ( unsigned char ) rand();
+    }
+    
+    CheckSwizzle();
+    CheckImages();
+    CheckTruncated();
+    
+    remove( FILE_NAME );
+    
+    return ES_TEST_RESULT();
+}
@@ -0,0 +1,181 @@
+//
+//  ESJobTest.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  esJobParallelFor over the sample's instance update: TRS matrices built four
+//  at a time, gathered through a shuffled visible list and multiplied in a
+//  batch. Inline and on workers, at every grain size, the output has to be bit
+//  for bit the one of a plain loop over single instances.
+//
+
+#include "ESJob.h"
+#include "ESQuaternion.h"
+#include "ESTest.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_INSTANCES 1000
+#define NUM_WORKERS   3
+
+typedef struct
+{
+    ESTRSArrays trs;
+    // visible instances, a shuffled subset as esCullTreeQuery would return
+    const int  *visible;
+    ESMatrix    perspective;
+    ESMatrix   *world;
+    ESMatrix   *mvps;
+    GLubyte   ( *colors )[4];
+    int        *visits;
+} InstanceUpdate;
+
+static GLfloat positions[3][NUM_INSTANCES];
+static GLfloat rotations[4][NUM_INSTANCES];
+static GLfloat scales[3][NUM_INSTANCES];
+static int     visible[NUM_INSTANCES];
+static ESMatrix world[NUM_INSTANCES];
+static ESMatrix mvps[NUM_INSTANCES];
+static ESMatrix expectedMvps[NUM_INSTANCES];
+static GLubyte colors[NUM_INSTANCES][4];
+static GLubyte expectedColors[NUM_INSTANCES][4];
+static int     visits[NUM_INSTANCES];
+
+// same steps as GatherVisibleRange in MyGLApplication.c, with the TRS build of esSceneUpdate in front
+static void ESCALLBACK UpdateRange( void *arg, int begin, int end )
+{
+    InstanceUpdate *update = ( InstanceUpdate * ) arg;
+    int i;
+    
+    esMatrixFromTRSBatch( &update->world[begin], &update->trs, &update->visible[begin], end - begin );
+    
+    for( i = begin; i < end; i++ )
+    {
+        int instance = update->visible[i];
+        
+        update->colors[i][0] = ( GLubyte ) instance;
+        update->colors[i][1] = ( GLubyte ) ( instance >> 8 );
+        update->colors[i][2] = ( GLubyte ) ( instance * 7 );
+        update->colors[i][3] = 255;
+        update->visits[i]++;
+    }
+    
+    esMatrixMultiplyBatch( &update->mvps[begin], &update->world[begin], &update->perspective, end - begin );
+}
+
+static void InitInstances( InstanceUpdate *update )
+{
+    int i;
+    
+    srand( 7 );
+    
+    for( i = 0; i < NUM_INSTANCES; i++ )
+    {
+        ESQuaternion rotation;
+        
+        esQuaternionFromAxisAngle( &rotation, ( float ) ( rand() % 3600 ) * 0.1f,
+                                   ( float ) ( rand() % 100 ) - 50.0f, 1.0f, ( float ) ( rand() % 100 ) * 0.1f );
+        
+        positions[0][i] = ( float ) ( rand() % 2000 ) * 0.01f - 10.0f;
+        positions[1][i] = ( float ) ( rand() % 2000 ) * 0.01f - 10.0f;
+        positions[2][i] = -1.0f - ( float ) ( rand() % 1900 ) * 0.01f;
+        rotations[0][i] = rotation.x;
+        rotations[1][i] = rotation.y;
+        rotations[2][i] = rotation.z;
+        rotations[3][i] = rotation.w;
+        scales[0][i]    = 0.5f + ( float ) ( rand() % 100 ) * 0.01f;
+        scales[1][i]    = 0.5f + ( float ) ( rand() % 100 ) * 0.01f;
+        scales[2][i]    = 0.5f + ( float ) ( rand() % 100 ) * 0.01f;
+        visible[i]      = i;
+    }
+    
+    // Fisher-Yates, the gather reads the instances out of order
+    for( i = NUM_INSTANCES - 1; i > 0; i-- )
+    {
+        int j = rand() % ( i + 1 );
+        int swap = visible[i];
+        
+        visible[i] = visible[j];
+        visible[j] = swap;
+    }
+    
+    memset( update, 0, sizeof( InstanceUpdate ) );
+    update->trs.positionX = positions[0];
+    update->trs.positionY = positions[1];
+    update->trs.positionZ = positions[2];
+    update->trs.rotationX = rotations[0];
+    update->trs.rotationY = rotations[1];
+    update->trs.rotationZ = rotations[2];
+    update->trs.rotationW = rotations[3];
+    update->trs.scaleX    = scales[0];
+    update->trs.scaleY    = scales[1];
+    update->trs.scaleZ    = scales[2];
+    update->visible       = visible;
+    update->world         = world;
+    update->mvps          = mvps;
+    update->colors        = colors;
+    update->visits        = visits;
+    
+    esMatrixLoadIdentity( &update->perspective );
+    esPerspective( &update->perspective, 60.0f, 1.5f, 1.0f, 20.0f );
+}
+
+// one instance at a time, so every matrix comes out of the scalar tail of the batch kernels
+static void UpdateSerial( InstanceUpdate *update )
+{
+    int i;
+    
+    for( i = 0; i < NUM_INSTANCES; i++ )
+    {
+        UpdateRange( update, i, i + 1 );
+    }
+    
+    memcpy( expectedMvps, mvps, sizeof( mvps ) );
+    memcpy( expectedColors, colors, sizeof( colors ) );
+}
+
+static void CheckParallel( InstanceUpdate *update )
+{
+    static const int grainSizes[] = { 0, 1, 3, 4, 7, 64, 333, NUM_INSTANCES - 1, NUM_INSTANCES, NUM_INSTANCES * 2 };
+    int g, i;
+    
+    for( g = 0; g < ( int ) ( sizeof( grainSizes ) / sizeof( grainSizes[0] ) ); g++ )
+    {
+        int once = 1;
+        
+        memset( mvps, 0, sizeof( mvps ) );
+        memset( colors, 0, sizeof( colors ) );
+        memset( visits, 0, sizeof( visits ) );
+        
+        esJobParallelFor( NUM_INSTANCES, grainSizes[g], UpdateRange, update );
+        
+        for( i = 0; i < NUM_INSTANCES; i++ )
+        {
+            once &= visits[i] == 1;
+        }
+        
+        ES_CHECK( once );
+        ES_CHECK( memcmp( mvps, expectedMvps, sizeof( mvps ) ) == 0 );
+        ES_CHECK( memcmp( colors, expectedColors, sizeof( colors ) ) == 0 );
+    }
+}
+
+int main( void )
+{
+    InstanceUpdate update;
+    
+    InitInstances( &update );
+    UpdateSerial( &update );
+    
+    // Without workers every range runs inline on this thread
+    ES_CHECK( esJobNumThreads() == 1 );
+    CheckParallel( &update );
+    
+    ES_CHECK( esJobSystemInit( NUM_WORKERS ) == NUM_WORKERS );
+    CheckParallel( &update );
+    esJobSystemShutdown();
+    
+    return ES_TEST_RESULT();
+}
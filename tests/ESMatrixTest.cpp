@@ -0,0 +1,205 @@
+//
+//  ESMatrixTest.cpp
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  es::Matrix expressions against esMatrixMultiply and the ESTransform
+//  builders, at runtime and in constant evaluation, plus the compile-time
+//  rules on affine results.
+//
+
+#include "ESMatrix.hpp"
+#include "ESTest.h"
+#include <type_traits>
+
+namespace
+{
+    // Only affine expressions fit an AffineMatrix, anything fits a Matrix
+    using AffineProduct = decltype( es::AffineMatrix() * es::AffineMatrix() );
+    using MixedProduct  = decltype( es::AffineMatrix() * es::Matrix() * es::AffineMatrix() );
+    
+    static_assert( AffineProduct::affine && !MixedProduct::affine, "a product is affine when both sides are" );
+    static_assert( std::is_constructible< es::AffineMatrix, AffineProduct >::value, "affine * affine is affine" );
+    static_assert( !std::is_constructible< es::AffineMatrix, MixedProduct >::value, "a projective factor is not" );
+    static_assert( std::is_constructible< es::Matrix, MixedProduct >::value, "any product fits a Matrix" );
+    static_assert( !std::is_assignable< es::AffineMatrix &, MixedProduct >::value, "nor can it be assigned" );
+    static_assert( !std::is_convertible< ESMatrix, es::Matrix >::value, "wrapping an ESMatrix is explicit" );
+    
+    // Products fold at compile time, with exact results on exact inputs
+    constexpr es::AffineMatrix moved = es::scaling( 2.0f, 3.0f, 4.0f ) * es::translation( 1.0f, -2.0f, 0.5f );
+    
+    static_assert( moved( 0, 0 ) == 2.0f && moved( 1, 1 ) == 3.0f && moved( 2, 2 ) == 4.0f, "scale first" );
+    static_assert( moved( 3, 0 ) == 1.0f && moved( 3, 1 ) == -2.0f && moved( 3, 2 ) == 0.5f, "then translate" );
+    static_assert( moved( 0, 3 ) == 0.0f && moved( 3, 3 ) == 1.0f, "last column stays 0, 0, 0, 1" );
+    
+    constexpr es::AffineMatrix movedBack = es::translation( -1.0f, 2.0f, -0.5f ) * es::translation( 1.0f, -2.0f, 0.5f );
+    
+    static_assert( movedBack( 3, 0 ) == 0.0f && movedBack( 3, 1 ) == 0.0f && movedBack( 3, 2 ) == 0.0f,
+                   "opposite translations cancel" );
+    
+    // a nested product on the right gives the same as the left-nested one
+    constexpr es::Matrix leftNested  = es::scaling( 2.0f, 2.0f, 2.0f ) * es::translation( 0.0f, 0.0f, -4.0f ) *
+                                       es::frustum( -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 9.0f );
+    constexpr es::Matrix rightNested = es::scaling( 2.0f, 2.0f, 2.0f ) * ( es::translation( 0.0f, 0.0f, -4.0f ) *
+                                                                            es::frustum( -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 9.0f ) );
+    
+    static_assert( leftNested( 0, 0 ) == 2.0f && leftNested( 2, 3 ) == -2.0f && leftNested( 3, 3 ) == 4.0f,
+                   "frustum after the view transform" );
+    static_assert( leftNested( 3, 2 ) == rightNested( 3, 2 ) && leftNested( 2, 2 ) == rightNested( 2, 2 ),
+                   "products associate" );
+    
+    // An invalid frustum is the identity, as with esFrustum
+    static_assert( es::frustum( 1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 9.0f )( 2, 3 ) == 0.0f, "degenerate frustum" );
+    
+    // distinct, well conditioned inputs
+    ESMatrix MakeMatrix( int seed, bool affine )
+    {
+        ESMatrix matrix;
+        
+        esMatrixLoadIdentity( &matrix );
+        esScale( &matrix, 1.0f + 0.1f * seed, 0.5f + 0.05f * seed, 2.0f );
+        esRotate( &matrix, 17.0f * seed, 0.3f, 1.0f, 0.2f * seed );
+        esTranslate( &matrix, ( float ) seed, -2.0f, 0.5f * seed );
+        
+        if( !affine )
+        {
+            matrix.m[0][3] = 0.25f;
+            matrix.m[2][3] = -0.5f * seed;
+            matrix.m[3][3] = 1.5f;
+        }
+        
+        return matrix;
+    }
+    
+    // esMatrixMultiply takes its operands by non-const pointer
+    ESMatrix Multiply( ESMatrix a, ESMatrix b )
+    {
+        ESMatrix result;
+        
+        esMatrixMultiply( &result, &a, &b );
+        
+        return result;
+    }
+    
+    // largest element difference relative to the largest element of b
+    double MaxDiff( const ESMatrix &a, const ESMatrix &b )
+    {
+        double diff = 0.0;
+        double scale = 1.0;
+        
+        for( int r = 0; r < 4; r++ )
+        {
+            for( int c = 0; c < 4; c++ )
+            {
+                diff  = fmax( diff, fabs( double( a.m[r][c] ) - b.m[r][c] ) );
+                scale = fmax( scale, fabs( double( b.m[r][c] ) ) );
+            }
+        }
+        
+        return diff / scale;
+    }
+    
+    void TestProducts()
+    {
+        const es::Matrix a( MakeMatrix( 1, false ) );
+        const es::Matrix b( MakeMatrix( 2, false ) );
+        const es::Matrix c( MakeMatrix( 3, false ) );
+        const es::AffineMatrix d( MakeMatrix( 4, true ) );
+        const es::AffineMatrix e( MakeMatrix( 5, true ) );
+        const ESMatrix ab = Multiply( a, b );
+        const ESMatrix abc = Multiply( ab, c );
+        es::Matrix result;
+        es::AffineMatrix affine;
+        
+        result = a * b;
+        ES_CHECK_NEAR( MaxDiff( result, ab ), 0.0, 1e-6 );
+        
+        result = a * b * c;
+        ES_CHECK_NEAR( MaxDiff( result, abc ), 0.0, 1e-6 );
+        
+        result = a * ( b * c );
+        ES_CHECK_NEAR( MaxDiff( result, abc ), 0.0, 1e-6 );
+        
+        result = ( a * b ) * ( c * d );
+        ES_CHECK_NEAR( MaxDiff( result, Multiply( abc, d ) ), 0.0, 1e-6 );
+        
+        // affine factors on either side skip their known terms
+        result = d * a * e;
+        ES_CHECK_NEAR( MaxDiff( result, Multiply( Multiply( d, a ), e ) ), 0.0, 1e-6 );
+        
+        affine = d * e * d;
+        ES_CHECK_NEAR( MaxDiff( affine, Multiply( Multiply( d, e ), d ) ), 0.0, 1e-6 );
+        ES_CHECK( affine.m[0][3] == 0.0f && affine.m[1][3] == 0.0f && affine.m[2][3] == 0.0f && affine.m[3][3] == 1.0f );
+        
+        // the destination may be one of the operands
+        result = a;
+        result = result * b;
+        ES_CHECK_NEAR( MaxDiff( result, ab ), 0.0, 1e-6 );
+        
+        result = b;
+        result = a * result * c;
+        ES_CHECK_NEAR( MaxDiff( result, abc ), 0.0, 1e-6 );
+        
+        result = c;
+        result = a * ( b * result );
+        ES_CHECK_NEAR( MaxDiff( result, abc ), 0.0, 1e-6 );
+        
+        // es::Matrix is an ESMatrix for the C API
+        result = b;
+        esMatrixMultiply( &result, &result, &affine );
+        ES_CHECK_NEAR( MaxDiff( result, Multiply( b, affine ) ), 0.0, 0.0 );
+    }
+    
+    void TestBuilders()
+    {
+        ESMatrix expected;
+        
+        esMatrixLoadIdentity( &expected );
+        esTranslate( &expected, 1.5f, -2.0f, 3.0f );
+        ES_CHECK_NEAR( MaxDiff( es::translation( 1.5f, -2.0f, 3.0f ), expected ), 0.0, 0.0 );
+        
+        esMatrixLoadIdentity( &expected );
+        esScale( &expected, 2.0f, 0.5f, -1.0f );
+        ES_CHECK_NEAR( MaxDiff( es::scaling( 2.0f, 0.5f, -1.0f ), expected ), 0.0, 0.0 );
+        
+        // the constexpr sin/cos against libm
+        for( int angle = -400; angle <= 400; angle += 35 )
+        {
+            esMatrixLoadIdentity( &expected );
+            esRotate( &expected, ( float ) angle, 0.3f, -1.0f, 0.6f );
+            ES_CHECK_NEAR( MaxDiff( es::rotation( ( float ) angle, 0.3f, -1.0f, 0.6f ), expected ), 0.0, 1e-6 );
+        }
+        
+        esMatrixLoadIdentity( &expected );
+        esFrustum( &expected, -2.0f, 1.0f, -0.5f, 1.5f, 0.5f, 40.0f );
+        ES_CHECK_NEAR( MaxDiff( es::frustum( -2.0f, 1.0f, -0.5f, 1.5f, 0.5f, 40.0f ), expected ), 0.0, 1e-6 );
+        
+        // computed at compile time
+        constexpr es::Matrix perspective = es::perspective( 60.0f, 1.5f, 1.0f, 20.0f );
+        
+        esMatrixLoadIdentity( &expected );
+        esPerspective( &expected, 60.0f, 1.5f, 1.0f, 20.0f );
+        ES_CHECK_NEAR( MaxDiff( perspective, expected ), 0.0, 1e-6 );
+        
+        // a whole model-view-projection chain folded by the compiler
+        constexpr es::Matrix mvp = es::rotation( 30.0f, 0.0f, 1.0f, 0.0f ) * es::translation( 0.0f, 0.0f, -5.0f ) *
+                                   es::perspective( 60.0f, 1.5f, 1.0f, 20.0f );
+        ESMatrix model;
+        
+        // each ES call applies before what the matrix already holds
+        esMatrixLoadIdentity( &model );
+        esTranslate( &model, 0.0f, 0.0f, -5.0f );
+        esRotate( &model, 30.0f, 0.0f, 1.0f, 0.0f );
+        ES_CHECK_NEAR( MaxDiff( mvp, Multiply( model, expected ) ), 0.0, 1e-6 );
+    }
+}
+
+int main()
+{
+    TestProducts();
+    TestBuilders();
+    
+    return ES_TEST_RESULT();
+}
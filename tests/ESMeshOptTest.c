@@ -0,0 +1,357 @@
+//
+//  ESMeshOptTest.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  The index optimizer checked by an independent FIFO post-transform cache
+//  simulator: esMeshAnalyzeCache has to agree with it, the cache pass has to
+//  keep every triangle and lower the ACMR, the fetch pass has to keep it. The
+//  overdraw pass has to keep every triangle, not raise the overdraw and give
+//  up little ACMR.
+//
+
+#include "ESMeshOpt.h"
+#include "ESTest.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Cache sizes the tests simulate
+static const int cacheSizes[] = { 8, 16, ES_MESH_CACHE_SIZE };
+
+// vertex shader invocations of a FIFO cache of cacheSize entries, a literal queue
+static int SimulateFIFO( const GLuint *indices, int numIndices, int cacheSize )
+{
+    GLuint *fifo = malloc( sizeof( GLuint ) * cacheSize );
+    int count = 0;
+    int next = 0;
+    int transforms = 0;
+    int i;
+    int k;
+    
+    for( i = 0; i < numIndices; i++ )
+    {
+        for( k = 0; k < count && fifo[k] != indices[i]; k++ )
+        {
+        }
+        
+        if( k == count )
+        {
+            fifo[next] = indices[i];
+            next = ( next + 1 ) % cacheSize;
+            count = count < cacheSize ? count + 1 : count;
+            transforms++;
+        }
+    }
+    
+    free( fifo );
+    return transforms;
+}
+
+// a triangle as the rotation starting at its smallest index, winding kept
+static void CanonicalTriangle( const GLuint *tri, GLuint *out )
+{
+    int first = tri[0] <= tri[1] && tri[0] <= tri[2] ? 0 : ( tri[1] <= tri[2] ? 1 : 2 );
+    
+    out[0] = tri[first];
+    out[1] = tri[( first + 1 ) % 3];
+    out[2] = tri[( first + 2 ) % 3];
+}
+
+static int CompareTriangles( const void *a, const void *b )
+{
+    const GLuint *ta = a;
+    const GLuint *tb = b;
+    int i;
+    
+    for( i = 0; i < 3; i++ )
+    {
+        if( ta[i] != tb[i] )
+        {
+            return ta[i] < tb[i] ? -1 : 1;
+        }
+    }
+    
+    return 0;
+}
+
+// both index buffers hold the same triangles with the same winding, in any order
+static int SameTriangles( const GLuint *a, const GLuint *b, int numIndices )
+{
+    GLuint *ca = malloc( sizeof( GLuint ) * numIndices );
+    GLuint *cb = malloc( sizeof( GLuint ) * numIndices );
+    int same;
+    int i;
+    
+    for( i = 0; i < numIndices; i += 3 )
+    {
+        CanonicalTriangle( a + i, ca + i );
+        CanonicalTriangle( b + i, cb + i );
+    }
+    
+    qsort( ca, numIndices / 3, sizeof( GLuint ) * 3, CompareTriangles );
+    qsort( cb, numIndices / 3, sizeof( GLuint ) * 3, CompareTriangles );
+    same = memcmp( ca, cb, sizeof( GLuint ) * numIndices ) == 0;
+    
+    free( ca );
+    free( cb );
+    return same;
+}
+
+// shuffle the triangles with a fixed LCG, the worst case for the cache
+static void ShuffleTriangles( GLuint *indices, int numIndices )
+{
+    unsigned int seed = 12345;
+    int i;
+    
+    for( i = numIndices / 3 - 1; i > 0; i-- )
+    {
+        int j;
+        GLuint tri[3];
+        
+        seed = seed * 1664525u + 1013904223u;
+        j = ( int ) ( ( seed >> 8 ) % ( unsigned int ) ( i + 1 ) );
+        memcpy( tri, indices + i * 3, sizeof( tri ) );
+        memcpy( indices + i * 3, indices + j * 3, sizeof( tri ) );
+        memcpy( indices + j * 3, tri, sizeof( tri ) );
+    }
+}
+
+static void TestMesh( const char *name, const GLuint *indices, int numIndices, int numVertices, float maxAcmr )
+{
+    GLuint *optimized = malloc( sizeof( GLuint ) * numIndices );
+    GLuint *remapped  = malloc( sizeof( GLuint ) * numIndices );
+    GLuint *remap     = malloc( sizeof( GLuint ) * numVertices );
+    ESMeshCacheStats before;
+    ESMeshCacheStats after;
+    int numUsed;
+    int i;
+    
+    // The analyzer is the same FIFO as the simulator
+    for( i = 0; i < ( int ) ( sizeof( cacheSizes ) / sizeof( cacheSizes[0] ) ); i++ )
+    {
+        esMeshAnalyzeCache( indices, numIndices, numVertices, cacheSizes[i], &before );
+        ES_CHECK( before.transforms == SimulateFIFO( indices, numIndices, cacheSizes[i] ) );
+    }
+    
+    ES_CHECK( esMeshOptimizeVertexCache( optimized, indices, numIndices, numVertices ) );
+    ES_CHECK( SameTriangles( indices, optimized, numIndices ) );
+    
+    esMeshAnalyzeCache( indices, numIndices, numVertices, ES_MESH_CACHE_SIZE, &before );
+    esMeshAnalyzeCache( optimized, numIndices, numVertices, ES_MESH_CACHE_SIZE, &after );
+    printf( "%-14s ACMR %.3f -> %.3f  ATVR %.3f -> %.3f\n", name, before.acmr, after.acmr, before.atvr, after.atvr );
+    
+    ES_CHECK( after.acmr <= before.acmr );
+    ES_CHECK( after.acmr <= maxAcmr );
+    ES_CHECK( after.atvr >= 1.0f );
+    
+    // The optimized order also wins on the smaller caches of the simulator
+    for( i = 0; i < ( int ) ( sizeof( cacheSizes ) / sizeof( cacheSizes[0] ) ); i++ )
+    {
+        ES_CHECK( SimulateFIFO( optimized, numIndices, cacheSizes[i] ) <= SimulateFIFO( indices, numIndices, cacheSizes[i] ) );
+    }
+    
+    // Renumbering only changes names: vertices appear as 0, 1, 2, ... and the cache behaves the same
+    numUsed = esMeshVertexFetchRemap( remap, optimized, numIndices, numVertices );
+    ES_CHECK( numUsed == numVertices );
+    esMeshRemapIndices( remapped, optimized, numIndices, remap );
+    
+    for( i = 0, numUsed = 0; i < numIndices; i++ )
+    {
+        ES_CHECK( remapped[i] <= ( GLuint ) numUsed );
+        numUsed += remapped[i] == ( GLuint ) numUsed;
+    }
+    
+    ES_CHECK( SimulateFIFO( remapped, numIndices, ES_MESH_CACHE_SIZE ) == after.transforms );
+    
+    free( optimized );
+    free( remapped );
+    free( remap );
+}
+
+// esMeshOptimizeShape moves the vertex data along with the indices
+static void TestShape( void )
+{
+    GLfloat *vertices;
+    GLuint *indices;
+    GLuint *original;
+    GLfloat *positions;
+    int numIndices = esGenSquareGrid( 16, &vertices, &indices );
+    int numVertices = 16 * 16;
+    int i;
+    
+    original  = malloc( sizeof( GLuint ) * numIndices );
+    positions = malloc( sizeof( GLfloat ) * 3 * numVertices );
+    memcpy( positions, vertices, sizeof( GLfloat ) * 3 * numVertices );
+    
+    ShuffleTriangles( indices, numIndices );
+    memcpy( original, indices, sizeof( GLuint ) * numIndices );
+    ES_CHECK( esMeshOptimizeShape( indices, numIndices, numVertices, vertices, NULL, NULL ) );
+    
+    // Every triangle still has the same corner positions, in the same order, as one of the originals.
+    // Grid positions are unique, so compare the triangles through them
+    for( i = 0; i < numIndices; i += 3 )
+    {
+        int t;
+        int found = 0;
+        
+        for( t = 0; t < numIndices && !found; t += 3 )
+        {
+            int r;
+            
+            for( r = 0; r < 3 && !found; r++ )
+            {
+                found = memcmp( vertices + indices[i] * 3, positions + original[t + r] * 3, sizeof( GLfloat ) * 3 ) == 0 &&
+                        memcmp( vertices + indices[i + 1] * 3, positions + original[t + ( r + 1 ) % 3] * 3, sizeof( GLfloat ) * 3 ) == 0 &&
+                        memcmp( vertices + indices[i + 2] * 3, positions + original[t + ( r + 2 ) % 3] * 3, sizeof( GLfloat ) * 3 ) == 0;
+            }
+        }
+        
+        ES_CHECK( found );
+    }
+    
+    free( vertices );
+    free( indices );
+    free( original );
+    free( positions );
+}
+
+// Two unit squares facing +z, the one at z = 0 listed first. Only the +z view sees them,
+// edge-on views are degenerate and the -z view culls them
+static void TestOverdrawSquares( void )
+{
+    static const GLfloat positions[] =
+    {
+        0.0f, 0.0f, 0.0f,  1.0f, 0.0f, 0.0f,  1.0f, 1.0f, 0.0f,  0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 1.0f,  1.0f, 0.0f, 1.0f,  1.0f, 1.0f, 1.0f,  0.0f, 1.0f, 1.0f,
+    };
+    GLuint indices[12] = { 0, 1, 2, 0, 2, 3, 4, 5, 6, 4, 6, 7 };
+    GLuint reversed[12] = { 2, 1, 0, 3, 2, 0, 6, 5, 4, 7, 6, 4 };
+    ESMeshOverdrawStats stats;
+    
+    // Back to front shades every pixel twice
+    esMeshAnalyzeOverdraw( indices, 12, positions, 8, &stats );
+    ES_CHECK( stats.covered > 0 );
+    ES_CHECK( stats.shaded == stats.covered * 2 );
+    
+    // Clockwise squares face -z, the near one is now the one at z = 0
+    esMeshAnalyzeOverdraw( reversed, 12, positions, 8, &stats );
+    ES_CHECK( stats.covered > 0 && stats.shaded == stats.covered );
+    
+    // The square further out along its normal goes first
+    ES_CHECK( esMeshOptimizeOverdraw( indices, indices, 12, positions, 8, ES_MESH_OVERDRAW_THRESHOLD ) );
+    ES_CHECK( indices[0] >= 4 && indices[3] >= 4 && indices[6] < 4 && indices[9] < 4 );
+    esMeshAnalyzeOverdraw( indices, 12, positions, 8, &stats );
+    ES_CHECK( stats.covered > 0 && stats.shaded == stats.covered );
+}
+
+// A 3x3x3 lattice of overlapping spheres in a shuffled order, cache optimized first as esMeshOptimizeShape does
+static void TestOverdrawSpheres( void )
+{
+    enum { SLICES = 16, SIDE = 3, NUM_SPHERES = SIDE * SIDE * SIDE };
+    GLfloat *vertices;
+    GLfloat *normals;
+    GLfloat *texCoords;
+    GLuint *sphereIndices;
+    int sphereIndexCount = esGenSphere( SLICES, 1.0f, &vertices, &normals, &texCoords, &sphereIndices );
+    int sphereVertexCount;
+    int numIndices;
+    int numVertices;
+    GLfloat *positions;
+    GLuint *indices;
+    GLuint *optimized;
+    ESMeshOverdrawStats single, before, after;
+    ESMeshCacheStats cacheBefore, cacheAfter;
+    int s, i;
+    
+    esGenSphereSize( SLICES, &sphereVertexCount, &numIndices );
+    
+    // a convex mesh is drawn once per pixel in any order
+    esMeshAnalyzeOverdraw( sphereIndices, sphereIndexCount, vertices, sphereVertexCount, &single );
+    ES_CHECK( single.covered > 0 && single.shaded == single.covered );
+    
+    numIndices  = sphereIndexCount * NUM_SPHERES;
+    numVertices = sphereVertexCount * NUM_SPHERES;
+    positions   = malloc( sizeof( GLfloat ) * 3 * numVertices );
+    indices     = malloc( sizeof( GLuint ) * numIndices );
+    optimized   = malloc( sizeof( GLuint ) * numIndices );
+    
+    for( s = 0; s < NUM_SPHERES; s++ )
+    {
+        // spheres 1.5 apart, stored in a scrambled order
+        int slot = ( s * 10 ) % NUM_SPHERES;
+        GLfloat offset[3] = { 1.5f * ( slot % SIDE ), 1.5f * ( slot / SIDE % SIDE ), 1.5f * ( slot / ( SIDE * SIDE ) ) };
+        
+        for( i = 0; i < sphereVertexCount; i++ )
+        {
+            positions[( s * sphereVertexCount + i ) * 3]     = vertices[i * 3] + offset[0];
+            positions[( s * sphereVertexCount + i ) * 3 + 1] = vertices[i * 3 + 1] + offset[1];
+            positions[( s * sphereVertexCount + i ) * 3 + 2] = vertices[i * 3 + 2] + offset[2];
+        }
+        
+        for( i = 0; i < sphereIndexCount; i++ )
+        {
+            indices[s * sphereIndexCount + i] = sphereIndices[i] + s * sphereVertexCount;
+        }
+    }
+    
+    ES_CHECK( esMeshOptimizeVertexCache( indices, indices, numIndices, numVertices ) );
+    ES_CHECK( esMeshOptimizeOverdraw( optimized, indices, numIndices, positions, numVertices, ES_MESH_OVERDRAW_THRESHOLD ) );
+    ES_CHECK( SameTriangles( indices, optimized, numIndices ) );
+    
+    esMeshAnalyzeOverdraw( indices, numIndices, positions, numVertices, &before );
+    esMeshAnalyzeOverdraw( optimized, numIndices, positions, numVertices, &after );
+    esMeshAnalyzeCache( indices, numIndices, numVertices, ES_MESH_CACHE_SIZE, &cacheBefore );
+    esMeshAnalyzeCache( optimized, numIndices, numVertices, ES_MESH_CACHE_SIZE, &cacheAfter );
+    printf( "%-14s overdraw %.3f -> %.3f  ACMR %.3f -> %.3f\n", "spheres", before.overdraw, after.overdraw,
+            cacheBefore.acmr, cacheAfter.acmr );
+    
+    ES_CHECK( after.covered == before.covered );
+    ES_CHECK( after.overdraw <= before.overdraw );
+    ES_CHECK( cacheAfter.acmr <= cacheBefore.acmr * ES_MESH_OVERDRAW_THRESHOLD );
+    
+    free( vertices );
+    free( normals );
+    free( texCoords );
+    free( sphereIndices );
+    free( positions );
+    free( indices );
+    free( optimized );
+}
+
+int main( void )
+{
+    GLfloat *vertices;
+    GLfloat *normals;
+    GLfloat *texCoords;
+    GLuint *indices;
+    GLuint unused[6] = { 0, 1, 2, 2, 1, 4 };
+    GLuint remap[5];
+    int numIndices;
+    
+    numIndices = esGenSquareGrid( 64, &vertices, &indices );
+    TestMesh( "grid", indices, numIndices, 64 * 64, 0.7f );
+    ShuffleTriangles( indices, numIndices );
+    TestMesh( "shuffled grid", indices, numIndices, 64 * 64, 0.7f );
+    free( vertices );
+    free( indices );
+    
+    numIndices = esGenSphere( 40, 1.0f, &vertices, &normals, &texCoords, &indices );
+    TestMesh( "sphere", indices, numIndices, ( 40 / 2 + 1 ) * ( 40 + 1 ), 0.7f );
+    free( vertices );
+    free( normals );
+    free( texCoords );
+    free( indices );
+    
+    // Vertex 3 is never referenced
+    ES_CHECK( esMeshVertexFetchRemap( remap, unused, 6, 5 ) == 4 );
+    ES_CHECK( remap[3] == ES_MESH_UNUSED );
+    ES_CHECK( remap[4] == 3 );
+    
+    TestShape();
+    TestOverdrawSquares();
+    TestOverdrawSpheres();
+    
+    return ES_TEST_RESULT();
+}
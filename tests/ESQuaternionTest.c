@@ -0,0 +1,369 @@
+//
+//  ESQuaternionTest.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  esMatrixFromTRS against esTranslate, esRotate and esScale, the SIMD batch
+//  against esMatrixFromTRS, and the quaternion and dual quaternion products
+//  against the matching esMatrixMultiply.
+//
+
+#include "ESQuaternion.h"
+#include "ESTest.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_RANDOM      1000
+#define NUM_BATCH       37
+// esRotate rounds the sine and cosine of the angle, the quaternion those of half of it.
+// Per unit of scale
+#define TRS_PRECISION   1e-6
+// the batch evaluates the same formulas four lanes at a time, a rounding step at most
+#define BATCH_PRECISION 2.4e-7
+#define GUARD           0x5A
+
+static float Random( float low, float high )
+{
+    return low + ( high - low ) * ( float ) rand() / ( float ) RAND_MAX;
+}
+
+static double MaxError( const ESMatrix *a, const ESMatrix *b )
+{
+    double error = 0.0;
+    int i, j;
+    
+    for( i = 0; i < 4; i++ )
+    {
+        for( j = 0; j < 4; j++ )
+        {
+            error = fmax( error, fabs( a->m[i][j] - b->m[i][j] ) );
+        }
+    }
+    
+    return error;
+}
+
+static void RandomRotation( ESQuaternion *rotation, GLfloat *angle, GLfloat *axis )
+{
+    *angle  = Random( -360.0f, 360.0f );
+    axis[0] = Random( -1.0f, 1.0f );
+    axis[1] = Random( -1.0f, 1.0f );
+    axis[2] = Random( -1.0f, 1.0f );
+    esQuaternionFromAxisAngle( rotation, *angle, axis[0], axis[1], axis[2] );
+}
+
+static void CheckTRS( void )
+{
+    int mismatches = 0;
+    int n;
+    
+    for( n = 0; n < NUM_RANDOM; n++ )
+    {
+        GLfloat translation[3];
+        GLfloat scale[3];
+        GLfloat axis[3];
+        GLfloat angle;
+        ESQuaternion rotation;
+        ESMatrix direct;
+        ESMatrix chain;
+        double largest;
+        
+        translation[0] = Random( -50.0f, 50.0f );
+        translation[1] = Random( -50.0f, 50.0f );
+        translation[2] = Random( -50.0f, 50.0f );
+        scale[0]       = Random( 0.5f, 2.0f );
+        scale[1]       = Random( -2.0f, -0.5f );
+        scale[2]       = Random( 0.5f, 2.0f );
+        RandomRotation( &rotation, &angle, axis );
+        
+        esMatrixFromTRS( &direct, translation, &rotation, scale );
+        
+        esMatrixLoadIdentity( &chain );
+        esTranslate( &chain, translation[0], translation[1], translation[2] );
+        esRotate( &chain, angle, axis[0], axis[1], axis[2] );
+        esScale( &chain, scale[0], scale[1], scale[2] );
+        
+        largest = fmax( fabs( scale[0] ), fmax( fabs( scale[1] ), fabs( scale[2] ) ) );
+        
+        // the translation row is copied through untouched either way
+        if( MaxError( &direct, &chain ) > TRS_PRECISION * largest ||
+            memcmp( direct.m[3], chain.m[3], sizeof( direct.m[3] ) ) != 0 )
+        {
+            mismatches++;
+        }
+    }
+    
+    ES_CHECK( mismatches == 0 );
+}
+
+// NULL translation and scale read as 0 and 1
+static void CheckTRSDefaults( void )
+{
+    static const GLfloat zero[3] = { 0.0f, 0.0f, 0.0f };
+    static const GLfloat one[3] = { 1.0f, 1.0f, 1.0f };
+    ESQuaternion rotation;
+    ESMatrix withNull;
+    ESMatrix withArrays;
+    ESMatrix identity;
+    
+    esQuaternionFromAxisAngle( &rotation, 33.0f, 1.0f, 2.0f, 3.0f );
+    esMatrixFromTRS( &withNull, NULL, &rotation, NULL );
+    esMatrixFromTRS( &withArrays, zero, &rotation, one );
+    ES_CHECK( memcmp( &withNull, &withArrays, sizeof( ESMatrix ) ) == 0 );
+    
+    esQuaternionIdentity( &rotation );
+    esMatrixFromTRS( &withNull, NULL, &rotation, NULL );
+    esMatrixLoadIdentity( &identity );
+    ES_CHECK( memcmp( &withNull, &identity, sizeof( ESMatrix ) ) == 0 );
+}
+
+// Every count through the four-wide steps and the scalar tail, in order, through an index
+// list, and with the optional arrays left out. The matrix past the last stays untouched
+static void CheckBatch( void )
+{
+    static GLfloat values[10][NUM_BATCH];
+    static int indices[NUM_BATCH];
+    static ESMatrix batch[NUM_BATCH + 1];
+    ESMatrix guard;
+    int mismatches = 0;
+    int variant;
+    int count;
+    int i;
+    
+    for( i = 0; i < NUM_BATCH; i++ )
+    {
+        ESQuaternion rotation;
+        GLfloat axis[3];
+        GLfloat angle;
+        
+        RandomRotation( &rotation, &angle, axis );
+        values[0][i] = Random( -50.0f, 50.0f );
+        values[1][i] = Random( -50.0f, 50.0f );
+        values[2][i] = Random( -50.0f, 50.0f );
+        values[3][i] = rotation.x;
+        values[4][i] = rotation.y;
+        values[5][i] = rotation.z;
+        values[6][i] = rotation.w;
+        values[7][i] = Random( 0.5f, 2.0f );
+        values[8][i] = Random( 0.5f, 2.0f );
+        values[9][i] = Random( 0.5f, 2.0f );
+        // out of order, some elements twice
+        indices[i]   = ( i * 7 + 3 ) % NUM_BATCH / ( i % 5 == 0 ? 2 : 1 );
+    }
+    
+    memset( &guard, GUARD, sizeof( guard ) );
+    
+    for( variant = 0; variant < 4; variant++ )
+    {
+        const int *list = variant & 1 ? indices : NULL;
+        ESTRSArrays trs;
+        
+        trs.positionX = variant & 2 ? NULL : values[0];
+        trs.positionY = values[1];
+        trs.positionZ = variant & 2 ? NULL : values[2];
+        trs.rotationX = values[3];
+        trs.rotationY = values[4];
+        trs.rotationZ = values[5];
+        trs.rotationW = values[6];
+        trs.scaleX    = values[7];
+        trs.scaleY    = variant & 2 ? NULL : values[8];
+        trs.scaleZ    = values[9];
+        
+        for( count = 0; count <= NUM_BATCH; count++ )
+        {
+            memset( batch, GUARD, sizeof( batch ) );
+            esMatrixFromTRSBatch( batch, &trs, list, count );
+            
+            for( i = 0; i < count; i++ )
+            {
+                int element = list != NULL ? list[i] : i;
+                GLfloat translation[3];
+                GLfloat scale[3];
+                ESQuaternion rotation;
+                ESMatrix expected;
+                
+                translation[0] = trs.positionX != NULL ? values[0][element] : 0.0f;
+                translation[1] = values[1][element];
+                translation[2] = trs.positionZ != NULL ? values[2][element] : 0.0f;
+                rotation.x     = values[3][element];
+                rotation.y     = values[4][element];
+                rotation.z     = values[5][element];
+                rotation.w     = values[6][element];
+                scale[0]       = values[7][element];
+                scale[1]       = trs.scaleY != NULL ? values[8][element] : 1.0f;
+                scale[2]       = values[9][element];
+                esMatrixFromTRS( &expected, translation, &rotation, scale );
+                
+                // scales go up to 2
+                if( MaxError( &batch[i], &expected ) > BATCH_PRECISION * 2.0 )
+                {
+                    mismatches++;
+                }
+            }
+            
+            if( memcmp( &batch[count], &guard, sizeof( guard ) ) != 0 )
+            {
+                mismatches++;
+            }
+        }
+    }
+    
+    ES_CHECK( mismatches == 0 );
+}
+
+static void CheckQuaternion( void )
+{
+    int mismatches = 0;
+    int n;
+    
+    for( n = 0; n < NUM_RANDOM; n++ )
+    {
+        ESQuaternion a;
+        ESQuaternion b;
+        ESQuaternion product;
+        ESMatrix matrixA;
+        ESMatrix matrixB;
+        ESMatrix expected;
+        ESMatrix rotated;
+        GLfloat axis[3];
+        GLfloat angle;
+        
+        // the esRotate rotation
+        RandomRotation( &a, &angle, axis );
+        esQuaternionToMatrix( &matrixA, &a );
+        esMatrixLoadIdentity( &rotated );
+        esRotate( &rotated, angle, axis[0], axis[1], axis[2] );
+        mismatches += MaxError( &matrixA, &rotated ) > TRS_PRECISION;
+        
+        // composes like esMatrixMultiply, also when the result aliases a source
+        RandomRotation( &b, &angle, axis );
+        esQuaternionToMatrix( &matrixB, &b );
+        esMatrixMultiply( &expected, &matrixA, &matrixB );
+        esQuaternionMultiply( &product, &a, &b );
+        esQuaternionToMatrix( &rotated, &product );
+        mismatches += MaxError( &rotated, &expected ) > TRS_PRECISION * 2.0;
+        esQuaternionMultiply( &a, &a, &b );
+        mismatches += memcmp( &a, &product, sizeof( a ) ) != 0;
+    }
+    
+    ES_CHECK( mismatches == 0 );
+}
+
+static void CheckSlerp( void )
+{
+    ESQuaternion a;
+    ESQuaternion b;
+    ESQuaternion negated;
+    ESQuaternion result;
+    ESQuaternion other;
+    ESQuaternion expected;
+    
+    // along a shared axis the angle moves linearly
+    esQuaternionFromAxisAngle( &a, 20.0f, 1.0f, -2.0f, 0.5f );
+    esQuaternionFromAxisAngle( &b, 140.0f, 1.0f, -2.0f, 0.5f );
+    esQuaternionFromAxisAngle( &expected, 50.0f, 1.0f, -2.0f, 0.5f );
+    esQuaternionSlerp( &result, &a, &b, 0.25f );
+    ES_CHECK_NEAR( result.x, expected.x, 1e-6 );
+    ES_CHECK_NEAR( result.y, expected.y, 1e-6 );
+    ES_CHECK_NEAR( result.z, expected.z, 1e-6 );
+    ES_CHECK_NEAR( result.w, expected.w, 1e-6 );
+    
+    esQuaternionSlerp( &result, &a, &b, 0.0f );
+    ES_CHECK_NEAR( result.w, a.w, 1e-6 );
+    esQuaternionSlerp( &result, &a, &b, 1.0f );
+    ES_CHECK_NEAR( result.x, b.x, 1e-6 );
+    ES_CHECK_NEAR( result.w, b.w, 1e-6 );
+    
+    // -b is the same rotation and takes the same path
+    negated.x = -b.x;
+    negated.y = -b.y;
+    negated.z = -b.z;
+    negated.w = -b.w;
+    esQuaternionSlerp( &result, &a, &b, 0.6f );
+    esQuaternionSlerp( &other, &a, &negated, 0.6f );
+    ES_CHECK_NEAR( result.x, other.x, 1e-6 );
+    ES_CHECK_NEAR( result.y, other.y, 1e-6 );
+    ES_CHECK_NEAR( result.z, other.z, 1e-6 );
+    ES_CHECK_NEAR( result.w, other.w, 1e-6 );
+    
+    // close enough for the linear fallback, still unit length
+    esQuaternionFromAxisAngle( &b, 20.01f, 1.0f, -2.0f, 0.5f );
+    esQuaternionSlerp( &result, &a, &b, 0.5f );
+    ES_CHECK_NEAR( result.x * result.x + result.y * result.y + result.z * result.z + result.w * result.w, 1.0, 1e-6 );
+    
+    // a zero axis is no rotation, as in esRotate
+    esQuaternionFromAxisAngle( &result, 45.0f, 0.0f, 0.0f, 0.0f );
+    ES_CHECK( result.x == 0.0f && result.y == 0.0f && result.z == 0.0f && result.w == 1.0f );
+}
+
+static void RandomTransform( ESDualQuaternion *transform, ESMatrix *matrix )
+{
+    GLfloat translation[3];
+    GLfloat axis[3];
+    GLfloat angle;
+    ESQuaternion rotation;
+    
+    translation[0] = Random( -10.0f, 10.0f );
+    translation[1] = Random( -10.0f, 10.0f );
+    translation[2] = Random( -10.0f, 10.0f );
+    RandomRotation( &rotation, &angle, axis );
+    
+    esDualQuaternionFromRotationTranslation( transform, &rotation, translation[0], translation[1], translation[2] );
+    esMatrixFromTRS( matrix, translation, &rotation, NULL );
+}
+
+static void CheckDualQuaternion( void )
+{
+    int mismatches = 0;
+    int n;
+    
+    for( n = 0; n < NUM_RANDOM; n++ )
+    {
+        ESDualQuaternion a;
+        ESDualQuaternion b;
+        ESDualQuaternion product;
+        ESDualQuaternion blend;
+        ESMatrix matrixA;
+        ESMatrix matrixB;
+        ESMatrix expected;
+        ESMatrix result;
+        
+        RandomTransform( &a, &matrixA );
+        RandomTransform( &b, &matrixB );
+        
+        esDualQuaternionToMatrix( &result, &a );
+        mismatches += MaxError( &result, &matrixA ) > 1e-5;
+        
+        // transform by a, then by b
+        esDualQuaternionMultiply( &product, &a, &b );
+        esDualQuaternionToMatrix( &result, &product );
+        esMatrixMultiply( &expected, &matrixA, &matrixB );
+        mismatches += MaxError( &result, &expected ) > 1e-5;
+        
+        // the ends of a blend are the transforms themselves
+        esDualQuaternionBlend( &blend, &a, &b, 0.0f );
+        esDualQuaternionToMatrix( &result, &blend );
+        mismatches += MaxError( &result, &matrixA ) > 1e-5;
+        esDualQuaternionBlend( &blend, &a, &b, 1.0f );
+        esDualQuaternionToMatrix( &result, &blend );
+        mismatches += MaxError( &result, &matrixB ) > 1e-5;
+    }
+    
+    ES_CHECK( mismatches == 0 );
+}
+
+int main( void )
+{
+    srand( 18 );
+    
+    CheckTRS();
+    CheckTRSDefaults();
+    CheckBatch();
+    CheckQuaternion();
+    CheckSlerp();
+    CheckDualQuaternion();
+    
+    return ES_TEST_RESULT();
+}
@@ -0,0 +1,223 @@
+//
+//  ESRingBufferTest.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  esRingBuffer against a recording ESRingBufferGL: region offsets and
+//  alignment, overflow, fencing at the end of a frame and the wait on
+//  wrap-around.
+//
+
+#include "ESRingBuffer.h"
+#include "ESTest.h"
+
+#define REGION_SIZE 1024
+#define NUM_REGIONS 3
+
+static unsigned char mockStore[REGION_SIZE * NUM_REGIONS];
+static GLsizeiptr mockStoreSize;
+static GLintptr   mockMapOffset;
+static GLsizeiptr mockMapLength;
+static GLbitfield mockMapAccess;
+static int mockFences;
+static int mockDeletedSyncs;
+static int mockDeletedBuffers;
+static int mockUnmaps;
+// clientWaitSync answers GL_TIMEOUT_EXPIRED this many times before it signals
+static int mockTimeouts;
+static int mockWaits;
+
+static void GL_APIENTRY mockGenBuffers( GLsizei n, GLuint *buffers )
+{
+    ( void ) n;
+    
+    buffers[0] = 7;
+}
+
+static void GL_APIENTRY mockDeleteBuffers( GLsizei n, const GLuint *buffers )
+{
+    ( void ) buffers;
+    
+    mockDeletedBuffers += n;
+}
+
+static void GL_APIENTRY mockBindBuffer( GLenum target, GLuint buffer )
+{
+    ( void ) target;
+    ( void ) buffer;
+}
+
+static void GL_APIENTRY mockBufferData( GLenum target, GLsizeiptr size, const void *data, GLenum usage )
+{
+    ( void ) target;
+    ( void ) data;
+    ( void ) usage;
+    
+    mockStoreSize = size;
+}
+
+static void *GL_APIENTRY mockMapBufferRange( GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access )
+{
+    ( void ) target;
+    
+    mockMapOffset = offset;
+    mockMapLength = length;
+    mockMapAccess = access;
+    
+    return mockStore + offset;
+}
+
+static GLboolean GL_APIENTRY mockUnmapBuffer( GLenum target )
+{
+    ( void ) target;
+    
+    mockUnmaps++;
+    return GL_TRUE;
+}
+
+static GLsync GL_APIENTRY mockFenceSync( GLenum condition, GLbitfield flags )
+{
+    ( void ) condition;
+    ( void ) flags;
+    
+    mockFences++;
+    return ( GLsync ) ( size_t ) mockFences;
+}
+
+static GLenum GL_APIENTRY mockClientWaitSync( GLsync sync, GLbitfield flags, GLuint64 timeout )
+{
+    ( void ) sync;
+    ( void ) flags;
+    ( void ) timeout;
+    
+    mockWaits++;
+    
+    if( mockTimeouts > 0 )
+    {
+        mockTimeouts--;
+        return GL_TIMEOUT_EXPIRED;
+    }
+    
+    return GL_CONDITION_SATISFIED;
+}
+
+static void GL_APIENTRY mockDeleteSync( GLsync sync )
+{
+    ( void ) sync;
+    
+    mockDeletedSyncs++;
+}
+
+static const ESRingBufferGL mockGL =
+{
+    mockGenBuffers,
+    mockDeleteBuffers,
+    mockBindBuffer,
+    mockBufferData,
+    mockMapBufferRange,
+    mockUnmapBuffer,
+    mockFenceSync,
+    mockClientWaitSync,
+    mockDeleteSync,
+};
+
+static void TestMapping( void )
+{
+    ESRingBuffer ring;
+    GLintptr offset = -1;
+    void *ptr;
+    
+    ES_CHECK( esRingBufferInit( &ring, GL_ARRAY_BUFFER, REGION_SIZE, NUM_REGIONS ) );
+    ES_CHECK( ring.buffer == 7 );
+    ES_CHECK( mockStoreSize == REGION_SIZE * NUM_REGIONS );
+    
+    ptr = esRingBufferMap( &ring, 10, 1, &offset );
+    ES_CHECK( ptr == mockStore && offset == 0 );
+    ES_CHECK( mockMapLength == 10 );
+    ES_CHECK( ( mockMapAccess & GL_MAP_UNSYNCHRONIZED_BIT ) != 0 );
+    
+    // Still mapped
+    ES_CHECK( esRingBufferMap( &ring, 10, 1, &offset ) == NULL );
+    ES_CHECK( esRingBufferUnmap( &ring ) );
+    ES_CHECK( !esRingBufferUnmap( &ring ) );
+    
+    // Rounded up to the alignment
+    ptr = esRingBufferMap( &ring, 100, 256, &offset );
+    ES_CHECK( offset == 256 && ptr == mockStore + 256 );
+    esRingBufferUnmap( &ring );
+    
+    // 356 bytes used, 700 more don't fit
+    ES_CHECK( esRingBufferMap( &ring, 700, 1, &offset ) == NULL );
+    ES_CHECK( ring.numOverflows == 1 );
+    ES_CHECK( esRingBufferMap( &ring, 0, 1, &offset ) == NULL );
+    
+    esRingBufferDestroy( &ring );
+}
+
+static void TestFrames( void )
+{
+    ESRingBuffer ring;
+    GLintptr offset;
+    int frame;
+    
+    mockFences = mockDeletedSyncs = mockDeletedBuffers = mockWaits = 0;
+    esRingBufferInit( &ring, GL_ARRAY_BUFFER, REGION_SIZE, NUM_REGIONS );
+    
+    // A frame that mapped nothing neither fences nor moves on
+    esRingBufferEndFrame( &ring );
+    ES_CHECK( mockFences == 0 && ring.region == 0 );
+    
+    // Every frame starts at the beginning of the next region
+    for( frame = 0; frame < NUM_REGIONS; frame++ )
+    {
+        esRingBufferMap( &ring, 16, 1, &offset );
+        ES_CHECK( offset == ( GLintptr ) frame * REGION_SIZE );
+        esRingBufferEndFrame( &ring );
+        ES_CHECK( mockFences == frame + 1 );
+    }
+    
+    ES_CHECK( ring.region == 0 );
+    ES_CHECK( mockWaits == 0 );
+    // The ranges were left mapped, esRingBufferEndFrame unmapped them
+    ES_CHECK( !ring.mapped );
+    
+    // Back at region 0: the GPU still reads it for two polls
+    mockTimeouts = 2;
+    esRingBufferMap( &ring, 16, 1, &offset );
+    ES_CHECK( offset == 0 );
+    ES_CHECK( ring.numWaits == 1 );
+    ES_CHECK( mockWaits == 3 );
+    ES_CHECK( mockDeletedSyncs == 1 );
+    ES_CHECK( ring.fences[0] == 0 );
+    
+    // Region 1 is signalled already: one poll, no wait counted
+    esRingBufferEndFrame( &ring );
+    esRingBufferMap( &ring, 16, 1, &offset );
+    ES_CHECK( ring.numWaits == 1 );
+    ES_CHECK( mockWaits == 4 );
+    
+    // Destroy unmaps and deletes the fences still pending ( regions 0 and 2 ) and the buffer
+    esRingBufferDestroy( &ring );
+    ES_CHECK( !ring.mapped );
+    ES_CHECK( mockDeletedSyncs == 4 );
+    ES_CHECK( mockDeletedBuffers == 1 );
+}
+
+int main( void )
+{
+    ESRingBuffer ring;
+    
+    esRingBufferSetBackend( &mockGL );
+    
+    ES_CHECK( !esRingBufferInit( &ring, GL_ARRAY_BUFFER, 0, NUM_REGIONS ) );
+    ES_CHECK( !esRingBufferInit( &ring, GL_ARRAY_BUFFER, REGION_SIZE, ES_RING_MAX_REGIONS + 1 ) );
+    
+    TestMapping();
+    TestFrames();
+    
+    esRingBufferSetBackend( NULL );
+    
+    return ES_TEST_RESULT();
+}
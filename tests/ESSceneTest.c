@@ -0,0 +1,251 @@
+//
+//  ESSceneTest.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  esSceneUpdate on a random hierarchy against world matrices built node by
+//  node from esTranslate, esRotate and esScale times the parent's world.
+//  Each update has to recompute exactly the changed nodes and everything
+//  below them, and a scene where nothing changed nothing at all.
+//
+
+#include "ESScene.h"
+#include "ESTest.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_NODES 1000
+// relative to the largest element of the matrix
+#define PRECISION 1e-5
+
+// the transforms as set, the reference keeps its own copy
+static int parents[NUM_NODES];
+static GLfloat positions[NUM_NODES][3];
+static GLfloat angles[NUM_NODES];
+static GLfloat axes[NUM_NODES][3];
+static GLfloat scales[NUM_NODES][3];
+static double reference[NUM_NODES][4][4];
+static unsigned char changed[NUM_NODES];
+
+static float Random( float low, float high )
+{
+    return low + ( high - low ) * ( float ) rand() / ( float ) RAND_MAX;
+}
+
+static void SetRandomTransform( ESScene *scene, int node )
+{
+    positions[node][0] = Random( -5.0f, 5.0f );
+    positions[node][1] = Random( -5.0f, 5.0f );
+    positions[node][2] = Random( -5.0f, 5.0f );
+    angles[node]       = Random( -180.0f, 180.0f );
+    axes[node][0]      = Random( -1.0f, 1.0f );
+    axes[node][1]      = Random( -1.0f, 1.0f );
+    axes[node][2]      = Random( 0.1f, 1.0f );
+    scales[node][0]    = Random( 0.7f, 1.3f );
+    scales[node][1]    = Random( 0.7f, 1.3f );
+    scales[node][2]    = Random( 0.7f, 1.3f );
+    
+    esSceneSetTranslation( scene, node, positions[node][0], positions[node][1], positions[node][2] );
+    esSceneSetRotation( scene, node, angles[node], axes[node][0], axes[node][1], axes[node][2] );
+    esSceneSetScale( scene, node, scales[node][0], scales[node][1], scales[node][2] );
+}
+
+// local transform the long way, times the parent's world in double
+static void BuildReference( void )
+{
+    int node;
+    int i, j, k;
+    
+    for( node = 0; node < NUM_NODES; node++ )
+    {
+        ESMatrix local;
+        
+        esMatrixLoadIdentity( &local );
+        esTranslate( &local, positions[node][0], positions[node][1], positions[node][2] );
+        esRotate( &local, angles[node], axes[node][0], axes[node][1], axes[node][2] );
+        esScale( &local, scales[node][0], scales[node][1], scales[node][2] );
+        
+        for( i = 0; i < 4; i++ )
+        {
+            for( j = 0; j < 4; j++ )
+            {
+                double sum = 0.0;
+                
+                if( parents[node] < 0 )
+                {
+                    reference[node][i][j] = local.m[i][j];
+                    continue;
+                }
+                
+                for( k = 0; k < 4; k++ )
+                {
+                    sum += local.m[i][k] * reference[parents[node]][k][j];
+                }
+                
+                reference[node][i][j] = sum;
+            }
+        }
+    }
+}
+
+static void CheckWorlds( const ESScene *scene )
+{
+    int mismatches = 0;
+    int node;
+    int i, j;
+    
+    BuildReference();
+    
+    for( node = 0; node < NUM_NODES; node++ )
+    {
+        const ESMatrix *world = esSceneWorld( scene, node );
+        double largest = 0.0;
+        double error = 0.0;
+        
+        for( i = 0; i < 4; i++ )
+        {
+            for( j = 0; j < 4; j++ )
+            {
+                largest = fmax( largest, fabs( reference[node][i][j] ) );
+                error   = fmax( error, fabs( world->m[i][j] - reference[node][i][j] ) );
+            }
+        }
+        
+        if( error > PRECISION * largest )
+        {
+            mismatches++;
+        }
+    }
+    
+    ES_CHECK( mismatches == 0 );
+}
+
+// the changed nodes and all below them, in index order, and nothing else
+static void CheckUpdate( ESScene *scene )
+{
+    int expected = 0;
+    int numUpdated;
+    int node;
+    
+    for( node = 0; node < NUM_NODES; node++ )
+    {
+        if( parents[node] >= 0 && changed[parents[node]] )
+        {
+            changed[node] = 1;
+        }
+    }
+    
+    numUpdated = esSceneUpdate( scene );
+    ES_CHECK( numUpdated == scene->numUpdated );
+    
+    for( node = 0; node < NUM_NODES; node++ )
+    {
+        if( changed[node] )
+        {
+            ES_CHECK( expected < numUpdated && scene->updated[expected] == node );
+            expected++;
+        }
+    }
+    
+    ES_CHECK( numUpdated == expected );
+    CheckWorlds( scene );
+    
+    // nothing changed since
+    ES_CHECK( esSceneUpdate( scene ) == 0 );
+    ES_CHECK( scene->numUpdated == 0 );
+    CheckWorlds( scene );
+    
+    memset( changed, 0, sizeof( changed ) );
+}
+
+static void CheckAdd( void )
+{
+    ESScene scene;
+    
+    ES_CHECK( !esSceneInit( &scene, 0 ) );
+    ES_CHECK( esSceneInit( &scene, 2 ) );
+    
+    // the parent has to come first
+    ES_CHECK( esSceneAddNode( &scene, 0 ) == -1 );
+    ES_CHECK( esSceneAddNode( &scene, -1 ) == 0 );
+    ES_CHECK( esSceneAddNode( &scene, 1 ) == -1 );
+    ES_CHECK( esSceneAddNode( &scene, 0 ) == 1 );
+    ES_CHECK( esSceneAddNode( &scene, 0 ) == -1 );
+    
+    // identity until set
+    ES_CHECK( esSceneUpdate( &scene ) == 2 );
+    ES_CHECK( esSceneWorld( &scene, 1 )->m[0][0] == 1.0f && esSceneWorld( &scene, 1 )->m[3][0] == 0.0f );
+    
+    esSceneDestroy( &scene );
+}
+
+int main( void )
+{
+    ESScene scene;
+    ESQuaternion delta;
+    int node;
+    int i;
+    
+    srand( 17 );
+    
+    CheckAdd();
+    
+    ES_CHECK( esSceneInit( &scene, NUM_NODES ) );
+    
+    // a few roots, the rest under any earlier node, mostly near the start so chains get deep
+    for( node = 0; node < NUM_NODES; node++ )
+    {
+        parents[node] = node < 4 || rand() % 50 == 0 ? -1 : rand() % node;
+        ES_CHECK( esSceneAddNode( &scene, parents[node] ) == node );
+        SetRandomTransform( &scene, node );
+        changed[node] = 1;
+    }
+    
+    CheckUpdate( &scene );
+    
+    // one node deep in the tree, then a root
+    SetRandomTransform( &scene, NUM_NODES / 2 );
+    changed[NUM_NODES / 2] = 1;
+    CheckUpdate( &scene );
+    
+    esSceneSetTranslation( &scene, 0, 1.0f, 2.0f, 3.0f );
+    positions[0][0] = 1.0f;
+    positions[0][1] = 2.0f;
+    positions[0][2] = 3.0f;
+    changed[0] = 1;
+    CheckUpdate( &scene );
+    
+    // several at once, the last node too, which has nothing below it
+    for( i = 0; i < 20; i++ )
+    {
+        node = rand() % NUM_NODES;
+        esSceneSetScale( &scene, node, 1.1f, 0.9f, 1.0f );
+        scales[node][0] = 1.1f;
+        scales[node][1] = 0.9f;
+        scales[node][2] = 1.0f;
+        changed[node] = 1;
+    }
+    
+    SetRandomTransform( &scene, NUM_NODES - 1 );
+    changed[NUM_NODES - 1] = 1;
+    CheckUpdate( &scene );
+    
+    // 90 steps of a degree around a node's own axis add up to 90 degrees more
+    node = NUM_NODES / 3;
+    esQuaternionFromAxisAngle( &delta, 1.0f, axes[node][0], axes[node][1], axes[node][2] );
+    
+    for( i = 0; i < 90; i++ )
+    {
+        esSceneRotate( &scene, node, &delta );
+    }
+    
+    angles[node] += 90.0f;
+    changed[node] = 1;
+    CheckUpdate( &scene );
+    
+    esSceneDestroy( &scene );
+    
+    return ES_TEST_RESULT();
+}
@@ -0,0 +1,228 @@
+//
+//  ESShapesTest.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  Sphere and grid generators: texture coordinates stay in [ 0, 1 ] and grow
+//  along the rows and columns, through the float and the interleaved unorm16
+//  path, and shapes too small to exist generate nothing.
+//
+
+#include "ESUtil.h"
+#include "ESVertexFormat.h"
+#include "ESTest.h"
+#include <stdlib.h>
+#include <string.h>
+
+// texCoords holds numRows rows of rowLength vertices: u grows along a row, v from row to row,
+// both span [ 0, 1 ] exactly
+static void CheckTexCoords( const GLfloat *texCoords, int numRows, int rowLength )
+{
+    int i;
+    int j;
+    
+    for( i = 0; i < numRows; i++ )
+    {
+        for( j = 0; j < rowLength; j++ )
+        {
+            const GLfloat *uv = texCoords + ( i * rowLength + j ) * 2;
+            
+            ES_CHECK( uv[0] >= 0.0f && uv[0] <= 1.0f );
+            ES_CHECK( uv[1] >= 0.0f && uv[1] <= 1.0f );
+            
+            if( j > 0 )
+            {
+                ES_CHECK( uv[0] > uv[-2] );
+                ES_CHECK( uv[1] == uv[-1] );
+            }
+            
+            if( i > 0 )
+            {
+                ES_CHECK( uv[1] > uv[1 - rowLength * 2] );
+            }
+        }
+    }
+    
+    ES_CHECK_NEAR( texCoords[0], 0.0, 1e-6 );
+    ES_CHECK_NEAR( texCoords[1], 0.0, 1e-6 );
+    ES_CHECK_NEAR( texCoords[( numRows * rowLength - 1 ) * 2], 1.0, 1e-6 );
+    ES_CHECK_NEAR( texCoords[( numRows * rowLength - 1 ) * 2 + 1], 1.0, 1e-6 );
+}
+
+static void TestSphere( int numSlices )
+{
+    GLfloat *vertices;
+    GLfloat *normals;
+    GLfloat *texCoords;
+    GLuint *indices;
+    int numVertices;
+    int numIndices;
+    int i;
+    
+    esGenSphereSize( numSlices, &numVertices, &numIndices );
+    ES_CHECK( esGenSphere( numSlices, 2.0f, &vertices, &normals, &texCoords, &indices ) == numIndices );
+    
+    CheckTexCoords( texCoords, numSlices / 2 + 1, numSlices + 1 );
+    
+    for( i = 0; i < numVertices; i++ )
+    {
+        const GLfloat *n = normals + i * 3;
+        
+        ES_CHECK_NEAR( n[0] * n[0] + n[1] * n[1] + n[2] * n[2], 1.0, 1e-5 );
+        ES_CHECK_NEAR( vertices[i * 3 + 1], 2.0f * n[1], 1e-5 );
+    }
+    
+    for( i = 0; i < numIndices; i++ )
+    {
+        ES_CHECK( indices[i] < ( GLuint ) numVertices );
+    }
+    
+    free( vertices );
+    free( normals );
+    free( texCoords );
+    free( indices );
+}
+
+// the unorm16 texture coordinates of the interleaved sphere keep the order of the float ones
+static void TestSphereInterleaved( void )
+{
+    ESVertexFormat format;
+    unsigned char *vertices;
+    GLuint *indices;
+    int numSlices = 16;
+    int rowLength = numSlices + 1;
+    int numVertices;
+    int i;
+    
+    ES_CHECK( esVertexFormatInit( &format, ES_ATTRIB_FLOAT, ES_ATTRIB_NONE, ES_ATTRIB_UNORM16, 1.0f ) );
+    esGenSphereSize( numSlices, &numVertices, NULL );
+    ES_CHECK( esGenSphereInterleaved( numSlices, 1.0f, &format, ( void ** ) &vertices, &indices ) > 0 );
+    
+    for( i = 0; i < numVertices; i++ )
+    {
+        GLushort uv[2];
+        GLushort above[2];
+        
+        memcpy( uv, vertices + i * format.stride + format.texCoordOffset, sizeof( uv ) );
+        
+        if( i >= rowLength )
+        {
+            memcpy( above, vertices + ( i - rowLength ) * format.stride + format.texCoordOffset, sizeof( above ) );
+            ES_CHECK( uv[1] > above[1] );
+        }
+        
+        if( i == 0 )
+        {
+            ES_CHECK( uv[0] == 0 && uv[1] == 0 );
+        }
+        else if( i == numVertices - 1 )
+        {
+            ES_CHECK( uv[0] == 65535 && uv[1] == 65535 );
+        }
+    }
+    
+    free( vertices );
+    free( indices );
+}
+
+static void TestGrid( int size )
+{
+    GLfloat *texCoords = malloc( sizeof( GLfloat ) * 2 * size * size );
+    GLuint *indices;
+    ESShapeStreams dest;
+    int numIndices;
+    int i;
+    
+    esGenSquareGridSize( size, NULL, &numIndices );
+    indices = malloc( sizeof( GLuint ) * numIndices );
+    
+    memset( &dest, 0, sizeof( ESShapeStreams ) );
+    dest.texCoords = texCoords;
+    ES_CHECK( esGenSquareGridInto( size, &dest, indices, 0 ) == numIndices );
+    
+    // Rows run along x, which is u
+    for( i = 0; i < size * size; i++ )
+    {
+        GLfloat swapped = texCoords[i * 2];
+        
+        texCoords[i * 2]     = texCoords[i * 2 + 1];
+        texCoords[i * 2 + 1] = swapped;
+    }
+    
+    CheckTexCoords( texCoords, size, size );
+    
+    for( i = 0; i < numIndices; i++ )
+    {
+        ES_CHECK( indices[i] < ( GLuint ) ( size * size ) );
+    }
+    
+    free( texCoords );
+    free( indices );
+}
+
+// too few slices or grid vertices: no sizes, no writes, no division by zero
+static void TestDegenerate( void )
+{
+    GLfloat untouched[8] = { -7.0f, -7.0f, -7.0f, -7.0f, -7.0f, -7.0f, -7.0f, -7.0f };
+    GLuint indices[6] = { 7, 7, 7, 7, 7, 7 };
+    ESShapeStreams dest;
+    int numVertices;
+    int numIndices;
+    int numSlices;
+    int size;
+    int i;
+    
+    memset( &dest, 0, sizeof( ESShapeStreams ) );
+    dest.positions = untouched;
+    dest.texCoords = untouched;
+    
+    for( numSlices = -1; numSlices < 4; numSlices++ )
+    {
+        esGenSphereSize( numSlices, &numVertices, &numIndices );
+        ES_CHECK( numVertices == 0 && numIndices == 0 );
+        ES_CHECK( esGenSphereInto( numSlices, 1.0f, &dest, indices, 0 ) == 0 );
+        esGenSphereVertices( numSlices, 1.0f, 0, 2, &dest );
+        esGenSphereIndices( numSlices, 0, 1, indices, 0 );
+    }
+    
+    for( size = -1; size < 2; size++ )
+    {
+        esGenSquareGridSize( size, &numVertices, &numIndices );
+        ES_CHECK( numVertices == 0 && numIndices == 0 );
+        ES_CHECK( esGenSquareGridInto( size, &dest, indices, 0 ) == 0 );
+        esGenSquareGridVertices( size, 0, 1, &dest );
+        esGenSquareGridIndices( size, 0, 1, indices, 0 );
+    }
+    
+    for( i = 0; i < 8; i++ )
+    {
+        ES_CHECK( untouched[i] == -7.0f );
+    }
+    
+    for( i = 0; i < 6; i++ )
+    {
+        ES_CHECK( indices[i] == 7 );
+    }
+    
+    // The smallest shapes that exist
+    esGenSphereSize( 4, &numVertices, &numIndices );
+    ES_CHECK( numVertices == 3 * 5 && numIndices == 2 * 4 * 6 );
+    esGenSquareGridSize( 2, &numVertices, &numIndices );
+    ES_CHECK( numVertices == 4 && numIndices == 6 );
+}
+
+int main( void )
+{
+    TestSphere( 4 );
+    TestSphere( 5 );
+    TestSphere( 20 );
+    TestSphere( 64 );
+    TestSphereInterleaved();
+    TestGrid( 2 );
+    TestGrid( 33 );
+    TestDegenerate();
+    
+    return ES_TEST_RESULT();
+}
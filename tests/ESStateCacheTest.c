@@ -0,0 +1,268 @@
+//
+//  ESStateCacheTest.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  esState* against a counting ESStateCacheGL: redundant calls must not
+//  reach GL, state that GL resets ( VAO switches, deletes, invalidation )
+//  must be issued again.
+//
+
+#include "ESStateCache.h"
+#include "ESTest.h"
+
+// calls that reached the mock, per entry point
+static int mockCalls[ES_STATE_NUM_CALLS];
+static int mockDeletes;
+static GLenum mockActiveTexture;
+
+static void GL_APIENTRY mockBindBuffer( GLenum target, GLuint buffer )
+{
+    ( void ) target;
+    ( void ) buffer;
+    
+    mockCalls[ES_STATE_BIND_BUFFER]++;
+}
+
+static void GL_APIENTRY mockBindVertexArray( GLuint array )
+{
+    ( void ) array;
+    
+    mockCalls[ES_STATE_BIND_VERTEX_ARRAY]++;
+}
+
+static void GL_APIENTRY mockUseProgram( GLuint program )
+{
+    ( void ) program;
+    
+    mockCalls[ES_STATE_USE_PROGRAM]++;
+}
+
+static void GL_APIENTRY mockEnableVertexAttribArray( GLuint index )
+{
+    ( void ) index;
+    
+    mockCalls[ES_STATE_ENABLE_ATTRIB]++;
+}
+
+static void GL_APIENTRY mockDisableVertexAttribArray( GLuint index )
+{
+    ( void ) index;
+    
+    mockCalls[ES_STATE_DISABLE_ATTRIB]++;
+}
+
+static void GL_APIENTRY mockVertexAttribDivisor( GLuint index, GLuint divisor )
+{
+    ( void ) index;
+    ( void ) divisor;
+    
+    mockCalls[ES_STATE_ATTRIB_DIVISOR]++;
+}
+
+static void GL_APIENTRY mockViewport( GLint x, GLint y, GLsizei width, GLsizei height )
+{
+    ( void ) x;
+    ( void ) y;
+    ( void ) width;
+    ( void ) height;
+    
+    mockCalls[ES_STATE_VIEWPORT]++;
+}
+
+static void GL_APIENTRY mockActiveTextureUnit( GLenum texture )
+{
+    mockCalls[ES_STATE_ACTIVE_TEXTURE]++;
+    mockActiveTexture = texture;
+}
+
+static void GL_APIENTRY mockBindTexture( GLenum target, GLuint texture )
+{
+    ( void ) target;
+    ( void ) texture;
+    
+    mockCalls[ES_STATE_BIND_TEXTURE]++;
+}
+
+static void GL_APIENTRY mockDeleteBuffers( GLsizei n, const GLuint *buffers )
+{
+    ( void ) buffers;
+    
+    mockDeletes += n;
+}
+
+static void GL_APIENTRY mockDeleteVertexArrays( GLsizei n, const GLuint *arrays )
+{
+    ( void ) arrays;
+    
+    mockDeletes += n;
+}
+
+static const ESStateCacheGL mockGL =
+{
+    mockBindBuffer,
+    mockBindVertexArray,
+    mockUseProgram,
+    mockEnableVertexAttribArray,
+    mockDisableVertexAttribArray,
+    mockVertexAttribDivisor,
+    mockViewport,
+    mockActiveTextureUnit,
+    mockBindTexture,
+    mockDeleteBuffers,
+    mockDeleteVertexArrays,
+};
+
+// the mock and the cache's own issued counters have to agree
+static void CheckIssued( const ESStateCache *cache )
+{
+    int i;
+    
+    for( i = 0; i < ES_STATE_NUM_CALLS; i++ )
+    {
+        ES_CHECK( cache->issued[i] == ( unsigned int ) mockCalls[i] );
+    }
+}
+
+static void TestBindings( ESStateCache *cache )
+{
+    esStateUseProgram( cache, 3 );
+    esStateUseProgram( cache, 3 );
+    esStateUseProgram( cache, 4 );
+    ES_CHECK( mockCalls[ES_STATE_USE_PROGRAM] == 2 );
+    ES_CHECK( cache->elided[ES_STATE_USE_PROGRAM] == 1 );
+    
+    esStateBindBuffer( cache, GL_ARRAY_BUFFER, 5 );
+    esStateBindBuffer( cache, GL_ARRAY_BUFFER, 5 );
+    esStateBindBuffer( cache, GL_ELEMENT_ARRAY_BUFFER, 5 );
+    ES_CHECK( mockCalls[ES_STATE_BIND_BUFFER] == 2 );
+    
+    // Untracked targets always reach GL
+    esStateBindBuffer( cache, GL_UNIFORM_BUFFER, 6 );
+    esStateBindBuffer( cache, GL_UNIFORM_BUFFER, 6 );
+    ES_CHECK( mockCalls[ES_STATE_BIND_BUFFER] == 4 );
+    
+    // Something else bound GL_ARRAY_BUFFER
+    esStateInvalidateBinding( cache, GL_ARRAY_BUFFER );
+    esStateBindBuffer( cache, GL_ARRAY_BUFFER, 5 );
+    ES_CHECK( mockCalls[ES_STATE_BIND_BUFFER] == 5 );
+    
+    // Deleting a bound buffer leaves 0 bound
+    esStateDeleteBuffers( cache, 1, ( GLuint[] ){ 5 } );
+    esStateBindBuffer( cache, GL_ARRAY_BUFFER, 0 );
+    esStateBindBuffer( cache, GL_ELEMENT_ARRAY_BUFFER, 0 );
+    ES_CHECK( mockCalls[ES_STATE_BIND_BUFFER] == 5 );
+    ES_CHECK( mockDeletes == 1 );
+    
+    esStateViewport( cache, 0, 0, 64, 64 );
+    esStateViewport( cache, 0, 0, 64, 64 );
+    esStateViewport( cache, 0, 0, 64, 32 );
+    ES_CHECK( mockCalls[ES_STATE_VIEWPORT] == 2 );
+    
+    CheckIssued( cache );
+}
+
+static void TestVertexArrays( ESStateCache *cache )
+{
+    esStateBindVertexArray( cache, 1 );
+    esStateBindBuffer( cache, GL_ELEMENT_ARRAY_BUFFER, 9 );
+    esStateSetVertexAttribArrays( cache, 0x5, 3 );
+    ES_CHECK( mockCalls[ES_STATE_ENABLE_ATTRIB] == 2 );
+    ES_CHECK( mockCalls[ES_STATE_DISABLE_ATTRIB] == 1 );
+    
+    // Only attribute 1 changes
+    esStateSetVertexAttribArrays( cache, 0x7, 3 );
+    ES_CHECK( mockCalls[ES_STATE_ENABLE_ATTRIB] == 3 );
+    ES_CHECK( mockCalls[ES_STATE_DISABLE_ATTRIB] == 1 );
+    
+    esStateVertexAttribDivisor( cache, 2, 1 );
+    esStateVertexAttribDivisor( cache, 2, 1 );
+    ES_CHECK( mockCalls[ES_STATE_ATTRIB_DIVISOR] == 1 );
+    
+    // Binding the same VAO keeps its state, another one brings its own
+    esStateBindVertexArray( cache, 1 );
+    esStateBindBuffer( cache, GL_ELEMENT_ARRAY_BUFFER, 9 );
+    ES_CHECK( mockCalls[ES_STATE_BIND_VERTEX_ARRAY] == 1 );
+    ES_CHECK( mockCalls[ES_STATE_BIND_BUFFER] == 6 );
+    
+    esStateBindVertexArray( cache, 2 );
+    esStateBindBuffer( cache, GL_ELEMENT_ARRAY_BUFFER, 9 );
+    esStateSetVertexAttribArrays( cache, 0x7, 3 );
+    esStateVertexAttribDivisor( cache, 2, 1 );
+    ES_CHECK( mockCalls[ES_STATE_BIND_BUFFER] == 7 );
+    ES_CHECK( mockCalls[ES_STATE_ENABLE_ATTRIB] == 6 );
+    ES_CHECK( mockCalls[ES_STATE_ATTRIB_DIVISOR] == 2 );
+    
+    // Attributes past ES_STATE_MAX_ATTRIBS are not tracked
+    esStateEnableVertexAttribArray( cache, ES_STATE_MAX_ATTRIBS );
+    esStateEnableVertexAttribArray( cache, ES_STATE_MAX_ATTRIBS );
+    ES_CHECK( mockCalls[ES_STATE_ENABLE_ATTRIB] == 8 );
+    
+    // Deleting the bound VAO falls back to VAO 0
+    esStateDeleteVertexArrays( cache, 1, ( GLuint[] ){ 2 } );
+    esStateBindVertexArray( cache, 0 );
+    ES_CHECK( mockCalls[ES_STATE_BIND_VERTEX_ARRAY] == 2 );
+    
+    CheckIssued( cache );
+}
+
+static void TestTextures( ESStateCache *cache )
+{
+    esStateBindTexture( cache, 0, GL_TEXTURE_2D, 10 );
+    esStateBindTexture( cache, 1, GL_TEXTURE_2D, 11 );
+    esStateBindTexture( cache, 0, GL_TEXTURE_2D, 10 );
+    esStateBindTexture( cache, 1, GL_TEXTURE_2D, 11 );
+    ES_CHECK( mockCalls[ES_STATE_BIND_TEXTURE] == 2 );
+    ES_CHECK( mockCalls[ES_STATE_ACTIVE_TEXTURE] == 2 );
+    ES_CHECK( mockActiveTexture == GL_TEXTURE1 );
+    
+    // Same unit, new texture: no unit switch
+    esStateBindTexture( cache, 1, GL_TEXTURE_2D, 12 );
+    ES_CHECK( mockCalls[ES_STATE_BIND_TEXTURE] == 3 );
+    ES_CHECK( mockCalls[ES_STATE_ACTIVE_TEXTURE] == 2 );
+    
+    // Other targets are always forwarded
+    esStateBindTexture( cache, 1, GL_TEXTURE_3D, 13 );
+    esStateBindTexture( cache, 1, GL_TEXTURE_3D, 13 );
+    ES_CHECK( mockCalls[ES_STATE_BIND_TEXTURE] == 5 );
+    
+    CheckIssued( cache );
+}
+
+int main( void )
+{
+    ESStateCache cache;
+    int i;
+    
+    esStateCacheSetBackend( &mockGL );
+    esStateCacheInit( &cache );
+    
+    TestBindings( &cache );
+    TestVertexArrays( &cache );
+    TestTextures( &cache );
+    
+    // After invalidation nothing is assumed
+    for( i = 0; i < ES_STATE_NUM_CALLS; i++ )
+    {
+        mockCalls[i] = 0;
+    }
+    
+    esStateCacheResetCounters( &cache );
+    esStateCacheInvalidate( &cache );
+    esStateUseProgram( &cache, 4 );
+    esStateBindVertexArray( &cache, 0 );
+    esStateViewport( &cache, 0, 0, 64, 32 );
+    esStateBindTexture( &cache, 1, GL_TEXTURE_2D, 12 );
+    ES_CHECK( mockCalls[ES_STATE_USE_PROGRAM] == 1 );
+    ES_CHECK( mockCalls[ES_STATE_BIND_VERTEX_ARRAY] == 1 );
+    ES_CHECK( mockCalls[ES_STATE_VIEWPORT] == 1 );
+    ES_CHECK( mockCalls[ES_STATE_ACTIVE_TEXTURE] == 1 );
+    ES_CHECK( mockCalls[ES_STATE_BIND_TEXTURE] == 1 );
+    CheckIssued( &cache );
+    
+    esStateCacheSetBackend( NULL );
+    
+    return ES_TEST_RESULT();
+}
@@ -0,0 +1,44 @@
+//
+//  ESTest.h
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+
+#ifndef ESTest_h
+#define ESTest_h
+
+#include <math.h>
+#include <stdio.h>
+
+// failed checks so far, main returns ES_TEST_RESULT()
+static int esTestFailures;
+
+// report a failed condition and carry on, so one run shows every failure
+#define ES_CHECK( cond ) \
+    do \
+    { \
+        if( !( cond ) ) \
+        { \
+            fprintf( stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond ); \
+            esTestFailures++; \
+        } \
+    } while( 0 )
+
+#define ES_CHECK_NEAR( a, b, eps ) \
+    do \
+    { \
+        double esTestA = ( a ); \
+        double esTestB = ( b ); \
+        \
+        if( !( fabs( esTestA - esTestB ) <= ( eps ) ) ) \
+        { \
+            fprintf( stderr, "%s:%d: check failed: %s = %g, %s = %g\n", __FILE__, __LINE__, #a, esTestA, #b, esTestB ); \
+            esTestFailures++; \
+        } \
+    } while( 0 )
+
+#define ES_TEST_RESULT() ( esTestFailures == 0 ? 0 : 1 )
+
+#endif /* ESTest_h */
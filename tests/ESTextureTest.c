@@ -0,0 +1,425 @@
+//
+//  ESTextureTest.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  Mip filters on gradients and noise, the SIMD RGBA kernels against scalar
+//  references, and the skyline packer's rectangles for overlap and bounds.
+//
+
+#include "ESTexture.h"
+#include "ESTest.h"
+#include <stdlib.h>
+#include <string.h>
+
+// the filter ESTexture.c documents: 8 taps of a half-rate sinc under a Kaiser window, alpha 4
+#define KAISER_TAPS  8
+#define KAISER_ALPHA 4.0
+
+// 3 per pixel across, 5 per row up and 20 per channel, fits a byte up to 32 x 16
+static GLubyte Gradient( int x, int y, int c )
+{
+    return ( GLubyte ) ( 3 * x + 5 * y + 20 * c );
+}
+
+static void FillGradient( GLubyte *pixels, int width, int height, int channels )
+{
+    int x, y, c;
+    
+    for( y = 0; y < height; y++ )
+    {
+        for( x = 0; x < width; x++ )
+        {
+            for( c = 0; c < channels; c++ )
+            {
+                pixels[ ( y * width + x ) * channels + c ] = Gradient( x, y, c );
+            }
+        }
+    }
+}
+
+static void FillNoise( GLubyte *pixels, size_t size, unsigned int seed )
+{
+    size_t i;
+    
+    for( i = 0; i < size; i++ )
+    {
+        seed = seed * 1664525u + 1013904223u;
+        pixels[i] = ( GLubyte ) ( seed >> 24 );
+    }
+}
+
+// channel c of an interleaved image as a 1 channel image
+static void ExtractChannel( GLubyte *plane, const GLubyte *pixels, int numPixels, int channels, int c )
+{
+    int i;
+    
+    for( i = 0; i < numPixels; i++ )
+    {
+        plane[i] = pixels[ i * channels + c ];
+    }
+}
+
+// The box of four gradient pixels is the gradient at their center, 2x + 0.5, 2y + 0.5
+static void TestBoxGradient( void )
+{
+    GLubyte src[32 * 16 * 4];
+    GLubyte dest[16 * 8 * 4];
+    int channels;
+    
+    for( channels = 1; channels <= 4; channels++ )
+    {
+        int x, y, c, mismatches = 0;
+        
+        FillGradient( src, 32, 16, channels );
+        esTextureDownsample( dest, src, 32, 16, channels, ES_MIP_BOX );
+        
+        for( y = 0; y < 8; y++ )
+        {
+            for( x = 0; x < 16; x++ )
+            {
+                for( c = 0; c < channels; c++ )
+                {
+                    mismatches += dest[ ( y * 16 + x ) * channels + c ] != 6 * x + 10 * y + 4 + 20 * c;
+                }
+            }
+        }
+        
+        ES_CHECK( mismatches == 0 );
+    }
+}
+
+// Symmetric and normalized, the Kaiser filter reproduces a linear ramp wherever no tap is clamped
+static void TestKaiserGradient( void )
+{
+    GLubyte src[32 * 16 * 4];
+    GLubyte dest[16 * 8 * 4];
+    int channels;
+    
+    for( channels = 1; channels <= 4; channels++ )
+    {
+        int x, y, c, worst = 0;
+        
+        FillGradient( src, 32, 16, channels );
+        esTextureDownsample( dest, src, 32, 16, channels, ES_MIP_KAISER );
+        
+        // taps reach from 2x - 3 to 2x + 4
+        for( y = 2; 2 * y + 4 < 16; y++ )
+        {
+            for( x = 2; 2 * x + 4 < 32; x++ )
+            {
+                for( c = 0; c < channels; c++ )
+                {
+                    int diff = abs( dest[ ( y * 16 + x ) * channels + c ] - ( 6 * x + 10 * y + 4 + 20 * c ) );
+                    
+                    worst = diff > worst ? diff : worst;
+                }
+            }
+        }
+        
+        ES_CHECK( worst == 0 );
+    }
+}
+
+// A flat image stays flat through every level, borders included
+static void TestFlatChain( ESMipFilter filter )
+{
+    GLubyte src[37 * 20 * 3];
+    GLubyte *chain = malloc( esTextureMipChainSize( 37, 20, 3 ) );
+    ESMipLevel levels[ES_TEXTURE_MAX_LEVELS];
+    size_t total = 0;
+    int numLevels, level, flat = 1;
+    
+    memset( src, 200, sizeof( src ) );
+    
+    numLevels = esTextureBuildMipChain( src, 37, 20, 3, filter, chain, levels );
+    
+    ES_CHECK( numLevels == esTextureMipCount( 37, 20 ) );
+    ES_CHECK( numLevels == 6 );
+    ES_CHECK( levels[0].pixels == src );
+    ES_CHECK( levels[numLevels - 1].width == 1 && levels[numLevels - 1].height == 1 );
+    
+    for( level = 1; level < numLevels; level++ )
+    {
+        size_t size = ( size_t ) levels[level].width * levels[level].height * 3;
+        size_t i;
+        
+        ES_CHECK( levels[level].width == ( levels[level - 1].width > 1 ? levels[level - 1].width / 2 : 1 ) );
+        ES_CHECK( levels[level].height == ( levels[level - 1].height > 1 ? levels[level - 1].height / 2 : 1 ) );
+        ES_CHECK( levels[level].pixels == chain + total );
+        
+        for( i = 0; i < size; i++ )
+        {
+            flat &= levels[level].pixels[i] == 200;
+        }
+        
+        total += size;
+    }
+    
+    ES_CHECK( flat );
+    ES_CHECK( total == esTextureMipChainSize( 37, 20, 3 ) );
+    
+    free( chain );
+}
+
+// The SSE2/NEON box kernel only runs on RGBA, the one channel path is scalar: both must agree exactly.
+// Odd sizes leave a scalar tail in every row and a last source row and column that are dropped
+static void TestBoxSimd( void )
+{
+    enum { W = 45, H = 23, DW = W / 2, DH = H / 2 };
+    GLubyte src[W * H * 4];
+    GLubyte dest[DW * DH * 4];
+    GLubyte plane[W * H];
+    GLubyte planeDest[DW * DH];
+    int c, i, mismatches = 0;
+    
+    FillNoise( src, sizeof( src ), 1 );
+    esTextureDownsample( dest, src, W, H, 4, ES_MIP_BOX );
+    
+    for( c = 0; c < 4; c++ )
+    {
+        ExtractChannel( plane, src, W * H, 4, c );
+        esTextureDownsample( planeDest, plane, W, H, 1, ES_MIP_BOX );
+        
+        for( i = 0; i < DW * DH; i++ )
+        {
+            mismatches += planeDest[i] != dest[ i * 4 + c ];
+        }
+    }
+    
+    ES_CHECK( mismatches == 0 );
+}
+
+static double BesselI0( double x )
+{
+    double sum = 1.0, term = 1.0;
+    int k;
+    
+    for( k = 1; k < 64; k++ )
+    {
+        term *= ( x / ( 2.0 * k ) ) * ( x / ( 2.0 * k ) );
+        sum  += term;
+    }
+    
+    return sum;
+}
+
+static int Clamp( int i, int size )
+{
+    return i < 0 ? 0 : ( i >= size ? size - 1 : i );
+}
+
+// Scalar double precision Kaiser downsample of one channel, both dimensions > 1
+static void KaiserReference( double *dest, const GLubyte *src, int width, int height )
+{
+    int destWidth = width / 2, destHeight = height / 2;
+    double weights[KAISER_TAPS], total = 0.0;
+    int x, y, i, j;
+    
+    for( i = 0; i < KAISER_TAPS; i++ )
+    {
+        double d = i - ( KAISER_TAPS - 1 ) * 0.5;
+        double t = d / ( KAISER_TAPS * 0.5 );
+        double s = d != 0.0 ? sin( M_PI * d * 0.5 ) / ( M_PI * d * 0.5 ) : 1.0;
+        
+        weights[i] = s * BesselI0( KAISER_ALPHA * sqrt( 1.0 - t * t ) );
+        total += weights[i];
+    }
+    
+    for( y = 0; y < destHeight; y++ )
+    {
+        for( x = 0; x < destWidth; x++ )
+        {
+            double sum = 0.0;
+            
+            for( j = 0; j < KAISER_TAPS; j++ )
+            {
+                for( i = 0; i < KAISER_TAPS; i++ )
+                {
+                    int sx = Clamp( 2 * x - KAISER_TAPS / 2 + 1 + i, width );
+                    int sy = Clamp( 2 * y - KAISER_TAPS / 2 + 1 + j, height );
+                    
+                    sum += weights[i] * weights[j] * src[ sy * width + sx ];
+                }
+            }
+            
+            dest[ y * destWidth + x ] = sum / ( total * total );
+        }
+    }
+}
+
+// The Kaiser vertical pass is vectorized for every channel count, check each channel of an
+// RGBA and a 3 channel image against the scalar reference. Float accumulation and the
+// SIMD round-to-even may move a result by one step
+static void TestKaiserSimd( void )
+{
+    enum { W = 45, H = 23, DW = W / 2, DH = H / 2 };
+    GLubyte src[W * H * 4];
+    GLubyte dest[DW * DH * 4];
+    GLubyte plane[W * H];
+    double reference[DW * DH];
+    int channels;
+    
+    for( channels = 3; channels <= 4; channels++ )
+    {
+        int c, i, worst = 0;
+        
+        FillNoise( src, sizeof( src ), 7 + channels );
+        esTextureDownsample( dest, src, W, H, channels, ES_MIP_KAISER );
+        
+        for( c = 0; c < channels; c++ )
+        {
+            ExtractChannel( plane, src, W * H, channels, c );
+            KaiserReference( reference, plane, W, H );
+            
+            for( i = 0; i < DW * DH; i++ )
+            {
+                double expected = reference[i] < 0.0 ? 0.0 : ( reference[i] > 255.0 ? 255.0 : reference[i] );
+                int diff = abs( dest[ i * channels + c ] - ( int ) floor( expected + 0.5 ) );
+                
+                worst = diff > worst ? diff : worst;
+            }
+        }
+        
+        ES_CHECK( worst <= 1 );
+    }
+}
+
+// Mark every rectangle, padding included, on a coverage grid: nothing may be marked twice
+// and nothing may leave the atlas
+static void CheckPacking( const ESAtlas *atlas, const ESAtlasRect *rects, const int *sizes, int count, int numPacked )
+{
+    unsigned char *coverage = calloc( ( size_t ) atlas->width * atlas->height, 1 );
+    long area = 0;
+    int placed = 0, inBounds = 1, overlaps = 0, sizesMatch = 1, uvsMatch = 1;
+    int i, x, y;
+    
+    for( i = 0; i < count; i++ )
+    {
+        const ESAtlasRect *rect = &rects[i];
+        int right, top;
+        
+        if( rect->width == 0 )
+        {
+            continue;
+        }
+        
+        placed++;
+        right = rect->x + rect->width + atlas->padding;
+        top   = rect->y + rect->height + atlas->padding;
+        
+        sizesMatch &= rect->width == sizes[2 * i] && rect->height == sizes[2 * i + 1];
+        uvsMatch   &= rect->u0 == ( GLfloat ) rect->x / atlas->width &&
+                      rect->v0 == ( GLfloat ) rect->y / atlas->height &&
+                      rect->u1 == ( GLfloat ) ( rect->x + rect->width ) / atlas->width &&
+                      rect->v1 == ( GLfloat ) ( rect->y + rect->height ) / atlas->height;
+        
+        if( rect->x < 0 || rect->y < 0 || right > atlas->width || top > atlas->height )
+        {
+            inBounds = 0;
+            continue;
+        }
+        
+        for( y = rect->y; y < top; y++ )
+        {
+            for( x = rect->x; x < right; x++ )
+            {
+                overlaps += coverage[ y * atlas->width + x ]++ != 0;
+            }
+        }
+        
+        area += ( long ) ( right - rect->x ) * ( top - rect->y );
+    }
+    
+    ES_CHECK( placed == numPacked );
+    ES_CHECK( inBounds );
+    ES_CHECK( overlaps == 0 );
+    ES_CHECK( sizesMatch );
+    ES_CHECK( uvsMatch );
+    ES_CHECK( area == atlas->usedArea );
+    
+    free( coverage );
+}
+
+static void TestAtlasRandom( void )
+{
+    enum { COUNT = 400 };
+    static int sizes[2 * COUNT];
+    static ESAtlasRect rects[COUNT];
+    unsigned int seed = 3;
+    ESAtlas atlas;
+    int i, numPacked;
+    
+    for( i = 0; i < 2 * COUNT; i++ )
+    {
+        seed = seed * 1664525u + 1013904223u;
+        sizes[i] = 1 + ( int ) ( ( seed >> 16 ) % 40 );
+    }
+    
+    // too small for all of them, so the rejections are checked too
+    ES_CHECK( esAtlasInit( &atlas, 256, 200, 2 ) );
+    numPacked = esAtlasPackBatch( &atlas, sizes, COUNT, rects );
+    
+    ES_CHECK( numPacked > 0 && numPacked < COUNT );
+    ES_CHECK( esAtlasOccupancy( &atlas ) > 0.7f );
+    CheckPacking( &atlas, rects, sizes, COUNT, numPacked );
+    
+    // one at a time in arrival order, without padding
+    esAtlasDestroy( &atlas );
+    ES_CHECK( esAtlasInit( &atlas, 300, 300, 0 ) );
+    
+    for( i = 0, numPacked = 0; i < COUNT; i++ )
+    {
+        numPacked += esAtlasPack( &atlas, sizes[2 * i], sizes[2 * i + 1], &rects[i] );
+    }
+    
+    CheckPacking( &atlas, rects, sizes, COUNT, numPacked );
+    
+    esAtlasDestroy( &atlas );
+}
+
+// Equal tiles that exactly cover the atlas all fit, and nothing more does
+static void TestAtlasFull( void )
+{
+    int sizes[2 * 16];
+    ESAtlasRect rects[16];
+    ESAtlasRect extra;
+    ESAtlas atlas;
+    int i;
+    
+    for( i = 0; i < 2 * 16; i++ )
+    {
+        sizes[i] = 16;
+    }
+    
+    ES_CHECK( esAtlasInit( &atlas, 64, 64, 0 ) );
+    ES_CHECK( esAtlasPackBatch( &atlas, sizes, 16, rects ) == 16 );
+    ES_CHECK_NEAR( esAtlasOccupancy( &atlas ), 1.0, 1e-6 );
+    CheckPacking( &atlas, rects, sizes, 16, 16 );
+    
+    ES_CHECK( !esAtlasPack( &atlas, 1, 1, &extra ) );
+    ES_CHECK( extra.width == 0 && extra.height == 0 );
+    ES_CHECK( !esAtlasPack( &atlas, 0, 4, &extra ) );
+    
+    esAtlasReset( &atlas );
+    ES_CHECK( esAtlasPack( &atlas, 64, 64, &extra ) );
+    ES_CHECK( !esAtlasPack( &atlas, 65, 1, &extra ) );
+    
+    esAtlasDestroy( &atlas );
+}
+
+int main( void )
+{
+    TestBoxGradient();
+    TestKaiserGradient();
+    TestFlatChain( ES_MIP_BOX );
+    TestFlatChain( ES_MIP_KAISER );
+    TestBoxSimd();
+    TestKaiserSimd();
+    TestAtlasRandom();
+    TestAtlasFull();
+    
+    return ES_TEST_RESULT();
+}
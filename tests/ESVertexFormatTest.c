@@ -0,0 +1,245 @@
+//
+//  ESVertexFormatTest.c
+//  MyOpenGLES
+//
+//  Created by 姚隽楠 on 2026/10/17.
+//  Copyright © 2026 姚隽楠. All rights reserved.
+//
+//  The float to half, snorm16, unorm16 and 2_10_10_10_REV conversions of
+//  esVertexFormatPack: signed zeros, denormals, the largest half and the
+//  overflow past it, ties to even, and -1, 0 and 1 surviving the round trip.
+//
+
+#include "ESVertexFormat.h"
+#include "ESTest.h"
+#include <string.h>
+
+#define NUM_FINITE_HALVES 0x7C00
+
+// stride 8: three halves and the 1.0 pad
+static ESVertexFormat halfFormat;
+static GLfloat positions[NUM_FINITE_HALVES * 3];
+static GLushort packed[NUM_FINITE_HALVES * 4];
+
+static float HalfToFloat( GLushort half )
+{
+    int exponent = ( half >> 10 ) & 0x1F;
+    float magnitude = exponent == 0 ? ldexpf( ( float ) ( half & 0x3FF ), -24 ) :
+                                      ldexpf( ( float ) ( 0x400 | ( half & 0x3FF ) ), exponent - 25 );
+    
+    return half & 0x8000 ? -magnitude : magnitude;
+}
+
+static GLushort PackHalf( GLfloat value )
+{
+    GLfloat position[3];
+    GLushort vertex[4];
+    
+    position[0] = value;
+    position[1] = 0.0f;
+    position[2] = 0.0f;
+    esVertexFormatPack( &halfFormat, vertex, 1, position, NULL, NULL );
+    
+    return vertex[0];
+}
+
+static void CheckHalfValues( void )
+{
+    GLfloat nan;
+    unsigned int nanBits = 0x7FC00000;
+    
+    memcpy( &nan, &nanBits, sizeof( nan ) );
+    
+    ES_CHECK( PackHalf( 0.0f ) == 0x0000 );
+    ES_CHECK( PackHalf( -0.0f ) == 0x8000 );
+    ES_CHECK( PackHalf( 1.0f ) == 0x3C00 );
+    ES_CHECK( PackHalf( -2.0f ) == 0xC000 );
+    
+    // denormals count units of 2^-24, half a unit ties to the even one
+    ES_CHECK( PackHalf( ldexpf( 1.0f, -24 ) ) == 0x0001 );
+    ES_CHECK( PackHalf( -ldexpf( 1.0f, -24 ) ) == 0x8001 );
+    ES_CHECK( PackHalf( ldexpf( 1.0f, -25 ) ) == 0x0000 );
+    ES_CHECK( PackHalf( ldexpf( 3.0f, -25 ) ) == 0x0002 );
+    ES_CHECK( PackHalf( ldexpf( 1023.0f, -24 ) ) == 0x03FF );
+    ES_CHECK( PackHalf( ldexpf( 1.0f, -14 ) ) == 0x0400 );
+    // past the last denormal and rounded up into the first normal
+    ES_CHECK( PackHalf( ldexpf( 2047.0f, -25 ) ) == 0x0400 );
+    ES_CHECK( PackHalf( ldexpf( 1.0f, -30 ) ) == 0x0000 );
+    
+    // 65504 is the largest half, 65520 is halfway to the next step and rounds to infinity
+    ES_CHECK( PackHalf( 65504.0f ) == 0x7BFF );
+    ES_CHECK( PackHalf( 65519.0f ) == 0x7BFF );
+    ES_CHECK( PackHalf( 65520.0f ) == 0x7C00 );
+    ES_CHECK( PackHalf( -65520.0f ) == 0xFC00 );
+    ES_CHECK( PackHalf( 1e10f ) == 0x7C00 );
+    ES_CHECK( PackHalf( HUGE_VALF ) == 0x7C00 );
+    ES_CHECK( PackHalf( -HUGE_VALF ) == 0xFC00 );
+    ES_CHECK( ( PackHalf( nan ) & 0x7C00 ) == 0x7C00 && ( PackHalf( nan ) & 0x3FF ) != 0 );
+    
+    // ties around 1.0, where a half step is 2^-10
+    ES_CHECK( PackHalf( 1.0f + ldexpf( 1.0f, -11 ) ) == 0x3C00 );
+    ES_CHECK( PackHalf( 1.0f + ldexpf( 3.0f, -11 ) ) == 0x3C02 );
+    ES_CHECK( PackHalf( 1.0f + ldexpf( 1.0f, -11 ) + ldexpf( 1.0f, -20 ) ) == 0x3C01 );
+    ES_CHECK( PackHalf( -1.0f - ldexpf( 3.0f, -11 ) ) == 0xBC02 );
+}
+
+// Every finite half round-trips, the midpoints to the next half go to the even one,
+// and a float step off a midpoint goes to the nearer half
+static void CheckHalfExhaustive( void )
+{
+    int mismatches[4] = { 0, 0, 0, 0 };
+    int pass;
+    int i;
+    
+    for( pass = 0; pass < 4; pass++ )
+    {
+        for( i = 0; i < NUM_FINITE_HALVES; i++ )
+        {
+            float value = HalfToFloat( ( GLushort ) i );
+            float next  = i + 1 < NUM_FINITE_HALVES ? HalfToFloat( ( GLushort ) ( i + 1 ) ) : 65536.0f;
+            float mid   = value + ( next - value ) * 0.5f;
+            
+            positions[i * 3 + 0] = pass == 0 ? value : pass == 1 ? mid : pass == 2 ? nextafterf( mid, 0.0f ) :
+                                                                       nextafterf( mid, HUGE_VALF );
+            // the same magnitude negated
+            positions[i * 3 + 1] = -positions[i * 3 + 0];
+            positions[i * 3 + 2] = 0.0f;
+        }
+        
+        esVertexFormatPack( &halfFormat, packed, NUM_FINITE_HALVES, positions, NULL, NULL );
+        
+        for( i = 0; i < NUM_FINITE_HALVES; i++ )
+        {
+            int expected = pass == 0 ? i : pass == 1 ? ( i & 1 ? i + 1 : i ) : pass == 2 ? i : i + 1;
+            
+            if( packed[i * 4 + 0] != expected || packed[i * 4 + 1] != ( expected | 0x8000 ) ||
+                packed[i * 4 + 2] != 0 || packed[i * 4 + 3] != 0x3C00 )
+            {
+                mismatches[pass]++;
+            }
+        }
+    }
+    
+    ES_CHECK( mismatches[0] == 0 );
+    ES_CHECK( mismatches[1] == 0 );
+    ES_CHECK( mismatches[2] == 0 );
+    ES_CHECK( mismatches[3] == 0 );
+}
+
+static void CheckSnorm16( void )
+{
+    // Scale 4: positions in [ -4, 4 ] are stored divided by 4, beyond that they clamp.
+    // -1, 0, 1 once scaled, then clamped, then 0.5 ties to the even 16384
+    static const GLfloat positions[9] = { -4.0f, 0.0f, 4.0f, -16.0f, 16.0f, 40.0f, 2.0f, -1.0f, 0.0f };
+    static const GLshort expected[9] = { -32767, 0, 32767, -32767, 32767, 32767, 16384, -8192, 0 };
+    ESVertexFormat format;
+    GLshort vertices[3][4];
+    int i;
+    
+    ES_CHECK( esVertexFormatInit( &format, ES_ATTRIB_SNORM16, ES_ATTRIB_NONE, ES_ATTRIB_NONE, 4.0f ) );
+    ES_CHECK( format.stride == 8 );
+    
+    esVertexFormatPack( &format, vertices, 3, positions, NULL, NULL );
+    
+    for( i = 0; i < 9; i++ )
+    {
+        ES_CHECK( vertices[i / 3][i % 3] == expected[i] );
+    }
+    
+    // the w pad is 1.0, not divided by the scale
+    ES_CHECK( vertices[0][3] == 32767 && vertices[1][3] == 32767 && vertices[2][3] == 32767 );
+    
+    // -1, 0 and 1 come back exactly through GL's snorm rule max( c / 32767, -1 ) and the scale
+    for( i = 0; i < 3; i++ )
+    {
+        ES_CHECK( vertices[0][i] / 32767.0f * 4.0f == positions[i] );
+    }
+}
+
+static GLint SignExtend10( GLuint bits )
+{
+    return bits & 0x200 ? ( GLint ) bits - 0x400 : ( GLint ) bits;
+}
+
+static void CheckNormal2101010( void )
+{
+    static const GLfloat normals[] =
+    {
+        -1.0f, 0.0f, 1.0f,
+        1.0f, -1.0f, 0.0f,
+        0.0f, 1.0f, -1.0f,
+        // clamped to [ -1, 1 ], 0.5 * 511 ties to the even 256
+        2.0f, -2.0f, 0.5f,
+    };
+    static const GLint expected[] = { -511, 0, 511, 511, -511, 0, 0, 511, -511, 511, -511, 256 };
+    ESVertexFormat format;
+    GLuint vertices[4];
+    int i;
+    
+    ES_CHECK( esVertexFormatInit( &format, ES_ATTRIB_NONE, ES_ATTRIB_INT_2_10_10_10_REV, ES_ATTRIB_NONE, 1.0f ) );
+    ES_CHECK( format.stride == 4 );
+    
+    esVertexFormatPack( &format, vertices, 4, NULL, normals, NULL );
+    
+    for( i = 0; i < 12; i++ )
+    {
+        GLint component = SignExtend10( ( vertices[i / 3] >> ( ( i % 3 ) * 10 ) ) & 0x3FF );
+        
+        ES_CHECK( component == expected[i] );
+        
+        if( i < 9 )
+        {
+            ES_CHECK( component / 511.0f == normals[i] );
+        }
+    }
+    
+    // w is 0
+    for( i = 0; i < 4; i++ )
+    {
+        ES_CHECK( ( vertices[i] >> 30 ) == 0 );
+    }
+}
+
+static void CheckUnorm16( void )
+{
+    static const GLfloat texCoords[] = { 0.0f, 1.0f, 0.5f, -1.0f, 2.0f, 0.25f };
+    static const GLushort expected[] = { 0, 65535, 32768, 0, 65535, 16384 };
+    ESVertexFormat format;
+    GLushort vertices[6];
+    int i;
+    
+    ES_CHECK( esVertexFormatInit( &format, ES_ATTRIB_NONE, ES_ATTRIB_NONE, ES_ATTRIB_UNORM16, 1.0f ) );
+    ES_CHECK( format.stride == 4 );
+    
+    esVertexFormatPack( &format, vertices, 3, NULL, NULL, texCoords );
+    
+    for( i = 0; i < 6; i++ )
+    {
+        ES_CHECK( vertices[i] == expected[i] );
+    }
+}
+
+// the encodings an attribute can't take are refused
+static void CheckUnsupported( void )
+{
+    ESVertexFormat format;
+    
+    ES_CHECK( !esVertexFormatInit( &format, ES_ATTRIB_INT_2_10_10_10_REV, ES_ATTRIB_NONE, ES_ATTRIB_NONE, 1.0f ) );
+    ES_CHECK( !esVertexFormatInit( &format, ES_ATTRIB_NONE, ES_ATTRIB_HALF, ES_ATTRIB_NONE, 1.0f ) );
+    ES_CHECK( !esVertexFormatInit( &format, ES_ATTRIB_SNORM16, ES_ATTRIB_NONE, ES_ATTRIB_NONE, 0.0f ) );
+}
+
+int main( void )
+{
+    ES_CHECK( esVertexFormatInit( &halfFormat, ES_ATTRIB_HALF, ES_ATTRIB_NONE, ES_ATTRIB_NONE, 1.0f ) );
+    ES_CHECK( halfFormat.stride == 8 );
+    
+    CheckUnsupported();
+    CheckHalfValues();
+    CheckHalfExhaustive();
+    CheckSnorm16();
+    CheckNormal2101010();
+    CheckUnorm16();
+    
+    return ES_TEST_RESULT();
+}